@@ -28,8 +28,11 @@
 #include "bt_target.h"
 
 #include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <sstream>
 
@@ -728,46 +731,56 @@ bool bta_gattc_cache_load(tBTA_GATTC_CLCB* p_clcb) {
   bta_gattc_generate_cache_file_name(fname, sizeof(fname),
                                      p_clcb->p_srcb->server_bda);
 
-  FILE* fd = fopen(fname, "rb");
-  if (!fd) {
+  int fd;
+  OSI_NO_INTR(fd = open(fname, O_RDONLY | O_CLOEXEC));
+  if (fd == INVALID_FD) {
     LOG(ERROR) << __func__ << ": can't open GATT cache file " << fname
                << " for reading, error: " << strerror(errno);
     return false;
   }
 
-  uint16_t cache_ver = 0;
-  bool success = false;
-  uint16_t num_attr = 0;
-
-  if (fread(&cache_ver, sizeof(uint16_t), 1, fd) != 1) {
-    LOG(ERROR) << __func__ << ": can't read GATT cache version from: " << fname;
-    goto done;
-  }
-
-  if (cache_ver != GATT_CACHE_VERSION) {
-    LOG(ERROR) << __func__ << ": wrong GATT cache version: " << fname;
-    goto done;
+  // The file is a version, an attribute count and the attributes. It is
+  // mapped rather than read so that the attributes are deserialized in place.
+  const size_t header_len = 2 * sizeof(uint16_t);
+  struct stat st;
+  if (fstat(fd, &st) == -1 || (size_t)st.st_size < header_len) {
+    LOG(ERROR) << __func__ << ": can't read GATT cache header from: " << fname;
+    close(fd);
+    return false;
   }
 
-  if (fread(&num_attr, sizeof(uint16_t), 1, fd) != 1) {
-    LOG(ERROR) << __func__
-               << ": can't read number of GATT attributes: " << fname;
-    goto done;
+  size_t file_len = st.st_size;
+  void* map = mmap(NULL, file_len, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    LOG(ERROR) << __func__ << ": can't map GATT cache file " << fname
+               << ", error: " << strerror(errno);
+    return false;
   }
 
-  {
-    std::vector<StoredAttribute> attr(num_attr);
-
-    if (fread(attr.data(), sizeof(StoredAttribute), num_attr, fd) != num_attr) {
-      LOG(ERROR) << __func__ << "s: can't read GATT attributes: " << fname;
-      goto done;
-    }
-
-    p_clcb->p_srcb->gatt_database = gatt::Database::Deserialize(attr, &success);
-  }
+  const uint8_t* data = static_cast<const uint8_t*>(map);
+  uint16_t cache_ver = 0;
+  uint16_t num_attr = 0;
+  bool success = false;
+  memcpy(&cache_ver, data, sizeof(uint16_t));
+  memcpy(&num_attr, data + sizeof(uint16_t), sizeof(uint16_t));
 
-done:
-  fclose(fd);
+  if (cache_ver != GATT_CACHE_VERSION) {
+    LOG(ERROR) << __func__ << ": wrong GATT cache version: " << fname;
+  } else if (file_len < header_len + num_attr * sizeof(StoredAttribute)) {
+    LOG(ERROR) << __func__ << ": can't read GATT attributes: " << fname;
+  } else {
+    // The attributes start at a 4 byte offset, which satisfies the alignment
+    // of StoredAttribute.
+    static_assert(alignof(StoredAttribute) <= 2 * sizeof(uint16_t),
+                  "StoredAttribute is misaligned in the cache file");
+    const StoredAttribute* attr =
+        reinterpret_cast<const StoredAttribute*>(data + header_len);
+    p_clcb->p_srcb->gatt_database =
+        gatt::Database::Deserialize(attr, num_attr, &success);
+  }
+
+  munmap(map, file_len);
   return success;
 }
 
@@ -119,13 +119,24 @@ std::vector<StoredAttribute> Database::Serialize() const {
 
 Database Database::Deserialize(const std::vector<StoredAttribute>& nv_attr,
                                bool* success) {
+  return Deserialize(nv_attr.data(), nv_attr.size(), success);
+}
+
+Database Database::Deserialize(const StoredAttribute* nv_attr, size_t count,
+                               bool* success) {
   // clear reallocating
   Database result;
-  auto it = nv_attr.cbegin();
+  const StoredAttribute* it = nv_attr;
+  const StoredAttribute* end = nv_attr + count;
+
+  const StoredAttribute* services_end = it;
+  while (services_end != end && (services_end->type == PRIMARY_SERVICE ||
+                                 services_end->type == SECONDARY_SERVICE))
+    services_end++;
+  result.services.reserve(services_end - it);
 
-  for (; it != nv_attr.cend(); ++it) {
+  for (; it != services_end; ++it) {
     const auto& attr = *it;
-    if (attr.type != PRIMARY_SERVICE && attr.type != SECONDARY_SERVICE) break;
     result.services.emplace_back(
         Service{.handle = attr.handle,
                 .end_handle = attr.value.service.end_handle,
@@ -133,8 +144,28 @@ Database Database::Deserialize(const std::vector<StoredAttribute>& nv_attr,
                 .uuid = attr.value.service.uuid});
   }
 
+  // Size each service's vectors up front so that large databases are built
+  // without reallocating.
+  std::vector<std::pair<size_t, size_t>> counts(result.services.size());
+  size_t service_index = 0;
+  for (const StoredAttribute* p = it; p != end; p++) {
+    while (service_index < counts.size() &&
+           result.services[service_index].end_handle < p->handle)
+      service_index++;
+    if (service_index == counts.size()) break;
+
+    if (p->type == INCLUDE)
+      counts[service_index].first++;
+    else if (p->type == CHARACTERISTIC)
+      counts[service_index].second++;
+  }
+  for (size_t i = 0; i < counts.size(); i++) {
+    result.services[i].included_services.reserve(counts[i].first);
+    result.services[i].characteristics.reserve(counts[i].second);
+  }
+
   auto current_service_it = result.services.begin();
-  for (; it != nv_attr.cend(); it++) {
+  for (; it != end; it++) {
     const auto& attr = *it;
 
     // go to the service this attribute belongs to; attributes are stored in
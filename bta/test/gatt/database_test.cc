@@ -84,6 +84,39 @@ TEST(GattDatabaseTest, serialize_deserialize_binary_test) {
   EXPECT_EQ(serialized[4].type, SERVICE_1_CHAR_1_DESC_1_UUID);
 }
 
+/* This test makes sure that a database deserialized from a raw attribute
+ * array, as read from a mapped cache file, matches the original. */
+TEST(GattDatabaseTest, deserialize_from_array_test) {
+  DatabaseBuilder builder;
+  builder.AddService(0x0001, 0x000f, SERVICE_1_UUID, true);
+  builder.AddService(0x0010, 0x001f, SERVICE_2_UUID, false);
+  builder.AddIncludedService(0x0002, SERVICE_2_UUID, 0x0010, 0x001f);
+  builder.AddCharacteristic(0x0003, 0x0004, SERVICE_1_CHAR_1_UUID, 0x02);
+  builder.AddDescriptor(0x0005, SERVICE_1_CHAR_1_DESC_1_UUID);
+  builder.AddCharacteristic(0x0006, 0x0007, SERVICE_1_CHAR_1_UUID, 0x10);
+  builder.AddCharacteristic(0x0011, 0x0012, SERVICE_1_CHAR_1_UUID, 0x08);
+
+  Database db = builder.Build();
+  std::vector<StoredAttribute> serialized = db.Serialize();
+
+  bool success = false;
+  Database result =
+      Database::Deserialize(serialized.data(), serialized.size(), &success);
+  EXPECT_TRUE(success);
+  EXPECT_EQ(db.ToString(), result.ToString());
+
+  ASSERT_EQ(2U, result.Services().size());
+  EXPECT_EQ(1U, result.Services()[0].included_services.size());
+  EXPECT_EQ(2U, result.Services()[0].characteristics.size());
+  EXPECT_EQ(2U, result.Services()[0].characteristics.capacity());
+  EXPECT_EQ(1U, result.Services()[1].characteristics.size());
+
+  // Attributes past the last service are rejected.
+  serialized.push_back({0x0020, SERVICE_1_CHAR_1_DESC_1_UUID, {}});
+  Database::Deserialize(serialized.data(), serialized.size(), &success);
+  EXPECT_FALSE(success);
+}
+
 /* This test makes sure that Service represented in StoredAttribute have proper
  * binary format. */
 TEST(GattCacheTest, stored_attribute_to_binary_service_test) {
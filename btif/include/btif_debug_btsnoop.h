@@ -42,3 +42,6 @@ void btif_debug_btsnoop_init(void);
 
 // Writes btsnoop data base64 encoded to fd
 void btif_debug_btsnoop_dump(int fd);
+
+// Writes the recorded packets to fd as a btsnoop file
+void btif_debug_btsnoop_write(int fd);
@@ -69,6 +69,7 @@
 #include "device/include/device_iot_config.h"
 #include "btsnoop.h"
 #include "btsnoop_mem.h"
+#include "hci_layer.h"
 #include "common/address_obfuscator.h"
 #include "device/include/interop.h"
 #include "osi/include/alarm.h"
@@ -78,6 +79,8 @@
 #include "osi/include/osi.h"
 #include "osi/include/wakelock.h"
 #include "stack/gatt/connection_manager.h"
+#include "stack/include/btm_ble_api.h"
+#include "stack/include/l2c_api.h"
 #include "stack_manager.h"
 
 
@@ -340,6 +343,12 @@ static void dump(int fd, const char** arguments) {
                                                                         true);
       return;
     }
+#if (BTSNOOP_MEM == TRUE)
+    if (strncmp(arguments[0], "--btsnoop", 9) == 0) {
+      btif_debug_btsnoop_write(fd);
+      return;
+    }
+#endif
   }
   btif_debug_conn_dump(fd);
   btif_debug_bond_event_dump(fd);
@@ -354,6 +363,9 @@ static void dump(int fd, const char** arguments) {
   alarm_debug_dump(fd);
   HearingAid::DebugDump(fd);
   connection_manager::dump(fd);
+  BTM_BleRpaCacheDumpStatistics(fd);
+  L2CA_DumpTxStatistics(fd);
+  hci_layer_debug_dump(fd);
   bluetooth::bqr::DebugDump(fd);
 #if (BTSNOOP_MEM == TRUE)
   btif_debug_btsnoop_dump(fd);
@@ -25,6 +25,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
+#include <memory>
+#include <mutex>
 #include <unordered_set>
 #include "device/include/controller.h"
 
@@ -42,7 +45,9 @@
 #include "btif_gatt.h"
 #include "btif_gatt_util.h"
 #include "btif_storage.h"
+#include "osi/include/alarm.h"
 #include "osi/include/log.h"
+#include "osi/include/properties.h"
 #include "vendor_api.h"
 #include "stack_manager.h"
 
@@ -102,28 +107,80 @@ void bta_batch_scan_reports_cb(int client_id, tBTA_STATUS status,
                     num_records, std::move(data));
 }
 
-void bta_scan_results_cb_impl(RawAddress bd_addr, tBT_DEVICE_TYPE device_type,
-                              int8_t rssi, uint8_t addr_type,
-                              uint16_t ble_evt_type, uint8_t ble_primary_phy,
-                              uint8_t ble_secondary_phy,
-                              uint8_t ble_advertising_sid, int8_t ble_tx_power,
-                              uint16_t ble_periodic_adv_int,
-                              vector<uint8_t> value) {
+// Scan results are handed to the JNI thread in batches instead of one task
+// per advertisement. A batch is filled on the bta thread, and flushed once the
+// HCI events queued with it have been processed, or when the window set by
+// |SCAN_BATCH_WINDOW_PROPERTY| expires.
+struct ScanResultBatch {
+  std::vector<btgatt_scan_result_t> results;
+  std::vector<tBT_DEVICE_TYPE> device_types;
+  // Advertising data of all the results, back to back
+  std::vector<uint8_t> adv_data;
+
+  void clear() {
+    results.clear();
+    device_types.clear();
+    adv_data.clear();
+  }
+};
+
+constexpr char SCAN_BATCH_WINDOW_PROPERTY[] =
+    "persist.bluetooth.scan_batch_window_ms";
+// Large enough for a busy window, small enough that results aren't held back
+constexpr size_t SCAN_BATCH_MAX_RESULTS = 256;
+// Batches kept for reuse once delivered
+constexpr size_t SCAN_BATCH_MAX_FREE = 4;
+
+// Accessed on the bta thread only
+std::unique_ptr<ScanResultBatch> pending_batch;
+bool batch_flush_scheduled = false;
+period_ms_t batch_window_ms = 0;
+alarm_t* batch_window_alarm = nullptr;
+
+// Returned from the jni thread, taken on the bta thread
+std::mutex free_batches_mutex;
+std::vector<std::unique_ptr<ScanResultBatch>> free_batches;
+
+std::unique_ptr<ScanResultBatch> scan_result_batch_new() {
+  std::lock_guard<std::mutex> lock(free_batches_mutex);
+  if (free_batches.empty()) return std::make_unique<ScanResultBatch>();
+
+  std::unique_ptr<ScanResultBatch> batch = std::move(free_batches.back());
+  free_batches.pop_back();
+  return batch;
+}
+
+void scan_result_batch_release(std::unique_ptr<ScanResultBatch> batch) {
+  std::lock_guard<std::mutex> lock(free_batches_mutex);
+  if (free_batches.size() >= SCAN_BATCH_MAX_FREE) return;
+
+  batch->clear();
+  free_batches.push_back(std::move(batch));
+}
+
+// Updates the properties of the device that sent |result|. Returns false if
+// the result should be dropped.
+bool scan_result_update_device(const btgatt_scan_result_t& result,
+                               tBT_DEVICE_TYPE device_type,
+                               const uint8_t* adv_data) {
+  RawAddress bd_addr = result.bda;
   uint8_t remote_name_len;
   bt_device_type_t dev_type;
   bt_property_t properties;
 
   const uint8_t* p_eir_remote_name = AdvertiseDataParser::GetFieldByType(
-      value, BTM_EIR_COMPLETE_LOCAL_NAME_TYPE, &remote_name_len);
+      adv_data, result.adv_data_len, BTM_EIR_COMPLETE_LOCAL_NAME_TYPE,
+      &remote_name_len);
 
   if (p_eir_remote_name == NULL) {
     p_eir_remote_name = AdvertiseDataParser::GetFieldByType(
-        value, BT_EIR_SHORTENED_LOCAL_NAME_TYPE, &remote_name_len);
+        adv_data, result.adv_data_len, BT_EIR_SHORTENED_LOCAL_NAME_TYPE,
+        &remote_name_len);
   }
 
-  if ((addr_type != BLE_ADDR_RANDOM) || (p_eir_remote_name)) {
+  if ((result.addr_type != BLE_ADDR_RANDOM) || (p_eir_remote_name)) {
     if (!btif_address_cache_find(bd_addr)) {
-      btif_address_cache_add(bd_addr, addr_type);
+      btif_address_cache_add(bd_addr, result.addr_type);
 
       if (p_eir_remote_name) {
         if (remote_name_len > BD_NAME_LEN + 1 ||
@@ -132,7 +189,7 @@ void bta_scan_results_cb_impl(RawAddress bd_addr, tBT_DEVICE_TYPE device_type,
           LOG_INFO(LOG_TAG,
                    "%s dropping invalid packet - device name too long: %d",
                    __func__, remote_name_len);
-          return;
+          return false;
         }
 
         bt_bdname_t bdname;
@@ -152,10 +209,70 @@ void bta_scan_results_cb_impl(RawAddress bd_addr, tBT_DEVICE_TYPE device_type,
                              sizeof(dev_type), &dev_type);
   btif_storage_set_remote_device_property(&(bd_addr), &properties);
 
-  btif_storage_set_remote_addr_type(&bd_addr, addr_type);
-  HAL_CBACK(bt_gatt_callbacks, scanner->scan_result_cb, ble_evt_type, addr_type,
-            &bd_addr, ble_primary_phy, ble_secondary_phy, ble_advertising_sid,
-            ble_tx_power, rssi, ble_periodic_adv_int, std::move(value));
+  btif_storage_set_remote_addr_type(&bd_addr, result.addr_type);
+  return true;
+}
+
+void bta_scan_results_batch_cb_impl(std::unique_ptr<ScanResultBatch> batch) {
+  std::vector<btgatt_scan_result_t>& results = batch->results;
+
+  size_t kept = 0;
+  for (size_t i = 0; i < results.size(); i++) {
+    if (scan_result_update_device(
+            results[i], batch->device_types[i],
+            batch->adv_data.data() + results[i].adv_data_offset))
+      results[kept++] = results[i];
+  }
+  results.resize(kept);
+
+  if (bt_gatt_callbacks && bt_gatt_callbacks->scanner->scan_results_batch_cb) {
+    if (!results.empty())
+      HAL_CBACK(bt_gatt_callbacks, scanner->scan_results_batch_cb, results,
+                batch->adv_data);
+  } else {
+    for (btgatt_scan_result_t& r : results) {
+      const uint8_t* p_data = batch->adv_data.data() + r.adv_data_offset;
+      HAL_CBACK(bt_gatt_callbacks, scanner->scan_result_cb, r.event_type,
+                r.addr_type, &r.bda, r.primary_phy, r.secondary_phy,
+                r.advertising_sid, r.tx_power, r.rssi, r.periodic_adv_int,
+                vector<uint8_t>(p_data, p_data + r.adv_data_len));
+    }
+  }
+
+  scan_result_batch_release(std::move(batch));
+}
+
+void scan_result_batch_flush() {
+  batch_flush_scheduled = false;
+  if (batch_window_alarm) alarm_cancel(batch_window_alarm);
+  if (!pending_batch || pending_batch->results.empty()) return;
+
+  do_in_jni_thread(
+      Bind(bta_scan_results_batch_cb_impl, base::Passed(&pending_batch)));
+}
+
+void scan_result_batch_window_expired(UNUSED_ATTR void* data) {
+  scan_result_batch_flush();
+}
+
+void scan_result_batch_schedule_flush() {
+  if (pending_batch->results.size() >= SCAN_BATCH_MAX_RESULTS) {
+    scan_result_batch_flush();
+    return;
+  }
+
+  if (batch_flush_scheduled) return;
+  batch_flush_scheduled = true;
+
+  if (batch_window_ms == 0) {
+    do_in_bta_thread(FROM_HERE, Bind(scan_result_batch_flush));
+    return;
+  }
+
+  if (batch_window_alarm == nullptr)
+    batch_window_alarm = alarm_new("btif_ble_scanner.batch_window");
+  alarm_set_on_mloop(batch_window_alarm, batch_window_ms,
+                     scan_result_batch_window_expired, NULL);
 }
 
 void bta_scan_results_cb(tBTA_DM_SEARCH_EVT event, tBTA_DM_SEARCH* p_data) {
@@ -172,23 +289,48 @@ void bta_scan_results_cb(tBTA_DM_SEARCH_EVT event, tBTA_DM_SEARCH* p_data) {
     return;
   }
 
-  vector<uint8_t> value;
-  if (p_data->inq_res.p_eir) {
-    value.insert(value.begin(), p_data->inq_res.p_eir,
-                 p_data->inq_res.p_eir + p_data->inq_res.eir_len);
+  tBTA_DM_INQ_RES* r = &p_data->inq_res;
+  uint16_t eir_len = r->p_eir ? r->eir_len : 0;
+  if (r->p_eir && AdvertiseDataParser::GetFieldByType(
+                      r->p_eir, eir_len, BTM_EIR_COMPLETE_LOCAL_NAME_TYPE,
+                      &len)) {
+    r->remt_name_not_required = true;
+  }
 
-    if (AdvertiseDataParser::GetFieldByType(
-            value, BTM_EIR_COMPLETE_LOCAL_NAME_TYPE, &len)) {
-      p_data->inq_res.remt_name_not_required = true;
-    }
+  if (!pending_batch) pending_batch = scan_result_batch_new();
+
+  btgatt_scan_result_t result;
+  result.event_type = r->ble_evt_type;
+  result.addr_type = r->ble_addr_type;
+  result.bda = r->bd_addr;
+  result.primary_phy = r->ble_primary_phy;
+  result.secondary_phy = r->ble_secondary_phy;
+  result.advertising_sid = r->ble_advertising_sid;
+  result.tx_power = r->ble_tx_power;
+  result.rssi = r->rssi;
+  result.periodic_adv_int = r->ble_periodic_adv_int;
+  result.adv_data_offset = pending_batch->adv_data.size();
+  result.adv_data_len = eir_len;
+  pending_batch->results.push_back(result);
+  pending_batch->device_types.push_back(r->device_type);
+  if (eir_len)
+    pending_batch->adv_data.insert(pending_batch->adv_data.end(), r->p_eir,
+                                   r->p_eir + eir_len);
+
+  scan_result_batch_schedule_flush();
+}
+
+// Starts or stops observing on the bta thread, delivering scan results in
+// batches spanning at most |window_ms|.
+void scan_observe(bool start, period_ms_t window_ms) {
+  if (!start) {
+    BTA_DmBleObserve(false, 0, nullptr);
+    scan_result_batch_flush();
+    return;
   }
 
-  tBTA_DM_INQ_RES* r = &p_data->inq_res;
-  do_in_jni_thread(Bind(bta_scan_results_cb_impl, r->bd_addr, r->device_type,
-                        r->rssi, r->ble_addr_type, r->ble_evt_type,
-                        r->ble_primary_phy, r->ble_secondary_phy,
-                        r->ble_advertising_sid, r->ble_tx_power,
-                        r->ble_periodic_adv_int, std::move(value)));
+  batch_window_ms = window_ms;
+  BTA_DmBleObserve(true, 0, bta_scan_results_cb);
 }
 
 void bta_track_adv_event_cb(tBTM_BLE_TRACK_ADV_DATA* p_track_adv_data) {
@@ -229,14 +371,14 @@ class BleScannerInterfaceImpl : public BleScannerInterface {
     do_in_jni_thread(Bind(
         [](bool start) {
           if (!start) {
-            do_in_bta_thread(FROM_HERE,
-                             Bind(&BTA_DmBleObserve, false, 0, nullptr));
+            do_in_bta_thread(FROM_HERE, Bind(&scan_observe, false, 0));
             return;
           }
 
           btif_address_cache_init();
-          do_in_bta_thread(
-              FROM_HERE, Bind(&BTA_DmBleObserve, true, 0, bta_scan_results_cb));
+          period_ms_t window_ms = std::max(
+              osi_property_get_int32(SCAN_BATCH_WINDOW_PROPERTY, 0), 0);
+          do_in_bta_thread(FROM_HERE, Bind(&scan_observe, true, window_ms));
         },
         start));
   }
@@ -30,6 +30,7 @@
 #include <string>
 
 #include <mutex>
+#include <shared_mutex>
 
 #include "bt_types.h"
 #include "btcore/include/module.h"
@@ -42,6 +43,7 @@
 #include "osi/include/allocator.h"
 #include "osi/include/compat.h"
 #include "osi/include/config.h"
+#include "osi/include/config_journal.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
 #include "osi/include/properties.h"
@@ -51,6 +53,7 @@
 #define INFO_SECTION "Info"
 #define FILE_TIMESTAMP "TimeCreated"
 #define FILE_SOURCE "FileSource"
+#define JOURNAL_GENERATION "JournalGeneration"
 #define TIME_STRING_LENGTH sizeof("YYYY-MM-DD HH:MM:SS")
 static const char* TIME_STRING_FORMAT = "%Y-%m-%d %H:%M:%S";
 
@@ -62,15 +65,22 @@ using bluetooth::common::AddressObfuscator;
 #if defined(OS_GENERIC)
 static const char* CONFIG_FILE_PATH = "bt_config.conf";
 static const char* CONFIG_BACKUP_PATH = "bt_config.bak";
+static const char* CONFIG_JOURNAL_PATH = "bt_config.journal";
 static const char* CONFIG_LEGACY_FILE_PATH = "bt_config.xml";
 #else   // !defined(OS_GENERIC)
 static const char* CONFIG_FILE_PATH = "/data/misc/bluedroid/bt_config.conf";
 static const char* CONFIG_BACKUP_PATH = "/data/misc/bluedroid/bt_config.bak";
+static const char* CONFIG_JOURNAL_PATH =
+    "/data/misc/bluedroid/bt_config.journal";
 static const char* CONFIG_LEGACY_FILE_PATH =
     "/data/misc/bluedroid/bt_config.xml";
 #endif  // defined(OS_GENERIC)
 static const period_ms_t CONFIG_SETTLE_PERIOD_MS = 3000;
 
+// Once the journal grows past this size, the next save rewrites the config
+// file in full and starts a fresh journal.
+static const size_t CONFIG_JOURNAL_COMPACT_SIZE = 64 * 1024;
+
 static void timer_config_save_cb(void* data);
 static void btif_config_write(uint16_t event, char* p_param);
 static bool is_factory_reset(void);
@@ -78,6 +88,9 @@ static void delete_config_files(void);
 static void btif_config_remove_unpaired(config_t* config);
 static void btif_config_remove_restricted(config_t* config);
 static config_t* btif_config_open(const char* filename);
+static bool is_journal_enabled(void);
+static void btif_config_journal_set(const char* section, const char* key);
+static bool btif_config_save_full(config_t* conf);
 
 static enum ConfigSource {
   NOT_LOADED,
@@ -158,13 +171,26 @@ static void read_or_set_metrics_salt() {
   AddressObfuscator::GetInstance()->Initialize(metrics_salt);
 }
 
-static std::recursive_mutex config_lock;  // protects operations on |config|.
+// Protects operations on |config|. Lookups take it shared, so readers on
+// different threads only contend with writers.
+static std::shared_timed_mutex config_lock;
 static alarm_t* config_timer;
 
+// Journal of changes made since the config file was last written in full;
+// NULL when journaling is disabled. Guarded by |config_lock|.
+static config_journal_t* config_journal;
+// Set while |config| holds changes that are in neither the config file nor
+// the journal, such as those made during init.
+static bool config_compaction_needed;
+// Counts the full saves. Stored in the config file and at the start of the
+// journal, so that the journal is only replayed over the save it was started
+// for. Guarded by |config_lock|.
+static uint64_t config_generation;
+
 // Module lifecycle functions
 
 static future_t* init(void) {
-  std::unique_lock<std::recursive_mutex> lock(config_lock);
+  std::unique_lock<std::shared_timed_mutex> lock(config_lock);
 
   if (is_factory_reset()) delete_config_files();
 
@@ -201,6 +227,19 @@ static future_t* init(void) {
     goto error;
   }
 
+  // The journal holds changes made on top of the last full save, so it only
+  // applies when one of the saved files was loaded, and only over the save it
+  // was started for. It is replayed even if journaling is now disabled; the
+  // first full save then removes it.
+  config_generation =
+      config_get_uint64(config, INFO_SECTION, JOURNAL_GENERATION, 0);
+  if (btif_config_source == ORIGINAL || btif_config_source == BACKUP) {
+    size_t records =
+        config_journal_replay(CONFIG_JOURNAL_PATH, config_generation, config);
+    if (records > 0)
+      LOG_INFO(LOG_TAG, "%s replayed %zu journal records.", __func__, records);
+  }
+
   if (!file_source.empty())
     config_set_string(config, INFO_SECTION, FILE_SOURCE, file_source.c_str());
 
@@ -226,8 +265,11 @@ static future_t* init(void) {
     }
   }
 
-  // Read or set metrics 256 bit hashing salt
+  // Read or set metrics 256 bit hashing salt. This goes through the public
+  // accessors, which take |config_lock| themselves.
+  lock.unlock();
   read_or_set_metrics_salt();
+  lock.lock();
 
   // TODO(sharvil): use a non-wake alarm for this once we have
   // API support for it. There's no need to wake the system to
@@ -238,6 +280,16 @@ static future_t* init(void) {
     goto error;
   }
 
+  if (is_journal_enabled()) {
+    config_journal = config_journal_new(CONFIG_JOURNAL_PATH);
+    if (!config_journal)
+      LOG_WARN(LOG_TAG, "%s unable to open journal; using full saves.",
+               __func__);
+  }
+  // Changes made above (and the replayed journal) are folded into the config
+  // file by the first save.
+  config_compaction_needed = true;
+
   LOG_EVENT_INT(BT_CONFIG_SOURCE_TAG_NUM, btif_config_source);
 
   return future_new_immediate(FUTURE_SUCCESS);
@@ -275,7 +327,9 @@ static future_t* clean_up(void) {
   alarm_free(config_timer);
   config_timer = NULL;
 
-  std::unique_lock<std::recursive_mutex> lock(config_lock);
+  std::unique_lock<std::shared_timed_mutex> lock(config_lock);
+  config_journal_free(config_journal);
+  config_journal = NULL;
   config_free(config);
   config = NULL;
   return future_new_immediate(FUTURE_SUCCESS);
@@ -291,7 +345,7 @@ bool btif_config_has_section(const char* section) {
   CHECK(config != NULL);
   CHECK(section != NULL);
 
-  std::unique_lock<std::recursive_mutex> lock(config_lock);
+  std::shared_lock<std::shared_timed_mutex> lock(config_lock);
   return config_has_section(config, section);
 }
 
@@ -300,7 +354,7 @@ bool btif_config_exist(const char* section, const char* key) {
   CHECK(section != NULL);
   CHECK(key != NULL);
 
-  std::unique_lock<std::recursive_mutex> lock(config_lock);
+  std::shared_lock<std::shared_timed_mutex> lock(config_lock);
   return config_has_key(config, section, key);
 }
 
@@ -310,7 +364,7 @@ bool btif_config_get_int(const char* section, const char* key, int* value) {
   CHECK(key != NULL);
   CHECK(value != NULL);
 
-  std::unique_lock<std::recursive_mutex> lock(config_lock);
+  std::shared_lock<std::shared_timed_mutex> lock(config_lock);
   bool ret = config_has_key(config, section, key);
   if (ret) *value = config_get_int(config, section, key, *value);
 
@@ -323,7 +377,7 @@ bool btif_config_get_uint16(const char* section, const char* key, uint16_t* valu
   CHECK(key != NULL);
   CHECK(value != NULL);
 
-  std::unique_lock<std::recursive_mutex> lock(config_lock);
+  std::shared_lock<std::shared_timed_mutex> lock(config_lock);
   bool ret = config_has_key(config, section, key);
   if (ret) *value = config_get_uint16(config, section, key, *value);
 
@@ -337,7 +391,7 @@ bool btif_config_get_uint64(const char* section, const char* key,
   CHECK(section != NULL);
   CHECK(key != NULL);
 
-  std::unique_lock<std::recursive_mutex> lock(config_lock);
+  std::shared_lock<std::shared_timed_mutex> lock(config_lock);
   bool ret = config_has_key(config, section, key);
   if (ret) *value = config_get_uint64(config, section, key, *value);
 
@@ -350,8 +404,9 @@ bool btif_config_set_int(const char* section, const char* key, int value) {
   CHECK(section != NULL);
   CHECK(key != NULL);
 
-  std::unique_lock<std::recursive_mutex> lock(config_lock);
+  std::unique_lock<std::shared_timed_mutex> lock(config_lock);
   config_set_int(config, section, key, value);
+  btif_config_journal_set(section, key);
 
   return true;
 }
@@ -361,8 +416,9 @@ bool btif_config_set_uint16(const char* section, const char* key, uint16_t value
   CHECK(section != NULL);
   CHECK(key != NULL);
 
-  std::unique_lock<std::recursive_mutex> lock(config_lock);
+  std::unique_lock<std::shared_timed_mutex> lock(config_lock);
   config_set_uint16(config, section, key, value);
+  btif_config_journal_set(section, key);
 
   return true;
 }
@@ -373,8 +429,9 @@ bool btif_config_set_uint64(const char* section, const char* key,
   CHECK(section != NULL);
   CHECK(key != NULL);
 
-  std::unique_lock<std::recursive_mutex> lock(config_lock);
+  std::unique_lock<std::shared_timed_mutex> lock(config_lock);
   config_set_uint64(config, section, key, value);
+  btif_config_journal_set(section, key);
 
   return true;
 }
@@ -389,7 +446,7 @@ bool btif_config_get_str(const char* section, const char* key, char* value,
   CHECK(size_bytes != NULL);
 
   {
-    std::unique_lock<std::recursive_mutex> lock(config_lock);
+    std::shared_lock<std::shared_timed_mutex> lock(config_lock);
     const char* stored_value = config_get_string(config, section, key, NULL);
     if (!stored_value) return false;
     strlcpy(value, stored_value, *size_bytes);
@@ -406,8 +463,9 @@ bool btif_config_set_str(const char* section, const char* key,
   CHECK(key != NULL);
   CHECK(value != NULL);
 
-  std::unique_lock<std::recursive_mutex> lock(config_lock);
+  std::unique_lock<std::shared_timed_mutex> lock(config_lock);
   config_set_string(config, section, key, value);
+  btif_config_journal_set(section, key);
   return true;
 }
 
@@ -419,7 +477,7 @@ bool btif_config_get_bin(const char* section, const char* key, uint8_t* value,
   CHECK(value != NULL);
   CHECK(length != NULL);
 
-  std::unique_lock<std::recursive_mutex> lock(config_lock);
+  std::shared_lock<std::shared_timed_mutex> lock(config_lock);
   const char* value_str = config_get_string(config, section, key, NULL);
 
   if (!value_str) {
@@ -445,7 +503,7 @@ size_t btif_config_get_bin_length(const char* section, const char* key) {
   CHECK(section != NULL);
   CHECK(key != NULL);
 
-  std::unique_lock<std::recursive_mutex> lock(config_lock);
+  std::shared_lock<std::shared_timed_mutex> lock(config_lock);
   const char* value_str = config_get_string(config, section, key, NULL);
   if (!value_str) return 0;
 
@@ -471,8 +529,9 @@ bool btif_config_set_bin(const char* section, const char* key,
   }
 
   {
-    std::unique_lock<std::recursive_mutex> lock(config_lock);
+    std::unique_lock<std::shared_timed_mutex> lock(config_lock);
     config_set_string(config, section, key, str);
+    btif_config_journal_set(section, key);
   }
 
   osi_free(str);
@@ -509,8 +568,11 @@ bool btif_config_remove(const char* section, const char* key) {
   CHECK(section != NULL);
   CHECK(key != NULL);
 
-  std::unique_lock<std::recursive_mutex> lock(config_lock);
-  return config_remove_key(config, section, key);
+  std::unique_lock<std::shared_timed_mutex> lock(config_lock);
+  bool ret = config_remove_key(config, section, key);
+  if (ret && config_journal)
+    config_journal_remove(config_journal, section, key);
+  return ret;
 }
 
 void btif_config_save(void) {
@@ -534,13 +596,16 @@ bool btif_config_clear(void) {
 
   alarm_cancel(config_timer);
 
-  std::unique_lock<std::recursive_mutex> lock(config_lock);
+  std::unique_lock<std::shared_timed_mutex> lock(config_lock);
   config_free(config);
 
   config = config_new_empty();
   if (config == NULL) return false;
 
-  bool ret = config_save(config, CONFIG_FILE_PATH);
+  bool ret = btif_config_save_full(config);
+  // Should the save have failed, the journal still applies to the old file,
+  // so it must not be appended to until the cleared config is saved in full.
+  config_compaction_needed = true;
   btif_config_source = RESET;
   return ret;
 }
@@ -557,17 +622,50 @@ static void btif_config_write(UNUSED_ATTR uint16_t event,
   CHECK(config != NULL);
   CHECK(config_timer != NULL);
 
-  std::unique_lock<std::recursive_mutex> lock(config_lock);
+  std::unique_lock<std::shared_timed_mutex> lock(config_lock);
+
+  // Append just the changes unless the journal is due for compaction. A
+  // failed append falls through to a full save, which supersedes it.
+  if (config_journal && !config_compaction_needed &&
+      config_journal_flush(config_journal) &&
+      config_journal_size(config_journal) < CONFIG_JOURNAL_COMPACT_SIZE)
+    return;
+
   rename(CONFIG_FILE_PATH, CONFIG_BACKUP_PATH);
   config_t* config_paired = config_new_clone(config);
 
   if (config_paired != NULL) {
     btif_config_remove_unpaired(config_paired);
-    config_save(config_paired, CONFIG_FILE_PATH);
+    if (btif_config_save_full(config_paired)) config_compaction_needed = false;
     config_free(config_paired);
   }
 }
 
+static void btif_config_journal_set(const char* section, const char* key) {
+  if (!config_journal) return;
+
+  // Journal the stored form so replay reproduces it exactly.
+  const char* value = config_get_string(config, section, key, NULL);
+  if (value) config_journal_set(config_journal, section, key, value);
+}
+
+// Writes |conf| out in full as the next generation, and starts the journal
+// over on top of it. Without an open journal (journaling disabled or the file
+// failed to open) the file replayed at init is removed instead. Returns false
+// unless changes can be appended to the journal from now on.
+static bool btif_config_save_full(config_t* conf) {
+  uint64_t generation = config_generation + 1;
+  config_set_uint64(conf, INFO_SECTION, JOURNAL_GENERATION, generation);
+  if (!config_save(conf, CONFIG_FILE_PATH)) return false;
+  config_generation = generation;
+
+  if (!config_journal) {
+    remove(CONFIG_JOURNAL_PATH);
+    return true;
+  }
+  return config_journal_reset(config_journal, generation);
+}
+
 static void btif_config_remove_unpaired(config_t* conf) {
   CHECK(conf != NULL);
   int paired_devices = 0;
@@ -632,6 +730,9 @@ void btif_debug_config_dump(int fd) {
   dprintf(fd, "  File created/tagged: %s\n", btif_config_time_created);
   dprintf(fd, "  File source: %s\n",
           config_get_string(config, INFO_SECTION, FILE_SOURCE, "Original"));
+  if (config_journal)
+    dprintf(fd, "  Journal size: %zu bytes\n",
+            config_journal_size(config_journal));
 }
 
 static void btif_config_remove_restricted(config_t* config) {
@@ -649,6 +750,12 @@ static void btif_config_remove_restricted(config_t* config) {
   }
 }
 
+static bool is_journal_enabled(void) {
+  char journal[PROPERTY_VALUE_MAX] = {0};
+  osi_property_get("persist.bluetooth.config_journal", journal, "true");
+  return strncmp(journal, "true", 4) == 0;
+}
+
 static bool is_factory_reset(void) {
   char factory_reset[PROPERTY_VALUE_MAX] = {0};
   osi_property_get("persist.bluetooth.factoryreset", factory_reset, "false");
@@ -658,5 +765,6 @@ static bool is_factory_reset(void) {
 static void delete_config_files(void) {
   remove(CONFIG_FILE_PATH);
   remove(CONFIG_BACKUP_PATH);
+  remove(CONFIG_JOURNAL_PATH);
   osi_property_set("persist.bluetooth.factoryreset", "false");
 }
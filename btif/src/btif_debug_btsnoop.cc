@@ -16,7 +16,11 @@
  *
  ******************************************************************************/
 
+#include <arpa/inet.h>
+#include <algorithm>
+#include <deque>
 #include <mutex>
+#include <vector>
 
 #include <base/logging.h>
 #include <resolv.h>
@@ -26,29 +30,58 @@
 #include "btif/include/btif_debug_btsnoop.h"
 #include "hci/include/btsnoop_mem.h"
 #include "internal_include/bt_target.h"
-#include "osi/include/ringbuffer.h"
+#include "stack/include/hcidefs.h"
+#include "osi/include/log.h"
+#include "osi/include/osi.h"
+#include "osi/include/thread.h"
 #include "osi/include/time.h"
 
 #define REDUCE_HCI_TYPE_TO_SIGNIFICANT_BITS(type) ((type) >> 8)
 
-// Total btsnoop memory log buffer size
+// Total btsnoop memory log buffer size, counted in compressed bytes
 #ifndef BTSNOOP_MEM_BUFFER_SIZE
-static const size_t BTSNOOP_MEM_BUFFER_SIZE = (256 * 1024);
+static const size_t BTSNOOP_MEM_BUFFER_SIZE = (2 * 1024 * 1024);
 #endif
 
+// Packets are collected uncompressed into segments of this size, which are
+// then compressed one at a time off the HCI thread.
+static const size_t SEGMENT_SIZE = 65536;
+
+// Full segments waiting for |compress_thread|. Should it fall this far behind,
+// new packets are dropped rather than held in memory.
+static const size_t MAX_PENDING_SEGMENTS = 8;
+
 // Block size for copying buffers (for compression/encoding etc.)
 static const size_t BLOCK_SIZE = 16384;
 
 // Maximum line length in bugreport (should be multiple of 4 for base64 output)
 static const uint8_t MAX_LINE_LENGTH = 128;
 
+// Records of btsnooz headers and packet data. Compressed segments hold a raw
+// deflate stream that ends on a byte boundary and is independent of every
+// other segment, so the ring can be exported as a single zlib stream by
+// concatenating them.
+typedef struct {
+  uint64_t first_timestamp_us;
+  uint32_t adler;
+  size_t raw_length;
+  bool compressed;
+  std::vector<uint8_t> data;
+} segment_t;
+
 static std::mutex buffer_mutex;
-static ringbuffer_t* buffer = NULL;
-static uint64_t last_timestamp_ms = 0;
+static segment_t staging;
+static std::deque<segment_t> pending;
+static std::deque<segment_t> segments;
+static size_t segments_size = 0;
+static size_t dropped_packets = 0;
+static uint64_t last_timestamp_us = 0;
+static thread_t* compress_thread = NULL;
 
 static size_t btsnoop_calculate_packet_length(uint16_t type,
                                               const uint8_t* data,
                                               size_t length);
+static void btsnoop_compress_pending(void* context);
 
 __attribute__((no_sanitize("integer")))
 static void btsnoop_cb(const uint16_t type, const uint8_t* data,
@@ -60,12 +93,20 @@ static void btsnoop_cb(const uint16_t type, const uint8_t* data,
 
   std::lock_guard<std::mutex> lock(buffer_mutex);
 
-  // Make room in the ring buffer
-
-  while (ringbuffer_available(buffer) <
-         (included_length + sizeof(btsnooz_header_t))) {
-    ringbuffer_pop(buffer, (uint8_t*)&header, sizeof(btsnooz_header_t));
-    ringbuffer_delete(buffer, header.length - 1);
+  // Hand the segment over for compression once it is full
+
+  const size_t record_length = included_length + sizeof(btsnooz_header_t);
+  if (staging.raw_length + record_length > SEGMENT_SIZE &&
+      staging.raw_length > 0) {
+    if (pending.size() < MAX_PENDING_SEGMENTS) {
+      pending.push_back(std::move(staging));
+      thread_post(compress_thread, btsnoop_compress_pending, NULL);
+    } else {
+      dropped_packets++;
+      return;
+    }
+    staging = segment_t();
+    staging.data.reserve(SEGMENT_SIZE);
   }
 
   // Insert data
@@ -73,160 +114,387 @@ static void btsnoop_cb(const uint16_t type, const uint8_t* data,
   header.length = included_length + 1;  // +1 for type byte
   header.packet_length = length + 1;    // +1 for type byte.
   header.delta_time_ms =
-      last_timestamp_ms ? timestamp_us - last_timestamp_ms : 0;
-  last_timestamp_ms = timestamp_us;
-
-  ringbuffer_insert(buffer, (uint8_t*)&header, sizeof(btsnooz_header_t));
-  ringbuffer_insert(buffer, data, included_length);
+      last_timestamp_us ? timestamp_us - last_timestamp_us : 0;
+  last_timestamp_us = timestamp_us;
+
+  if (staging.raw_length == 0) staging.first_timestamp_us = timestamp_us;
+  const uint8_t* p_header = reinterpret_cast<const uint8_t*>(&header);
+  staging.data.insert(staging.data.end(), p_header,
+                      p_header + sizeof(btsnooz_header_t));
+  staging.data.insert(staging.data.end(), data, data + included_length);
+  staging.raw_length += record_length;
 }
 
+// How much of each packet type is kept. Types without an entry, such as SCO
+// audio, are not logged at all.
+typedef struct {
+  uint16_t type;
+  size_t max_length;
+} truncation_policy_t;
+
+// Maximum amount of ACL data to log.
+// Enough for an RFCOMM frame up to the frame check;
+// not enough for a HID report or audio data.
+static const size_t MAX_HCI_ACL_LEN = 14;
+
+static const truncation_policy_t truncation_policies[] = {
+    {BT_EVT_TO_LM_HCI_CMD, SIZE_MAX},
+    {BT_EVT_TO_BTU_HCI_EVT, SIZE_MAX},
+    {BT_EVT_TO_LM_HCI_ACL, MAX_HCI_ACL_LEN},
+    {BT_EVT_TO_BTU_HCI_ACL, MAX_HCI_ACL_LEN},
+};
+
+// ACL data on these channels is always taken in full. That way, the PSM setup
+// is captured, allowing decoding of PSMs down the road.
+static const uint16_t full_length_cids[] = {
+    0x0001,  // L2CAP signaling
+    0x0005,  // LE L2CAP signaling
+};
+
 static size_t btsnoop_calculate_packet_length(uint16_t type,
                                               const uint8_t* data,
                                               size_t length) {
   static const size_t HCI_ACL_HEADER_SIZE = 4;
   static const size_t L2CAP_HEADER_SIZE = 4;
   static const size_t L2CAP_CID_OFFSET = (HCI_ACL_HEADER_SIZE + 2);
-  static const uint16_t L2CAP_SIGNALING_CID = 0x0001;
-
-  // Maximum amount of ACL data to log.
-  // Enough for an RFCOMM frame up to the frame check;
-  // not enough for a HID report or audio data.
-  static const size_t MAX_HCI_ACL_LEN = 14;
-
-  // Calculate packet length to be included
-
-  switch (type) {
-    case BT_EVT_TO_LM_HCI_CMD:
-      return length;
-
-    case BT_EVT_TO_BTU_HCI_EVT:
-      return length;
-
-    case BT_EVT_TO_LM_HCI_ACL:
-    case BT_EVT_TO_BTU_HCI_ACL: {
-      size_t len_hci_acl = HCI_ACL_HEADER_SIZE + L2CAP_HEADER_SIZE;
-      // Check if we have enough data for an L2CAP header
-      if (length > len_hci_acl) {
-        uint16_t l2cap_cid =
-            data[L2CAP_CID_OFFSET] | (data[L2CAP_CID_OFFSET + 1] << 8);
-        if (l2cap_cid == L2CAP_SIGNALING_CID) {
-          // For the signaling CID, take the full packet.
-          // That way, the PSM setup is captured, allowing decoding of PSMs down
-          // the road.
-          return length;
-        } else {
-          // Otherwise, return as much as we reasonably can
-          len_hci_acl = MAX_HCI_ACL_LEN;
-        }
-      }
-      return len_hci_acl < length ? len_hci_acl : length;
+
+  const truncation_policy_t* policy = NULL;
+  for (const truncation_policy_t& entry : truncation_policies) {
+    if (entry.type == type) {
+      policy = &entry;
+      break;
     }
+  }
+  if (policy == NULL) return 0;
 
-    case BT_EVT_TO_LM_HCI_SCO:
-    case BT_EVT_TO_BTU_HCI_SCO:
-    // We're not logging SCO packets at this time since they are not currently
-    // used.
-    // FALLTHROUGH
-    default:
-      return 0;
+  size_t max_length = policy->max_length;
+  if (type == BT_EVT_TO_LM_HCI_ACL || type == BT_EVT_TO_BTU_HCI_ACL) {
+    // Check if we have enough data for an L2CAP header
+    if (length <= HCI_ACL_HEADER_SIZE + L2CAP_HEADER_SIZE) return length;
+
+    uint16_t l2cap_cid =
+        data[L2CAP_CID_OFFSET] | (data[L2CAP_CID_OFFSET + 1] << 8);
+    for (uint16_t cid : full_length_cids) {
+      if (l2cap_cid == cid) return length;
+    }
   }
+
+  return max_length < length ? max_length : length;
 }
 
-static bool btsnoop_compress(ringbuffer_t* rb_dst, ringbuffer_t* rb_src) {
-  CHECK(rb_dst != NULL);
-  CHECK(rb_src != NULL);
+// Deflates the records in |segment| into |compressed| as a raw deflate
+// stream that ends on a byte boundary.
+static bool btsnoop_compress_segment(const segment_t& segment,
+                                     segment_t* compressed) {
+  CHECK(compressed != NULL);
 
   z_stream zs;
   zs.zalloc = Z_NULL;
   zs.zfree = Z_NULL;
   zs.opaque = Z_NULL;
 
-  if (deflateInit(&zs, Z_DEFAULT_COMPRESSION) != Z_OK) return false;
+  if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK)
+    return false;
 
-  bool rc = true;
-  uint8_t block_src[BLOCK_SIZE];
-  uint8_t block_dst[BLOCK_SIZE];
+  // deflateBound() assumes Z_FINISH; leave room for the empty stored block a
+  // sync flush ends with instead.
+  compressed->data.resize(deflateBound(&zs, segment.raw_length) + 8);
+  zs.next_in = const_cast<uint8_t*>(segment.data.data());
+  zs.avail_in = segment.raw_length;
+  zs.next_out = compressed->data.data();
+  zs.avail_out = compressed->data.size();
 
-  const size_t num_blocks =
-      (ringbuffer_size(rb_src) + BLOCK_SIZE - 1) / BLOCK_SIZE;
-  for (size_t i = 0; i < num_blocks; ++i) {
-    zs.avail_in =
-        ringbuffer_peek(rb_src, i * BLOCK_SIZE, block_src, BLOCK_SIZE);
-    zs.next_in = block_src;
+  int err = deflate(&zs, Z_SYNC_FLUSH);
+  bool rc = (err == Z_OK && zs.avail_in == 0 && zs.avail_out != 0);
+  deflateEnd(&zs);
+  if (!rc) return false;
+
+  compressed->data.resize(compressed->data.size() - zs.avail_out);
+  compressed->data.shrink_to_fit();
+  compressed->first_timestamp_us = segment.first_timestamp_us;
+  compressed->adler = adler32(adler32(0L, Z_NULL, 0), segment.data.data(),
+                              segment.raw_length);
+  compressed->raw_length = segment.raw_length;
+  compressed->compressed = true;
+  return true;
+}
 
-    do {
-      zs.avail_out = BLOCK_SIZE;
-      zs.next_out = block_dst;
+// Runs on |compress_thread| once for every segment added to |pending|.
+static void btsnoop_compress_pending(UNUSED_ATTR void* context) {
+  const segment_t* segment;
+  {
+    std::lock_guard<std::mutex> lock(buffer_mutex);
+    if (pending.empty()) return;
+    segment = &pending.front();
+  }
 
-      int err = deflate(&zs, (i == num_blocks - 1) ? Z_FINISH : Z_NO_FLUSH);
-      if (err == Z_STREAM_ERROR) {
-        rc = false;
-        break;
-      }
+  // Only this thread removes from |pending|, and appending does not move the
+  // existing elements, so |segment| can be read without the lock.
+  segment_t compressed;
+  bool rc = btsnoop_compress_segment(*segment, &compressed);
 
-      const size_t length = BLOCK_SIZE - zs.avail_out;
-      ringbuffer_insert(rb_dst, block_dst, length);
-    } while (zs.avail_out == 0);
+  std::lock_guard<std::mutex> lock(buffer_mutex);
+  pending.pop_front();
+  if (!rc) {
+    LOG_ERROR(LOG_TAG, "%s: unable to compress snoop segment", __func__);
+    return;
   }
 
+  segments_size += compressed.data.size();
+  segments.push_back(std::move(compressed));
+  while (segments_size > BTSNOOP_MEM_BUFFER_SIZE) {
+    segments_size -= segments.front().data.size();
+    segments.pop_front();
+  }
+}
+
+// Copies out everything recorded so far, oldest first, and compresses the
+// parts that were not yet. Returns false if compression failed.
+static bool btsnoop_snapshot(std::vector<segment_t>* snapshot,
+                             uint64_t* last_timestamp, size_t* dropped) {
+  {
+    std::lock_guard<std::mutex> lock(buffer_mutex);
+    snapshot->assign(segments.begin(), segments.end());
+    snapshot->insert(snapshot->end(), pending.begin(), pending.end());
+    if (staging.raw_length > 0) snapshot->push_back(staging);
+    *last_timestamp = last_timestamp_us;
+    *dropped = dropped_packets;
+  }
+
+  for (segment_t& segment : *snapshot) {
+    if (segment.compressed) continue;
+    segment_t compressed;
+    if (!btsnoop_compress_segment(segment, &compressed)) return false;
+    segment = std::move(compressed);
+  }
+  return true;
+}
+
+// Joins |snapshot| into a single zlib stream after |preamble|.
+static bool btsnoop_build_btsnooz(const std::vector<segment_t>& snapshot,
+                                  const btsnooz_preamble_t& preamble,
+                                  std::vector<uint8_t>* out) {
+  // zlib header: deflate with a 32K window, default compression
+  static const uint8_t ZLIB_HEADER[] = {0x78, 0x9c};
+
+  const uint8_t* p_preamble = reinterpret_cast<const uint8_t*>(&preamble);
+  out->assign(p_preamble, p_preamble + sizeof(btsnooz_preamble_t));
+  out->insert(out->end(), ZLIB_HEADER, ZLIB_HEADER + sizeof(ZLIB_HEADER));
+
+  uLong adler = adler32(0L, Z_NULL, 0);
+  for (const segment_t& segment : snapshot) {
+    out->insert(out->end(), segment.data.begin(), segment.data.end());
+    adler = adler32_combine(adler, segment.adler, segment.raw_length);
+  }
+
+  // Terminate the deflate stream with an empty final block.
+  z_stream zs;
+  zs.zalloc = Z_NULL;
+  zs.zfree = Z_NULL;
+  zs.opaque = Z_NULL;
+  if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK)
+    return false;
+
+  uint8_t block_dst[16];
+  zs.next_in = Z_NULL;
+  zs.avail_in = 0;
+  zs.next_out = block_dst;
+  zs.avail_out = sizeof(block_dst);
+  int err = deflate(&zs, Z_FINISH);
   deflateEnd(&zs);
-  return rc;
+  if (err != Z_STREAM_END) return false;
+  out->insert(out->end(), block_dst,
+              block_dst + sizeof(block_dst) - zs.avail_out);
+
+  for (int shift = 24; shift >= 0; shift -= 8)
+    out->push_back((adler >> shift) & 0xff);
+  return true;
 }
 
 void btif_debug_btsnoop_init(void) {
-  if (buffer == NULL) buffer = ringbuffer_init(BTSNOOP_MEM_BUFFER_SIZE);
+  if (compress_thread == NULL) {
+    compress_thread = thread_new("btsnoop_compress");
+    if (compress_thread == NULL) {
+      LOG_ERROR(LOG_TAG, "%s: unable to create compression thread", __func__);
+      return;
+    }
+    staging.data.reserve(SEGMENT_SIZE);
+  }
   btsnoop_mem_set_callback(btsnoop_cb);
 }
 
 void btif_debug_btsnoop_dump(int fd) {
-  ringbuffer_t* ringbuffer = ringbuffer_init(BTSNOOP_MEM_BUFFER_SIZE);
-  if (ringbuffer == NULL) {
-    dprintf(fd, "%s Unable to allocate memory for compression", __func__);
-    return;
-  }
+  std::vector<segment_t> snapshot;
+  uint64_t last_timestamp = 0;
+  size_t dropped = 0;
+  bool rc = btsnoop_snapshot(&snapshot, &last_timestamp, &dropped);
+
+  size_t raw_length = 0;
+  for (const segment_t& segment : snapshot) raw_length += segment.raw_length;
+  dprintf(fd, "--- BEGIN:BTSNOOP_LOG_SUMMARY (%zu bytes in) ---\n",
+          raw_length);
 
   // Prepend preamble
 
   btsnooz_preamble_t preamble;
   preamble.version = BTSNOOZ_CURRENT_VERSION;
-  preamble.last_timestamp_ms = last_timestamp_ms;
-  ringbuffer_insert(ringbuffer, (uint8_t*)&preamble,
-                    sizeof(btsnooz_preamble_t));
-
-  // Compress data
-
-  uint8_t b64_in[3] = {0};
-  char b64_out[5] = {0};
-
-  size_t line_length = 0;
-
-  bool rc;
-  {
-    std::lock_guard<std::mutex> lock(buffer_mutex);
-    dprintf(fd, "--- BEGIN:BTSNOOP_LOG_SUMMARY (%zu bytes in) ---\n",
-            ringbuffer_size(buffer));
-    rc = btsnoop_compress(ringbuffer, buffer);
-  }
+  preamble.last_timestamp_ms = last_timestamp;
 
+  std::vector<uint8_t> btsnooz;
+  if (rc) rc = btsnoop_build_btsnooz(snapshot, preamble, &btsnooz);
   if (rc == false) {
     dprintf(fd, "%s Log compression failed", __func__);
-    goto error;
+    return;
   }
 
   // Base64 encode & output
 
-  while (ringbuffer_size(ringbuffer) > 0) {
-    size_t read = ringbuffer_pop(ringbuffer, b64_in, 3);
+  char b64_out[5] = {0};
+  size_t line_length = 0;
+
+  for (size_t i = 0; i < btsnooz.size(); i += 3) {
+    size_t read = std::min<size_t>(3, btsnooz.size() - i);
     if (line_length >= MAX_LINE_LENGTH) {
       dprintf(fd, "\n");
       line_length = 0;
     }
-    line_length += b64_ntop(b64_in, read, b64_out, 5);
+    line_length += b64_ntop(&btsnooz[i], read, b64_out, 5);
     dprintf(fd, "%s", b64_out);
   }
 
   dprintf(fd, "\n--- END:BTSNOOP_LOG_SUMMARY ---\n");
+  if (dropped > 0)
+    dprintf(fd, "  %zu packets dropped while compression was behind\n",
+            dropped);
+}
+
+static uint64_t htonll(uint64_t ll) {
+  const uint32_t l = 1;
+  if (*(reinterpret_cast<const uint8_t*>(&l)) == 1)
+    return static_cast<uint64_t>(htonl(ll & 0xffffffff)) << 32 |
+           htonl(ll >> 32);
+
+  return ll;
+}
+
+// Converts the records in |raw| to btsnoop records, appending them to |out|.
+__attribute__((no_sanitize("integer")))
+static void btsnoop_append_records(const uint8_t* raw, size_t length,
+                                   uint64_t timestamp_us,
+                                   std::vector<uint8_t>* out) {
+  static const uint64_t BTSNOOP_EPOCH_DELTA = 0x00dcddb30f2f8000ULL;
+
+  typedef struct {
+    uint32_t length_original;
+    uint32_t length_captured;
+    uint32_t flags;
+    uint32_t dropped_packets;
+    uint64_t timestamp;
+    uint8_t type;
+  } __attribute__((__packed__)) btsnoop_header_t;
+
+  bool first = true;
+  size_t offset = 0;
+  while (offset + sizeof(btsnooz_header_t) <= length) {
+    btsnooz_header_t snooz;
+    memcpy(&snooz, raw + offset, sizeof(snooz));
+    offset += sizeof(snooz);
+    if (snooz.length == 0 || offset + snooz.length - 1 > length) break;
+
+    // The first record's delta is relative to a packet that may have been
+    // evicted; segments carry their own starting time instead.
+    if (!first) timestamp_us += snooz.delta_time_ms;
+    first = false;
+
+    btsnoop_header_t header;
+    uint32_t flags = 0;
+    switch (snooz.type) {
+      case REDUCE_HCI_TYPE_TO_SIGNIFICANT_BITS(BT_EVT_TO_LM_HCI_CMD):
+        header.type = HCIT_TYPE_COMMAND;
+        flags = 2;
+        break;
+      case REDUCE_HCI_TYPE_TO_SIGNIFICANT_BITS(BT_EVT_TO_BTU_HCI_EVT):
+        header.type = HCIT_TYPE_EVENT;
+        flags = 3;
+        break;
+      case REDUCE_HCI_TYPE_TO_SIGNIFICANT_BITS(BT_EVT_TO_LM_HCI_ACL):
+        header.type = HCIT_TYPE_ACL_DATA;
+        break;
+      case REDUCE_HCI_TYPE_TO_SIGNIFICANT_BITS(BT_EVT_TO_BTU_HCI_ACL):
+        header.type = HCIT_TYPE_ACL_DATA;
+        flags = 1;
+        break;
+      case REDUCE_HCI_TYPE_TO_SIGNIFICANT_BITS(BT_EVT_TO_LM_HCI_SCO):
+        header.type = HCIT_TYPE_SCO_DATA;
+        break;
+      case REDUCE_HCI_TYPE_TO_SIGNIFICANT_BITS(BT_EVT_TO_BTU_HCI_SCO):
+        header.type = HCIT_TYPE_SCO_DATA;
+        flags = 1;
+        break;
+      default:
+        offset += snooz.length - 1;
+        continue;
+    }
+
+    header.length_original = htonl(snooz.packet_length);
+    header.length_captured = htonl(snooz.length);
+    header.flags = htonl(flags);
+    header.dropped_packets = 0;
+    header.timestamp = htonll(timestamp_us + BTSNOOP_EPOCH_DELTA);
+
+    const uint8_t* p_header = reinterpret_cast<const uint8_t*>(&header);
+    out->insert(out->end(), p_header, p_header + sizeof(header));
+    out->insert(out->end(), raw + offset, raw + offset + snooz.length - 1);
+    offset += snooz.length - 1;
+  }
+}
+
+void btif_debug_btsnoop_write(int fd) {
+  std::vector<segment_t> snapshot;
+  uint64_t last_timestamp = 0;
+  size_t dropped = 0;
+  if (!btsnoop_snapshot(&snapshot, &last_timestamp, &dropped)) {
+    LOG_ERROR(LOG_TAG, "%s: log compression failed", __func__);
+    return;
+  }
+
+  static const char BTSNOOP_FILE_HEADER[] = "btsnoop\0\0\0\0\1\0\0\x3\xea";
+  std::vector<uint8_t> out(BTSNOOP_FILE_HEADER, BTSNOOP_FILE_HEADER + 16);
+  std::vector<uint8_t> raw;
+
+  for (const segment_t& segment : snapshot) {
+    z_stream zs;
+    zs.zalloc = Z_NULL;
+    zs.zfree = Z_NULL;
+    zs.opaque = Z_NULL;
+    if (inflateInit2(&zs, -MAX_WBITS) != Z_OK) return;
+
+    raw.resize(segment.raw_length);
+    zs.next_in = const_cast<uint8_t*>(segment.data.data());
+    zs.avail_in = segment.data.size();
+    zs.next_out = raw.data();
+    zs.avail_out = raw.size();
+    int err = inflate(&zs, Z_SYNC_FLUSH);
+    inflateEnd(&zs);
+    if ((err != Z_OK && err != Z_BUF_ERROR) || zs.avail_out != 0) {
+      LOG_ERROR(LOG_TAG, "%s: corrupt snoop segment", __func__);
+      continue;
+    }
+
+    btsnoop_append_records(raw.data(), raw.size(),
+                           segment.first_timestamp_us, &out);
+  }
 
-error:
-  ringbuffer_free(ringbuffer);
+  size_t offset = 0;
+  while (offset < out.size()) {
+    size_t length = std::min(BLOCK_SIZE, out.size() - offset);
+    ssize_t written = TEMP_FAILURE_RETRY(write(fd, &out[offset], length));
+    if (written < 0) {
+      LOG_ERROR(LOG_TAG, "%s: write failed: %s", __func__, strerror(errno));
+      return;
+    }
+    offset += written;
+  }
 }
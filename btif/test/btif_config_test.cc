@@ -0,0 +1,258 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+#include <gtest/gtest.h>
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+
+#include "btcore/include/module.h"
+#include "bt_trace.h"
+#include "btif/include/btif_config.h"
+#include "osi/include/compat.h"
+#include "osi/include/config.h"
+#include "osi/include/future.h"
+#include "osi/include/properties.h"
+
+// Built with OS_GENERIC, so the config files live in the working directory
+static const char CONFIG_FILE[] = "bt_config.conf";
+static const char CONFIG_TEMP_FILE[] = "bt_config.conf.new";
+static const char CONFIG_BACKUP_FILE[] = "bt_config.bak";
+static const char CONFIG_JOURNAL_FILE[] = "bt_config.journal";
+
+static const char JOURNAL_PROPERTY[] = "persist.bluetooth.config_journal";
+static const char DEVICE[] = "aa:bb:cc:dd:ee:ff";
+
+static const char CONFIG_CONTENTS[] =
+    "[Adapter]\n"
+    "Address = 01:02:03:04:05:06\n"
+    "\n"
+    "[aa:bb:cc:dd:ee:ff]\n"
+    "LinkKey = 00112233445566778899aabbccddeeff\n";
+
+extern module_t btif_config_module;
+
+static std::map<std::string, std::string> properties;
+
+int osi_property_get(const char* key, char* value, const char* default_value) {
+  auto it = properties.find(key);
+  const char* found = it != properties.end() ? it->second.c_str()
+                                             : default_value;
+  if (!found) return 0;
+  strlcpy(value, found, PROPERTY_VALUE_MAX);
+  return strlen(value);
+}
+
+int osi_property_set(const char* key, const char* value) {
+  properties[key] = value;
+  return 0;
+}
+
+int32_t osi_property_get_int32(const char* key, int32_t default_value) {
+  auto it = properties.find(key);
+  return it != properties.end() ? atoi(it->second.c_str()) : default_value;
+}
+
+// The stack's trace output and the rest of btif are not linked in
+void LogMsg(uint32_t trace_set_mask, const char* fmt_str, ...) {}
+void vnd_LogMsg(uint32_t trace_set_mask, const char* fmt_str, ...) {}
+uint8_t btif_trace_level = BT_TRACE_LEVEL_NONE;
+
+bool is_restricted_mode(void) { return false; }
+
+config_t* btif_config_transcode(const char* xml_filename) { return NULL; }
+
+typedef void(tBTIF_CBACK)(uint16_t event, char* p_param);
+typedef void(tBTIF_COPY_CBACK)(uint16_t event, char* p_dest, char* p_src);
+bt_status_t btif_transfer_context(tBTIF_CBACK* p_cback, uint16_t event,
+                                  char* p_params, int param_len,
+                                  tBTIF_COPY_CBACK* p_copy_cback) {
+  p_cback(event, p_params);
+  return BT_STATUS_SUCCESS;
+}
+
+class BtifConfigTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    char dir_template[] = "/tmp/btif_config_test.XXXXXX";
+    ASSERT_NE(mkdtemp(dir_template), nullptr);
+    dir_ = dir_template;
+    ASSERT_NE(getcwd(cwd_, sizeof(cwd_)), nullptr);
+    ASSERT_EQ(chdir(dir_.c_str()), 0);
+
+    FILE* fp = fopen(CONFIG_FILE, "wt");
+    ASSERT_NE(fp, nullptr);
+    fputs(CONFIG_CONTENTS, fp);
+    fclose(fp);
+
+    properties.clear();
+    SetJournalEnabled(true);
+  }
+
+  void TearDown() override {
+    if (loaded_) UnloadConfig();
+    remove(CONFIG_FILE);
+    remove(CONFIG_TEMP_FILE);
+    remove(CONFIG_BACKUP_FILE);
+    remove(CONFIG_JOURNAL_FILE);
+    ASSERT_EQ(chdir(cwd_), 0);
+    rmdir(dir_.c_str());
+  }
+
+  void SetJournalEnabled(bool enabled) {
+    osi_property_set(JOURNAL_PROPERTY, enabled ? "true" : "false");
+  }
+
+  // A boot: loads the config files, replaying the journal
+  void LoadConfig() {
+    ASSERT_EQ(future_await(btif_config_module.init()), FUTURE_SUCCESS);
+    loaded_ = true;
+  }
+
+  void UnloadConfig() {
+    future_await(btif_config_module.clean_up());
+    loaded_ = false;
+  }
+
+  std::string GetName() {
+    char name[64] = {0};
+    int size = sizeof(name);
+    if (!btif_config_get_str("Adapter", "Name", name, &size)) return "";
+    return name;
+  }
+
+  static bool JournalExists() { return access(CONFIG_JOURNAL_FILE, F_OK) == 0; }
+
+  static std::string ReadJournal() {
+    std::ifstream in(CONFIG_JOURNAL_FILE, std::ios::binary);
+    std::ostringstream contents;
+    contents << in.rdbuf();
+    return contents.str();
+  }
+
+  static void WriteJournal(const std::string& contents) {
+    std::ofstream out(CONFIG_JOURNAL_FILE, std::ios::binary | std::ios::trunc);
+    out << contents;
+  }
+
+ private:
+  std::string dir_;
+  char cwd_[PATH_MAX];
+  bool loaded_ = false;
+};
+
+TEST_F(BtifConfigTest, journal_replayed_after_restart) {
+  LoadConfig();
+  btif_config_flush();  // The first save is a full one
+  btif_config_set_str("Adapter", "Name", "journaled");
+  btif_config_flush();
+  UnloadConfig();
+  EXPECT_TRUE(JournalExists());
+
+  LoadConfig();
+  EXPECT_EQ(GetName(), "journaled");
+  EXPECT_TRUE(btif_config_has_section(DEVICE));
+}
+
+TEST_F(BtifConfigTest, journal_disabled_after_enabled_is_not_replayed_again) {
+  LoadConfig();
+  btif_config_flush();
+  btif_config_set_str("Adapter", "Name", "old");
+  btif_config_flush();
+  UnloadConfig();
+
+  // The journal written above is still replayed once journaling is disabled...
+  SetJournalEnabled(false);
+  LoadConfig();
+  EXPECT_EQ(GetName(), "old");
+
+  // ...but must not outlive the full save that supersedes it.
+  btif_config_set_str("Adapter", "Name", "new");
+  btif_config_flush();
+  EXPECT_FALSE(JournalExists());
+  UnloadConfig();
+
+  LoadConfig();
+  EXPECT_EQ(GetName(), "new");
+}
+
+TEST_F(BtifConfigTest, clear_then_save) {
+  LoadConfig();
+  btif_config_flush();
+  btif_config_set_str("Adapter", "Name", "before");
+  btif_config_flush();
+
+  EXPECT_TRUE(btif_config_clear());
+  btif_config_set_str("Adapter", "Name", "after");
+  btif_config_flush();
+  UnloadConfig();
+
+  LoadConfig();
+  EXPECT_EQ(GetName(), "after");
+  EXPECT_FALSE(btif_config_has_section(DEVICE));
+}
+
+TEST_F(BtifConfigTest, clear_with_failed_save_is_not_undone_by_journal) {
+  LoadConfig();
+  btif_config_flush();
+  btif_config_set_str("Adapter", "Name", "before");
+  btif_config_flush();
+
+  // A directory in the way of the temporary file fails the save
+  ASSERT_EQ(mkdir(CONFIG_TEMP_FILE, 0700), 0);
+  EXPECT_FALSE(btif_config_clear());
+  ASSERT_EQ(rmdir(CONFIG_TEMP_FILE), 0);
+
+  // The next save has to write the cleared config in full, rather than
+  // append to the journal of the old file still on disk.
+  btif_config_set_str("Adapter", "Name", "after");
+  btif_config_flush();
+  UnloadConfig();
+
+  LoadConfig();
+  EXPECT_EQ(GetName(), "after");
+  EXPECT_FALSE(btif_config_has_section(DEVICE));
+}
+
+TEST_F(BtifConfigTest, journal_not_replayed_over_newer_full_save) {
+  LoadConfig();
+  btif_config_flush();
+  btif_config_set_str("Adapter", "Name", "stale");
+  btif_config_flush();
+  UnloadConfig();
+  std::string stale_journal = ReadJournal();
+
+  // The first save after init is a full one
+  LoadConfig();
+  btif_config_set_str("Adapter", "Name", "fresh");
+  btif_config_flush();
+  UnloadConfig();
+
+  // As if the device crashed after writing the config file, but before
+  // starting the journal over
+  WriteJournal(stale_journal);
+  LoadConfig();
+  EXPECT_EQ(GetName(), "fresh");
+}
@@ -0,0 +1,152 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <base/message_loop/message_loop.h>
+#include <benchmark/benchmark.h>
+#include <hardware/bluetooth.h>
+#include <time.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "osi/include/alarm.h"
+#include "osi/include/semaphore.h"
+#include "osi/include/wakelock.h"
+
+using ::benchmark::State;
+
+// Alarms are only ever processed on the default callback thread here.
+base::MessageLoop* get_message_loop() { return nullptr; }
+
+#define BENCHMARK_ALARM_COUNTS Arg(100)->Arg(1000)->Arg(10000)
+
+// Deadlines are spread over this window when measuring firing jitter; short
+// enough that the wakelock path is used, as for most stack timers.
+#define FIRING_WINDOW_MS 500
+
+static int acquire_wake_lock_cb(const char* lock_name) {
+  return BT_STATUS_SUCCESS;
+}
+
+static int release_wake_lock_cb(const char* lock_name) {
+  return BT_STATUS_SUCCESS;
+}
+
+static bt_os_callouts_t bt_wakelock_callouts = {
+    sizeof(bt_os_callouts_t), NULL, acquire_wake_lock_cb, release_wake_lock_cb};
+
+static period_ms_t boottime_ms() {
+  struct timespec ts;
+  clock_gettime(CLOCK_BOOTTIME, &ts);
+  return (ts.tv_sec * 1000LL) + (ts.tv_nsec / 1000000LL);
+}
+
+static std::vector<alarm_t*> new_alarms(int count) {
+  std::vector<alarm_t*> alarms;
+  for (int i = 0; i < count; i++) {
+    std::string name = "alarm_benchmark." + std::to_string(i);
+    alarms.push_back(alarm_new(name.c_str()));
+  }
+  return alarms;
+}
+
+static void free_alarms(std::vector<alarm_t*>& alarms) {
+  for (alarm_t* alarm : alarms) alarm_free(alarm);
+}
+
+static void never_cb(void* data) {}
+
+// Arms and cancels protocol-style timeouts (1s to 10min) that never fire.
+static void BM_AlarmSetCancel(State& state) {
+  std::vector<alarm_t*> alarms = new_alarms(state.range(0));
+
+  for (auto _ : state) {
+    for (size_t i = 0; i < alarms.size(); i++)
+      alarm_set(alarms[i], 1000 + (i * 7919) % 600000, never_cb, NULL);
+    for (alarm_t* alarm : alarms) alarm_cancel(alarm);
+  }
+  state.SetItemsProcessed(state.iterations() * alarms.size() * 2);
+
+  free_alarms(alarms);
+}
+BENCHMARK(BM_AlarmSetCancel)->BENCHMARK_ALARM_COUNTS;
+
+typedef struct {
+  period_ms_t deadline;
+  period_ms_t fired;
+} firing_t;
+
+static std::atomic<int> pending_firings;
+static semaphore_t* all_fired;
+
+static void record_firing_cb(void* data) {
+  firing_t* firing = static_cast<firing_t*>(data);
+  firing->fired = boottime_ms();
+  if (--pending_firings == 0) semaphore_post(all_fired);
+}
+
+// Lateness of each callback relative to its deadline, with every alarm
+// pending at once.
+static void BM_AlarmFiringJitter(State& state) {
+  std::vector<alarm_t*> alarms = new_alarms(state.range(0));
+  std::vector<firing_t> firings(alarms.size());
+  all_fired = semaphore_new(0);
+
+  period_ms_t total_late_ms = 0;
+  period_ms_t max_late_ms = 0;
+  for (auto _ : state) {
+    pending_firings = alarms.size();
+    for (size_t i = 0; i < alarms.size(); i++) {
+      period_ms_t interval_ms = 10 + (i * 7919) % FIRING_WINDOW_MS;
+      firings[i].deadline = boottime_ms() + interval_ms;
+      alarm_set(alarms[i], interval_ms, record_firing_cb, &firings[i]);
+    }
+    semaphore_wait(all_fired);
+
+    for (const firing_t& firing : firings) {
+      period_ms_t late_ms =
+          firing.fired > firing.deadline ? firing.fired - firing.deadline : 0;
+      total_late_ms += late_ms;
+      if (late_ms > max_late_ms) max_late_ms = late_ms;
+    }
+  }
+  state.counters["mean_late_ms"] =
+      (double)total_late_ms / (state.iterations() * alarms.size());
+  state.counters["max_late_ms"] = max_late_ms;
+
+  semaphore_free(all_fired);
+  free_alarms(alarms);
+}
+BENCHMARK(BM_AlarmFiringJitter)
+    ->BENCHMARK_ALARM_COUNTS
+    ->Iterations(5)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+int main(int argc, char** argv) {
+  // Off device there is no wakelock to take; without one, short alarms would
+  // never be armed.
+  wakelock_set_os_callouts(&bt_wakelock_callouts);
+
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  ::benchmark::RunSpecifiedBenchmarks();
+
+  alarm_cleanup();
+  wakelock_cleanup();
+  return 0;
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "osi/include/allocation_tracker.h"
+#include "osi/include/allocator.h"
+#include "osi/include/slab_allocator.h"
+
+using ::benchmark::State;
+
+// Typical BT_HDR payload sizes: HCI event, LE ACL, BR/EDR 2-DH5 ACL,
+// BT_DEFAULT_BUFFER_SIZE.
+#define BENCHMARK_BUFFER_SIZES Arg(64)->Arg(264)->Arg(1021)->Arg(4112)
+
+// Number of buffers kept in flight per iteration, modelling a queue of
+// packets waiting for controller credits.
+#define IN_FLIGHT_BUFFERS 64
+
+static const allocator_id_t kBenchmarkAllocatorId = 99;
+
+// The pre-slab osi_malloc path: glibc malloc with allocation tracker
+// bookkeeping.
+static void* system_alloc(size_t size) {
+  void* ptr = malloc(allocation_tracker_resize_for_canary(size));
+  return allocation_tracker_notify_alloc(kBenchmarkAllocatorId, ptr, size);
+}
+
+static void system_free(void* ptr) {
+  free(allocation_tracker_notify_free(kBenchmarkAllocatorId, ptr));
+}
+
+static void run_alloc_free(State& state, void* (*alloc)(size_t),
+                           void (*release)(void*)) {
+  size_t size = state.range(0);
+  void* buffers[IN_FLIGHT_BUFFERS];
+  for (auto _ : state) {
+    for (int i = 0; i < IN_FLIGHT_BUFFERS; i++) {
+      buffers[i] = alloc(size);
+      memset(buffers[i], 0, 16);  // Touch the BT_HDR
+    }
+    for (int i = 0; i < IN_FLIGHT_BUFFERS; i++) release(buffers[i]);
+  }
+  state.SetItemsProcessed(state.iterations() * IN_FLIGHT_BUFFERS);
+}
+
+static void BM_SystemMalloc(State& state) {
+  run_alloc_free(state, system_alloc, system_free);
+}
+BENCHMARK(BM_SystemMalloc)->BENCHMARK_BUFFER_SIZES->ThreadRange(1, 8);
+
+static void BM_OsiMalloc(State& state) {
+  run_alloc_free(state, osi_malloc, osi_free);
+}
+BENCHMARK(BM_OsiMalloc)->BENCHMARK_BUFFER_SIZES->ThreadRange(1, 8);
+
+// Allocator without tracker overhead, to isolate the cost of the slabs.
+static void BM_SlabAllocator(State& state) {
+  run_alloc_free(state, slab_allocator_alloc, slab_allocator_free);
+}
+BENCHMARK(BM_SlabAllocator)->BENCHMARK_BUFFER_SIZES->ThreadRange(1, 8);
+
+static void BM_RawMalloc(State& state) {
+  run_alloc_free(state, malloc, free);
+}
+BENCHMARK(BM_RawMalloc)->BENCHMARK_BUFFER_SIZES->ThreadRange(1, 8);
+
+int main(int argc, char** argv) {
+  // The tracker is always enabled on device; turn it on before any benchmark
+  // thread starts so that no allocation straddles the switch.
+  allocation_tracker_init();
+
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  ::benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
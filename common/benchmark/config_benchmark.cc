@@ -0,0 +1,164 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#include "osi/include/config.h"
+
+using ::benchmark::State;
+
+// Roughly what btif_config writes for a bonded LE/BR-EDR device.
+static const char* kDeviceKeys[] = {
+    "Name",         "DevClass",     "DevType",       "AddrType",
+    "Timestamp",    "LinkKeyType",  "PinLength",     "LinkKey",
+    "Service",      "LE_KEY_PENC",  "LE_KEY_PID",    "LE_KEY_PCSRK",
+    "LE_KEY_LENC",  "LE_KEY_LCSRK", "Manufacturer",  "LmpVer",
+    "LmpSubVer",    "AvrcpCtVersion"};
+
+#define NUM_DEVICE_KEYS (sizeof(kDeviceKeys) / sizeof(kDeviceKeys[0]))
+
+static std::string device_address(int index) {
+  char address[18];
+  snprintf(address, sizeof(address), "00:11:22:%02x:%02x:%02x",
+           (index >> 16) & 0xff, (index >> 8) & 0xff, index & 0xff);
+  return address;
+}
+
+// Writes a bt_config.conf with |num_devices| device sections and returns its
+// path.
+static std::string write_config_file(int num_devices) {
+  char path[] = "/tmp/bt_config_benchmark_XXXXXX";
+  int fd = mkstemp(path);
+  FILE* fp = fdopen(fd, "w");
+
+  fprintf(fp, "[Info]\nFileSource = Empty\nTimeCreated = 2019-01-01\n\n");
+  fprintf(fp, "[Adapter]\nAddress = 00:11:22:33:44:55\nName = benchmark\n\n");
+  for (int i = 0; i < num_devices; i++) {
+    fprintf(fp, "[%s]\n", device_address(i).c_str());
+    for (const char* key : kDeviceKeys)
+      fprintf(fp, "%s = 00112233445566778899aabbccddeeff\n", key);
+    fprintf(fp, "\n");
+  }
+  fclose(fp);
+  return path;
+}
+
+static void BM_ConfigParse(State& state) {
+  std::string path = write_config_file(state.range(0));
+  for (auto _ : state) {
+    config_t* config = config_new(path.c_str());
+    benchmark::DoNotOptimize(config);
+    config_free(config);
+  }
+  unlink(path.c_str());
+}
+BENCHMARK(BM_ConfigParse)->Arg(100)->Arg(1000);
+
+static void BM_ConfigLookup(State& state) {
+  int num_devices = state.range(0);
+  std::string path = write_config_file(num_devices);
+  config_t* config = config_new(path.c_str());
+
+  std::vector<std::string> addresses;
+  for (int i = 0; i < num_devices; i++) addresses.push_back(device_address(i));
+
+  // Walk devices in a stride so consecutive lookups hit different sections.
+  size_t n = 0;
+  for (auto _ : state) {
+    const std::string& address = addresses[(n * 7919) % num_devices];
+    const char* key = kDeviceKeys[n % NUM_DEVICE_KEYS];
+    benchmark::DoNotOptimize(
+        config_get_string(config, address.c_str(), key, NULL));
+    n++;
+  }
+  state.SetItemsProcessed(state.iterations());
+
+  config_free(config);
+  unlink(path.c_str());
+}
+BENCHMARK(BM_ConfigLookup)->Arg(100)->Arg(1000);
+
+// Contended access in the style of btif_config: many threads look up keys in
+// one shared config and one operation in |CONTENDED_WRITE_INTERVAL| is a
+// write. Compares the old recursive_mutex with the reader/writer lock.
+#define CONTENDED_DEVICES 1000
+#define CONTENDED_WRITE_INTERVAL 1024
+
+static std::recursive_mutex contended_recursive_lock;
+static std::shared_timed_mutex contended_shared_lock;
+static std::atomic<size_t> contended_thread_count;
+
+// Shared by every thread of every run; it lives until the process exits.
+static config_t* contended_config() {
+  static config_t* config = []() {
+    std::string path = write_config_file(CONTENDED_DEVICES);
+    config_t* config = config_new(path.c_str());
+    unlink(path.c_str());
+    return config;
+  }();
+  return config;
+}
+
+template <typename ReadLock, typename WriteLock, typename Mutex>
+static void run_contended(State& state, Mutex& mutex) {
+  std::vector<std::string> addresses;
+  for (int i = 0; i < CONTENDED_DEVICES; i++)
+    addresses.push_back(device_address(i));
+
+  config_t* config = contended_config();
+  // Start each thread at a different device.
+  size_t n = contended_thread_count++ * 104729;
+  for (auto _ : state) {
+    const std::string& address = addresses[(n * 7919) % CONTENDED_DEVICES];
+    const char* key = kDeviceKeys[n % NUM_DEVICE_KEYS];
+    if (n % CONTENDED_WRITE_INTERVAL == 0) {
+      WriteLock lock(mutex);
+      config_set_string(config, address.c_str(), key,
+                        "ffeeddccbbaa99887766554433221100");
+    } else {
+      ReadLock lock(mutex);
+      benchmark::DoNotOptimize(
+          config_get_string(config, address.c_str(), key, NULL));
+    }
+    n++;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_ConfigContendedRecursiveMutex(State& state) {
+  run_contended<std::unique_lock<std::recursive_mutex>,
+                std::unique_lock<std::recursive_mutex>>(
+      state, contended_recursive_lock);
+}
+BENCHMARK(BM_ConfigContendedRecursiveMutex)->ThreadRange(1, 16)->UseRealTime();
+
+static void BM_ConfigContendedSharedMutex(State& state) {
+  run_contended<std::shared_lock<std::shared_timed_mutex>,
+                std::unique_lock<std::shared_timed_mutex>>(
+      state, contended_shared_lock);
+}
+BENCHMARK(BM_ConfigContendedSharedMutex)->ThreadRange(1, 16)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -19,12 +19,16 @@
 #include <base/run_loop.h>
 #include <base/threading/thread.h>
 #include <benchmark/benchmark.h>
+#include <algorithm>
+#include <chrono>
 #include <memory>
 #include <thread>
+#include <vector>
 
 #include "common/execution_barrier.h"
 #include "common/message_loop_thread.h"
 #include "osi/include/fixed_queue.h"
+#include "osi/include/ring_queue.h"
 #include "osi/include/thread.h"
 
 using ::benchmark::State;
@@ -32,6 +36,7 @@ using bluetooth::common::ExecutionBarrier;
 using bluetooth::common::MessageLoopThread;
 
 #define NUM_MESSAGES_TO_SEND 100000
+#define RING_QUEUE_CAPACITY 1024
 
 volatile static int g_counter = 0;
 static std::unique_ptr<ExecutionBarrier> g_counter_barrier = nullptr;
@@ -63,6 +68,54 @@ void callback_batch(fixed_queue_t* queue, void* data) {
   }
 }
 
+void ring_callback_batch(ring_queue_t* queue, void* data) {
+  CHECK_NE(queue, nullptr);
+  ring_queue_try_dequeue(queue);
+  g_counter++;
+  if (g_counter >= NUM_MESSAGES_TO_SEND) {
+    g_counter_barrier->NotifyFinished();
+  }
+}
+
+// Enqueue-to-callback latency of the message currently in flight, used by the
+// sequential benchmarks to report tail latency.
+static std::chrono::steady_clock::time_point g_enqueue_time;
+static std::vector<int64_t> g_latencies_ns;
+
+static void record_latency() {
+  auto latency = std::chrono::steady_clock::now() - g_enqueue_time;
+  g_latencies_ns.push_back(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count());
+}
+
+static void report_latency(State& state) {
+  if (g_latencies_ns.empty()) return;
+  std::sort(g_latencies_ns.begin(), g_latencies_ns.end());
+  auto percentile = [](double p) {
+    size_t index = static_cast<size_t>(p * (g_latencies_ns.size() - 1));
+    return static_cast<double>(g_latencies_ns[index]);
+  };
+  state.counters["p50_ns"] = percentile(0.50);
+  state.counters["p99_ns"] = percentile(0.99);
+  state.counters["p999_ns"] = percentile(0.999);
+  state.counters["max_ns"] = static_cast<double>(g_latencies_ns.back());
+  g_latencies_ns.clear();
+}
+
+void callback_sequential_queue_latency(fixed_queue_t* queue, void* context) {
+  CHECK_NE(queue, nullptr);
+  fixed_queue_dequeue(queue);
+  record_latency();
+  g_counter_barrier->NotifyFinished();
+}
+
+void ring_callback_sequential_latency(ring_queue_t* queue, void* context) {
+  CHECK_NE(queue, nullptr);
+  ring_queue_try_dequeue(queue);
+  record_latency();
+  g_counter_barrier->NotifyFinished();
+}
+
 class BM_ThreadPerformance : public ::benchmark::Fixture {
  protected:
   void SetUp(State& st) override {
@@ -308,6 +361,87 @@ BENCHMARK_F(BM_OsiReactorThread, sequential_execution_using_reactor)
   }
 };
 
+BENCHMARK_F(BM_OsiReactorThread, batch_enque_dequeue_using_reactor_msgs)
+(State& state) {
+  fixed_queue_register_dequeue(bt_msg_queue_, thread_get_reactor(thread_),
+                               callback_batch, nullptr);
+  for (auto _ : state) {
+    g_counter = 0;
+    g_counter_barrier = std::make_unique<ExecutionBarrier>();
+    for (int i = 0; i < NUM_MESSAGES_TO_SEND; i++) {
+      fixed_queue_enqueue(bt_msg_queue_, (void*)&g_counter);
+    }
+    g_counter_barrier->WaitForExecution();
+  }
+  state.SetItemsProcessed(state.iterations() * NUM_MESSAGES_TO_SEND);
+};
+
+BENCHMARK_F(BM_OsiReactorThread, sequential_latency_using_reactor)
+(State& state) {
+  fixed_queue_register_dequeue(bt_msg_queue_, thread_get_reactor(thread_),
+                               callback_sequential_queue_latency, nullptr);
+  for (auto _ : state) {
+    for (int i = 0; i < NUM_MESSAGES_TO_SEND; i++) {
+      g_counter_barrier = std::make_unique<ExecutionBarrier>();
+      g_enqueue_time = std::chrono::steady_clock::now();
+      fixed_queue_enqueue(bt_msg_queue_, (void*)&g_counter);
+      g_counter_barrier->WaitForExecution();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * NUM_MESSAGES_TO_SEND);
+  report_latency(state);
+};
+
+// Same workloads as above, with the lock-free ring_queue_t in place of
+// fixed_queue_t.
+class BM_OsiReactorRingQueue : public BM_OsiReactorThread {
+ protected:
+  void SetUp(State& st) override {
+    BM_OsiReactorThread::SetUp(st);
+    ring_queue_ = ring_queue_new(RING_QUEUE_CAPACITY);
+  }
+
+  void TearDown(State& st) override {
+    ring_queue_unregister_dequeue(ring_queue_);
+    ring_queue_free(ring_queue_, nullptr);
+    ring_queue_ = nullptr;
+    BM_OsiReactorThread::TearDown(st);
+  }
+
+  ring_queue_t* ring_queue_ = nullptr;
+};
+
+BENCHMARK_F(BM_OsiReactorRingQueue, batch_enque_dequeue_using_reactor_msgs)
+(State& state) {
+  ring_queue_register_dequeue(ring_queue_, thread_get_reactor(thread_),
+                              ring_callback_batch, nullptr);
+  for (auto _ : state) {
+    g_counter = 0;
+    g_counter_barrier = std::make_unique<ExecutionBarrier>();
+    for (int i = 0; i < NUM_MESSAGES_TO_SEND; i++) {
+      ring_queue_enqueue(ring_queue_, (void*)&g_counter);
+    }
+    g_counter_barrier->WaitForExecution();
+  }
+  state.SetItemsProcessed(state.iterations() * NUM_MESSAGES_TO_SEND);
+};
+
+BENCHMARK_F(BM_OsiReactorRingQueue, sequential_latency_using_reactor)
+(State& state) {
+  ring_queue_register_dequeue(ring_queue_, thread_get_reactor(thread_),
+                              ring_callback_sequential_latency, nullptr);
+  for (auto _ : state) {
+    for (int i = 0; i < NUM_MESSAGES_TO_SEND; i++) {
+      g_counter_barrier = std::make_unique<ExecutionBarrier>();
+      g_enqueue_time = std::chrono::steady_clock::now();
+      ring_queue_enqueue(ring_queue_, (void*)&g_counter);
+      g_counter_barrier->WaitForExecution();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * NUM_MESSAGES_TO_SEND);
+  report_latency(state);
+};
+
 class BM_MessageLooopThread : public BM_ThreadPerformance {
  protected:
   void SetUp(State& st) override {
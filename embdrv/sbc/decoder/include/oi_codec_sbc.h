@@ -395,6 +395,48 @@ OI_STATUS OI_CODEC_SBC_DecodeFrame(OI_CODEC_SBC_DECODER_CONTEXT* context,
                                    uint32_t* frameBytes, int16_t* pcmData,
                                    uint32_t* pcmBytes);
 
+/**
+ * Decode consecutive SBC frames, such as all the frames of a media packet,
+ * into one PCM buffer.
+ *
+ * Decoding stops after *frameCount frames, when the frame data is used up,
+ * or at the first frame that cannot be decoded. The frames decoded before
+ * that remain valid.
+ *
+ * @param context       Pointer to a decoder context structure. The same context
+ *                      must be used each time when decoding from the same
+ *                      stream.
+ *
+ * @param frameData     Address of a pointer to the SBC data to decode. This
+ *                      value will be updated to point past the last frame
+ *                      decoded.
+ *
+ * @param frameBytes    Pointer to a uint32_t containing the number of available
+ *                      bytes of frame data. This value will be updated to
+ *                      reflect the number of bytes remaining.
+ *
+ * @param pcmData       Address of an array of int16_t pairs, which will be
+ *                      populated with the decoded audio data of all frames
+ *                      back to back. This address is not updated.
+ *
+ * @param pcmBytes      Pointer to a uint32_t in/out parameter. On input, it
+ *                      should contain the number of bytes available for pcm
+ *                      data. On output, it will contain the number of bytes
+ *                      written.
+ *
+ * @param frameCount    Pointer to a uint32_t in/out parameter. On input, it
+ *                      should contain the maximum number of frames to decode.
+ *                      On output, it will contain the number of frames
+ *                      decoded.
+ *
+ * @return OI_OK if decoding stopped because of frameCount or frameBytes,
+ *         otherwise the status of the frame that failed to decode.
+ */
+OI_STATUS OI_CODEC_SBC_DecodeFrames(OI_CODEC_SBC_DECODER_CONTEXT* context,
+                                    const OI_BYTE** frameData,
+                                    uint32_t* frameBytes, int16_t* pcmData,
+                                    uint32_t* pcmBytes, uint32_t* frameCount);
+
 /**
  * Calculate the number of SBC frames but don't decode. CRC's are not checked,
  * but the Sync word is found prior to count calculation.
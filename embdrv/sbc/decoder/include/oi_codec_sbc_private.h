@@ -20,6 +20,10 @@
 #ifndef _OI_CODEC_SBC_PRIVATE_H
 #define _OI_CODEC_SBC_PRIVATE_H
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /*******************************************************************************
   $Revision: #1 $
  ******************************************************************************/
@@ -127,6 +131,14 @@ typedef struct {
 
 #define DCT_SHIFT 15
 
+#define AAN_C4_FIX (759250125) /* S1.30  759250125   0.707107*/
+
+#define AAN_C6_FIX (410903207) /* S1.30  410903207   0.382683*/
+
+#define AAN_Q0_FIX (581104888) /* S1.30  581104888   0.541196*/
+
+#define AAN_Q1_FIX (1402911301) /* S1.30 1402911301   1.306563*/
+
 #define DCTIII_4_SHIFT_IN 2
 #define DCTIII_4_SHIFT_OUT 15
 
@@ -184,6 +196,13 @@ PRIVATE void cosineModulateSynth4(SBC_BUFFER_T* RESTRICT out,
 PRIVATE void SynthWindow40_int32_int32_symmetry_with_sum(
     int16_t* pcm, SBC_BUFFER_T buffer[80], OI_UINT strideShift);
 
+PRIVATE void dct2_8(SBC_BUFFER_T* RESTRICT out, int32_t const* RESTRICT x);
+PRIVATE void OI_SBC_DCT2_8Blocks(SBC_BUFFER_T* RESTRICT out,
+                                 int32_t const* RESTRICT in, OI_UINT count);
+PRIVATE void SynthWindow80_generated(int16_t* pcm,
+                                     SBC_BUFFER_T const* RESTRICT buffer,
+                                     OI_UINT strideShift);
+
 INLINE void dct3_4(int32_t* RESTRICT out, int32_t const* RESTRICT in);
 PRIVATE void analyze4_generated(SBC_BUFFER_T analysisBuffer[RESTRICT 40],
                                 int16_t* pcm, OI_UINT strideShift,
@@ -215,6 +234,10 @@ PRIVATE void OI_SBC_SynthFrame(OI_CODEC_SBC_DECODER_CONTEXT* context,
                                int16_t* pcm, OI_UINT start_block,
                                OI_UINT nrof_blocks);
 INLINE int32_t OI_SBC_Dequant(uint32_t raw, OI_UINT scale_factor, OI_UINT bits);
+PRIVATE void OI_SBC_DequantSamples(int32_t* RESTRICT s,
+                                   int8_t const* scale_factor,
+                                   uint8_t const* bits, OI_UINT rowCount,
+                                   OI_UINT sampleCount);
 PRIVATE OI_BOOL OI_SBC_ExamineCommandPacket(
     OI_CODEC_SBC_DECODER_CONTEXT* context, const OI_BYTE* data, uint32_t len);
 PRIVATE void OI_SBC_GenerateTestSignal(int16_t pcmData[][2],
@@ -225,8 +248,115 @@ PRIVATE OI_STATUS OI_CODEC_SBC_Alloc(OI_CODEC_SBC_COMMON_CONTEXT* common,
                                      uint32_t* codecDataAligned,
                                      uint32_t codecDataBytes,
                                      uint8_t maxChannels, uint8_t pcmStride);
+/**
+ * The inner loops of the decoder. OI_SBC_DecoderKernelsInit() points
+ * OI_SBC_DecoderKernels at the fastest set the CPU supports; every set
+ * produces exactly the same output as the generic C code.
+ */
+typedef struct {
+  /** Replaces the sampleCount raw samples at s by their dequantized values.
+   * Each group of rowCount samples (one block) uses scale_factor[0..rowCount)
+   * and bits[0..rowCount). */
+  void (*dequant)(int32_t* RESTRICT s, int8_t const* scale_factor,
+                  uint8_t const* bits, OI_UINT rowCount, OI_UINT sampleCount);
+  /** dct2_8() of count consecutive groups of 8 samples. */
+  void (*dct2_8)(SBC_BUFFER_T* RESTRICT out, int32_t const* RESTRICT in,
+                 OI_UINT count);
+  /** SynthWindow80_generated() */
+  void (*synthWindow80)(int16_t* pcm, SBC_BUFFER_T const* RESTRICT buffer,
+                        OI_UINT strideShift);
+} OI_SBC_DECODER_KERNELS;
+
+extern const OI_SBC_DECODER_KERNELS* OI_SBC_DecoderKernels;
+extern const OI_SBC_DECODER_KERNELS OI_SBC_DecoderKernelsGeneric;
+#if defined(__i386__) || defined(__x86_64__)
+extern const OI_SBC_DECODER_KERNELS OI_SBC_DecoderKernelsAVX2;
+#endif
+#if defined(__ARM_NEON)
+extern const OI_SBC_DECODER_KERNELS OI_SBC_DecoderKernelsNEON;
+#endif
+
+PRIVATE void OI_SBC_DecoderKernelsInit(void);
+
+/**
+ * SynthWindow80_generated() as a table. Output sample j is the sum over
+ * g = 0..4 of the terms
+ *
+ * @code
+ *     (coef[g][0][j] * buffer[16 * g + 4 + j]) >> shift[g][0][j]
+ *     (coef[g][1][j] * buffer[16 * g + 12 - j]) >> shift[g][1][j]
+ * @endcode
+ *
+ * divided by 32768. The left shifts of the generated code are folded into
+ * the coefficients, which is exact in wrapping 32 bit arithmetic.
+ */
+extern const int32_t OI_SBC_SynthWindow80Coef[5][2][8];
+extern const uint8_t OI_SBC_SynthWindow80Shift[5][2][8];
+
+/**
+ * dct2_8() on vectors holding independent inputs in each lane. The caller
+ * supplies the vector type and operations: SCALE(x, n) as SCALE() in
+ * synthesis-dct8.c, HALVE(x) as x / 2 and MULT(K, x) as FIX_MULT_DCT().
+ */
+#define OI_SBC_DCT2_8_LANES(VT, ADD, SUB, SCALE, HALVE, MULT, in, out) \
+  do {                                                                \
+    VT L00 = ADD(in[0], in[7]);                                       \
+    VT L01 = ADD(in[1], in[6]);                                       \
+    VT L02 = ADD(in[2], in[5]);                                       \
+    VT L03 = ADD(in[3], in[4]);                                       \
+    VT L04 = SUB(in[3], in[4]);                                       \
+    VT L05 = SUB(in[2], in[5]);                                       \
+    VT L06 = SUB(in[1], in[6]);                                       \
+    VT L07 = SUB(in[0], in[7]);                                       \
+    VT L25, t;                                                        \
+                                                                      \
+    t = ADD(L00, L03);                                                \
+    L03 = SUB(L00, L03);                                              \
+    L00 = t;                                                          \
+    t = ADD(L01, L02);                                                \
+    L02 = SUB(L01, L02);                                              \
+    L01 = t;                                                          \
+    L02 = MULT(AAN_C4_FIX, ADD(L02, L03));                            \
+    t = ADD(L00, L01);                                                \
+    L01 = SUB(L00, L01);                                              \
+    L00 = t;                                                          \
+    out[0] = SCALE(L00, DCTII_8_SHIFT_0);                             \
+    out[4] = SCALE(L01, DCTII_8_SHIFT_4);                             \
+    t = ADD(L03, L02);                                                \
+    L02 = SUB(L03, L02);                                              \
+    L03 = t;                                                          \
+    out[6] = SCALE(L02, DCTII_8_SHIFT_6);                             \
+    out[2] = SCALE(L03, DCTII_8_SHIFT_2);                             \
+                                                                      \
+    L04 = HALVE(ADD(L04, L05));                                       \
+    L05 = HALVE(ADD(L05, L06));                                       \
+    L06 = HALVE(ADD(L06, L07));                                       \
+    L07 = HALVE(L07);                                                 \
+    L05 = MULT(AAN_C4_FIX, L05);                                      \
+    L25 = MULT(AAN_C6_FIX, SUB(L06, L04));                            \
+    L04 = SUB(MULT(AAN_Q0_FIX, L04), L25);                            \
+    L06 = SUB(MULT(AAN_Q1_FIX, L06), L25);                            \
+    t = ADD(L07, L05);                                                \
+    L05 = SUB(L07, L05);                                              \
+    L07 = t;                                                          \
+    t = ADD(L05, L04);                                                \
+    L04 = SUB(L05, L04);                                              \
+    L05 = t;                                                          \
+    out[3] = SCALE(L04, DCTII_8_SHIFT_3 - 1);                         \
+    out[5] = SCALE(L05, DCTII_8_SHIFT_5 - 1);                         \
+    t = ADD(L07, L06);                                                \
+    L06 = SUB(L07, L06);                                              \
+    L07 = t;                                                          \
+    out[7] = SCALE(L06, DCTII_8_SHIFT_7 - 1);                         \
+    out[1] = SCALE(L07, DCTII_8_SHIFT_1 - 1);                         \
+  } while (0)
+
 /**
 @}
 */
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* _OI_CODEC_SBC_PRIVATE_H */
@@ -70,6 +70,8 @@ INLINE OI_STATUS internal_DecoderReset(OI_CODEC_SBC_DECODER_CONTEXT* context,
     return status;
   }
 
+  OI_SBC_DecoderKernelsInit();
+
   context->common.codecInfo = OI_Codec_Copyright;
   context->common.maxBitneed = 0;
   context->limitFrameFormat = FALSE;
@@ -189,36 +191,35 @@ PRIVATE void OI_SBC_ReadSamples(OI_CODEC_SBC_DECODER_CONTEXT* context,
   do {
     OI_UINT i;
     for (i = 0; i < iter_count; ++i) {
-      uint32_t sf_by4 = ((uint32_t*)common->scale_factor)[i];
       uint32_t bits_by4 = common->bits.uint32[i];
       OI_UINT n;
       for (n = 0; n < 4; ++n) {
-        int32_t dequant;
+        uint32_t raw;
         OI_UINT bits;
-        OI_INT sf;
 
         if (OI_CPU_BYTE_ORDER == OI_LITTLE_ENDIAN_BYTE_ORDER) {
           bits = bits_by4 & 0xFF;
           bits_by4 >>= 8;
-          sf = sf_by4 & 0xFF;
-          sf_by4 >>= 8;
         } else {
           bits = (bits_by4 >> 24) & 0xFF;
           bits_by4 <<= 8;
-          sf = (sf_by4 >> 24) & 0xFF;
-          sf_by4 <<= 8;
         }
         if (bits) {
-          uint32_t raw;
           OI_BITSTREAM_READUINT(raw, bits, ptr, value, bitPtr);
-          dequant = OI_SBC_Dequant(raw, sf, bits);
         } else {
-          dequant = 0;
+          raw = 0;
         }
-        *s++ = dequant;
+        *s++ = (int32_t)raw;
       }
     }
   } while (--nrof_blocks);
+
+  /* The samples are unpacked first and then dequantized all at once. */
+  OI_SBC_DecoderKernels->dequant(
+      common->subdata, common->scale_factor, common->bits.uint8,
+      common->frameInfo.nrof_channels * common->frameInfo.nrof_subbands,
+      common->frameInfo.nrof_channels * common->frameInfo.nrof_subbands *
+          common->frameInfo.nrof_blocks);
 }
 
 /**
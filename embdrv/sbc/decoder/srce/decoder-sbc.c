@@ -344,6 +344,36 @@ OI_STATUS OI_CODEC_SBC_DecodeFrame(OI_CODEC_SBC_DECODER_CONTEXT* context,
   return status;
 }
 
+OI_STATUS OI_CODEC_SBC_DecodeFrames(OI_CODEC_SBC_DECODER_CONTEXT* context,
+                                    const OI_BYTE** frameData,
+                                    uint32_t* frameBytes, int16_t* pcmData,
+                                    uint32_t* pcmBytes, uint32_t* frameCount) {
+  OI_STATUS status = OI_OK;
+  uint32_t maxFrames = *frameCount;
+  uint32_t availPcmBytes = *pcmBytes;
+  uint32_t framePcmBytes;
+
+  TRACE(("+OI_CODEC_SBC_DecodeFrames"));
+
+  *frameCount = 0;
+  *pcmBytes = 0;
+  while (*frameCount < maxFrames && *frameBytes != 0) {
+    framePcmBytes = availPcmBytes;
+    status = OI_CODEC_SBC_DecodeFrame(context, frameData, frameBytes, pcmData,
+                                      &framePcmBytes);
+    if (!OI_SUCCESS(status)) {
+      break;
+    }
+    availPcmBytes -= framePcmBytes;
+    pcmData += framePcmBytes / sizeof(int16_t);
+    *pcmBytes += framePcmBytes;
+    (*frameCount)++;
+  }
+
+  TRACE(("-OI_CODEC_SBC_DecodeFrames: %d", status));
+  return status;
+}
+
 OI_STATUS OI_CODEC_SBC_SkipFrame(OI_CODEC_SBC_DECODER_CONTEXT* context,
                                  const OI_BYTE** frameData,
                                  uint32_t* frameBytes) {
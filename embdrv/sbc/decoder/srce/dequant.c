@@ -180,6 +180,25 @@ INLINE int32_t OI_SBC_Dequant(uint32_t raw, OI_UINT scale_factor,
   return result >> (15 - scale_factor);
 }
 
+/* Dequantizes a frame's worth of raw samples in place. Each block holds
+ * rowCount samples, one per channel and subband, using the scale factor and
+ * bit allocation of its row. This is the generic version of
+ * OI_SBC_DecoderKernels->dequant. */
+PRIVATE void OI_SBC_DequantSamples(int32_t* RESTRICT s,
+                                   int8_t const* scale_factor,
+                                   uint8_t const* bits, OI_UINT rowCount,
+                                   OI_UINT sampleCount) {
+  OI_UINT i;
+  OI_UINT row;
+
+  for (i = 0; i < sampleCount; i += rowCount) {
+    for (row = 0; row < rowCount; row++) {
+      s[i + row] =
+          OI_SBC_Dequant((uint32_t)s[i + row], scale_factor[row], bits[row]);
+    }
+  }
+}
+
 /* This version of Dequant does not incorporate the scaling factor of 1.38. It
  * is intended for use with implementations of the filterbank which are
  * hard-coded into a DSP. Output is Q16.4 format, so that after joint stereo
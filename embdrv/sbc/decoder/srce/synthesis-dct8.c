@@ -37,14 +37,6 @@
 
 #include "oi_codec_sbc_private.h"
 
-#define AAN_C4_FIX (759250125) /* S1.30  759250125   0.707107*/
-
-#define AAN_C6_FIX (410903207) /* S1.30  410903207   0.382683*/
-
-#define AAN_Q0_FIX (581104888) /* S1.30  581104888   0.541196*/
-
-#define AAN_Q1_FIX (1402911301) /* S1.30 1402911301   1.306563*/
-
 /** Scales x by y bits to the right, adding a rounding factor.
  */
 #ifndef SCALE
@@ -344,4 +336,18 @@ PRIVATE void dct2_8(SBC_BUFFER_T* RESTRICT out, int32_t const* RESTRICT in) {
 #endif
 }
 
+/*
+ * dct2_8() of count consecutive groups of 8 inputs, written to consecutive
+ * groups of 8 outputs. This is the generic version of
+ * OI_SBC_DecoderKernels->dct2_8.
+ */
+PRIVATE void OI_SBC_DCT2_8Blocks(SBC_BUFFER_T* RESTRICT out,
+                                 int32_t const* RESTRICT in, OI_UINT count) {
+  while (count--) {
+    dct2_8(out, in);
+    out += 8;
+    in += 8;
+  }
+}
+
 /**@}*/
@@ -0,0 +1,184 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/** @file
+
+NEON versions of the decoder inner loops.
+
+@ingroup codec_internal
+*/
+
+/**@addtogroup codec_internal */
+/**@{*/
+
+#include "oi_codec_sbc_private.h"
+
+#if defined(__ARM_NEON)
+
+#include <arm_neon.h>
+
+extern const uint32_t dequant_long_scaled[17];
+
+#ifndef SBC_DEQUANT_LONG_SCALED_OFFSET
+#define SBC_DEQUANT_LONG_SCALED_OFFSET 1555931970
+#endif
+
+/* Four samples at a time in frame order. A block has 4, 8 or 16 samples, so
+ * the parameters of each lane repeat every 16 samples. */
+static void dequant_neon(int32_t* RESTRICT s, int8_t const* scale_factor,
+                         uint8_t const* bits, OI_UINT rowCount,
+                         OI_UINT sampleCount) {
+  uint32_t scale[16], mask[16];
+  int32_t shift[16];
+  const uint32x4_t one = vdupq_n_u32(1);
+  const uint32x4_t offset = vdupq_n_u32(SBC_DEQUANT_LONG_SCALED_OFFSET);
+  OI_UINT i, k;
+
+  for (i = 0; i < 16; i++) {
+    k = i % rowCount;
+    scale[i] = dequant_long_scaled[bits[k]];
+    /* negative counts shift right */
+    shift[i] = scale_factor[k] - 15;
+    mask[i] = bits[k] > 1 ? 0xFFFFFFFF : 0;
+  }
+
+  for (i = 0; i < sampleCount; i += 4) {
+    uint32x4_t d = vld1q_u32((uint32_t*)s + i);
+    int32x4_t r;
+    k = i & 15;
+    d = vmulq_u32(vaddq_u32(vshlq_n_u32(d, 1), one), vld1q_u32(scale + k));
+    r = vshlq_s32(vreinterpretq_s32_u32(vsubq_u32(d, offset)),
+                  vld1q_s32(shift + k));
+    r = vreinterpretq_s32_u32(
+        vandq_u32(vreinterpretq_u32_s32(r), vld1q_u32(mask + k)));
+    vst1q_s32(s + i, r);
+  }
+}
+
+#define SCALE_NEON(x, n) \
+  vshrq_n_s32(vaddq_s32(x, vdupq_n_s32(1 << ((n)-1))), n)
+
+/* x / 2, rounding towards zero */
+static inline int32x4_t halve_neon(int32x4_t x) {
+  return vshrq_n_s32(
+      vaddq_s32(x, vreinterpretq_s32_u32(
+                       vshrq_n_u32(vreinterpretq_u32_s32(x), 31))),
+      1);
+}
+
+/* FIX_MULT_DCT() of every lane */
+static inline int32x4_t mult_dct_neon(int32_t k, int32x4_t x) {
+  const int32x2_t vk = vdup_n_s32(k);
+  int32x4_t hi = vcombine_s32(vshrn_n_s64(vmull_s32(vget_low_s32(x), vk), 32),
+                              vshrn_n_s64(vmull_s32(vget_high_s32(x), vk), 32));
+  return vshlq_n_s32(hi, 2);
+}
+
+/* Transposes the 4x4 32 bit matrix in r0..r3 */
+#define TRANSPOSE4_NEON(r0, r1, r2, r3)                                    \
+  do {                                                                     \
+    int32x4x2_t t01 = vtrnq_s32(r0, r1);                                   \
+    int32x4x2_t t23 = vtrnq_s32(r2, r3);                                   \
+    r0 = vcombine_s32(vget_low_s32(t01.val[0]), vget_low_s32(t23.val[0])); \
+    r1 = vcombine_s32(vget_low_s32(t01.val[1]), vget_low_s32(t23.val[1])); \
+    r2 = vcombine_s32(vget_high_s32(t01.val[0]),                           \
+                      vget_high_s32(t23.val[0]));                          \
+    r3 = vcombine_s32(vget_high_s32(t01.val[1]),                           \
+                      vget_high_s32(t23.val[1]));                          \
+  } while (0)
+
+/* Four groups at a time, one per lane */
+static void dct2_8_neon(SBC_BUFFER_T* RESTRICT out,
+                        int32_t const* RESTRICT in, OI_UINT count) {
+  int32x4_t x[8], y[8];
+  int i;
+
+  for (; count >= 4; count -= 4) {
+    for (i = 0; i < 4; i++) {
+      x[i] = vld1q_s32(in + 8 * i);
+      x[i + 4] = vld1q_s32(in + 8 * i + 4);
+    }
+    TRANSPOSE4_NEON(x[0], x[1], x[2], x[3]);
+    TRANSPOSE4_NEON(x[4], x[5], x[6], x[7]);
+    OI_SBC_DCT2_8_LANES(int32x4_t, vaddq_s32, vsubq_s32, SCALE_NEON,
+                        halve_neon, mult_dct_neon, x, y);
+    TRANSPOSE4_NEON(y[0], y[1], y[2], y[3]);
+    TRANSPOSE4_NEON(y[4], y[5], y[6], y[7]);
+    for (i = 0; i < 4; i++) {
+      /* vmovn truncates like the (int16_t) casts in dct2_8() */
+      vst1q_s16(out + 8 * i, vcombine_s16(vmovn_s32(y[i]), vmovn_s32(y[i + 4])));
+    }
+    in += 32;
+    out += 32;
+  }
+  OI_SBC_DCT2_8Blocks(out, in, count);
+}
+
+/* All eight outputs at once, as two halves: the first term of each pair
+ * reads buffer[16 * g + 4 .. 16 * g + 11] and the second reads
+ * buffer[16 * g + 5 .. 16 * g + 12] in reverse. */
+static void synth_window80_neon(int16_t* pcm,
+                                SBC_BUFFER_T const* RESTRICT buffer,
+                                OI_UINT strideShift) {
+  int32x4_t lo = vdupq_n_s32(0);
+  int32x4_t hi = vdupq_n_s32(0);
+  int16x8_t x[2], out;
+  int g, h;
+
+  for (g = 0; g < 5; g++) {
+    x[0] = vld1q_s16(buffer + 16 * g + 4);
+    x[1] = vrev64q_s16(vld1q_s16(buffer + 16 * g + 5));
+    x[1] = vcombine_s16(vget_high_s16(x[1]), vget_low_s16(x[1]));
+    for (h = 0; h < 2; h++) {
+      const int32_t* coef = OI_SBC_SynthWindow80Coef[g][h];
+      /* negative counts shift right */
+      int16x8_t shift = vnegq_s16(vreinterpretq_s16_u16(
+          vmovl_u8(vld1_u8(OI_SBC_SynthWindow80Shift[g][h]))));
+      lo = vaddq_s32(lo, vshlq_s32(vmulq_s32(vmovl_s16(vget_low_s16(x[h])),
+                                             vld1q_s32(coef)),
+                                   vmovl_s16(vget_low_s16(shift))));
+      hi = vaddq_s32(hi, vshlq_s32(vmulq_s32(vmovl_s16(vget_high_s16(x[h])),
+                                             vld1q_s32(coef + 4)),
+                                   vmovl_s16(vget_high_s16(shift))));
+    }
+  }
+
+  /* / 32768, rounding towards zero, then clipped to 16 bits */
+  lo = vaddq_s32(lo, vandq_s32(vshrq_n_s32(lo, 31), vdupq_n_s32(32767)));
+  hi = vaddq_s32(hi, vandq_s32(vshrq_n_s32(hi, 31), vdupq_n_s32(32767)));
+  out = vcombine_s16(vqmovn_s32(vshrq_n_s32(lo, 15)),
+                     vqmovn_s32(vshrq_n_s32(hi, 15)));
+
+  if (strideShift == 0) {
+    vst1q_s16(pcm, out);
+  } else {
+    int16_t samples[8];
+    vst1q_s16(samples, out);
+    for (h = 0; h < 8; h++) {
+      pcm[h << strideShift] = samples[h];
+    }
+  }
+}
+
+const OI_SBC_DECODER_KERNELS OI_SBC_DecoderKernelsNEON = {
+    dequant_neon, dct2_8_neon, synth_window80_neon,
+};
+
+#endif
+
+/**@}*/
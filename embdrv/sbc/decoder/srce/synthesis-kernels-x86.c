@@ -0,0 +1,197 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/** @file
+
+AVX2 versions of the decoder inner loops. They are compiled with a target
+attribute and only selected by OI_SBC_DecoderKernelsInit() when the CPU
+supports AVX2. SSE2 alone has no per-lane shifts, which both the
+dequantizer and the synthesis window need, so older CPUs keep the generic
+code.
+
+@ingroup codec_internal
+*/
+
+/**@addtogroup codec_internal */
+/**@{*/
+
+#include "oi_codec_sbc_private.h"
+
+#if defined(__i386__) || defined(__x86_64__)
+
+#include <immintrin.h>
+
+#define OI_AVX2 __attribute__((target("avx2")))
+
+extern const uint32_t dequant_long_scaled[17];
+
+#ifndef SBC_DEQUANT_LONG_SCALED_OFFSET
+#define SBC_DEQUANT_LONG_SCALED_OFFSET 1555931970
+#endif
+
+/* Eight samples at a time in frame order. A block has 4, 8 or 16 samples, so
+ * the parameters of each lane repeat every 16 samples. */
+static OI_AVX2 void dequant_avx2(int32_t* RESTRICT s,
+                                 int8_t const* scale_factor,
+                                 uint8_t const* bits, OI_UINT rowCount,
+                                 OI_UINT sampleCount) {
+  int32_t scale[16], shift[16], mask[16];
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i offset = _mm256_set1_epi32(SBC_DEQUANT_LONG_SCALED_OFFSET);
+  OI_UINT i, k;
+
+  for (i = 0; i < 16; i++) {
+    k = i % rowCount;
+    scale[i] = (int32_t)dequant_long_scaled[bits[k]];
+    shift[i] = 15 - scale_factor[k];
+    mask[i] = bits[k] > 1 ? -1 : 0;
+  }
+
+  for (i = 0; i < sampleCount; i += 8) {
+    __m256i d = _mm256_loadu_si256((__m256i const*)(s + i));
+    k = i & 15;
+    d = _mm256_add_epi32(_mm256_add_epi32(d, d), one);
+    d = _mm256_mullo_epi32(
+        d, _mm256_loadu_si256((__m256i const*)(scale + k)));
+    d = _mm256_srav_epi32(_mm256_sub_epi32(d, offset),
+                          _mm256_loadu_si256((__m256i const*)(shift + k)));
+    d = _mm256_and_si256(d, _mm256_loadu_si256((__m256i const*)(mask + k)));
+    _mm256_storeu_si256((__m256i*)(s + i), d);
+  }
+}
+
+static OI_AVX2 inline __m256i scale_avx2(__m256i x, int n) {
+  return _mm256_srai_epi32(_mm256_add_epi32(x, _mm256_set1_epi32(1 << (n - 1))),
+                           n);
+}
+
+/* x / 2, rounding towards zero */
+static OI_AVX2 inline __m256i halve_avx2(__m256i x) {
+  return _mm256_srai_epi32(_mm256_add_epi32(x, _mm256_srli_epi32(x, 31)), 1);
+}
+
+/* FIX_MULT_DCT() of every lane */
+static OI_AVX2 inline __m256i mult_dct_avx2(int32_t k, __m256i x) {
+  const __m256i vk = _mm256_set1_epi32(k);
+  __m256i even = _mm256_srli_epi64(_mm256_mul_epi32(x, vk), 32);
+  __m256i odd = _mm256_mul_epi32(_mm256_srli_epi64(x, 32), vk);
+  return _mm256_slli_epi32(_mm256_blend_epi32(even, odd, 0xAA), 2);
+}
+
+static OI_AVX2 void transpose8_avx2(__m256i r[8]) {
+  __m256i t[8], u[8];
+  int i;
+
+  for (i = 0; i < 8; i += 2) {
+    t[i] = _mm256_unpacklo_epi32(r[i], r[i + 1]);
+    t[i + 1] = _mm256_unpackhi_epi32(r[i], r[i + 1]);
+  }
+  for (i = 0; i < 8; i += 4) {
+    u[i] = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+    u[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+    u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+    u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+  }
+  for (i = 0; i < 4; i++) {
+    r[i] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x20);
+    r[i + 4] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x31);
+  }
+}
+
+/* Eight groups at a time, one per lane */
+static OI_AVX2 void dct2_8_avx2(SBC_BUFFER_T* RESTRICT out,
+                                int32_t const* RESTRICT in, OI_UINT count) {
+  __m256i x[8], y[8];
+  int i;
+
+  for (; count >= 8; count -= 8) {
+    for (i = 0; i < 8; i++) {
+      x[i] = _mm256_loadu_si256((__m256i const*)(in + 8 * i));
+    }
+    transpose8_avx2(x);
+    OI_SBC_DCT2_8_LANES(__m256i, _mm256_add_epi32, _mm256_sub_epi32,
+                        scale_avx2, halve_avx2, mult_dct_avx2, x, y);
+    transpose8_avx2(y);
+    for (i = 0; i < 8; i += 2) {
+      /* Truncate to 16 bits like the (int16_t) casts in dct2_8() */
+      __m256i a = _mm256_srai_epi32(_mm256_slli_epi32(y[i], 16), 16);
+      __m256i b = _mm256_srai_epi32(_mm256_slli_epi32(y[i + 1], 16), 16);
+      _mm256_storeu_si256(
+          (__m256i*)(out + 8 * i),
+          _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8));
+    }
+    in += 64;
+    out += 64;
+  }
+  OI_SBC_DCT2_8Blocks(out, in, count);
+}
+
+/* All eight outputs at once: the first term of each pair reads
+ * buffer[16 * g + 4 .. 16 * g + 11] and the second reads
+ * buffer[16 * g + 5 .. 16 * g + 12] in reverse. */
+static OI_AVX2 void synth_window80_avx2(int16_t* pcm,
+                                        SBC_BUFFER_T const* RESTRICT buffer,
+                                        OI_UINT strideShift) {
+  const __m128i reverse = _mm_set_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10,
+                                       13, 12, 15, 14);
+  __m256i acc = _mm256_setzero_si256();
+  __m128i out;
+  int g, h;
+
+  for (g = 0; g < 5; g++) {
+    __m256i x[2];
+    x[0] = _mm256_cvtepi16_epi32(
+        _mm_loadu_si128((__m128i const*)(buffer + 16 * g + 4)));
+    x[1] = _mm256_cvtepi16_epi32(_mm_shuffle_epi8(
+        _mm_loadu_si128((__m128i const*)(buffer + 16 * g + 5)), reverse));
+    for (h = 0; h < 2; h++) {
+      __m256i coef = _mm256_loadu_si256(
+          (__m256i const*)OI_SBC_SynthWindow80Coef[g][h]);
+      __m256i shift = _mm256_cvtepu8_epi32(_mm_loadl_epi64(
+          (__m128i const*)OI_SBC_SynthWindow80Shift[g][h]));
+      acc = _mm256_add_epi32(
+          acc, _mm256_srav_epi32(_mm256_mullo_epi32(x[h], coef), shift));
+    }
+  }
+
+  /* acc / 32768, rounding towards zero, then clipped to 16 bits */
+  acc = _mm256_add_epi32(
+      acc, _mm256_and_si256(_mm256_srai_epi32(acc, 31),
+                            _mm256_set1_epi32(32767)));
+  acc = _mm256_srai_epi32(acc, 15);
+  out = _mm_packs_epi32(_mm256_castsi256_si128(acc),
+                        _mm256_extracti128_si256(acc, 1));
+
+  if (strideShift == 0) {
+    _mm_storeu_si128((__m128i*)pcm, out);
+  } else {
+    int16_t samples[8];
+    _mm_storeu_si128((__m128i*)samples, out);
+    for (h = 0; h < 8; h++) {
+      pcm[h << strideShift] = samples[h];
+    }
+  }
+}
+
+const OI_SBC_DECODER_KERNELS OI_SBC_DecoderKernelsAVX2 = {
+    dequant_avx2, dct2_8_avx2, synth_window80_avx2,
+};
+
+#endif
+
+/**@}*/
@@ -0,0 +1,82 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/** @file
+
+Selection of the decoder inner loops (dequantization, the 8-subband DCT and
+the 8-subband synthesis window) for the CPU the decoder runs on, and the
+tables shared by the vector versions.
+
+@ingroup codec_internal
+*/
+
+/**@addtogroup codec_internal */
+/**@{*/
+
+#include "oi_codec_sbc_private.h"
+
+/* The coefficients and shifts of SynthWindow80_generated(), laid out as
+ * described in oi_codec_sbc_private.h. Output 0 has no term for buffer[4],
+ * which is always zero, and output 4 reads buffer[16 * g + 8] once. */
+const int32_t OI_SBC_SynthWindow80Coef[5][2][8] = {
+    {{0, -3263, -10385, -16457, 10445, -8443, -10337, -6087},
+     {8235, 29293, 24995, 19083, 0, 16913, 11167, 9293}},
+    {{-23167, -5229, -4944, -23641, -10594, -9632, -30605, -23144},
+     {26479, 30835, 9161, -29015, 0, 7374, 7668, 9976}},
+    {{-34794, -54042, -46126, -51556, 89196, 41020, 38212, 36110},
+     {75192, 63266, 55122, 49160, 0, 61788, 66536, 94684}},
+    {{34794, 34638, 18472, 24211, 10603, 9405, 16383, 3494},
+     {26479, 26663, 12705, 23469, 0, -18233, 22117, 11537}},
+    {{23167, 4555, 6239, 21223, 9539, 26189, 8603, 8721},
+     {8235, 12419, 9251, 26913, 0, 1499, 7543, 1370}},
+};
+
+const uint8_t OI_SBC_SynthWindow80Shift[5][2][8] = {
+    {{0, 5, 6, 6, 4, 7, 4, 2}, {3, 5, 5, 5, 0, 5, 4, 3}},
+    {{3, 0, 0, 2, 0, 0, 1, 0}, {2, 3, 3, 4, 0, 0, 0, 0}},
+    {{0, 0, 0, 0, 0, 0, 0, 0}, {0, 0, 0, 0, 0, 0, 0, 0}},
+    {{0, 0, 0, 1, 0, 1, 2, 0}, {2, 2, 1, 2, 0, 3, 4, 1}},
+    {{3, 1, 3, 8, 4, 7, 6, 7}, {3, 4, 4, 6, 0, 1, 3, 0}},
+};
+
+const OI_SBC_DECODER_KERNELS OI_SBC_DecoderKernelsGeneric = {
+    OI_SBC_DequantSamples, OI_SBC_DCT2_8Blocks, SynthWindow80_generated,
+};
+
+const OI_SBC_DECODER_KERNELS* OI_SBC_DecoderKernels =
+    &OI_SBC_DecoderKernelsGeneric;
+
+/**
+ * Points OI_SBC_DecoderKernels at the fastest kernels the CPU supports. The
+ * choice depends only on the CPU, so calling this again is harmless.
+ */
+PRIVATE void OI_SBC_DecoderKernelsInit(void) {
+#if defined(__i386__) || defined(__x86_64__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    OI_SBC_DecoderKernels = &OI_SBC_DecoderKernelsAVX2;
+    return;
+  }
+#elif defined(__ARM_NEON)
+  OI_SBC_DecoderKernels = &OI_SBC_DecoderKernelsNEON;
+  return;
+#endif
+  OI_SBC_DecoderKernels = &OI_SBC_DecoderKernelsGeneric;
+}
+
+/**@}*/
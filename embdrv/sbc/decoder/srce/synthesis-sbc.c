@@ -163,6 +163,8 @@ The output samples X[0..7] are defined as sums of W:
 @{
 */
 
+#include <string.h>
+
 #include "oi_codec_sbc_private.h"
 
 const int32_t dec_window_4[21] = {
@@ -243,13 +245,9 @@ INLINE int32_t default_mul_16s_32s_hi(int16_t u, int32_t v) {
 
 #define LONG_MULT_DCT(K, sample) (MUL_16S_32S_HI(K, sample) << 2)
 
-PRIVATE void SynthWindow80_generated(int16_t* pcm,
-                                     SBC_BUFFER_T const* RESTRICT buffer,
-                                     OI_UINT strideShift);
 PRIVATE void SynthWindow112_generated(int16_t* pcm,
                                       SBC_BUFFER_T const* RESTRICT buffer,
                                       OI_UINT strideShift);
-PRIVATE void dct2_8(SBC_BUFFER_T* RESTRICT out, int32_t const* RESTRICT x);
 
 typedef void (*SYNTH_FRAME)(OI_CODEC_SBC_DECODER_CONTEXT* context, int16_t* pcm,
                             OI_UINT blkstart, OI_UINT blkcount);
@@ -265,8 +263,13 @@ typedef void (*SYNTH_FRAME)(OI_CODEC_SBC_DECODER_CONTEXT* context, int16_t* pcm,
 #define DCT2_8(dst, src) dct2_8(dst, src)
 #endif
 
+#ifndef DCT2_8_BLOCKS
+#define DCT2_8_BLOCKS(dst, src, count) \
+  OI_SBC_DecoderKernels->dct2_8(dst, src, count)
+#endif
+
 #ifndef SYNTH80
-#define SYNTH80 SynthWindow80_generated
+#define SYNTH80 OI_SBC_DecoderKernels->synthWindow80
 #endif
 
 #ifndef SYNTH112
@@ -283,6 +286,12 @@ PRIVATE void OI_SBC_SynthFrame_80(OI_CODEC_SBC_DECODER_CONTEXT* context,
   OI_UINT offset = context->common.filterBufferOffset;
   int32_t* s = context->common.subdata + 8 * nrof_channels * blkstart;
   OI_UINT blkstop = blkstart + blkcount;
+  SBC_BUFFER_T dct[SBC_MAX_BLOCKS * SBC_MAX_CHANNELS * 8];
+  SBC_BUFFER_T const* d = dct;
+
+  /* The transforms of all the blocks are independent of the filter history,
+   * so they are computed together up front. */
+  DCT2_8_BLOCKS(dct, s, blkcount * nrof_channels);
 
   for (blk = blkstart; blk < blkstop; blk++) {
     if (offset == 0) {
@@ -302,10 +311,11 @@ PRIVATE void OI_SBC_SynthFrame_80(OI_CODEC_SBC_DECODER_CONTEXT* context,
     }
 
     for (ch = 0; ch < nrof_channels; ch++) {
-      DCT2_8(context->common.filterBuffer[ch] + offset, s);
+      memcpy(context->common.filterBuffer[ch] + offset, d,
+             8 * sizeof(SBC_BUFFER_T));
       SYNTH80(pcm + ch, context->common.filterBuffer[ch] + offset,
               pcmStrideShift);
-      s += 8;
+      d += 8;
     }
     pcm += (8 << pcmStrideShift);
   }
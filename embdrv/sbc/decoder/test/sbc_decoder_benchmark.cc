@@ -0,0 +1,115 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <benchmark/benchmark.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "oi_codec_sbc_private.h"
+#include "sbc_encoder.h"
+
+using ::benchmark::Counter;
+using ::benchmark::State;
+
+// Frames decoded per iteration, as if they arrived in one media packet each.
+#define FRAMES_PER_ITERATION 36
+
+static std::vector<uint8_t> benchmark_stream(int16_t subbands, int16_t blocks,
+                                             int16_t mode) {
+  SBC_ENC_PARAMS params;
+  memset(&params, 0, sizeof(params));
+  params.s16SamplingFreq = SBC_sf44100;
+  params.s16NumOfSubBands = subbands;
+  params.s16NumOfBlocks = blocks;
+  params.s16ChannelMode = mode;
+  params.s16AllocationMethod = SBC_LOUDNESS;
+  params.u16BitRate = (mode == SBC_MONO) ? 200 : 345;
+  SBC_Encoder_Init(&params);
+
+  std::vector<int16_t> pcm(SBC_MAX_NUM_OF_BLOCKS * SBC_MAX_NUM_OF_SUBBANDS *
+                           SBC_MAX_NUM_OF_CHANNELS);
+  std::vector<uint8_t> stream;
+  uint8_t frame[512];
+  uint32_t seed = 1;
+  size_t n = 0;
+  for (int f = 0; f < FRAMES_PER_ITERATION; f++) {
+    for (size_t i = 0; i < pcm.size(); i++, n++) {
+      seed = seed * 1103515245 + 12345;
+      int32_t triangle = (int32_t)(n % 256) - 128;
+      pcm[i] =
+          (int16_t)(200 * triangle + (int32_t)((seed >> 16) % 2048) - 1024);
+    }
+    uint32_t len = SBC_Encode(&params, pcm.data(), frame);
+    stream.insert(stream.end(), frame, frame + len);
+  }
+  return stream;
+}
+
+// Decodes FRAMES_PER_ITERATION frames with |kernels| into stride 2 PCM. The
+// arguments are the number of subbands, the number of blocks and the channel
+// mode.
+static void BM_SbcDecode(State& state, const OI_SBC_DECODER_KERNELS* kernels) {
+  static OI_CODEC_SBC_DECODER_CONTEXT context;
+  static OI_CODEC_SBC_CODEC_DATA_STEREO data;
+  static int16_t pcm[FRAMES_PER_ITERATION * SBC_MAX_SAMPLES_PER_FRAME * 2];
+  std::vector<uint8_t> stream =
+      benchmark_stream(state.range(0), state.range(1), state.range(2));
+
+  OI_CODEC_SBC_DecoderReset(&context, data.data, sizeof(data), 2, 2, FALSE);
+  OI_SBC_DecoderKernels = kernels;
+  for (auto _ : state) {
+    const OI_BYTE* frame = stream.data();
+    uint32_t frame_bytes = stream.size();
+    uint32_t pcm_bytes = sizeof(pcm);
+    uint32_t frame_count = FRAMES_PER_ITERATION;
+    benchmark::DoNotOptimize(OI_CODEC_SBC_DecodeFrames(
+        &context, &frame, &frame_bytes, pcm, &pcm_bytes, &frame_count));
+  }
+  state.counters["frames_per_second"] =
+      Counter(state.iterations() * FRAMES_PER_ITERATION, Counter::kIsRate);
+  OI_SBC_DecoderKernelsInit();
+}
+
+static void register_kernels(const char* name,
+                             const OI_SBC_DECODER_KERNELS* kernels) {
+  std::string benchmark_name = std::string("BM_SbcDecode/") + name;
+  benchmark::RegisterBenchmark(benchmark_name.c_str(), BM_SbcDecode, kernels)
+      ->ArgNames({"subbands", "blocks", "mode"})
+      ->ArgsProduct({{SUB_BANDS_4, SUB_BANDS_8},
+                     {SBC_BLOCK_0, SBC_BLOCK_1, SBC_BLOCK_2, SBC_BLOCK_3},
+                     {SBC_MONO, SBC_STEREO, SBC_JOINT_STEREO}});
+}
+
+int main(int argc, char** argv) {
+  register_kernels("generic", &OI_SBC_DecoderKernelsGeneric);
+#if defined(__i386__) || defined(__x86_64__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    register_kernels("avx2", &OI_SBC_DecoderKernelsAVX2);
+#endif
+#if defined(__ARM_NEON)
+  register_kernels("neon", &OI_SBC_DecoderKernelsNEON);
+#endif
+
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  ::benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -0,0 +1,320 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "oi_codec_sbc_private.h"
+#include "sbc_encoder.h"
+
+namespace {
+
+constexpr int kTestFrames = 100;
+
+struct KernelSet {
+  const char* name;
+  const OI_SBC_DECODER_KERNELS* kernels;
+};
+
+std::vector<KernelSet> available_kernels() {
+  std::vector<KernelSet> sets = {{"generic", &OI_SBC_DecoderKernelsGeneric}};
+#if defined(__i386__) || defined(__x86_64__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    sets.push_back({"avx2", &OI_SBC_DecoderKernelsAVX2});
+#endif
+#if defined(__ARM_NEON)
+  sets.push_back({"neon", &OI_SBC_DecoderKernelsNEON});
+#endif
+  return sets;
+}
+
+uint32_t next_random(uint32_t* state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+  return *state;
+}
+
+// A triangle wave plus noise, with bursts of full scale square wave so that
+// the synthesis output clips.
+std::vector<int16_t> test_pcm(size_t samples) {
+  std::vector<int16_t> pcm(samples);
+  uint32_t seed = 7;
+  for (size_t i = 0; i < samples; i++) {
+    int32_t slow = (int32_t)(i % 512) - 256;
+    int32_t v = 12000 - 94 * (slow < 0 ? -slow : slow) +
+                (int32_t)(next_random(&seed) % 9000) - 4500;
+    if (i % 3000 < 60) v = (i & 1) ? 32767 : -32768;
+    pcm[i] = (int16_t)v;
+  }
+  return pcm;
+}
+
+struct StreamConfig {
+  int16_t sampling_freq;
+  int16_t channel_mode;
+  int16_t subbands;
+  int16_t blocks;
+};
+
+std::vector<uint8_t> encode_stream(const StreamConfig& config) {
+  SBC_ENC_PARAMS params;
+  memset(&params, 0, sizeof(params));
+  params.s16SamplingFreq = config.sampling_freq;
+  params.s16ChannelMode = config.channel_mode;
+  params.s16NumOfSubBands = config.subbands;
+  params.s16NumOfBlocks = config.blocks;
+  params.s16AllocationMethod = SBC_LOUDNESS;
+  params.u16BitRate = (config.channel_mode == SBC_MONO) ? 200 : 345;
+  SBC_Encoder_Init(&params);
+
+  size_t frame_samples =
+      params.s16NumOfSubBands * params.s16NumOfBlocks * params.s16NumOfChannels;
+  std::vector<int16_t> pcm = test_pcm(frame_samples * kTestFrames);
+  std::vector<uint8_t> stream;
+  uint8_t frame[1024];
+  for (int f = 0; f < kTestFrames; f++) {
+    uint32_t len = SBC_Encode(&params, pcm.data() + f * frame_samples, frame);
+    stream.insert(stream.end(), frame, frame + len);
+  }
+  return stream;
+}
+
+std::vector<StreamConfig> test_configs() {
+  std::vector<StreamConfig> configs;
+  for (int16_t freq : {SBC_sf44100, SBC_sf48000}) {
+    for (int16_t mode : {SBC_MONO, SBC_DUAL, SBC_STEREO, SBC_JOINT_STEREO}) {
+      for (int16_t subbands : {SUB_BANDS_4, SUB_BANDS_8}) {
+        for (int16_t blocks : {SBC_BLOCK_0, SBC_BLOCK_3}) {
+          configs.push_back({freq, mode, subbands, blocks});
+        }
+      }
+    }
+  }
+  return configs;
+}
+
+uint64_t fnv1a(const void* data, size_t len, uint64_t hash) {
+  const uint8_t* p = (const uint8_t*)data;
+  for (size_t i = 0; i < len; i++) {
+    hash ^= p[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+// Decodes |stream| frame by frame into stride 2 PCM. The decoder reset does
+// not clear the synthesis history, so |data| starts zeroed.
+uint64_t decode_digest(const std::vector<uint8_t>& stream,
+                       const OI_SBC_DECODER_KERNELS* kernels) {
+  OI_CODEC_SBC_DECODER_CONTEXT context;
+  OI_CODEC_SBC_CODEC_DATA_STEREO data = {};
+  int16_t pcm[SBC_MAX_SAMPLES_PER_FRAME * 2];
+  uint64_t hash = 1469598103934665603ULL;
+
+  EXPECT_EQ(OI_OK, OI_CODEC_SBC_DecoderReset(&context, data.data,
+                                             sizeof(data), 2, 2, FALSE));
+  OI_SBC_DecoderKernels = kernels;
+  const OI_BYTE* frame = stream.data();
+  uint32_t frame_bytes = stream.size();
+  while (frame_bytes != 0) {
+    uint32_t pcm_bytes = sizeof(pcm);
+    OI_STATUS status = OI_CODEC_SBC_DecodeFrame(&context, &frame, &frame_bytes,
+                                                pcm, &pcm_bytes);
+    EXPECT_EQ(OI_OK, status);
+    if (!OI_SUCCESS(status)) break;
+    hash = fnv1a(pcm, pcm_bytes, hash);
+  }
+  OI_SBC_DecoderKernelsInit();
+  return hash;
+}
+
+// Digests of the PCM produced by the decoder before it had vector kernels,
+// in test_configs() order.
+const uint64_t kGoldenVectors[] = {
+    0x8eef1b28ddbbc5ffULL,
+    0x337bdfebe8a44ca7ULL,
+    0x254c5bf14d9576cbULL,
+    0x22a6d0978a55c3e7ULL,
+    0x9744d09e901c29aeULL,
+    0x93765baf05ce2907ULL,
+    0xb89a5cda79e31fccULL,
+    0xd1b5341ae5f451c1ULL,
+    0x90354f95d5fb1431ULL,
+    0xc72ad759cd77b940ULL,
+    0x634ebec9ba585361ULL,
+    0xa8cb4a768269aef2ULL,
+    0x3b79122a4704158eULL,
+    0x83dbaec7c6a1dad5ULL,
+    0xbe5106b4fade505dULL,
+    0xffc426b90925cefdULL,
+    0xad408d9b173eafb3ULL,
+    0x650a168dab22fcc7ULL,
+    0x50327cfd72979e77ULL,
+    0x14bdc99f30c0bf67ULL,
+    0x8dda6c4893dd22ffULL,
+    0x58ccd3930d798a15ULL,
+    0x8172578d55ed17beULL,
+    0x20fb3e206f227f0cULL,
+    0x5988e170b6808e83ULL,
+    0x1e65bfb44b8abfe0ULL,
+    0x5dd063ed915d948eULL,
+    0xa525e52072d8a076ULL,
+    0x9231c92a9d0af8faULL,
+    0xa6e367111f144234ULL,
+    0xd9e796fd1b58b039ULL,
+    0x4a27591acd6ad4aaULL,
+};
+
+}  // namespace
+
+TEST(SbcDecoderTest, test_golden_vectors) {
+  std::vector<StreamConfig> configs = test_configs();
+  ASSERT_EQ(sizeof(kGoldenVectors) / sizeof(kGoldenVectors[0]),
+            configs.size());
+  for (const KernelSet& set : available_kernels()) {
+    for (size_t i = 0; i < configs.size(); i++) {
+      EXPECT_EQ(kGoldenVectors[i],
+                decode_digest(encode_stream(configs[i]), set.kernels))
+          << set.name << " config " << i;
+    }
+  }
+}
+
+TEST(SbcDecoderTest, test_dequant_matches_generic) {
+  uint32_t seed = 1;
+  int32_t raw[SBC_MAX_SAMPLES_PER_FRAME * 2];
+  int32_t expected[SBC_MAX_SAMPLES_PER_FRAME * 2];
+  int32_t actual[SBC_MAX_SAMPLES_PER_FRAME * 2];
+  int8_t scale_factor[SBC_MAX_CHANNELS * SBC_MAX_BANDS];
+  uint8_t bits[SBC_MAX_CHANNELS * SBC_MAX_BANDS];
+
+  for (const KernelSet& set : available_kernels()) {
+    for (int iteration = 0; iteration < 1000; iteration++) {
+      OI_UINT rows = 4 << (next_random(&seed) % 3);
+      OI_UINT samples = rows * 4 * (1 + next_random(&seed) % 4);
+      for (OI_UINT i = 0; i < rows; i++) {
+        scale_factor[i] = next_random(&seed) % 16;
+        bits[i] = next_random(&seed) % 17;
+      }
+      for (OI_UINT i = 0; i < samples; i++) {
+        OI_UINT b = bits[i % rows];
+        raw[i] = b < 2 ? 0 : next_random(&seed) % ((1u << b) - 1);
+      }
+      memcpy(expected, raw, samples * sizeof(raw[0]));
+      memcpy(actual, raw, samples * sizeof(raw[0]));
+      OI_SBC_DequantSamples(expected, scale_factor, bits, rows, samples);
+      set.kernels->dequant(actual, scale_factor, bits, rows, samples);
+      ASSERT_EQ(0, memcmp(expected, actual, samples * sizeof(raw[0])))
+          << set.name;
+    }
+  }
+}
+
+TEST(SbcDecoderTest, test_dct2_8_matches_generic) {
+  uint32_t seed = 2;
+  int32_t in[SBC_MAX_BLOCKS * SBC_MAX_CHANNELS * 8];
+  SBC_BUFFER_T expected[SBC_MAX_BLOCKS * SBC_MAX_CHANNELS * 8];
+  SBC_BUFFER_T actual[SBC_MAX_BLOCKS * SBC_MAX_CHANNELS * 8];
+
+  for (const KernelSet& set : available_kernels()) {
+    for (OI_UINT count = 1; count <= SBC_MAX_BLOCKS * SBC_MAX_CHANNELS;
+         count++) {
+      for (OI_UINT i = 0; i < count * 8; i++) {
+        // Dequantized samples stay well below 2^31 / 1.38
+        in[i] = (int32_t)(next_random(&seed) % (1u << 28)) - (1 << 27);
+      }
+      OI_SBC_DCT2_8Blocks(expected, in, count);
+      set.kernels->dct2_8(actual, in, count);
+      ASSERT_EQ(0, memcmp(expected, actual, count * 8 * sizeof(expected[0])))
+          << set.name << " count " << count;
+    }
+  }
+}
+
+TEST(SbcDecoderTest, test_synth_window80_matches_generic) {
+  uint32_t seed = 3;
+  SBC_BUFFER_T buffer[80];
+  int16_t expected[16];
+  int16_t actual[16];
+
+  for (const KernelSet& set : available_kernels()) {
+    for (int iteration = 0; iteration < 10000; iteration++) {
+      for (int i = 0; i < 80; i++) {
+        buffer[i] = (int16_t)next_random(&seed);
+      }
+      for (OI_UINT stride_shift = 0; stride_shift < 2; stride_shift++) {
+        memset(expected, 0x55, sizeof(expected));
+        memset(actual, 0x55, sizeof(actual));
+        SynthWindow80_generated(expected, buffer, stride_shift);
+        set.kernels->synthWindow80(actual, buffer, stride_shift);
+        ASSERT_EQ(0, memcmp(expected, actual, sizeof(expected))) << set.name;
+      }
+    }
+  }
+}
+
+TEST(SbcDecoderTest, test_decode_frames_matches_decode_frame) {
+  std::vector<uint8_t> stream =
+      encode_stream({SBC_sf44100, SBC_JOINT_STEREO, SUB_BANDS_8, SBC_BLOCK_3});
+  OI_CODEC_SBC_DECODER_CONTEXT context;
+  OI_CODEC_SBC_CODEC_DATA_STEREO data = {};
+  std::vector<int16_t> pcm(SBC_MAX_SAMPLES_PER_FRAME * 2 * kTestFrames);
+
+  ASSERT_EQ(OI_OK, OI_CODEC_SBC_DecoderReset(&context, data.data,
+                                             sizeof(data), 2, 2, FALSE));
+  const OI_BYTE* frame = stream.data();
+  uint32_t frame_bytes = stream.size();
+  uint32_t pcm_bytes = pcm.size() * sizeof(int16_t);
+  uint32_t frame_count = kTestFrames;
+  ASSERT_EQ(OI_OK, OI_CODEC_SBC_DecodeFrames(&context, &frame, &frame_bytes,
+                                             pcm.data(), &pcm_bytes,
+                                             &frame_count));
+  EXPECT_EQ((uint32_t)kTestFrames, frame_count);
+  EXPECT_EQ(0u, frame_bytes);
+  EXPECT_EQ(pcm.size() * sizeof(int16_t), pcm_bytes);
+  EXPECT_EQ(decode_digest(stream, OI_SBC_DecoderKernels),
+            fnv1a(pcm.data(), pcm_bytes, 1469598103934665603ULL));
+
+  // Stops at the frame limit
+  ASSERT_EQ(OI_OK, OI_CODEC_SBC_DecoderReset(&context, data.data,
+                                             sizeof(data), 2, 2, FALSE));
+  frame = stream.data();
+  frame_bytes = stream.size();
+  pcm_bytes = pcm.size() * sizeof(int16_t);
+  frame_count = 3;
+  ASSERT_EQ(OI_OK, OI_CODEC_SBC_DecodeFrames(&context, &frame, &frame_bytes,
+                                             pcm.data(), &pcm_bytes,
+                                             &frame_count));
+  EXPECT_EQ(3u, frame_count);
+  EXPECT_EQ(3u * SBC_MAX_SAMPLES_PER_FRAME * 2 * sizeof(int16_t), pcm_bytes);
+  EXPECT_EQ(stream.data() + stream.size() / kTestFrames * 3, frame);
+
+  // Stops when the PCM buffer is full, keeping the frames decoded so far
+  pcm_bytes = 2 * SBC_MAX_SAMPLES_PER_FRAME * 2 * sizeof(int16_t) + 10;
+  frame_count = kTestFrames;
+  EXPECT_EQ(OI_CODEC_SBC_NOT_ENOUGH_AUDIO_DATA,
+            OI_CODEC_SBC_DecodeFrames(&context, &frame, &frame_bytes,
+                                      pcm.data(), &pcm_bytes, &frame_count));
+  EXPECT_EQ(2u, frame_count);
+  EXPECT_EQ(2u * SBC_MAX_SAMPLES_PER_FRAME * 2 * sizeof(int16_t), pcm_bytes);
+}
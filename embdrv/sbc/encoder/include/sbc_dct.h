@@ -91,4 +91,79 @@ s32OutLow=(int32_t)((int32_t)(s16In2)*(int32_t)(s32In1>>15));
 #endif
 #endif
 
+#if (SBC_ENC_SIMD_INCLUDED == TRUE)
+/* The 16 bit cosines of SBC_FastIDCT8 */
+#define SBC_LANES_COS_PI_SUR_4 0x00005a82
+#define SBC_LANES_COS_PI_SUR_8 0x00007641
+#define SBC_LANES_COS_3PI_SUR_8 0x000030fb
+#define SBC_LANES_COS_PI_SUR_16 0x00007d8a
+#define SBC_LANES_COS_3PI_SUR_16 0x00006a6d
+#define SBC_LANES_COS_5PI_SUR_16 0x0000471c
+#define SBC_LANES_COS_7PI_SUR_16 0x000018f8
+
+/* SBC_FastIDCT8 for the vector kernels, on one set of inputs per lane of
+ * the 16 vectors |in|. ADD, SUB, SRAI and SLLI are the 32 bit lane
+ * operations and MULC(x, c) is SBC_MULT_32_16_SIMPLIFIED by a constant. */
+#define SBC_DCT8_LANES(VT, ADD, SUB, SRAI, SLLI, MULC, in, out)              \
+  {                                                                          \
+    VT x0, x1, x2, x3, x4, x5, x6, x7, temp, e0, e1, e2, e3, o0, o1, o2, o3; \
+    x0 = MULC(in[4], SBC_LANES_COS_PI_SUR_4);                                \
+    x1 = SRAI(ADD(in[3], in[5]), 1);                                         \
+    x2 = SRAI(ADD(in[2], in[6]), 1);                                         \
+    x3 = SRAI(ADD(in[1], in[7]), 1);                                         \
+    x4 = SRAI(ADD(in[0], in[8]), 1);                                         \
+    x5 = SRAI(SUB(in[9], in[15]), 1);                                        \
+    x6 = SRAI(SUB(in[10], in[14]), 1);                                       \
+    x7 = SRAI(SUB(in[11], in[13]), 1);                                       \
+                                                                             \
+    temp = x0;                                                               \
+    x0 = MULC(ADD(x0, x4), SBC_LANES_COS_PI_SUR_4);                          \
+    x4 = MULC(SUB(temp, x4), SBC_LANES_COS_PI_SUR_4);                        \
+                                                                             \
+    x2 = SUB(x2, x6);                                                        \
+    x6 = SLLI(x6, 1);                                                        \
+    x6 = MULC(x6, SBC_LANES_COS_PI_SUR_4);                                   \
+    temp = x2;                                                               \
+    x2 = MULC(ADD(x2, x6), SBC_LANES_COS_PI_SUR_8);                          \
+    x6 = MULC(SUB(temp, x6), SBC_LANES_COS_3PI_SUR_8);                       \
+                                                                             \
+    e0 = ADD(x0, x2);                                                        \
+    e1 = ADD(x4, x6);                                                        \
+    e2 = SUB(x4, x6);                                                        \
+    e3 = SUB(x0, x2);                                                        \
+                                                                             \
+    x7 = SLLI(x7, 1);                                                        \
+    x5 = SUB(SLLI(x5, 1), x7);                                               \
+    x3 = SUB(SLLI(x3, 1), x5);                                               \
+    x1 = SUB(x1, SRAI(x3, 1));                                               \
+                                                                             \
+    x5 = MULC(x5, SBC_LANES_COS_PI_SUR_4);                                   \
+    temp = x1;                                                               \
+    x1 = ADD(x1, x5);                                                        \
+    x5 = SUB(temp, x5);                                                      \
+                                                                             \
+    x3 = SUB(x3, x7);                                                        \
+    x7 = SLLI(x7, 1);                                                        \
+    x7 = MULC(x7, SBC_LANES_COS_PI_SUR_4);                                   \
+                                                                             \
+    temp = x3;                                                               \
+    x3 = MULC(ADD(x3, x7), SBC_LANES_COS_PI_SUR_8);                          \
+    x7 = MULC(SUB(temp, x7), SBC_LANES_COS_3PI_SUR_8);                       \
+                                                                             \
+    o0 = MULC(ADD(x1, x3), SBC_LANES_COS_PI_SUR_16);                         \
+    o1 = MULC(ADD(x5, x7), SBC_LANES_COS_3PI_SUR_16);                        \
+    o2 = MULC(SUB(x5, x7), SBC_LANES_COS_5PI_SUR_16);                        \
+    o3 = MULC(SUB(x1, x3), SBC_LANES_COS_7PI_SUR_16);                        \
+                                                                             \
+    out[0] = ADD(e0, o0);                                                    \
+    out[1] = ADD(e1, o1);                                                    \
+    out[2] = ADD(e2, o2);                                                    \
+    out[3] = ADD(e3, o3);                                                    \
+    out[7] = SUB(e0, o0);                                                    \
+    out[6] = SUB(e1, o1);                                                    \
+    out[5] = SUB(e2, o2);                                                    \
+    out[4] = SUB(e3, o3);                                                    \
+  }
+#endif
+
 #endif
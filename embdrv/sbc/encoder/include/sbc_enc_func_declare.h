@@ -26,6 +26,11 @@
 #define SBC_FUNCDECLARE_H
 
 #include "sbc_encoder.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /* Global data */
 #if (SBC_IS_64_MULT_IN_WINDOW_ACCU == FALSE)
 extern const int16_t gas32CoeffFor4SBs[];
@@ -35,22 +40,78 @@ extern const int32_t gas32CoeffFor4SBs[];
 extern const int32_t gas32CoeffFor8SBs[];
 #endif
 
+/* The vector kernels reproduce the 16 bit windowing, 32x16 bit DCT and 64 bit
+ * quantizer of the default SBC_IPAQ_OPT build bit for bit. Other builds only
+ * use the scalar code. */
+#if (SBC_ARM_ASM_OPT == FALSE && SBC_DSP_OPT == FALSE && \
+     SBC_IPAQ_OPT == TRUE && SBC_IS_64_MULT_IN_WINDOW_ACCU == FALSE && \
+     SBC_FAST_DCT == TRUE && SBC_IS_64_MULT_IN_IDCT == FALSE &&      \
+     SBC_IS_64_MULT_IN_QUANTIZER == TRUE)
+#define SBC_ENC_SIMD_INCLUDED TRUE
+#else
+#define SBC_ENC_SIMD_INCLUDED FALSE
+#endif
+
+/* Inner loops of the encoder, with one implementation per instruction set.
+ * They all produce the same output. */
+typedef struct {
+  /* Windows the 40 samples at |x| into the 8 inputs of SBC_FastIDCT4 at |y| */
+  void (*window4)(const int16_t* x, int32_t* y);
+  /* Windows the 80 samples at |x| into the 16 inputs of SBC_FastIDCT8 at |y| */
+  void (*window8)(const int16_t* x, int32_t* y);
+  /* Runs SBC_FastIDCT8 on the |count| sets of 16 inputs at |y|, writing 8
+   * subband samples for each at |out| */
+  void (*dct8)(const int32_t* y, int32_t* out, int32_t count);
+  /* Quantizes every subband sample of |strEncParams| into |out|, using its
+   * scale factors and bit allocation */
+  void (*quantize)(const SBC_ENC_PARAMS* strEncParams, uint32_t* out);
+} SBC_ENC_KERNELS;
+
+extern const SBC_ENC_KERNELS* sbc_enc_kernels;
+extern const SBC_ENC_KERNELS sbc_enc_kernels_scalar;
+#if (SBC_ENC_SIMD_INCLUDED == TRUE)
+#if defined(__i386__) || defined(__x86_64__)
+extern const SBC_ENC_KERNELS sbc_enc_kernels_sse2;
+extern const SBC_ENC_KERNELS sbc_enc_kernels_avx2;
+#endif
+#if defined(__ARM_NEON)
+extern const SBC_ENC_KERNELS sbc_enc_kernels_neon;
+#endif
+
+/* Window coefficients applied to samples k, k + 2 * subbands, ...,
+ * k + 8 * subbands for DCT input k, one row per multiple of 2 * subbands */
+extern const int16_t gas16WindowTaps4[5 * 8];
+extern const int16_t gas16WindowTaps8[5 * 16];
+#endif
+
 /* Global functions*/
 
 extern void sbc_enc_bit_alloc_mono(SBC_ENC_PARAMS* CodecParams);
 extern void sbc_enc_bit_alloc_ste(SBC_ENC_PARAMS* CodecParams);
 
 extern void SbcAnalysisInit(void);
+extern void SbcEncKernelsInit(void);
 
 extern void SbcAnalysisFilter4(SBC_ENC_PARAMS* strEncParams, int16_t* input);
 extern void SbcAnalysisFilter8(SBC_ENC_PARAMS* strEncParams, int16_t* input);
 
-extern void SBC_FastIDCT8(int32_t* pInVect, int32_t* pOutVect);
+extern void SbcWindow4(const int16_t* x, int32_t* y);
+extern void SbcWindow8(const int16_t* x, int32_t* y);
+
+extern void SBC_FastIDCT8(const int32_t* pInVect, int32_t* pOutVect);
+extern void SBC_FastIDCT8Blocks(const int32_t* pInVect, int32_t* pOutVect,
+                                int32_t s32Count);
 extern void SBC_FastIDCT4(int32_t* x0, int32_t* pOutVect);
 
 extern uint32_t EncPacking(SBC_ENC_PARAMS* strEncParams, uint8_t* output);
-extern void EncQuantizer(SBC_ENC_PARAMS*);
+extern void EncQuantizer(const SBC_ENC_PARAMS* strEncParams,
+                         uint32_t* pu32Quantized);
 #if (SBC_DSP_OPT == TRUE)
 int32_t SBC_Multiply_32_16_Simplified(int32_t s32In2Temp, int32_t s32In1Temp);
 #endif
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif
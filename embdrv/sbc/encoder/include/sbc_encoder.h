@@ -199,6 +199,16 @@ extern "C" {
  * number of bytes written. */
 extern uint32_t SBC_Encode(SBC_ENC_PARAMS* strEncParams, int16_t* input,
                            uint8_t* output);
+
+/* Encode |num_frames| consecutive frames of interleaved PCM from |input| and
+ * write them back to back into |output|, which must have room for
+ * |num_frames| * SBC_FrameLength() bytes. Return number of bytes written. */
+extern uint32_t SBC_EncodeFrames(SBC_ENC_PARAMS* strEncParams, int16_t* input,
+                                 uint32_t num_frames, uint8_t* output);
+
+/* Return the length in bytes of every frame SBC_Encode() produces with the
+ * current parameters. */
+extern uint32_t SBC_FrameLength(const SBC_ENC_PARAMS* strEncParams);
 extern void SBC_Encoder_Init(SBC_ENC_PARAMS* strEncParams);
 
 #ifdef __cplusplus
@@ -200,7 +200,10 @@
 #if (SBC_USE_ARM_PRAGMA == TRUE)
 #pragma arm section zidata = "sbc_s32_analysis_section"
 #endif
-static int32_t s32DCTY[16] = {0};
+/* DCT inputs of every block and channel of the frame, 16 per block for 8
+ * subbands, so that they can be transformed in one pass */
+static int32_t s32DCTY[SBC_MAX_NUM_OF_BLOCKS * SBC_MAX_NUM_OF_CHANNELS * 16] = {
+    0};
 static int32_t s32X[ENC_VX_BUFFER_SIZE / 2];
 static int16_t* s16X =
     (int16_t*)s32X; /* s16X must be 32 bits aligned cf  SHIFTUP_X8_2*/
@@ -1185,20 +1188,14 @@ static int16_t* s16X =
 #endif
 #endif
 
-static int16_t ShiftCounter = 0;
-extern int16_t EncMaxShiftCounter;
 /****************************************************************************
-* SbcAnalysisFilter - performs Analysis of the input audio stream
+* SbcWindow4 - windows the 40 newest samples of a channel, |s16X| being the
+* newest one, into the 8 inputs of SBC_FastIDCT4
 *
 * RETURNS : N/A
 */
-void SbcAnalysisFilter4(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
-  int16_t* ps16PcmBuf;
-  int32_t* ps32SbBuf;
-  int32_t s32Blk, s32Ch;
-  int32_t s32NumOfChannels, s32NumOfBlocks;
-  int32_t i, *ps32X, *ps32X2;
-  int32_t Offset, Offset2, ChOffset;
+void SbcWindow4(const int16_t* s16X, int32_t* s32DCTY) {
+  const int32_t ChOffset = 0;
 #if (SBC_ARM_ASM_OPT == TRUE)
   register int32_t s32Hi, s32Hi2;
 #else
@@ -1209,14 +1206,57 @@ void SbcAnalysisFilter4(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
   register int32_t s32Temp, s32Temp2;
 #endif
 #else
-
 #if (SBC_IS_64_MULT_IN_WINDOW_ACCU == TRUE)
   int64_t s64Temp;
+#endif
+#endif
 #endif
 
+  WINDOW_PARTIAL_4
+}
+
+/****************************************************************************
+* SbcWindow8 - windows the 80 newest samples of a channel, |s16X| being the
+* newest one, into the 16 inputs of SBC_FastIDCT8
+*
+* RETURNS : N/A
+*/
+void SbcWindow8(const int16_t* s16X, int32_t* s32DCTY) {
+  const int32_t ChOffset = 0;
+#if (SBC_ARM_ASM_OPT == TRUE)
+  register int32_t s32Hi, s32Hi2;
+#else
+#if (SBC_IPAQ_OPT == TRUE)
+#if (SBC_IS_64_MULT_IN_WINDOW_ACCU == TRUE)
+  register int64_t s64Temp, s64Temp2;
+#else
+  register int32_t s32Temp, s32Temp2;
+#endif
+#else
+#if (SBC_IS_64_MULT_IN_WINDOW_ACCU == TRUE)
+  int64_t s64Temp;
+#endif
 #endif
 #endif
 
+  WINDOW_PARTIAL_8
+}
+
+static int16_t ShiftCounter = 0;
+extern int16_t EncMaxShiftCounter;
+/****************************************************************************
+* SbcAnalysisFilter - performs Analysis of the input audio stream
+*
+* RETURNS : N/A
+*/
+void SbcAnalysisFilter4(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
+  int16_t* ps16PcmBuf;
+  int32_t* ps32SbBuf;
+  int32_t s32Blk, s32Ch;
+  int32_t s32NumOfChannels, s32NumOfBlocks;
+  int32_t i, *ps32X, *ps32X2;
+  int32_t Offset, Offset2, ChOffset;
+
   s32NumOfChannels = pstrEncParams->s16NumOfChannels;
   s32NumOfBlocks = pstrEncParams->s16NumOfBlocks;
 
@@ -1257,7 +1297,7 @@ void SbcAnalysisFilter4(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
     for (s32Ch = 0; s32Ch < s32NumOfChannels; s32Ch++) {
       ChOffset = s32Ch * Offset2 + Offset;
 
-      WINDOW_PARTIAL_4
+      sbc_enc_kernels->window4(s16X + ChOffset, s32DCTY);
 
       SBC_FastIDCT4(s32DCTY, ps32SbBuf);
 
@@ -1284,34 +1324,19 @@ void SbcAnalysisFilter4(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
 /* ////////////////////////////////////////////////////////////////////////// */
 void SbcAnalysisFilter8(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
   int16_t* ps16PcmBuf;
-  int32_t* ps32SbBuf;
+  int32_t* ps32DCTY;
   int32_t s32Blk, s32Ch; /* counter for block*/
   int32_t Offset, Offset2;
   int32_t s32NumOfChannels, s32NumOfBlocks;
   int32_t i, *ps32X, *ps32X2;
   int32_t ChOffset;
-#if (SBC_ARM_ASM_OPT == TRUE)
-  register int32_t s32Hi, s32Hi2;
-#else
-#if (SBC_IPAQ_OPT == TRUE)
-#if (SBC_IS_64_MULT_IN_WINDOW_ACCU == TRUE)
-  register int64_t s64Temp, s64Temp2;
-#else
-  register int32_t s32Temp, s32Temp2;
-#endif
-#else
-#if (SBC_IS_64_MULT_IN_WINDOW_ACCU == TRUE)
-  int64_t s64Temp;
-#endif
-#endif
-#endif
 
   s32NumOfChannels = pstrEncParams->s16NumOfChannels;
   s32NumOfBlocks = pstrEncParams->s16NumOfBlocks;
 
   ps16PcmBuf = input;
 
-  ps32SbBuf = pstrEncParams->s32SbBuffer;
+  ps32DCTY = s32DCTY;
   Offset2 = (int32_t)(EncMaxShiftCounter + 80);
   for (s32Blk = 0; s32Blk < s32NumOfBlocks; s32Blk++) {
     Offset = (int32_t)(EncMaxShiftCounter - ShiftCounter);
@@ -1370,11 +1395,9 @@ void SbcAnalysisFilter8(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
     for (s32Ch = 0; s32Ch < s32NumOfChannels; s32Ch++) {
       ChOffset = s32Ch * Offset2 + Offset;
 
-      WINDOW_PARTIAL_8
+      sbc_enc_kernels->window8(s16X + ChOffset, ps32DCTY);
 
-      SBC_FastIDCT8(s32DCTY, ps32SbBuf);
-
-      ps32SbBuf += SUB_BANDS_8;
+      ps32DCTY += 16;
     }
     if (s32NumOfChannels == 1) {
       if (ShiftCounter >= EncMaxShiftCounter) {
@@ -1392,6 +1415,10 @@ void SbcAnalysisFilter8(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
       }
     }
   }
+
+  /* Matrix all blocks and channels at once */
+  sbc_enc_kernels->dct8(s32DCTY, pstrEncParams->s32SbBuffer,
+                        s32NumOfBlocks * s32NumOfChannels);
 }
 
 void SbcAnalysisInit(void) {
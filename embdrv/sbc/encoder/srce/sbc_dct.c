@@ -78,7 +78,7 @@ extern const int16_t gas16AnalDCTcoeff8[];
 extern const int16_t gas16AnalDCTcoeff4[];
 #endif
 
-void SBC_FastIDCT8(int32_t* pInVect, int32_t* pOutVect) {
+void SBC_FastIDCT8(const int32_t* pInVect, int32_t* pOutVect) {
 #if (SBC_FAST_DCT == TRUE)
 #if (SBC_ARM_ASM_OPT == TRUE)
 #else
@@ -200,6 +200,25 @@ void SBC_FastIDCT8(int32_t* pInVect, int32_t* pOutVect) {
           pOutVect[0],pOutVect[1],pOutVect[2],pOutVect[3],pOutVect[4],pOutVect[5],pOutVect[6],pOutVect[7]);*/
 }
 
+/*******************************************************************************
+ *
+ * Function         SBC_FastIDCT8Blocks
+ *
+ * Description      runs SBC_FastIDCT8 on s32Count consecutive sets of 16
+ *                  inputs, writing 8 outputs for each
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void SBC_FastIDCT8Blocks(const int32_t* pInVect, int32_t* pOutVect,
+                         int32_t s32Count) {
+  for (; s32Count > 0; s32Count--) {
+    SBC_FastIDCT8(pInVect, pOutVect);
+    pInVect += 16;
+    pOutVect += SUB_BANDS_8;
+  }
+}
+
 /*******************************************************************************
  *
  * Function         SBC_FastIDCT4
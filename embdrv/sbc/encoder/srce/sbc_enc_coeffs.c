@@ -22,6 +22,7 @@
  *
  ******************************************************************************/
 
+#include "sbc_enc_func_declare.h"
 #include "sbc_encoder.h"
 
 #if (SBC_ARM_ASM_OPT == FALSE && SBC_IPAQ_OPT == FALSE)
@@ -242,3 +243,34 @@ const int32_t gas32CoeffFor8SBs[] = {
 
 #endif
 #endif
+
+#if (SBC_ENC_SIMD_INCLUDED == TRUE)
+/* The WIND_4_SUBBANDS_* coefficients of sbc_analysis.c, arranged for the
+ * vector window kernels */
+const int16_t gas16WindowTaps4[5 * 8] = {
+    0, 18, 49, 90, 126, 128, 61, -100,
+    358, 670, 946, 1055, 848, 201, -944, -2544,
+    4443, 6389, 8081, 9235, 9644, 9235, 8081, 6389,
+    -4443, -2544, -944, 201, 848, 1055, 946, 670,
+    -358, -100, 61, 128, 126, 90, 49, 18,
+};
+
+/* The WIND_8_SUBBANDS_* coefficients of sbc_analysis.c, arranged for the
+ * vector window kernels */
+const int16_t gas16WindowTaps8[5 * 16] = {
+    0, 5, 11, 18, 27, 37, 48, 58,
+    66, 69, 65, 53, 30, -6, -54, -115,
+
+    185, 263, 343, 418, 480, 521, 532, 502,
+    424, 290, 96, -161, -480, -856, -1280, -1743,
+
+    2228, 2719, 3197, 3644, 4039, 4367, 4612, 4764,
+    4815, 4764, 4612, 4367, 4039, 3644, 3197, 2719,
+
+    -2228, -1743, -1280, -856, -480, -161, 96, 290,
+    424, 502, 532, 521, 480, 418, 343, 263,
+
+    -185, -115, -54, -6, 30, 53, 65, 69,
+    66, 58, 48, 37, 27, 18, 11, 5,
+};
+#endif
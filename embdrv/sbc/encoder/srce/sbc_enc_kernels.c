@@ -0,0 +1,54 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file selects the implementation of the encoder inner loops for the
+ *  CPU the encoder runs on.
+ *
+ ******************************************************************************/
+
+#include "sbc_enc_func_declare.h"
+#include "sbc_encoder.h"
+
+const SBC_ENC_KERNELS sbc_enc_kernels_scalar = {
+    SbcWindow4, SbcWindow8, SBC_FastIDCT8Blocks, EncQuantizer,
+};
+
+const SBC_ENC_KERNELS* sbc_enc_kernels = &sbc_enc_kernels_scalar;
+
+/****************************************************************************
+* SbcEncKernelsInit - selects the fastest kernels supported by the CPU
+*
+* RETURNS : N/A
+*/
+void SbcEncKernelsInit(void) {
+  sbc_enc_kernels = &sbc_enc_kernels_scalar;
+#if (SBC_ENC_SIMD_INCLUDED == TRUE)
+#if defined(__i386__) || defined(__x86_64__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    sbc_enc_kernels = &sbc_enc_kernels_avx2;
+  } else if (__builtin_cpu_supports("sse2")) {
+    sbc_enc_kernels = &sbc_enc_kernels_sse2;
+  }
+#elif defined(__ARM_NEON)
+  sbc_enc_kernels = &sbc_enc_kernels_neon;
+#endif
+#endif
+}
@@ -0,0 +1,151 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  NEON versions of the encoder inner loops.
+ *
+ ******************************************************************************/
+
+#include "sbc_dct.h"
+#include "sbc_enc_func_declare.h"
+#include "sbc_encoder.h"
+
+#if (SBC_ENC_SIMD_INCLUDED == TRUE) && defined(__ARM_NEON)
+
+#include <arm_neon.h>
+
+/* Windows |s32Count| consecutive DCT inputs. The 5 samples of input k are k,
+ * k + s32Step, ..., k + 4 * s32Step, and |ps16Taps| has their coefficients
+ * at the same offsets. */
+static void sbc_window_lanes_neon(const int16_t* x, const int16_t* ps16Taps,
+                                  int32_t s32Step, int32_t s32Count,
+                                  int32_t* y) {
+  int32x4_t acc;
+  int32_t j, k;
+
+  for (k = 0; k < s32Count; k += 4) {
+    acc = vmull_s16(vld1_s16(x + k), vld1_s16(ps16Taps + k));
+    for (j = 1; j < 5; j++) {
+      acc = vmlal_s16(acc, vld1_s16(x + k + j * s32Step),
+                      vld1_s16(ps16Taps + k + j * s32Step));
+    }
+    vst1q_s32(y + k, acc);
+  }
+}
+
+static void sbc_window4_neon(const int16_t* x, int32_t* y) {
+  sbc_window_lanes_neon(x, gas16WindowTaps4, 8, 8, y);
+}
+
+static void sbc_window8_neon(const int16_t* x, int32_t* y) {
+  sbc_window_lanes_neon(x, gas16WindowTaps8, 16, 16, y);
+}
+
+/* SBC_MULT_32_16_SIMPLIFIED of every lane by a constant */
+static inline int32x4_t sbc_mult_c_neon(int32x4_t x, int32_t c) {
+  const int32x2_t vc = vdup_n_s32(c);
+  return vcombine_s32(vshrn_n_s64(vmull_s32(vget_low_s32(x), vc), 15),
+                      vshrn_n_s64(vmull_s32(vget_high_s32(x), vc), 15));
+}
+
+/* Transposes the 4x4 32 bit matrix in r0..r3 */
+#define SBC_TRANSPOSE4_NEON(r0, r1, r2, r3)                                \
+  {                                                                        \
+    int32x4x2_t t01 = vtrnq_s32(r0, r1);                                   \
+    int32x4x2_t t23 = vtrnq_s32(r2, r3);                                   \
+    r0 = vcombine_s32(vget_low_s32(t01.val[0]), vget_low_s32(t23.val[0])); \
+    r1 = vcombine_s32(vget_low_s32(t01.val[1]), vget_low_s32(t23.val[1])); \
+    r2 = vcombine_s32(vget_high_s32(t01.val[0]),                           \
+                      vget_high_s32(t23.val[0]));                          \
+    r3 = vcombine_s32(vget_high_s32(t01.val[1]),                           \
+                      vget_high_s32(t23.val[1]));                          \
+  }
+
+/* Four sets of inputs at a time, one per lane */
+static void sbc_dct8_neon(const int32_t* y, int32_t* out, int32_t count) {
+  int32x4_t in[16], res[8];
+  int32_t k;
+
+  for (; count >= 4; count -= 4) {
+    for (k = 0; k < 16; k += 4) {
+      in[k] = vld1q_s32(y + k);
+      in[k + 1] = vld1q_s32(y + 16 + k);
+      in[k + 2] = vld1q_s32(y + 32 + k);
+      in[k + 3] = vld1q_s32(y + 48 + k);
+      SBC_TRANSPOSE4_NEON(in[k], in[k + 1], in[k + 2], in[k + 3]);
+    }
+    SBC_DCT8_LANES(int32x4_t, vaddq_s32, vsubq_s32, vshrq_n_s32, vshlq_n_s32,
+                   sbc_mult_c_neon, in, res);
+    for (k = 0; k < 8; k += 4) {
+      SBC_TRANSPOSE4_NEON(res[k], res[k + 1], res[k + 2], res[k + 3]);
+      vst1q_s32(out + k, res[k]);
+      vst1q_s32(out + 8 + k, res[k + 1]);
+      vst1q_s32(out + 16 + k, res[k + 2]);
+      vst1q_s32(out + 24 + k, res[k + 3]);
+    }
+    y += 64;
+    out += 32;
+  }
+  SBC_FastIDCT8Blocks(y, out, count);
+}
+
+/* Four samples at a time in frame order, with per lane shifts. Frames have
+ * a multiple of 4 blocks of 4, 8 or 16 subband samples, so the scale factor
+ * and levels of each lane repeat every 16 samples. */
+static void sbc_quantize_neon(const SBC_ENC_PARAMS* pstrEncParams,
+                              uint32_t* pu32Quantized) {
+  const int32_t s32Rows =
+      pstrEncParams->s16NumOfChannels * pstrEncParams->s16NumOfSubBands;
+  const int32_t s32Count = s32Rows * pstrEncParams->s16NumOfBlocks;
+  int32_t as32Offset[16], as32Levels[16];
+  int64_t as64Shift[16];
+  int32x4_t a, offset, levels;
+  int64x2_t lo, hi;
+  int32_t i, k;
+
+  for (i = 0; i < 16; i++) {
+    k = i % s32Rows;
+    as32Offset[i] = 1 << (pstrEncParams->as16ScaleFactor[k] + 13);
+    as32Levels[i] = (1 << pstrEncParams->as16Bits[k]) - 1;
+    /* negative counts shift right */
+    as64Shift[i] = -(pstrEncParams->as16ScaleFactor[k] + 14);
+  }
+
+  for (i = 0; i < s32Count; i += 4) {
+    k = i & 15;
+    offset = vld1q_s32(as32Offset + k);
+    levels = vld1q_s32(as32Levels + k);
+    a = vaddq_s32(vshrq_n_s32(vld1q_s32(pstrEncParams->s32SbBuffer + i), 2),
+                  offset);
+    lo = vshlq_s64(vmull_s32(vget_low_s32(a), vget_low_s32(levels)),
+                   vld1q_s64(as64Shift + k));
+    hi = vshlq_s64(vmull_s32(vget_high_s32(a), vget_high_s32(levels)),
+                   vld1q_s64(as64Shift + k + 2));
+    vst1q_u32(pu32Quantized + i,
+              vandq_u32(vreinterpretq_u32_s32(
+                            vcombine_s32(vmovn_s64(lo), vmovn_s64(hi))),
+                        vdupq_n_u32(0xFFFF)));
+  }
+}
+
+const SBC_ENC_KERNELS sbc_enc_kernels_neon = {
+    sbc_window4_neon, sbc_window8_neon, sbc_dct8_neon, sbc_quantize_neon,
+};
+
+#endif
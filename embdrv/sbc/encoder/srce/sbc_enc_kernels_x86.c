@@ -0,0 +1,323 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  SSE2 and AVX2 versions of the encoder inner loops. The AVX2 functions are
+ *  built for that instruction set with target attributes and are only
+ *  selected by SbcEncKernelsInit when the CPU supports it.
+ *
+ ******************************************************************************/
+
+#include "sbc_dct.h"
+#include "sbc_enc_func_declare.h"
+#include "sbc_encoder.h"
+
+#if (SBC_ENC_SIMD_INCLUDED == TRUE) && \
+    (defined(__i386__) || defined(__x86_64__))
+
+#include <immintrin.h>
+
+#define SBC_AVX2 __attribute__((target("avx2")))
+
+/* Transposes the 4x4 32 bit matrix in r0..r3 (per 128 bit lane) */
+#define SBC_TRANSPOSE4(PFX, VT, r0, r1, r2, r3) \
+  {                                             \
+    VT t0 = PFX##_unpacklo_epi32(r0, r1);       \
+    VT t1 = PFX##_unpacklo_epi32(r2, r3);       \
+    VT t2 = PFX##_unpackhi_epi32(r0, r1);       \
+    VT t3 = PFX##_unpackhi_epi32(r2, r3);       \
+    r0 = PFX##_unpacklo_epi64(t0, t1);          \
+    r1 = PFX##_unpackhi_epi64(t0, t1);          \
+    r2 = PFX##_unpacklo_epi64(t2, t3);          \
+    r3 = PFX##_unpackhi_epi64(t2, t3);          \
+  }
+
+#define SBC_LOAD128(p) _mm_loadu_si128((const __m128i*)(p))
+#define SBC_STORE128(p, v) _mm_storeu_si128((__m128i*)(p), v)
+#define SBC_LOAD256(p) _mm256_loadu_si256((const __m256i*)(p))
+#define SBC_STORE256(p, v) _mm256_storeu_si256((__m256i*)(p), v)
+
+/*******************************************************************************
+ * SSE2
+ ******************************************************************************/
+
+/* Windows 8 consecutive DCT inputs. The 5 samples of input k are k,
+ * k + s32Step, ..., k + 4 * s32Step, and |ps16Taps| has their coefficients
+ * at the same offsets. Sample rows are multiplied two at a time with madd,
+ * which adds up exactly like the scalar 32 bit accumulation. */
+static void sbc_window_lanes_sse2(const int16_t* x, const int16_t* ps16Taps,
+                                  int32_t s32Step, int32_t* y) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i lo, hi, xa, xb, ta, tb;
+  int32_t j;
+
+  lo = hi = zero;
+  for (j = 0; j < 5; j += 2) {
+    xa = SBC_LOAD128(x + j * s32Step);
+    ta = SBC_LOAD128(ps16Taps + j * s32Step);
+    xb = (j < 4) ? SBC_LOAD128(x + (j + 1) * s32Step) : zero;
+    tb = (j < 4) ? SBC_LOAD128(ps16Taps + (j + 1) * s32Step) : zero;
+    lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(xa, xb),
+                                          _mm_unpacklo_epi16(ta, tb)));
+    hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(xa, xb),
+                                          _mm_unpackhi_epi16(ta, tb)));
+  }
+  SBC_STORE128(y, lo);
+  SBC_STORE128(y + 4, hi);
+}
+
+static void sbc_window4_sse2(const int16_t* x, int32_t* y) {
+  sbc_window_lanes_sse2(x, gas16WindowTaps4, 8, y);
+}
+
+static void sbc_window8_sse2(const int16_t* x, int32_t* y) {
+  sbc_window_lanes_sse2(x, gas16WindowTaps8, 16, y);
+  sbc_window_lanes_sse2(x + 8, gas16WindowTaps8 + 8, 16, y + 8);
+}
+
+/* SBC_MULT_32_16_SIMPLIFIED of every lane by a positive 16 bit constant.
+ * With x = hi * 2^16 + lo, ((int64_t)c * x) >> 15 is
+ * 2 * c * hi + ((c * (lo - 2^15)) >> 15) + c, and flipping bit 15 of x
+ * turns both products into a single madd. */
+static inline __m128i sbc_mult_c_sse2(__m128i x, int32_t c) {
+  x = _mm_xor_si128(x, _mm_set1_epi32(0x8000));
+  return _mm_add_epi32(
+      _mm_add_epi32(
+          _mm_slli_epi32(_mm_madd_epi16(x, _mm_set1_epi32(c << 16)), 1),
+          _mm_srai_epi32(_mm_madd_epi16(x, _mm_set1_epi32(c)), 15)),
+      _mm_set1_epi32(c));
+}
+
+/* Four sets of inputs at a time, one per lane */
+static void sbc_dct8_sse2(const int32_t* y, int32_t* out, int32_t count) {
+  __m128i in[16], res[8];
+  int32_t k;
+
+  for (; count >= 4; count -= 4) {
+    for (k = 0; k < 16; k += 4) {
+      in[k] = SBC_LOAD128(y + k);
+      in[k + 1] = SBC_LOAD128(y + 16 + k);
+      in[k + 2] = SBC_LOAD128(y + 32 + k);
+      in[k + 3] = SBC_LOAD128(y + 48 + k);
+      SBC_TRANSPOSE4(_mm, __m128i, in[k], in[k + 1], in[k + 2], in[k + 3]);
+    }
+    SBC_DCT8_LANES(__m128i, _mm_add_epi32, _mm_sub_epi32, _mm_srai_epi32,
+                   _mm_slli_epi32, sbc_mult_c_sse2, in, res);
+    for (k = 0; k < 8; k += 4) {
+      SBC_TRANSPOSE4(_mm, __m128i, res[k], res[k + 1], res[k + 2],
+                     res[k + 3]);
+      SBC_STORE128(out + k, res[k]);
+      SBC_STORE128(out + 8 + k, res[k + 1]);
+      SBC_STORE128(out + 16 + k, res[k + 2]);
+      SBC_STORE128(out + 24 + k, res[k + 3]);
+    }
+    y += 64;
+    out += 32;
+  }
+  SBC_FastIDCT8Blocks(y, out, count);
+}
+
+/* Quantizes the samples of one subband in four blocks. The 64 bit product of
+ * a signed sample and the unsigned levels is their unsigned product, minus
+ * levels << 32 when the sample is negative. */
+static inline __m128i sbc_quantize_lanes_sse2(__m128i s, int16_t s16Scf,
+                                              int16_t s16Bits) {
+  const __m128i levels = _mm_set1_epi32((1 << s16Bits) - 1);
+  const __m128i shift = _mm_cvtsi32_si128(s16Scf + 14);
+  const __m128i low32 = _mm_set1_epi64x(0xFFFFFFFF);
+  __m128i a, neg, even, odd;
+
+  a = _mm_add_epi32(_mm_srai_epi32(s, 2), _mm_set1_epi32(1 << (s16Scf + 13)));
+  neg = _mm_and_si128(_mm_srai_epi32(a, 31), levels);
+
+  even = _mm_sub_epi64(_mm_mul_epu32(a, levels), _mm_slli_epi64(neg, 32));
+  odd = _mm_sub_epi64(_mm_mul_epu32(_mm_srli_epi64(a, 32), levels),
+                      _mm_andnot_si128(low32, neg));
+  even = _mm_srl_epi64(even, shift);
+  odd = _mm_srl_epi64(odd, shift);
+
+  return _mm_and_si128(
+      _mm_or_si128(_mm_and_si128(even, low32), _mm_slli_epi64(odd, 32)),
+      _mm_set1_epi32(0xFFFF));
+}
+
+/* Four blocks and four subbands at a time. Frames have a multiple of 4
+ * blocks, and the samples of one subband in four blocks share a scale factor
+ * and bit allocation. */
+static void sbc_quantize_sse2(const SBC_ENC_PARAMS* pstrEncParams,
+                              uint32_t* pu32Quantized) {
+  const int32_t s32Rows =
+      pstrEncParams->s16NumOfChannels * pstrEncParams->s16NumOfSubBands;
+  const int32_t s32NumOfBlocks = pstrEncParams->s16NumOfBlocks;
+  const int16_t* ps16Scf = pstrEncParams->as16ScaleFactor;
+  const int16_t* ps16Bits = pstrEncParams->as16Bits;
+  const int32_t* ps32Sb;
+  uint32_t* pu32Out;
+  int32_t s32Blk, s32Row;
+  __m128i r0, r1, r2, r3;
+
+  for (s32Blk = 0; s32Blk < s32NumOfBlocks; s32Blk += 4) {
+    ps32Sb = pstrEncParams->s32SbBuffer + s32Blk * s32Rows;
+    pu32Out = pu32Quantized + s32Blk * s32Rows;
+    for (s32Row = 0; s32Row < s32Rows; s32Row += 4) {
+      r0 = SBC_LOAD128(ps32Sb + s32Row);
+      r1 = SBC_LOAD128(ps32Sb + s32Rows + s32Row);
+      r2 = SBC_LOAD128(ps32Sb + 2 * s32Rows + s32Row);
+      r3 = SBC_LOAD128(ps32Sb + 3 * s32Rows + s32Row);
+      SBC_TRANSPOSE4(_mm, __m128i, r0, r1, r2, r3);
+      r0 = sbc_quantize_lanes_sse2(r0, ps16Scf[s32Row], ps16Bits[s32Row]);
+      r1 = sbc_quantize_lanes_sse2(r1, ps16Scf[s32Row + 1],
+                                   ps16Bits[s32Row + 1]);
+      r2 = sbc_quantize_lanes_sse2(r2, ps16Scf[s32Row + 2],
+                                   ps16Bits[s32Row + 2]);
+      r3 = sbc_quantize_lanes_sse2(r3, ps16Scf[s32Row + 3],
+                                   ps16Bits[s32Row + 3]);
+      SBC_TRANSPOSE4(_mm, __m128i, r0, r1, r2, r3);
+      SBC_STORE128(pu32Out + s32Row, r0);
+      SBC_STORE128(pu32Out + s32Rows + s32Row, r1);
+      SBC_STORE128(pu32Out + 2 * s32Rows + s32Row, r2);
+      SBC_STORE128(pu32Out + 3 * s32Rows + s32Row, r3);
+    }
+  }
+}
+
+const SBC_ENC_KERNELS sbc_enc_kernels_sse2 = {
+    sbc_window4_sse2, sbc_window8_sse2, sbc_dct8_sse2, sbc_quantize_sse2,
+};
+
+/*******************************************************************************
+ * AVX2
+ ******************************************************************************/
+
+/* Same as sbc_window_lanes_sse2 for 16 inputs. The 256 bit unpacks work on
+ * each 128 bit half, so the halves of |lo| hold inputs 0-3 and 8-11, and
+ * those of |hi| inputs 4-7 and 12-15. */
+SBC_AVX2 static void sbc_window8_avx2(const int16_t* x, int32_t* y) {
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i lo, hi, xa, xb, ta, tb;
+  int32_t j;
+
+  lo = hi = zero;
+  for (j = 0; j < 5; j += 2) {
+    xa = SBC_LOAD256(x + j * 16);
+    ta = SBC_LOAD256(gas16WindowTaps8 + j * 16);
+    xb = (j < 4) ? SBC_LOAD256(x + (j + 1) * 16) : zero;
+    tb = (j < 4) ? SBC_LOAD256(gas16WindowTaps8 + (j + 1) * 16) : zero;
+    lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(xa, xb),
+                                                _mm256_unpacklo_epi16(ta, tb)));
+    hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(xa, xb),
+                                                _mm256_unpackhi_epi16(ta, tb)));
+  }
+  SBC_STORE256(y, _mm256_permute2x128_si256(lo, hi, 0x20));
+  SBC_STORE256(y + 8, _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+SBC_AVX2 static inline __m256i sbc_mult_c_avx2(__m256i x, int32_t c) {
+  x = _mm256_xor_si256(x, _mm256_set1_epi32(0x8000));
+  return _mm256_add_epi32(
+      _mm256_add_epi32(
+          _mm256_slli_epi32(_mm256_madd_epi16(x, _mm256_set1_epi32(c << 16)),
+                            1),
+          _mm256_srai_epi32(_mm256_madd_epi16(x, _mm256_set1_epi32(c)), 15)),
+      _mm256_set1_epi32(c));
+}
+
+/* Eight sets of inputs at a time, sets 0-3 in the low halves and sets 4-7 in
+ * the high halves of the vectors */
+SBC_AVX2 static void sbc_dct8_avx2(const int32_t* y, int32_t* out,
+                                   int32_t count) {
+  __m256i in[16], res[8];
+  int32_t k, b;
+
+  for (; count >= 8; count -= 8) {
+    for (k = 0; k < 16; k += 4) {
+      for (b = 0; b < 4; b++) {
+        in[k + b] = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(SBC_LOAD128(y + 16 * b + k)),
+            SBC_LOAD128(y + 16 * (b + 4) + k), 1);
+      }
+      SBC_TRANSPOSE4(_mm256, __m256i, in[k], in[k + 1], in[k + 2], in[k + 3]);
+    }
+    SBC_DCT8_LANES(__m256i, _mm256_add_epi32, _mm256_sub_epi32,
+                   _mm256_srai_epi32, _mm256_slli_epi32, sbc_mult_c_avx2, in,
+                   res);
+    for (k = 0; k < 8; k += 4) {
+      SBC_TRANSPOSE4(_mm256, __m256i, res[k], res[k + 1], res[k + 2],
+                     res[k + 3]);
+      for (b = 0; b < 4; b++) {
+        SBC_STORE128(out + 8 * b + k, _mm256_castsi256_si128(res[k + b]));
+        SBC_STORE128(out + 8 * (b + 4) + k,
+                     _mm256_extracti128_si256(res[k + b], 1));
+      }
+    }
+    y += 128;
+    out += 64;
+  }
+  sbc_dct8_sse2(y, out, count);
+}
+
+/* Eight samples at a time in frame order, with per lane shifts. Frames have
+ * a multiple of 4 blocks of 4, 8 or 16 subband samples, so the scale factor
+ * and levels of each lane repeat every 16 samples. */
+SBC_AVX2 static void sbc_quantize_avx2(const SBC_ENC_PARAMS* pstrEncParams,
+                                       uint32_t* pu32Quantized) {
+  const int32_t s32Rows =
+      pstrEncParams->s16NumOfChannels * pstrEncParams->s16NumOfSubBands;
+  const int32_t s32Count = s32Rows * pstrEncParams->s16NumOfBlocks;
+  const __m256i low32 = _mm256_set1_epi64x(0xFFFFFFFF);
+  int32_t as32Offset[16], as32Levels[16], as32Shift[16];
+  __m256i offset[2], levels[2], shift[2];
+  __m256i a, even, odd;
+  int32_t i, k;
+
+  for (i = 0; i < 16; i++) {
+    k = i % s32Rows;
+    as32Offset[i] = 1 << (pstrEncParams->as16ScaleFactor[k] + 13);
+    as32Levels[i] = (1 << pstrEncParams->as16Bits[k]) - 1;
+    as32Shift[i] = pstrEncParams->as16ScaleFactor[k] + 14;
+  }
+  for (k = 0; k < 2; k++) {
+    offset[k] = SBC_LOAD256(as32Offset + 8 * k);
+    levels[k] = SBC_LOAD256(as32Levels + 8 * k);
+    shift[k] = SBC_LOAD256(as32Shift + 8 * k);
+  }
+
+  for (i = 0; i < s32Count; i += 8) {
+    k = (i >> 3) & 1;
+    a = _mm256_add_epi32(
+        _mm256_srai_epi32(SBC_LOAD256(pstrEncParams->s32SbBuffer + i), 2),
+        offset[k]);
+    even = _mm256_srlv_epi64(_mm256_mul_epi32(a, levels[k]),
+                             _mm256_and_si256(shift[k], low32));
+    odd = _mm256_srlv_epi64(
+        _mm256_mul_epi32(_mm256_srli_epi64(a, 32),
+                         _mm256_srli_epi64(levels[k], 32)),
+        _mm256_srli_epi64(shift[k], 32));
+    SBC_STORE256(pu32Quantized + i,
+                 _mm256_and_si256(
+                     _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA),
+                     _mm256_set1_epi32(0xFFFF)));
+  }
+}
+
+const SBC_ENC_KERNELS sbc_enc_kernels_avx2 = {
+    sbc_window4_sse2, sbc_window8_avx2, sbc_dct8_avx2, sbc_quantize_avx2,
+};
+
+#endif
@@ -155,6 +155,45 @@ uint32_t SBC_Encode(SBC_ENC_PARAMS* pstrEncParams, int16_t* input,
   return EncPacking(pstrEncParams, output);
 }
 
+uint32_t SBC_EncodeFrames(SBC_ENC_PARAMS* pstrEncParams, int16_t* input,
+                          uint32_t num_frames, uint8_t* output) {
+  int32_t s32FrameSamples = pstrEncParams->s16NumOfSubBands *
+                            pstrEncParams->s16NumOfBlocks *
+                            pstrEncParams->s16NumOfChannels;
+  uint32_t u32Written = 0;
+
+  while (num_frames--) {
+    u32Written += SBC_Encode(pstrEncParams, input, output + u32Written);
+    input += s32FrameSamples;
+  }
+  return u32Written;
+}
+
+uint32_t SBC_FrameLength(const SBC_ENC_PARAMS* pstrEncParams) {
+  uint32_t u32Bits; /* bits of audio data, including the join field */
+
+  switch (pstrEncParams->s16ChannelMode) {
+    case SBC_MONO:
+    case SBC_DUAL:
+      u32Bits = pstrEncParams->s16NumOfBlocks *
+                pstrEncParams->s16NumOfChannels * pstrEncParams->s16BitPool;
+      break;
+    case SBC_JOINT_STEREO:
+      u32Bits = pstrEncParams->s16NumOfSubBands +
+                pstrEncParams->s16NumOfBlocks * pstrEncParams->s16BitPool;
+      break;
+    default:
+      u32Bits = pstrEncParams->s16NumOfBlocks * pstrEncParams->s16BitPool;
+      break;
+  }
+  /* header and scale factors, then the audio data padded to a byte */
+  return 4 +
+         (4 * pstrEncParams->s16NumOfSubBands *
+          pstrEncParams->s16NumOfChannels) /
+             8 +
+         (u32Bits + 7) / 8;
+}
+
 /****************************************************************************
 * InitSbcAnalysisFilt - Initalizes the input data to 0
 *
@@ -254,5 +293,6 @@ void SBC_Encoder_Init(SBC_ENC_PARAMS* pstrEncParams) {
       EncMaxShiftCounter = ((ENC_VX_BUFFER_SIZE - 8 * 10 * 2) >> 4) << 3;
   }
 
+  SbcEncKernelsInit();
   SbcAnalysisInit();
 }
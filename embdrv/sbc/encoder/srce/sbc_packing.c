@@ -51,6 +51,70 @@
   }
 #endif
 
+/* Quantizes every subband sample, block by block, in the order of
+ * s32SbBuffer. Samples of subbands without bits quantize to 0. */
+void EncQuantizer(const SBC_ENC_PARAMS* pstrEncParams,
+                  uint32_t* pu32Quantized) {
+  int32_t s32Blk;       /* counter for block*/
+  int32_t s32Ch;        /* counter for channel*/
+  int32_t s32LoopCount; /* number of bits of the sample*/
+  uint32_t u32QuantizedSbValue0; /* temp variable to store quantized sb val*/
+  const int16_t* ps16GenPtr;
+  const int16_t* ps16ScfPtr;
+  const int32_t* ps32SbPtr;
+  int32_t s32Sb = pstrEncParams->s16NumOfChannels *
+                  pstrEncParams->s16NumOfSubBands;
+  uint32_t u32SfRaisedToPow2; /*scale factor raised to power 2*/
+  uint16_t u16Levels;         /*to store levels*/
+  int32_t s32Temp1;           /*used in 64-bit multiplication*/
+  int32_t s32Low;             /*used in 64-bit multiplication*/
+#if (SBC_IS_64_MULT_IN_QUANTIZER == TRUE)
+  int32_t s32Hi1, s32Low1, s32Carry, s32TempVal2, s32Hi, s32Temp2;
+#endif
+
+  ps32SbPtr = pstrEncParams->s32SbBuffer;
+  for (s32Blk = pstrEncParams->s16NumOfBlocks - 1; s32Blk >= 0; s32Blk--) {
+    ps16GenPtr = pstrEncParams->as16Bits;
+    ps16ScfPtr = pstrEncParams->as16ScaleFactor;
+    for (s32Ch = s32Sb - 1; s32Ch >= 0; s32Ch--) {
+      s32LoopCount = *ps16GenPtr++;
+      u32QuantizedSbValue0 = 0;
+      if (s32LoopCount != 0) {
+#if (SBC_IS_64_MULT_IN_QUANTIZER == TRUE)
+        /* finding level from reconstruction part of decoder */
+        u32SfRaisedToPow2 = ((uint32_t)1 << ((*ps16ScfPtr) + 1));
+        u16Levels = (uint16_t)(((uint32_t)1 << s32LoopCount) - 1);
+
+        /* quantizer */
+        s32Temp1 = (*ps32SbPtr >> 2) + (u32SfRaisedToPow2 << 12);
+        s32Temp2 = u16Levels;
+
+        Mult64(s32Temp1, s32Temp2, s32Low, s32Hi);
+
+        s32Low1 = s32Low >> ((*ps16ScfPtr) + 2);
+        s32Low1 &= ((uint32_t)1 << (32 - ((*ps16ScfPtr) + 2))) - 1;
+        s32Hi1 = s32Hi << (32 - ((*ps16ScfPtr) + 2));
+
+        u32QuantizedSbValue0 = (uint16_t)((s32Low1 | s32Hi1) >> 12);
+#else
+        /* finding level from reconstruction part of decoder */
+        u32SfRaisedToPow2 = ((uint32_t)1 << *ps16ScfPtr);
+        u16Levels = (uint16_t)(((uint32_t)1 << s32LoopCount) - 1);
+
+        /* quantizer */
+        s32Temp1 = (*ps32SbPtr >> 15) + u32SfRaisedToPow2;
+        Mult32(s32Temp1, u16Levels, s32Low);
+        s32Low >>= (*ps16ScfPtr + 1);
+        u32QuantizedSbValue0 = (uint16_t)s32Low;
+#endif
+      }
+      *pu32Quantized++ = u32QuantizedSbValue0;
+      ps16ScfPtr++;
+      ps32SbPtr++;
+    }
+  }
+}
+
 /* return number of bytes written to output */
 uint32_t EncPacking(SBC_ENC_PARAMS* pstrEncParams, uint8_t* output) {
   uint8_t* pu8PacketPtr; /* packet ptr*/
@@ -61,24 +125,18 @@ uint32_t EncPacking(SBC_ENC_PARAMS* pstrEncParams, uint8_t* output) {
   int32_t s32PresentBit; /* represents bit to be stored*/
   /*int32_t s32LoopCountI;                       loop counter*/
   int32_t s32LoopCountJ; /* loop counter*/
-  uint32_t u32QuantizedSbValue,
-      u32QuantizedSbValue0; /* temp variable to store quantized sb val*/
-  int32_t s32LoopCount;     /* loop counter*/
-  uint8_t u8XoredVal;       /* to store XORed value in CRC calculation*/
-  uint8_t u8CRC;            /* to store CRC value*/
+  int32_t s32LoopCount;  /* loop counter*/
+  uint8_t u8XoredVal;    /* to store XORed value in CRC calculation*/
+  uint8_t u8CRC;         /* to store CRC value*/
   int16_t* ps16GenPtr;
   int32_t s32NumOfBlocks;
   int32_t s32NumOfSubBands = pstrEncParams->s16NumOfSubBands;
   int32_t s32NumOfChannels = pstrEncParams->s16NumOfChannels;
-  uint32_t u32SfRaisedToPow2; /*scale factor raised to power 2*/
-  int16_t* ps16ScfPtr;
-  int32_t* ps32SbPtr;
-  uint16_t u16Levels; /*to store levels*/
-  int32_t s32Temp1;   /*used in 64-bit multiplication*/
-  int32_t s32Low;     /*used in 64-bit multiplication*/
-#if (SBC_IS_64_MULT_IN_QUANTIZER == TRUE)
-  int32_t s32Hi1, s32Low1, s32Carry, s32TempVal2, s32Hi, s32Temp2;
-#endif
+  uint32_t u32Quantized[SBC_MAX_NUM_OF_CHANNELS * SBC_MAX_NUM_OF_SUBBANDS *
+                        SBC_MAX_NUM_OF_BLOCKS];
+  uint32_t* pu32QuantizedPtr;
+  uint32_t u32BitAcc; /* bits not yet written, in the low s32AccBits bits*/
+  int32_t s32AccBits;
 
   pu8PacketPtr = output;           /*Initialize the ptr*/
   *pu8PacketPtr++ = (uint8_t)0x9C; /*Sync word*/
@@ -125,85 +183,30 @@ uint32_t EncPacking(SBC_ENC_PARAMS* pstrEncParams, uint8_t* output) {
     }
   }
 
-  /* Pack samples */
-  ps32SbPtr = pstrEncParams->s32SbBuffer;
-  /*Temp=*pu8PacketPtr;*/
+  /* Quantize all samples, then pack them most significant bit first. A
+   * quantized sample never exceeds its number of bits, so the samples can
+   * be appended to an accumulator and written out a byte at a time. As
+   * before, a full byte is only written once more bits follow it. */
+  sbc_enc_kernels->quantize(pstrEncParams, u32Quantized);
+
+  pu32QuantizedPtr = u32Quantized;
+  u32BitAcc = Temp;
+  s32AccBits = 8 - s32PresentBit;
   s32NumOfBlocks = pstrEncParams->s16NumOfBlocks;
   for (s32Blk = s32NumOfBlocks - 1; s32Blk >= 0; s32Blk--) {
     ps16GenPtr = pstrEncParams->as16Bits;
-    ps16ScfPtr = pstrEncParams->as16ScaleFactor;
     for (s32Ch = s32Sb - 1; s32Ch >= 0; s32Ch--) {
       s32LoopCount = *ps16GenPtr++;
-      if (s32LoopCount != 0) {
-#if (SBC_IS_64_MULT_IN_QUANTIZER == TRUE)
-        /* finding level from reconstruction part of decoder */
-        u32SfRaisedToPow2 = ((uint32_t)1 << ((*ps16ScfPtr) + 1));
-        u16Levels = (uint16_t)(((uint32_t)1 << s32LoopCount) - 1);
-
-        /* quantizer */
-        s32Temp1 = (*ps32SbPtr >> 2) + (u32SfRaisedToPow2 << 12);
-        s32Temp2 = u16Levels;
-
-        Mult64(s32Temp1, s32Temp2, s32Low, s32Hi);
-
-        s32Low1 = s32Low >> ((*ps16ScfPtr) + 2);
-        s32Low1 &= ((uint32_t)1 << (32 - ((*ps16ScfPtr) + 2))) - 1;
-        s32Hi1 = s32Hi << (32 - ((*ps16ScfPtr) + 2));
-
-        u32QuantizedSbValue0 = (uint16_t)((s32Low1 | s32Hi1) >> 12);
-#else
-        /* finding level from reconstruction part of decoder */
-        u32SfRaisedToPow2 = ((uint32_t)1 << *ps16ScfPtr);
-        u16Levels = (uint16_t)(((uint32_t)1 << s32LoopCount) - 1);
-
-        /* quantizer */
-        s32Temp1 = (*ps32SbPtr >> 15) + u32SfRaisedToPow2;
-        Mult32(s32Temp1, u16Levels, s32Low);
-        s32Low >>= (*ps16ScfPtr + 1);
-        u32QuantizedSbValue0 = (uint16_t)s32Low;
-#endif
-        /*store the number of bits required and the quantized s32Sb
-        sample to ease the coding*/
-        u32QuantizedSbValue = u32QuantizedSbValue0;
-
-        if (s32PresentBit >= s32LoopCount) {
-          Temp <<= s32LoopCount;
-          Temp |= u32QuantizedSbValue;
-          s32PresentBit -= s32LoopCount;
-        } else {
-          while (s32PresentBit < s32LoopCount) {
-            s32LoopCount -= s32PresentBit;
-            u32QuantizedSbValue >>= s32LoopCount;
-
-            /*remove the unwanted msbs*/
-            /*u32QuantizedSbValue <<= 16 - s32PresentBit;
-            u32QuantizedSbValue >>= 16 - s32PresentBit;*/
-
-            Temp <<= s32PresentBit;
-
-            Temp |= u32QuantizedSbValue;
-            /*restore the original*/
-            u32QuantizedSbValue = u32QuantizedSbValue0;
-
-            *(pu8PacketPtr++) = Temp;
-            Temp = 0;
-            s32PresentBit = 8;
-          }
-          Temp <<= s32LoopCount;
-
-          /* remove the unwanted msbs */
-          /*u32QuantizedSbValue <<= 16 - s32LoopCount;
-          u32QuantizedSbValue >>= 16 - s32LoopCount;*/
-
-          Temp |= u32QuantizedSbValue;
-
-          s32PresentBit -= s32LoopCount;
-        }
+      u32BitAcc = (u32BitAcc << s32LoopCount) | *pu32QuantizedPtr++;
+      s32AccBits += s32LoopCount;
+      while (s32AccBits > 8) {
+        s32AccBits -= 8;
+        *(pu8PacketPtr++) = (uint8_t)(u32BitAcc >> s32AccBits);
       }
-      ps16ScfPtr++;
-      ps32SbPtr++;
     }
   }
+  Temp = (uint8_t)u32BitAcc;
+  s32PresentBit = 8 - s32AccBits;
 
   Temp <<= s32PresentBit;
   *pu8PacketPtr = Temp;
@@ -0,0 +1,105 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <benchmark/benchmark.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "sbc_enc_func_declare.h"
+#include "sbc_encoder.h"
+
+using ::benchmark::Counter;
+using ::benchmark::State;
+
+// Frames encoded per iteration; about 100 ms of audio at 44.1 kHz with
+// 16 blocks of 8 subbands.
+#define FRAMES_PER_ITERATION 36
+
+static std::vector<int16_t> benchmark_pcm() {
+  std::vector<int16_t> pcm(FRAMES_PER_ITERATION * SBC_MAX_NUM_OF_BLOCKS *
+                           SBC_MAX_NUM_OF_SUBBANDS * SBC_MAX_NUM_OF_CHANNELS);
+  uint32_t seed = 1;
+  for (size_t i = 0; i < pcm.size(); i++) {
+    seed = seed * 1103515245 + 12345;
+    int32_t triangle = (int32_t)(i % 256) - 128;
+    pcm[i] = (int16_t)(200 * triangle + (int32_t)((seed >> 16) % 2048) - 1024);
+  }
+  return pcm;
+}
+
+// Encodes FRAMES_PER_ITERATION frames with |kernels|. The arguments are the
+// number of subbands, the number of blocks and the channel mode.
+static void BM_SbcEncode(State& state, const SBC_ENC_KERNELS* kernels) {
+  SBC_ENC_PARAMS params;
+  memset(&params, 0, sizeof(params));
+  params.s16SamplingFreq = SBC_sf44100;
+  params.s16NumOfSubBands = state.range(0);
+  params.s16NumOfBlocks = state.range(1);
+  params.s16ChannelMode = state.range(2);
+  params.s16AllocationMethod = SBC_LOUDNESS;
+  params.u16BitRate = (params.s16ChannelMode == SBC_MONO) ? 200 : 345;
+  SBC_Encoder_Init(&params);
+  sbc_enc_kernels = kernels;
+
+  std::vector<int16_t> pcm = benchmark_pcm();
+  size_t frame_samples = params.s16NumOfSubBands * params.s16NumOfBlocks *
+                         params.s16NumOfChannels;
+  uint8_t frame[512];
+  for (auto _ : state) {
+    for (int f = 0; f < FRAMES_PER_ITERATION; f++) {
+      benchmark::DoNotOptimize(
+          SBC_Encode(&params, pcm.data() + f * frame_samples, frame));
+    }
+  }
+  state.counters["frames_per_second"] =
+      Counter(state.iterations() * FRAMES_PER_ITERATION, Counter::kIsRate);
+  SbcEncKernelsInit();
+}
+
+static void register_kernels(const char* name,
+                             const SBC_ENC_KERNELS* kernels) {
+  std::string benchmark_name = std::string("BM_SbcEncode/") + name;
+  benchmark::RegisterBenchmark(benchmark_name.c_str(), BM_SbcEncode, kernels)
+      ->ArgNames({"subbands", "blocks", "mode"})
+      ->ArgsProduct({{SUB_BANDS_4, SUB_BANDS_8},
+                     {SBC_BLOCK_0, SBC_BLOCK_1, SBC_BLOCK_2, SBC_BLOCK_3},
+                     {SBC_MONO, SBC_STEREO, SBC_JOINT_STEREO}});
+}
+
+int main(int argc, char** argv) {
+  register_kernels("scalar", &sbc_enc_kernels_scalar);
+#if (SBC_ENC_SIMD_INCLUDED == TRUE)
+#if defined(__i386__) || defined(__x86_64__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse2"))
+    register_kernels("sse2", &sbc_enc_kernels_sse2);
+  if (__builtin_cpu_supports("avx2"))
+    register_kernels("avx2", &sbc_enc_kernels_avx2);
+#endif
+#if defined(__ARM_NEON)
+  register_kernels("neon", &sbc_enc_kernels_neon);
+#endif
+#endif
+
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  ::benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -0,0 +1,318 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "sbc_enc_func_declare.h"
+#include "sbc_encoder.h"
+
+namespace {
+
+constexpr int kGoldenFrames = 300;
+
+struct KernelSet {
+  const char* name;
+  const SBC_ENC_KERNELS* kernels;
+};
+
+std::vector<KernelSet> available_kernels() {
+  std::vector<KernelSet> sets = {{"scalar", &sbc_enc_kernels_scalar}};
+#if (SBC_ENC_SIMD_INCLUDED == TRUE)
+#if defined(__i386__) || defined(__x86_64__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse2"))
+    sets.push_back({"sse2", &sbc_enc_kernels_sse2});
+  if (__builtin_cpu_supports("avx2"))
+    sets.push_back({"avx2", &sbc_enc_kernels_avx2});
+#endif
+#if defined(__ARM_NEON)
+  sets.push_back({"neon", &sbc_enc_kernels_neon});
+#endif
+#endif
+  return sets;
+}
+
+uint32_t next_random(uint32_t* state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+  return *state;
+}
+
+// Two triangle waves plus noise, with bursts of full scale square wave to
+// hit the largest scale factors. Integer only, so that the golden digests do
+// not depend on the math library.
+std::vector<int16_t> test_pcm(size_t samples) {
+  std::vector<int16_t> pcm(samples);
+  uint32_t seed = 7;
+  for (size_t i = 0; i < samples; i++) {
+    int32_t slow = (int32_t)(i % 512) - 256;
+    int32_t fast = (int32_t)(i % 20) - 10;
+    int32_t v = 12000 - 94 * (slow < 0 ? -slow : slow) +
+                800 * (fast < 0 ? -fast : fast) - 4000 +
+                (int32_t)(next_random(&seed) % 4000) - 2000;
+    if (i % 5000 < 40) v = (i & 1) ? 32767 : -32768;
+    pcm[i] = (int16_t)v;
+  }
+  return pcm;
+}
+
+struct GoldenVector {
+  int16_t subbands;
+  int16_t blocks;
+  int16_t channel_mode;
+  int16_t allocation;
+  uint32_t digest;  // FNV-1a of the frames and their lengths
+};
+
+// Produced by the scalar encoder before the vector kernels were added.
+const GoldenVector kGoldenVectors[] = {
+    {4, 4, SBC_MONO, SBC_LOUDNESS, 0x65ca0a18},
+    {4, 4, SBC_MONO, SBC_SNR, 0x6bc2d6fc},
+    {4, 4, SBC_DUAL, SBC_LOUDNESS, 0xf52070e2},
+    {4, 4, SBC_DUAL, SBC_SNR, 0x612cedc2},
+    {4, 4, SBC_STEREO, SBC_LOUDNESS, 0x789f6944},
+    {4, 4, SBC_STEREO, SBC_SNR, 0x503e3820},
+    {4, 4, SBC_JOINT_STEREO, SBC_LOUDNESS, 0xdb71645c},
+    {4, 4, SBC_JOINT_STEREO, SBC_SNR, 0x329ce40d},
+    {4, 8, SBC_MONO, SBC_LOUDNESS, 0x32f0a349},
+    {4, 8, SBC_MONO, SBC_SNR, 0x65c2641f},
+    {4, 8, SBC_DUAL, SBC_LOUDNESS, 0x73a8b375},
+    {4, 8, SBC_DUAL, SBC_SNR, 0x59ac7d44},
+    {4, 8, SBC_STEREO, SBC_LOUDNESS, 0x131a79de},
+    {4, 8, SBC_STEREO, SBC_SNR, 0xb3419917},
+    {4, 8, SBC_JOINT_STEREO, SBC_LOUDNESS, 0xeca34c3c},
+    {4, 8, SBC_JOINT_STEREO, SBC_SNR, 0x7c7f41a4},
+    {4, 12, SBC_MONO, SBC_LOUDNESS, 0xaa2e329d},
+    {4, 12, SBC_MONO, SBC_SNR, 0x99caaab1},
+    {4, 12, SBC_DUAL, SBC_LOUDNESS, 0xd8201f23},
+    {4, 12, SBC_DUAL, SBC_SNR, 0x1ab61bc7},
+    {4, 12, SBC_STEREO, SBC_LOUDNESS, 0xc4d73273},
+    {4, 12, SBC_STEREO, SBC_SNR, 0x1ffa6cc7},
+    {4, 12, SBC_JOINT_STEREO, SBC_LOUDNESS, 0xdd3bb61c},
+    {4, 12, SBC_JOINT_STEREO, SBC_SNR, 0x51aa3b2c},
+    {4, 16, SBC_MONO, SBC_LOUDNESS, 0x34174f63},
+    {4, 16, SBC_MONO, SBC_SNR, 0x070ea137},
+    {4, 16, SBC_DUAL, SBC_LOUDNESS, 0x7d4d1476},
+    {4, 16, SBC_DUAL, SBC_SNR, 0xa84eab35},
+    {4, 16, SBC_STEREO, SBC_LOUDNESS, 0xaec0e6ca},
+    {4, 16, SBC_STEREO, SBC_SNR, 0xd72acb37},
+    {4, 16, SBC_JOINT_STEREO, SBC_LOUDNESS, 0xa98a86b6},
+    {4, 16, SBC_JOINT_STEREO, SBC_SNR, 0xafae84f7},
+    {8, 4, SBC_MONO, SBC_LOUDNESS, 0xf84bdafd},
+    {8, 4, SBC_MONO, SBC_SNR, 0xd83bc9bd},
+    {8, 4, SBC_DUAL, SBC_LOUDNESS, 0xbcd3dcdd},
+    {8, 4, SBC_DUAL, SBC_SNR, 0x0aef465a},
+    {8, 4, SBC_STEREO, SBC_LOUDNESS, 0x59af27d6},
+    {8, 4, SBC_STEREO, SBC_SNR, 0x6829ab48},
+    {8, 4, SBC_JOINT_STEREO, SBC_LOUDNESS, 0x89f4a0b7},
+    {8, 4, SBC_JOINT_STEREO, SBC_SNR, 0x665e680e},
+    {8, 8, SBC_MONO, SBC_LOUDNESS, 0xf8d0f764},
+    {8, 8, SBC_MONO, SBC_SNR, 0x266a219f},
+    {8, 8, SBC_DUAL, SBC_LOUDNESS, 0x04d96a7e},
+    {8, 8, SBC_DUAL, SBC_SNR, 0x681b1af1},
+    {8, 8, SBC_STEREO, SBC_LOUDNESS, 0xd911dcdf},
+    {8, 8, SBC_STEREO, SBC_SNR, 0xf7e34f72},
+    {8, 8, SBC_JOINT_STEREO, SBC_LOUDNESS, 0x41fe7620},
+    {8, 8, SBC_JOINT_STEREO, SBC_SNR, 0x4c4786b9},
+    {8, 12, SBC_MONO, SBC_LOUDNESS, 0xe189342f},
+    {8, 12, SBC_MONO, SBC_SNR, 0x2c6fc2a3},
+    {8, 12, SBC_DUAL, SBC_LOUDNESS, 0x80a3f48b},
+    {8, 12, SBC_DUAL, SBC_SNR, 0xfb43598d},
+    {8, 12, SBC_STEREO, SBC_LOUDNESS, 0x0c0839d0},
+    {8, 12, SBC_STEREO, SBC_SNR, 0xa043303e},
+    {8, 12, SBC_JOINT_STEREO, SBC_LOUDNESS, 0x7ed75172},
+    {8, 12, SBC_JOINT_STEREO, SBC_SNR, 0xe295b41e},
+    {8, 16, SBC_MONO, SBC_LOUDNESS, 0x5599513e},
+    {8, 16, SBC_MONO, SBC_SNR, 0xd54557c3},
+    {8, 16, SBC_DUAL, SBC_LOUDNESS, 0xf9d2d298},
+    {8, 16, SBC_DUAL, SBC_SNR, 0x5f81a407},
+    {8, 16, SBC_STEREO, SBC_LOUDNESS, 0xf3502c3b},
+    {8, 16, SBC_STEREO, SBC_SNR, 0x5a86e24e},
+    {8, 16, SBC_JOINT_STEREO, SBC_LOUDNESS, 0x4542374a},
+    {8, 16, SBC_JOINT_STEREO, SBC_SNR, 0x497634c8},
+};
+
+uint32_t encode_digest(const GoldenVector& config,
+                       const SBC_ENC_KERNELS* kernels,
+                       const std::vector<int16_t>& pcm) {
+  SBC_ENC_PARAMS params;
+  memset(&params, 0, sizeof(params));
+  params.s16SamplingFreq = SBC_sf44100;
+  params.s16ChannelMode = config.channel_mode;
+  params.s16NumOfSubBands = config.subbands;
+  params.s16NumOfBlocks = config.blocks;
+  params.s16AllocationMethod = config.allocation;
+  params.u16BitRate = (config.channel_mode == SBC_MONO ||
+                       config.channel_mode == SBC_DUAL)
+                          ? 200
+                          : 345;
+  SBC_Encoder_Init(&params);
+  sbc_enc_kernels = kernels;
+
+  uint8_t frame[512];
+  uint32_t digest = 2166136261u;
+  const int16_t* input = pcm.data();
+  for (int f = 0; f < kGoldenFrames; f++) {
+    uint32_t length = SBC_Encode(&params, const_cast<int16_t*>(input), frame);
+    for (uint32_t i = 0; i < length; i++) {
+      digest ^= frame[i];
+      digest *= 16777619u;
+    }
+    digest ^= length;
+    input += params.s16NumOfSubBands * params.s16NumOfBlocks *
+             params.s16NumOfChannels;
+  }
+  return digest;
+}
+
+}  // namespace
+
+TEST(SbcEncoderTest, test_golden_vectors) {
+  std::vector<int16_t> pcm =
+      test_pcm(kGoldenFrames * SBC_MAX_NUM_OF_BLOCKS * SBC_MAX_NUM_OF_SUBBANDS *
+               SBC_MAX_NUM_OF_CHANNELS);
+  for (const KernelSet& set : available_kernels()) {
+    for (const GoldenVector& config : kGoldenVectors) {
+      EXPECT_EQ(config.digest, encode_digest(config, set.kernels, pcm))
+          << set.name << " subbands " << config.subbands << " blocks "
+          << config.blocks << " mode " << config.channel_mode
+          << " allocation " << config.allocation;
+    }
+  }
+  SbcEncKernelsInit();
+}
+
+TEST(SbcEncoderTest, test_window_matches_scalar) {
+  uint32_t seed = 1;
+  int16_t x[80];
+  int32_t expected[16], actual[16];
+  for (const KernelSet& set : available_kernels()) {
+    for (int iteration = 0; iteration < 1000; iteration++) {
+      for (int i = 0; i < 80; i++) {
+        x[i] = (iteration % 3 == 0)
+                   ? ((next_random(&seed) & 1) ? 32767 : -32768)
+                   : (int16_t)next_random(&seed);
+      }
+      SbcWindow4(x, expected);
+      set.kernels->window4(x, actual);
+      ASSERT_EQ(0, memcmp(expected, actual, 8 * sizeof(int32_t))) << set.name;
+      SbcWindow8(x, expected);
+      set.kernels->window8(x, actual);
+      ASSERT_EQ(0, memcmp(expected, actual, 16 * sizeof(int32_t)))
+          << set.name;
+    }
+  }
+}
+
+TEST(SbcEncoderTest, test_dct8_matches_scalar) {
+  const int kMaxSets = SBC_MAX_NUM_OF_BLOCKS * SBC_MAX_NUM_OF_CHANNELS;
+  uint32_t seed = 2;
+  int32_t y[kMaxSets * 16];
+  int32_t expected[kMaxSets * SUB_BANDS_8], actual[kMaxSets * SUB_BANDS_8];
+  for (const KernelSet& set : available_kernels()) {
+    for (int iteration = 0; iteration < 1000; iteration++) {
+      for (int i = 0; i < kMaxSets * 16; i++) {
+        y[i] = (int32_t)next_random(&seed) >> (next_random(&seed) % 8);
+      }
+      int32_t count = 1 + iteration % kMaxSets;
+      SBC_FastIDCT8Blocks(y, expected, count);
+      set.kernels->dct8(y, actual, count);
+      ASSERT_EQ(0, memcmp(expected, actual,
+                          count * SUB_BANDS_8 * sizeof(int32_t)))
+          << set.name << " count " << count;
+    }
+  }
+}
+
+TEST(SbcEncoderTest, test_quantize_matches_scalar) {
+  uint32_t seed = 3;
+  uint32_t expected[SBC_MAX_NUM_OF_CHANNELS * SBC_MAX_NUM_OF_SUBBANDS *
+                    SBC_MAX_NUM_OF_BLOCKS];
+  uint32_t actual[SBC_MAX_NUM_OF_CHANNELS * SBC_MAX_NUM_OF_SUBBANDS *
+                  SBC_MAX_NUM_OF_BLOCKS];
+  SBC_ENC_PARAMS params;
+  for (const KernelSet& set : available_kernels()) {
+    for (int iteration = 0; iteration < 1000; iteration++) {
+      memset(&params, 0, sizeof(params));
+      params.s16NumOfSubBands = (iteration & 1) ? SUB_BANDS_8 : SUB_BANDS_4;
+      params.s16NumOfChannels = 1 + ((iteration >> 1) & 1);
+      params.s16NumOfBlocks = 4 * (1 + ((iteration >> 2) & 3));
+      int32_t rows = params.s16NumOfSubBands * params.s16NumOfChannels;
+      int32_t count = rows * params.s16NumOfBlocks;
+      for (int i = 0; i < rows; i++) {
+        params.as16ScaleFactor[i] = next_random(&seed) % 16;
+        params.as16Bits[i] = next_random(&seed) % 17;
+      }
+      // Mostly samples within their scale factor, as the encoder produces
+      for (int i = 0; i < count; i++) {
+        int32_t v = (int32_t)next_random(&seed);
+        int32_t range = 1 << (params.as16ScaleFactor[i % rows] + 15);
+        params.s32SbBuffer[i] = (iteration % 4 == 0) ? v : v % range;
+      }
+      EncQuantizer(&params, expected);
+      set.kernels->quantize(&params, actual);
+      ASSERT_EQ(0, memcmp(expected, actual, count * sizeof(uint32_t)))
+          << set.name;
+    }
+  }
+}
+
+TEST(SbcEncoderTest, test_encode_frames_matches_encode) {
+  constexpr int kFrames = 15;
+  std::vector<int16_t> pcm = test_pcm(kFrames * SBC_MAX_NUM_OF_BLOCKS *
+                                      SBC_MAX_NUM_OF_SUBBANDS *
+                                      SBC_MAX_NUM_OF_CHANNELS);
+  for (const GoldenVector& config : kGoldenVectors) {
+    SBC_ENC_PARAMS params;
+    memset(&params, 0, sizeof(params));
+    params.s16SamplingFreq = SBC_sf48000;
+    params.s16ChannelMode = config.channel_mode;
+    params.s16NumOfSubBands = config.subbands;
+    params.s16NumOfBlocks = config.blocks;
+    params.s16AllocationMethod = config.allocation;
+    params.u16BitRate = 229;
+    SBC_Encoder_Init(&params);
+    uint32_t frame_length = SBC_FrameLength(&params);
+
+    std::vector<uint8_t> expected(kFrames * 512);
+    uint32_t expected_length = 0;
+    int16_t* input = pcm.data();
+    for (int f = 0; f < kFrames; f++) {
+      uint32_t length =
+          SBC_Encode(&params, input, expected.data() + expected_length);
+      ASSERT_EQ(frame_length, length);
+      expected_length += length;
+      input += params.s16NumOfSubBands * params.s16NumOfBlocks *
+               params.s16NumOfChannels;
+    }
+
+    SBC_Encoder_Init(&params);
+    std::vector<uint8_t> actual(kFrames * frame_length);
+    ASSERT_EQ(expected_length,
+              SBC_EncodeFrames(&params, pcm.data(), kFrames, actual.data()));
+    EXPECT_EQ(0, memcmp(expected.data(), actual.data(), expected_length))
+        << "subbands " << config.subbands << " blocks " << config.blocks
+        << " mode " << config.channel_mode << " allocation "
+        << config.allocation;
+  }
+}
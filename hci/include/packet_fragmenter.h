@@ -59,6 +59,16 @@ typedef struct packet_fragmenter_t {
 
 const packet_fragmenter_t* packet_fragmenter_get_interface();
 
+// Returns the number of data bytes a HAL should allocate for the inbound ACL
+// packet |data| of |len| bytes (ACL header included). If it is the start of
+// an L2CAP PDU that spans several fragments, the result covers the whole PDU;
+// the HAL should then store it in |layer_specific| so that
+// |reassemble_and_dispatch| can append the continuation fragments in place
+// instead of allocating and copying into a new buffer. Otherwise returns
+// |len|, and |layer_specific| should be left at zero.
+uint16_t packet_fragmenter_get_acl_rx_capacity(const uint8_t* data,
+                                               uint16_t len);
+
 const packet_fragmenter_t* packet_fragmenter_get_test_interface(
     const controller_t* controller_interface,
     const allocator_t* buffer_allocator_interface);
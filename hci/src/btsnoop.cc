@@ -35,6 +35,7 @@
 #include <sys/time.h>
 #include <sys/uio.h>
 #include <unistd.h>
+#include <atomic>
 #include <mutex>
 #include <unordered_map>
 #include <unordered_set>
@@ -44,8 +45,11 @@
 #include "hci/include/btsnoop_mem.h"
 #include "hci_layer.h"
 #include "internal_include/bt_trace.h"
+#include "osi/include/allocator.h"
 #include "osi/include/log.h"
 #include "osi/include/properties.h"
+#include "osi/include/ring_queue.h"
+#include "osi/include/thread.h"
 #include "osi/include/time.h"
 #include "stack/include/hcimsgs.h"
 #include "stack/include/rfcdefs.h"
@@ -81,6 +85,15 @@
 #endif  //OFF_TARGET_TEST_ENABLED
 #define BTSNOOP_MAX_PACKETS_PROPERTY "persist.bluetooth.btsnoopsize"
 
+// When enabled, |capture| only copies packets into |snoop_ring| and the file
+// is written in batches from |writer_thread|, off the HCI path. Packets that
+// arrive while the ring is full, or reach the writer while no file is open,
+// are dropped and counted in the |dropped_packets| field of later records.
+#define BTSNOOP_ASYNC_PROPERTY "persist.bluetooth.btsnoopasync"
+#define BTSNOOP_FLUSH_INTERVAL_PROPERTY "persist.bluetooth.btsnoopflushms"
+#define DEFAULT_BTSNOOP_FLUSH_INTERVAL_MS 100
+#define BTSNOOP_RING_CAPACITY 8192
+
 typedef enum {
   kCommandPacket = 1,
   kAclPacket = 2,
@@ -109,6 +122,13 @@ static int32_t packets_per_file;
 static int32_t packet_counter;
 static bool sock_snoop_active = false;
 
+static bool is_btsnoop_async;
+static int32_t flush_interval_ms;
+static ring_queue_t* snoop_ring;
+static thread_t* writer_thread;
+static std::atomic<uint32_t> dropped_packets;
+static uint32_t reported_dropped_packets;
+
 extern bt_logger_interface_t *logger_interface;
 int64_t gmt_offset;
 int64_t tmp_gmt_offset;
@@ -190,6 +210,10 @@ static std::string get_btsnoop_last_log_path(std::string log_path);
 static void open_next_snoop_file();
 static void btsnoop_write_packet(packet_type_t type, uint8_t* packet,
                                  bool is_received, uint64_t timestamp_us);
+static void btsnoop_queue_packet(packet_type_t type, uint8_t* packet,
+                                 bool is_received, uint64_t timestamp_us);
+static void start_writer_thread();
+static void stop_writer_thread();
 
 // Module lifecycle functions
 
@@ -266,6 +290,9 @@ static future_t* start_up() {
                                               DEFAULT_BTSNOOP_SIZE);
     btsnoop_net_open();
     START_SNOOP_LOGGING();
+
+    osi_property_get(BTSNOOP_ASYNC_PROPERTY, property.data(), "false");
+    if (!strcmp(property.data(), "true")) start_writer_thread();
   }
   LOG_DEBUG(LOG_TAG, "%s: vendor_logging_level values is %d ", __func__, vendor_logging_level);
 
@@ -275,6 +302,9 @@ static future_t* start_up() {
 static future_t* shut_down(void) {
   std::lock_guard<std::mutex> lock(btsnoop_mutex);
 
+  // Write out whatever is still queued before the file goes away.
+  if (is_btsnoop_async) stop_writer_thread();
+
   if (is_btsnoop_enabled) {
     if (is_btsnoop_filtered) {
       delete_btsnoop_files(false);
@@ -307,7 +337,11 @@ EXPORT_SYMBOL extern const module_t btsnoop_module = {
 static void capture(const BT_HDR* buffer, bool is_received) {
   uint8_t* p = const_cast<uint8_t*>(buffer->data + buffer->offset);
 
-  std::lock_guard<std::mutex> lock(btsnoop_mutex);
+  // In async mode the HCI threads leave |logfile_fd| to |writer_thread|, which
+  // closes and reopens it on rotation, and otherwise only read state that is
+  // fixed between |start_up| and |shut_down|, so no lock is needed.
+  std::unique_lock<std::mutex> lock(btsnoop_mutex, std::defer_lock);
+  if (!is_btsnoop_async) lock.lock();
 
   struct timespec ts_now = {};
   clock_gettime(CLOCK_REALTIME, &ts_now);
@@ -325,22 +359,24 @@ static void capture(const BT_HDR* buffer, bool is_received) {
 
   btsnoop_mem_capture(buffer, timestamp_us);
 
-  if (logfile_fd == INVALID_FD) return;
+  if (!is_btsnoop_async && logfile_fd == INVALID_FD) return;
 
+  auto write_packet =
+      is_btsnoop_async ? btsnoop_queue_packet : btsnoop_write_packet;
   switch (buffer->event & MSG_EVT_MASK) {
     case MSG_HC_TO_STACK_HCI_EVT:
-      btsnoop_write_packet(kEventPacket, p, false, timestamp_us);
+      write_packet(kEventPacket, p, false, timestamp_us);
       break;
     case MSG_HC_TO_STACK_HCI_ACL:
     case MSG_STACK_TO_HC_HCI_ACL:
-      btsnoop_write_packet(kAclPacket, p, is_received, timestamp_us);
+      write_packet(kAclPacket, p, is_received, timestamp_us);
       break;
     case MSG_HC_TO_STACK_HCI_SCO:
     case MSG_STACK_TO_HC_HCI_SCO:
-      btsnoop_write_packet(kScoPacket, p, is_received, timestamp_us);
+      write_packet(kScoPacket, p, is_received, timestamp_us);
       break;
     case MSG_STACK_TO_HC_HCI_CMD:
-      btsnoop_write_packet(kCommandPacket, p, true, timestamp_us);
+      write_packet(kCommandPacket, p, true, timestamp_us);
       break;
   }
 }
@@ -552,11 +588,13 @@ static bool should_filter_log(bool is_received, uint8_t* packet) {
   return false;
 }
 
-static void btsnoop_write_packet(packet_type_t type, uint8_t* packet,
-                                 bool is_received, uint64_t timestamp_us) {
+// Fills in |header| for |packet| and returns the number of bytes of |packet|
+// to log after the type byte, or 0 if the packet should not be logged.
+static uint32_t btsnoop_prepare_packet(packet_type_t type, uint8_t* packet,
+                                       bool is_received, uint64_t timestamp_us,
+                                       btsnoop_header_t* header) {
   uint32_t length_he = 0;
   uint32_t flags = 0;
-  int status = 0;
 
   switch (type) {
     case kCommandPacket:
@@ -578,26 +616,54 @@ static void btsnoop_write_packet(packet_type_t type, uint8_t* packet,
   }
 
   if (!length_he)
-    return;
+    return 0;
 
-  btsnoop_header_t header;
-  header.length_original = htonl(length_he);
+  header->length_original = htonl(length_he);
 
   bool blacklisted = false;
   if (is_btsnoop_filtered && type == kAclPacket) {
     blacklisted = should_filter_log(is_received, packet);
   }
 
-  header.length_captured =
-      blacklisted ? htonl(L2C_HEADER_SIZE) : header.length_original;
+  header->length_captured =
+      blacklisted ? htonl(L2C_HEADER_SIZE) : header->length_original;
   if (blacklisted) length_he = L2C_HEADER_SIZE;
-  header.flags = htonl(flags);
-  header.dropped_packets = 0;
-  header.timestamp = htonll(timestamp_us + BTSNOOP_EPOCH_DELTA);
-  header.type = type;
+  header->flags = htonl(flags);
+  header->dropped_packets =
+      htonl(dropped_packets.load(std::memory_order_relaxed));
+  header->timestamp = htonll(timestamp_us + BTSNOOP_EPOCH_DELTA);
+  header->type = type;
+
+  return length_he - 1;
+}
+
+// Writes |iovcnt| buffers to the log file if it can take them without
+// blocking.
+static void btsnoop_write_log(const struct iovec* iov, int iovcnt) {
+  struct pollfd fds;
+  fds.fd = logfile_fd;
+  fds.events = POLLOUT;
+
+  int status = poll(&fds, 1, 0);
+  if(status > 0 && fds.revents & POLLOUT) {
+    TEMP_FAILURE_RETRY(writev(logfile_fd, iov, iovcnt));
+  } else if (status == 0) {
+    LOG_WARN(LOG_TAG, "%s poll() timeout", __func__);
+  } else if (status == -1) {
+    LOG_ERROR(LOG_TAG, "%s poll failed errno %d (%s)",
+                  __func__, errno, strerror(errno));
+  }
+}
+
+static void btsnoop_write_packet(packet_type_t type, uint8_t* packet,
+                                 bool is_received, uint64_t timestamp_us) {
+  btsnoop_header_t header;
+  uint32_t length =
+      btsnoop_prepare_packet(type, packet, is_received, timestamp_us, &header);
+  if (!length) return;
 
   btsnoop_net_write(&header, sizeof(btsnoop_header_t));
-  btsnoop_net_write(packet, length_he - 1);
+  btsnoop_net_write(packet, length);
 
   if (logfile_fd != INVALID_FD) {
     packet_counter++;
@@ -605,22 +671,140 @@ static void btsnoop_write_packet(packet_type_t type, uint8_t* packet,
       open_next_snoop_file();
     }
 
-    struct pollfd fds;
-    fds.fd = logfile_fd;
-    fds.events = POLLOUT;
     iovec iov[] = {{&header, sizeof(btsnoop_header_t)},
-                   {reinterpret_cast<void*>(packet), length_he - 1}};
-
-    status = poll(&fds, 1, 0);
-    if(status > 0 && fds.revents & POLLOUT) {
-      TEMP_FAILURE_RETRY(writev(logfile_fd, iov, 2));
-    } else if (status == 0) {
-      LOG_WARN(LOG_TAG, "%s poll() timeout", __func__);
-    } else if (status == -1) {
-      LOG_ERROR(LOG_TAG, "%s poll failed errno %d (%s)",
-                    __func__, errno, strerror(errno));
+                   {reinterpret_cast<void*>(packet), length}};
+    btsnoop_write_log(iov, 2);
+  }
+}
+
+// A packet waiting in |snoop_ring| to be written by |writer_thread|.
+typedef struct {
+  uint32_t length;
+  btsnoop_header_t header;
+  uint8_t data[];
+} __attribute__((__packed__)) snoop_record_t;
+
+static void btsnoop_queue_packet(packet_type_t type, uint8_t* packet,
+                                 bool is_received, uint64_t timestamp_us) {
+  btsnoop_header_t header;
+  uint32_t length =
+      btsnoop_prepare_packet(type, packet, is_received, timestamp_us, &header);
+  if (!length) return;
+
+  snoop_record_t* record =
+      static_cast<snoop_record_t*>(osi_malloc(sizeof(snoop_record_t) + length));
+  record->length = length;
+  record->header = header;
+  memcpy(record->data, packet, length);
+
+  if (!ring_queue_try_enqueue(snoop_ring, record)) {
+    dropped_packets.fetch_add(1, std::memory_order_relaxed);
+    osi_free(record);
+  }
+}
+
+// Writes out up to |max_records| queued packets, batching consecutive ones
+// into a single writev(). Returns the number of packets taken off the ring.
+static size_t btsnoop_flush_ring(size_t max_records) {
+  static const int MAX_BATCH_RECORDS = IOV_MAX / 2;
+  iovec iov[MAX_BATCH_RECORDS * 2];
+  snoop_record_t* batch[MAX_BATCH_RECORDS];
+  int batch_size = 0;
+  size_t taken = 0;
+
+  // Packets that find no file open, e.g. after a failed rotation, are lost
+  // to the file as much as those that find the ring full.
+  auto write_batch = [&]() {
+    if (batch_size) {
+      std::lock_guard<std::mutex> lock(btSnoopFd_mutex);
+      if (logfile_fd != INVALID_FD)
+        btsnoop_write_log(iov, batch_size * 2);
+      else
+        dropped_packets.fetch_add(batch_size, std::memory_order_relaxed);
     }
+    for (int i = 0; i < batch_size; i++) osi_free(batch[i]);
+    batch_size = 0;
+  };
+
+  snoop_record_t* record;
+  while (taken < max_records &&
+         (record = static_cast<snoop_record_t*>(
+              ring_queue_try_dequeue(snoop_ring))) != NULL) {
+    taken++;
+    btsnoop_net_write(&record->header, sizeof(btsnoop_header_t));
+    btsnoop_net_write(record->data, record->length);
+
+    packet_counter++;
+    if (!sock_snoop_active && packet_counter > packets_per_file) {
+      write_batch();
+      open_next_snoop_file();
+    }
+
+    iov[batch_size * 2] = {&record->header, sizeof(btsnoop_header_t)};
+    iov[batch_size * 2 + 1] = {record->data, record->length};
+    batch[batch_size++] = record;
+    if (batch_size == MAX_BATCH_RECORDS) write_batch();
   }
+  write_batch();
+
+  uint32_t dropped = dropped_packets.load(std::memory_order_relaxed);
+  if (dropped != reported_dropped_packets) {
+    LOG_WARN(LOG_TAG, "%s %u snoop packets dropped so far",
+             __func__, dropped);
+    reported_dropped_packets = dropped;
+  }
+
+  return taken;
+}
+
+// Runs on |writer_thread| whenever |snoop_ring| is non-empty.
+static void snoop_ring_ready(UNUSED_ATTR ring_queue_t* queue,
+                             UNUSED_ATTR void* context) {
+  size_t taken = btsnoop_flush_ring(BTSNOOP_RING_CAPACITY);
+
+  // Let packets accumulate for a while so that each wakeup writes a large
+  // batch, unless the ring is filling up faster than that.
+  if (flush_interval_ms > 0 && taken < BTSNOOP_RING_CAPACITY / 2)
+    usleep(flush_interval_ms * 1000);
+}
+
+static void start_writer_thread() {
+  flush_interval_ms = osi_property_get_int32(BTSNOOP_FLUSH_INTERVAL_PROPERTY,
+                                             DEFAULT_BTSNOOP_FLUSH_INTERVAL_MS);
+
+  snoop_ring = ring_queue_new(BTSNOOP_RING_CAPACITY);
+  writer_thread = thread_new("btsnoop_writer");
+  if (snoop_ring == NULL || writer_thread == NULL) {
+    LOG_ERROR(LOG_TAG, "%s unable to start snoop writer, writing inline",
+              __func__);
+    thread_free(writer_thread);
+    writer_thread = NULL;
+    ring_queue_free(snoop_ring, NULL);
+    snoop_ring = NULL;
+    return;
+  }
+
+  dropped_packets = 0;
+  reported_dropped_packets = 0;
+  ring_queue_register_dequeue(snoop_ring, thread_get_reactor(writer_thread),
+                              snoop_ring_ready, NULL);
+  is_btsnoop_async = true;
+  LOG_INFO(LOG_TAG, "%s snoop packets written every %d ms", __func__,
+           flush_interval_ms);
+}
+
+// The HCI layer depends on this module and has shut down by now, so nothing
+// is capturing into |snoop_ring| any more.
+static void stop_writer_thread() {
+  is_btsnoop_async = false;
+
+  ring_queue_unregister_dequeue(snoop_ring);
+  thread_free(writer_thread);
+  writer_thread = NULL;
+
+  btsnoop_flush_ring(SIZE_MAX);
+  ring_queue_free(snoop_ring, osi_free);
+  snoop_ring = NULL;
 }
 
 void update_snoop_fd(int snoop_fd) {
@@ -31,8 +31,12 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <chrono>
 #include <mutex>
+#include <queue>
+#include <unordered_map>
+#include <vector>
 
 #include "btcore/include/module.h"
 #include "btsnoop.h"
@@ -43,7 +47,6 @@
 #include "hcimsgs.h"
 #include "bt_utils.h"
 #include "osi/include/alarm.h"
-#include "osi/include/list.h"
 #include "osi/include/log.h"
 #include "osi/include/properties.h"
 #include "osi/include/reactor.h"
@@ -61,7 +64,7 @@ extern void hci_log_firmware_debug_packet(int fd, BT_HDR* packet);
 
 static int hci_firmware_log_fd = INVALID_FD;
 
-typedef struct {
+typedef struct waiting_command_t {
   uint16_t opcode;
   future_t* complete_future;
   command_complete_cb complete_callback;
@@ -69,8 +72,24 @@ typedef struct {
   void* context;
   BT_HDR* command;
   std::chrono::time_point<std::chrono::steady_clock> timestamp;
+  // Neighbours in the order commands were sent, while awaiting a response
+  struct waiting_command_t* older;
+  struct waiting_command_t* newer;
 } waiting_command_t;
 
+// Response latency histogram: below 250 us, doubling up to 256 ms, and slower
+#define COMMAND_LATENCY_BUCKETS 12
+static const uint64_t COMMAND_LATENCY_FIRST_BUCKET_US = 250;
+
+typedef struct {
+  // The command with this opcode awaiting a response, if any
+  waiting_command_t* pending;
+  uint64_t responses;
+  uint64_t total_latency_us;
+  uint64_t max_latency_us;
+  uint64_t latency_histogram[COMMAND_LATENCY_BUCKETS];
+} command_opcode_entry_t;
+
 // Using a define here, because it can be stringified for the property lookup
 // Reducing startup timeout to less than 3sec to ensure that wakelock is aquired
 // during initialization
@@ -84,6 +103,9 @@ static const int BT_HCI_RT_PRIORITY = 1;
 static const uint32_t COMMAND_PENDING_TIMEOUT_MS = 2000;
 static const uint32_t COMMAND_TIMEOUT_RESTART_MS = 5000;
 
+// Most commands moved from the queue to the controller under one lock
+static const size_t COMMAND_ISSUE_BATCH_MAX = 16;
+
 
 // Our interface
 static bool interface_created;
@@ -106,12 +128,25 @@ static alarm_t *hci_timeout_abort_timer;
 // Outbound-related
 static int command_credits = 1;
 static std::mutex command_credits_mutex;
-static std::queue<base::Closure> command_queue;
+static std::queue<waiting_command_t*> command_queue;
+// Whether event_commands_ready() is posted to send the queued commands
+static bool commands_ready_posted;
 
 // Inbound-related
 static alarm_t* command_response_timer;
-static list_t* commands_pending_response;
 static std::recursive_mutex commands_pending_response_mutex;
+// Every opcode sent so far, with the command awaiting a response and the
+// latency stats. Commands awaiting a response are also linked oldest first.
+static std::unordered_map<command_opcode_t, command_opcode_entry_t>
+    commands_by_opcode;
+static waiting_command_t* oldest_pending_command;
+static waiting_command_t* newest_pending_command;
+static int num_pending_commands;
+// Vendor specific commands are not always answered with their own opcode, so
+// only one of them is sent at a time. Responses with another opcode are only
+// taken as its own once it is sent.
+static waiting_command_t* pending_vendor_command;
+static bool pending_vendor_command_sent;
 
 // The hand-off point for data going to a higher layer, set by the higher layer
 static base::Callback<void(const base::Location&, BT_HDR*)>
@@ -125,7 +160,12 @@ static void event_finish_startup(void* context);
 static void startup_timer_expired(void* context);
 
 static void enqueue_command(waiting_command_t* wait_entry);
-static void event_command_ready(waiting_command_t* wait_entry);
+static void post_commands_ready();
+static void event_commands_ready();
+static bool is_vendor_specific(command_opcode_t opcode);
+static bool can_send_command(const waiting_command_t* wait_entry);
+static void add_pending_command(waiting_command_t* wait_entry);
+static void mark_vendor_command_sent(const waiting_command_t* wait_entry);
 static void enqueue_packet(void* packet);
 static void event_packet_ready(void* packet);
 static void command_timed_out(void* context);
@@ -229,14 +269,6 @@ static future_t* hci_module_start_up(void) {
     LOG_ERROR(LOG_TAG, "%s unable to make thread RT.", __func__);
   }
 
-  commands_pending_response = list_new(NULL);
-  if (!commands_pending_response) {
-    LOG_ERROR(LOG_TAG,
-              "%s unable to create list for commands pending response.",
-              __func__);
-    goto error;
-  }
-
   // Make sure we run in a bounded amount of time
   future_t* local_startup_future;
   local_startup_future = future_new();
@@ -283,9 +315,25 @@ static future_t* hci_module_shut_down() {
 
 
   {
+    std::lock_guard<std::mutex> lock(command_credits_mutex);
+    while (!command_queue.empty()) {
+      waiting_command_t* wait_entry = command_queue.front();
+      command_queue.pop();
+      buffer_allocator->free(wait_entry->command);
+      osi_free(wait_entry);
+    }
+    commands_ready_posted = false;
+  }
+
+  {
+    // Keep the latency stats for dumpsys
     std::lock_guard<std::recursive_mutex> lock(commands_pending_response_mutex);
-    list_free(commands_pending_response);
-    commands_pending_response = NULL;
+    for (auto& it : commands_by_opcode) it.second.pending = NULL;
+    oldest_pending_command = NULL;
+    newest_pending_command = NULL;
+    num_pending_commands = 0;
+    pending_vendor_command = NULL;
+    pending_vendor_command_sent = false;
   }
 
   packet_fragmenter->cleanup();
@@ -406,33 +454,63 @@ static void startup_timer_expired(UNUSED_ATTR void* context) {
 
 // Command/packet transmitting functions
 static void enqueue_command(waiting_command_t* wait_entry) {
-  base::Closure callback = base::Bind(&event_command_ready, wait_entry);
-
   std::lock_guard<std::mutex> command_credits_lock(command_credits_mutex);
-  if (command_credits > 0) {
-    std::lock_guard<std::mutex> message_loop_lock(message_loop_mutex);
-    if (message_loop_ == nullptr) {
-      // HCI Layer was shut down
-      buffer_allocator->free(wait_entry->command);
-      osi_free(wait_entry);
-      return;
-    }
-    message_loop_->task_runner()->PostTask(FROM_HERE, std::move(callback));
-    command_credits--;
-  } else {
-    command_queue.push(std::move(callback));
+  std::lock_guard<std::mutex> message_loop_lock(message_loop_mutex);
+  if (message_loop_ == nullptr) {
+    // HCI Layer was shut down
+    buffer_allocator->free(wait_entry->command);
+    osi_free(wait_entry);
+    return;
   }
+  command_queue.push(wait_entry);
+  post_commands_ready();
 }
 
-static void event_command_ready(waiting_command_t* wait_entry) {
-  {
-    /// Move it to the list of commands awaiting response
-    std::lock_guard<std::recursive_mutex> lock(commands_pending_response_mutex);
-    wait_entry->timestamp = std::chrono::steady_clock::now();
-    list_append(commands_pending_response, wait_entry);
-  }
-  // Send it off
-  packet_fragmenter->fragment_and_dispatch(wait_entry->command);
+// Posts one task to send the queued commands, if there are credits for them.
+// Must be called with command_credits_mutex and message_loop_mutex held.
+static void post_commands_ready() {
+  if (commands_ready_posted || command_credits <= 0 || command_queue.empty())
+    return;
+  message_loop_->task_runner()->PostTask(FROM_HERE,
+                                         base::Bind(&event_commands_ready));
+  commands_ready_posted = true;
+}
+
+// Sends as many queued commands as the controller has credits for, back to
+// back, stopping at the first one that depends on a response still awaited.
+static void event_commands_ready() {
+  waiting_command_t* batch[COMMAND_ISSUE_BATCH_MAX];
+  size_t count;
+  waiting_command_t* vendor_command;
+
+  do {
+    count = 0;
+    vendor_command = NULL;
+    {
+      std::lock_guard<std::mutex> command_credits_lock(command_credits_mutex);
+      std::lock_guard<std::recursive_mutex> lock(
+          commands_pending_response_mutex);
+      commands_ready_posted = false;
+      while (count < COMMAND_ISSUE_BATCH_MAX && command_credits > 0 &&
+             !command_queue.empty() &&
+             can_send_command(command_queue.front())) {
+        waiting_command_t* wait_entry = command_queue.front();
+        command_queue.pop();
+        command_credits--;
+        // Move it to the table of commands awaiting response
+        add_pending_command(wait_entry);
+        batch[count++] = wait_entry;
+        if (is_vendor_specific(wait_entry->opcode)) vendor_command = wait_entry;
+      }
+    }
+
+    // Send them off. A command may be answered, and freed, as soon as it is
+    // sent, so none is looked at again afterwards.
+    for (size_t i = 0; i < count; i++) {
+      packet_fragmenter->fragment_and_dispatch(batch[i]->command);
+      if (batch[i] == vendor_command) mark_vendor_command_sent(vendor_command);
+    }
+  } while (count == COMMAND_ISSUE_BATCH_MAX);
 
   update_command_response_timer();
 }
@@ -505,11 +583,8 @@ static void command_timed_out(void* original_wait_entry) {
   LOG_ERROR(LOG_TAG, "%s: %d commands pending response", __func__,
             get_num_waiting_commands());
 
-  for (const list_node_t* node = list_begin(commands_pending_response);
-       node != list_end(commands_pending_response); node = list_next(node)) {
-    waiting_command_t* wait_entry =
-        reinterpret_cast<waiting_command_t*>(list_node(node));
-
+  for (const waiting_command_t* wait_entry = oldest_pending_command;
+       wait_entry != NULL; wait_entry = wait_entry->newer) {
     int wait_time_ms =
         std::chrono::duration_cast<std::chrono::milliseconds>(
             std::chrono::steady_clock::now() - wait_entry->timestamp)
@@ -582,12 +657,7 @@ void process_command_credits(int credits) {
   // Subtract commands in flight.
   command_credits = credits - get_num_waiting_commands();
 
-  while (command_credits > 0 && command_queue.size() > 0) {
-    message_loop_->task_runner()->PostTask(FROM_HERE,
-                                           std::move(command_queue.front()));
-    command_queue.pop();
-    command_credits--;
-  }
+  post_commands_ready();
 }
 
 // Returns true if the event was intercepted and should not proceed to
@@ -696,54 +766,116 @@ static void dispatch_reassembled(BT_HDR* packet) {
 
 // Misc internal functions
 
-static waiting_command_t* get_waiting_command(command_opcode_t opcode) {
+static bool is_vendor_specific(command_opcode_t opcode) {
+  return (opcode & HCI_GRP_VENDOR_SPECIFIC) == HCI_GRP_VENDOR_SPECIFIC;
+}
+
+// Responses only carry the opcode, so a command is held back while another
+// one it could be mistaken for is awaiting a response.
+static bool can_send_command(const waiting_command_t* wait_entry) {
   std::lock_guard<std::recursive_mutex> lock(commands_pending_response_mutex);
 
-  for (const list_node_t* node = list_begin(commands_pending_response);
-       node != list_end(commands_pending_response); node = list_next(node)) {
-    waiting_command_t* wait_entry =
-        reinterpret_cast<waiting_command_t*>(list_node(node));
+  if (is_vendor_specific(wait_entry->opcode) && pending_vendor_command)
+    return false;
 
-    if (!wait_entry || wait_entry->opcode != opcode) continue;
+  auto it = commands_by_opcode.find(wait_entry->opcode);
+  return it == commands_by_opcode.end() || it->second.pending == NULL;
+}
 
-    list_remove(commands_pending_response, wait_entry);
+static void add_pending_command(waiting_command_t* wait_entry) {
+  std::lock_guard<std::recursive_mutex> lock(commands_pending_response_mutex);
 
-    return wait_entry;
-  }
-  // look for any command complete with improper VS Opcode
-  for (const list_node_t *node = list_begin(commands_pending_response);
-      node != list_end(commands_pending_response);
-      node = list_next(node)) {
-    waiting_command_t *wait_entry =
-        reinterpret_cast<waiting_command_t*> (list_node(node));
-
-    if (wait_entry && (wait_entry->opcode != opcode) &&
-        (((wait_entry->opcode & HCI_GRP_VENDOR_SPECIFIC) == HCI_GRP_VENDOR_SPECIFIC) &&
-         (((opcode & HCI_GRP_VENDOR_SPECIFIC) == HCI_GRP_VENDOR_SPECIFIC) ||
-            opcode == 0))) {
-      LOG_DEBUG(LOG_TAG,"%s Treat it as valid, wait_entry opcode 0x%x opcode 0x%x",
-                __func__, wait_entry->opcode, opcode);
-    } else {
-      continue;
-    }
+  wait_entry->timestamp = std::chrono::steady_clock::now();
+  commands_by_opcode[wait_entry->opcode].pending = wait_entry;
+  if (is_vendor_specific(wait_entry->opcode)) {
+    pending_vendor_command = wait_entry;
+    pending_vendor_command_sent = false;
+  }
+
+  wait_entry->older = newest_pending_command;
+  wait_entry->newer = NULL;
+  if (newest_pending_command)
+    newest_pending_command->newer = wait_entry;
+  else
+    oldest_pending_command = wait_entry;
+  newest_pending_command = wait_entry;
+  num_pending_commands++;
+}
 
-    list_remove(commands_pending_response, wait_entry);
+// Called once |wait_entry| is handed to the HAL. It may be answered, and freed,
+// by then, so it is only compared. The mutex is not held while sending, as the
+// HAL may have to deliver events on its own thread to finish a send.
+static void mark_vendor_command_sent(const waiting_command_t* wait_entry) {
+  std::lock_guard<std::recursive_mutex> lock(commands_pending_response_mutex);
+  if (pending_vendor_command == wait_entry) pending_vendor_command_sent = true;
+}
 
-    return wait_entry;
-  }
-  return NULL;
+static void record_command_latency(command_opcode_entry_t* entry,
+                                   const waiting_command_t* wait_entry) {
+  uint64_t latency_us =
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - wait_entry->timestamp)
+          .count();
+
+  entry->responses++;
+  entry->total_latency_us += latency_us;
+  entry->max_latency_us = std::max(entry->max_latency_us, latency_us);
+
+  int bucket = 0;
+  for (uint64_t bound = COMMAND_LATENCY_FIRST_BUCKET_US;
+       bucket < COMMAND_LATENCY_BUCKETS - 1 && latency_us >= bound;
+       bound <<= 1)
+    bucket++;
+  entry->latency_histogram[bucket]++;
+}
+
+static waiting_command_t* get_waiting_command(command_opcode_t opcode) {
+  std::lock_guard<std::recursive_mutex> lock(commands_pending_response_mutex);
+
+  waiting_command_t* wait_entry = NULL;
+  auto it = commands_by_opcode.find(opcode);
+  if (it != commands_by_opcode.end()) wait_entry = it->second.pending;
+
+  // look for any command complete with improper VS Opcode
+  if (!wait_entry && pending_vendor_command && pending_vendor_command_sent &&
+      (is_vendor_specific(opcode) || opcode == 0)) {
+    wait_entry = pending_vendor_command;
+    LOG_DEBUG(LOG_TAG,
+              "%s Treat it as valid, wait_entry opcode 0x%x opcode 0x%x",
+              __func__, wait_entry->opcode, opcode);
+    it = commands_by_opcode.find(wait_entry->opcode);
+  }
+
+  if (!wait_entry) return NULL;
+
+  command_opcode_entry_t* entry = &it->second;
+  entry->pending = NULL;
+  record_command_latency(entry, wait_entry);
+  if (wait_entry == pending_vendor_command) pending_vendor_command = NULL;
+
+  if (wait_entry->older)
+    wait_entry->older->newer = wait_entry->newer;
+  else
+    oldest_pending_command = wait_entry->newer;
+  if (wait_entry->newer)
+    wait_entry->newer->older = wait_entry->older;
+  else
+    newest_pending_command = wait_entry->older;
+  num_pending_commands--;
+
+  return wait_entry;
 }
 
 static int get_num_waiting_commands() {
   std::lock_guard<std::recursive_mutex> lock(commands_pending_response_mutex);
-  return list_length(commands_pending_response);
+  return num_pending_commands;
 }
 
 static void update_command_response_timer(void) {
   std::lock_guard<std::recursive_mutex> lock(commands_pending_response_mutex);
 
   if (command_response_timer == NULL) return;
-  if (list_is_empty(commands_pending_response)) {
+  if (oldest_pending_command == NULL) {
     if (alarm_is_scheduled(command_response_timer)) {
       alarm_cancel(command_response_timer);
     } else {
@@ -752,7 +884,44 @@ static void update_command_response_timer(void) {
     }
   } else {
     alarm_set(command_response_timer, COMMAND_PENDING_TIMEOUT_MS,
-              command_timed_out, list_front(commands_pending_response));
+              command_timed_out, oldest_pending_command);
+  }
+}
+
+void hci_layer_debug_dump(int fd) {
+  size_t queued;
+  int credits;
+  {
+    std::lock_guard<std::mutex> lock(command_credits_mutex);
+    queued = command_queue.size();
+    credits = command_credits;
+  }
+
+  std::lock_guard<std::recursive_mutex> lock(commands_pending_response_mutex);
+
+  dprintf(fd, "\nHCI commands:\n");
+  dprintf(fd, "  Credits: %d, queued: %zu, awaiting response: %d\n", credits,
+          queued, num_pending_commands);
+
+  std::vector<command_opcode_t> opcodes;
+  for (const auto& it : commands_by_opcode) {
+    if (it.second.responses) opcodes.push_back(it.first);
+  }
+  if (opcodes.empty()) return;
+  std::sort(opcodes.begin(), opcodes.end());
+
+  dprintf(fd, "  Response latency by opcode, average and maximum in us,\n");
+  dprintf(fd, "  then responses below 0.25, 0.5, 1, 2, 4, 8, 16, 32, 64, 128\n");
+  dprintf(fd, "  and 256 ms, and slower:\n");
+  for (command_opcode_t opcode : opcodes) {
+    const command_opcode_entry_t& entry = commands_by_opcode[opcode];
+    dprintf(fd, "  0x%04x: %llu responses, avg %llu, max %llu |", opcode,
+            (unsigned long long)entry.responses,
+            (unsigned long long)(entry.total_latency_us / entry.responses),
+            (unsigned long long)entry.max_latency_us);
+    for (int i = 0; i < COMMAND_LATENCY_BUCKETS; i++)
+      dprintf(fd, " %llu", (unsigned long long)entry.latency_histogram[i]);
+    dprintf(fd, "\n");
   }
 }
 
@@ -28,6 +28,7 @@
 #include <base/logging.h>
 #include "buffer_allocator.h"
 #include "osi/include/log.h"
+#include "packet_fragmenter.h"
 #include <cutils/properties.h>
 
 #include <android/hardware/bluetooth/1.0/IBluetoothHci.h>
@@ -67,12 +68,19 @@ class BluetoothHciCallbacks : public IBluetoothHciCallbacks {
   }
 
   BT_HDR* WrapPacketAndCopy(uint16_t event, const hidl_vec<uint8_t>& data) {
-    size_t packet_size = data.size() + BT_HDR_SIZE;
+    return WrapPacketAndCopy(event, data, data.size());
+  }
+
+  // Allocates room for |capacity| data bytes so that the packet fragmenter
+  // can reassemble the rest of an L2CAP PDU into this buffer.
+  BT_HDR* WrapPacketAndCopy(uint16_t event, const hidl_vec<uint8_t>& data,
+                            uint16_t capacity) {
+    size_t packet_size = capacity + BT_HDR_SIZE;
     BT_HDR* packet =
         reinterpret_cast<BT_HDR*>(buffer_allocator->alloc(packet_size));
     packet->offset = 0;
     packet->len = data.size();
-    packet->layer_specific = 0;
+    packet->layer_specific = (capacity > data.size()) ? capacity : 0;
     packet->event = event;
     // TODO(eisenbach): Avoid copy here; if BT_HDR->data can be ensured to
     // be the only way the data is accessed, a pointer could be passed here...
@@ -97,7 +105,9 @@ class BluetoothHciCallbacks : public IBluetoothHciCallbacks {
   }
 
   Return<void> aclDataReceived(const hidl_vec<uint8_t>& data) {
-    BT_HDR* packet = WrapPacketAndCopy(MSG_HC_TO_STACK_HCI_ACL, data);
+    BT_HDR* packet = WrapPacketAndCopy(
+        MSG_HC_TO_STACK_HCI_ACL, data,
+        packet_fragmenter_get_acl_rx_capacity(data.data(), data.size()));
     acl_event_received(packet);
     return Void();
   }
@@ -28,10 +28,11 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
-#include <algorithm>
+#include <memory>
 
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 
 #include "buffer_allocator.h"
@@ -41,6 +42,7 @@
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
 #include "osi/include/properties.h"
+#include "packet_fragmenter.h"
 
 using base::Thread;
 
@@ -60,6 +62,11 @@ using base::Thread;
 #define MGMT_EV_SIZE_MAX 1024
 #define MGMT_EV_POLL_TIMEOUT 3000 /* 3000ms */
 
+/* Packets read per recvmmsg() call, and the largest packet, including its
+ * type byte, that can be read */
+#define HCI_RX_BATCH 16
+#define HCI_RX_MAX_PACKET_SIZE 2000
+
 struct sockaddr_hci {
   sa_family_t hci_family;
   unsigned short hci_dev;
@@ -108,62 +115,110 @@ static int rfkill_en;
 int reader_thread_ctrl_fd = -1;
 Thread* reader_thread = NULL;
 
+/* Hands one packet read from the controller, starting with its type byte, to
+ * the stack in a buffer sized for it. */
+static void dispatch_packet(const allocator_t* buffer_allocator,
+                            const uint8_t* buf, size_t len) {
+  uint8_t type = buf[0];
+
+  // Start fragments of a multi-fragment L2CAP PDU get room for the whole
+  // PDU so the fragmenter can reassemble in place.
+  uint16_t capacity = len - 1;
+  if (type == HCI_PACKET_TYPE_ACL_DATA)
+    capacity = packet_fragmenter_get_acl_rx_capacity(buf + 1, len - 1);
+
+  size_t packet_size = capacity + BT_HDR_SIZE;
+  BT_HDR* packet =
+      reinterpret_cast<BT_HDR*>(buffer_allocator->alloc(packet_size));
+  packet->offset = 0;
+  packet->layer_specific = (capacity > len - 1) ? capacity : 0;
+  packet->len = len - 1;
+  memcpy(packet->data, buf + 1, len - 1);
+
+  switch (type) {
+    case HCI_PACKET_TYPE_COMMAND:
+      packet->event = MSG_HC_TO_STACK_HCI_EVT;
+      hci_event_received(FROM_HERE, packet);
+      break;
+    case HCI_PACKET_TYPE_ACL_DATA:
+      packet->event = MSG_HC_TO_STACK_HCI_ACL;
+      acl_event_received(packet);
+      break;
+    case HCI_PACKET_TYPE_SCO_DATA:
+      packet->event = MSG_HC_TO_STACK_HCI_SCO;
+      sco_data_received(packet);
+      break;
+    case HCI_PACKET_TYPE_EVENT:
+      packet->event = MSG_HC_TO_STACK_HCI_EVT;
+      hci_event_received(FROM_HERE, packet);
+      break;
+    default:
+      LOG(FATAL) << "Unexpected event type: " << +type;
+      break;
+  }
+}
+
+/* Reads packets from |fd| until the socket is closed or |ctrl_fd| becomes
+ * readable. Each wakeup drains every queued packet, up to HCI_RX_BATCH per
+ * recvmmsg() call, into receive buffers that are reused; the stack only gets
+ * buffers the size of the packets. */
 void monitor_socket(int ctrl_fd, int fd) {
   const allocator_t* buffer_allocator = buffer_allocator_get_interface();
-  const size_t buf_size = 2000;
-  uint8_t buf[buf_size];
-  ssize_t len = read(fd, buf, buf_size);
-
-  while (len > 0) {
-    if (len == buf_size)
-      LOG(FATAL) << "This packet filled buffer, if it have continuation we "
-                    "don't know how to merge it, increase buffer size!";
-
-    uint8_t type = buf[0];
-
-    size_t packet_size = buf_size + BT_HDR_SIZE;
-    BT_HDR* packet =
-        reinterpret_cast<BT_HDR*>(buffer_allocator->alloc(packet_size));
-    packet->offset = 0;
-    packet->layer_specific = 0;
-    packet->len = len - 1;
-    memcpy(packet->data, buf + 1, len - 1);
-
-    switch (type) {
-      case HCI_PACKET_TYPE_COMMAND:
-        packet->event = MSG_HC_TO_STACK_HCI_EVT;
-        hci_event_received(FROM_HERE, packet);
-        break;
-      case HCI_PACKET_TYPE_ACL_DATA:
-        packet->event = MSG_HC_TO_STACK_HCI_ACL;
-        acl_event_received(packet);
-        break;
-      case HCI_PACKET_TYPE_SCO_DATA:
-        packet->event = MSG_HC_TO_STACK_HCI_SCO;
-        sco_data_received(packet);
-        break;
-      case HCI_PACKET_TYPE_EVENT:
-        packet->event = MSG_HC_TO_STACK_HCI_EVT;
-        hci_event_received(FROM_HERE, packet);
-        break;
-      default:
-        LOG(FATAL) << "Unexpected event type: " << +type;
-        break;
-    }
 
-    fd_set fds;
-    FD_ZERO(&fds);
-    FD_SET(ctrl_fd, &fds);
-    FD_SET(fd, &fds);
-    int res = select(std::max(fd, ctrl_fd) + 1, &fds, NULL, NULL, NULL);
-    if (res <= 0) LOG(INFO) << "Nothing more to read";
+  std::unique_ptr<uint8_t[]> bufs(
+      new uint8_t[HCI_RX_BATCH * HCI_RX_MAX_PACKET_SIZE]);
+  struct iovec iov[HCI_RX_BATCH];
+  struct mmsghdr msgs[HCI_RX_BATCH];
+  memset(msgs, 0, sizeof(msgs));
+  for (int i = 0; i < HCI_RX_BATCH; i++) {
+    iov[i].iov_base = bufs.get() + i * HCI_RX_MAX_PACKET_SIZE;
+    iov[i].iov_len = HCI_RX_MAX_PACKET_SIZE;
+    msgs[i].msg_hdr.msg_iov = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  struct pollfd fds[2];
+  fds[0].fd = ctrl_fd;
+  fds[0].events = POLLIN;
+  fds[1].fd = fd;
+  fds[1].events = POLLIN;
+
+  while (true) {
+    int res;
+    OSI_NO_INTR(res = poll(fds, 2, -1));
+    if (res < 0) {
+      LOG(ERROR) << "Poll error: " << strerror(errno);
+      return;
+    }
 
-    if (FD_ISSET(ctrl_fd, &fds)) {
+    if (fds[0].revents) {
       LOG(INFO) << "exitting";
       return;
     }
 
-    len = read(fd, buf, buf_size);
+    // The socket stays blocking for hci_transmit(), so only these reads are
+    // made non-blocking.
+    int count = HCI_RX_BATCH;
+    while (count == HCI_RX_BATCH) {
+      OSI_NO_INTR(count =
+                      recvmmsg(fd, msgs, HCI_RX_BATCH, MSG_DONTWAIT, NULL));
+      if (count < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+        LOG(ERROR) << "Error reading HCI socket: " << strerror(errno);
+        return;
+      }
+
+      for (int i = 0; i < count; i++) {
+        // HCI packets are never empty; this is the daemon hanging up.
+        if (msgs[i].msg_len == 0) return;
+        if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+          LOG(FATAL) << "This packet did not fit the buffer, if it have "
+                        "continuation we don't know how to merge it, "
+                        "increase buffer size!";
+        dispatch_packet(buffer_allocator, (const uint8_t*)iov[i].iov_base,
+                        msgs[i].msg_len);
+      }
+    }
   }
 }
 
@@ -266,12 +321,16 @@ hci_transmit_status_t hci_transmit(BT_HDR* packet) {
       break;
   }
 
-  uint8_t* addr = packet->data + packet->offset - 1;
-  uint8_t store = *addr;
-  *addr = type;
-  size_t ret = write(bt_vendor_fd, addr, packet->len + 1);
-
-  *(addr) = store;
+  // Send the packet type indicator from its own iovec rather than writing it
+  // into the byte in front of the payload, which may belong to an earlier
+  // fragment of the same buffer.
+  struct iovec iov[2];
+  iov[0].iov_base = &type;
+  iov[0].iov_len = 1;
+  iov[1].iov_base = packet->data + packet->offset;
+  iov[1].iov_len = packet->len;
+  ssize_t ret;
+  OSI_NO_INTR(ret = writev(bt_vendor_fd, iov, 2));
 
   if (ret != packet->len + 1) {
     status = HCI_TRANSMIT_DAEMON_DIED;
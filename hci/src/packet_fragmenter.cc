@@ -177,6 +177,9 @@ static void reassemble_and_dispatch(UNUSED_ATTR BT_HDR* packet) {
         return;
       }
 
+      uint16_t capacity = packet->layer_specific;
+      packet->layer_specific = 0;
+
       if (full_length <= packet->len) {
         if (full_length < packet->len)
           LOG_WARN(LOG_TAG,
@@ -187,13 +190,20 @@ static void reassemble_and_dispatch(UNUSED_ATTR BT_HDR* packet) {
         return;
       }
 
-      BT_HDR* partial_packet =
-          (BT_HDR*)buffer_allocator->alloc(full_length + sizeof(BT_HDR));
-      partial_packet->event = packet->event;
-      partial_packet->len = full_length;
+      BT_HDR* partial_packet;
+      if (capacity >= full_length) {
+        // The HAL already sized this buffer for the whole L2CAP PDU, so the
+        // continuation fragments can be appended to it directly.
+        partial_packet = packet;
+      } else {
+        partial_packet =
+            (BT_HDR*)buffer_allocator->alloc(full_length + sizeof(BT_HDR));
+        partial_packet->event = packet->event;
+        partial_packet->layer_specific = 0;
+        memcpy(partial_packet->data, packet->data, packet->len);
+      }
       partial_packet->offset = packet->len;
-
-      memcpy(partial_packet->data, packet->data, packet->len);
+      partial_packet->len = full_length;
 
       // Update the ACL data size to indicate the full expected length
       stream = partial_packet->data;
@@ -203,7 +213,7 @@ static void reassemble_and_dispatch(UNUSED_ATTR BT_HDR* packet) {
       partial_packets[handle] = partial_packet;
 
       // Free the old packet buffer, since we don't need it anymore
-      buffer_allocator->free(packet);
+      if (partial_packet != packet) buffer_allocator->free(packet);
     } else {
       auto map_iter = partial_packets.find(handle);
       if (map_iter == partial_packets.end()) {
@@ -246,6 +256,32 @@ static void reassemble_and_dispatch(UNUSED_ATTR BT_HDR* packet) {
   }
 }
 
+uint16_t packet_fragmenter_get_acl_rx_capacity(const uint8_t* data,
+                                               uint16_t len) {
+  if (len < HCI_ACL_PREAMBLE_SIZE + L2CAP_HEADER_SIZE) return len;
+
+  uint16_t handle;
+  uint16_t acl_length;
+  uint16_t l2cap_length;
+  STREAM_TO_UINT16(handle, data);
+  STREAM_TO_UINT16(acl_length, data);
+  STREAM_TO_UINT16(l2cap_length, data);
+
+  if (GET_BOUNDARY_FLAG(handle) != START_PACKET_BOUNDARY ||
+      acl_length != len - HCI_ACL_PREAMBLE_SIZE ||
+      check_uint16_overflow(l2cap_length,
+                            (L2CAP_HEADER_SIZE + HCI_ACL_PREAMBLE_SIZE)))
+    return len;
+
+  uint16_t full_length =
+      l2cap_length + L2CAP_HEADER_SIZE + HCI_ACL_PREAMBLE_SIZE;
+  if (full_length <= len ||
+      (full_length + sizeof(BT_HDR)) > BT_DEFAULT_BUFFER_SIZE)
+    return len;
+
+  return full_length;
+}
+
 static const packet_fragmenter_t interface = {init, cleanup,
 
                                               fragment_and_dispatch,
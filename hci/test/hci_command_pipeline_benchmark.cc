@@ -0,0 +1,215 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <base/location.h>
+#include <base/logging.h>
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "bt_types.h"
+#include "btcore/include/module.h"
+#include "btsnoop.h"
+#include "buffer_allocator.h"
+#include "device/include/controller.h"
+#include "hci_layer.h"
+#include "hcidefs.h"
+#include "osi/include/allocator.h"
+#include "osi/include/future.h"
+#include "osi/include/osi.h"
+#include "packet_fragmenter.h"
+
+using ::benchmark::Counter;
+using ::benchmark::State;
+
+extern const module_t hci_module;
+extern void hci_event_received(const base::Location& from_here,
+                               BT_HDR* packet);
+extern void initialization_complete();
+
+// Commands in each burst, and how many different opcodes they use
+#define COMMANDS_PER_BURST 32
+#define OPCODES_PER_BURST 8
+
+typedef std::chrono::steady_clock::time_point time_point_t;
+
+// The fake controller answers every command with a Command Complete event
+// |controller_latency| after receiving it, in order, each time granting
+// |controller_credits| command packets.
+static std::mutex controller_mutex;
+static std::condition_variable controller_cv;
+static std::deque<std::pair<uint16_t, time_point_t>> controller_commands;
+static std::atomic<int> controller_credits;
+static std::chrono::microseconds controller_latency;
+static bool controller_running;
+static std::thread controller_thread;
+
+static std::atomic<uint64_t> commands_completed;
+
+static void send_command_complete(uint16_t opcode) {
+  BT_HDR* packet = static_cast<BT_HDR*>(osi_malloc(BT_HDR_SIZE + 6));
+  packet->event = MSG_HC_TO_STACK_HCI_EVT;
+  packet->offset = 0;
+  packet->len = 6;
+  uint8_t* p = packet->data;
+  UINT8_TO_STREAM(p, HCI_COMMAND_COMPLETE_EVT);
+  UINT8_TO_STREAM(p, 4);
+  UINT8_TO_STREAM(p, controller_credits.load());
+  UINT16_TO_STREAM(p, opcode);
+  UINT8_TO_STREAM(p, HCI_SUCCESS);
+  hci_event_received(FROM_HERE, packet);
+}
+
+static void controller_run() {
+  std::unique_lock<std::mutex> lock(controller_mutex);
+  for (;;) {
+    controller_cv.wait(lock, [] {
+      return !controller_commands.empty() || !controller_running;
+    });
+    if (!controller_running) return;
+    std::pair<uint16_t, time_point_t> command = controller_commands.front();
+    controller_commands.pop_front();
+    lock.unlock();
+    std::this_thread::sleep_until(command.second);
+    send_command_complete(command.first);
+    lock.lock();
+  }
+}
+
+// The HAL, talking to the fake controller
+void hci_initialize() { initialization_complete(); }
+void hci_close() {}
+int hci_open_firmware_log_file() { return INVALID_FD; }
+void hci_close_firmware_log_file(UNUSED_ATTR int fd) {}
+void hci_log_firmware_debug_packet(UNUSED_ATTR int fd,
+                                   UNUSED_ATTR BT_HDR* packet) {}
+
+hci_transmit_status_t hci_transmit(BT_HDR* packet) {
+  uint8_t* stream = packet->data + packet->offset;
+  uint16_t opcode;
+  STREAM_TO_UINT16(opcode, stream);
+  std::lock_guard<std::mutex> lock(controller_mutex);
+  controller_commands.emplace_back(
+      opcode, std::chrono::steady_clock::now() + controller_latency);
+  controller_cv.notify_one();
+  return HCI_TRANSMIT_SUCCESS;
+}
+
+const controller_t* controller_get_interface() { return nullptr; }
+
+static void btsnoop_capture(UNUSED_ATTR const BT_HDR* packet,
+                            UNUSED_ATTR bool is_received) {}
+
+static const btsnoop_t btsnoop = {btsnoop_capture, NULL, NULL, NULL, NULL};
+
+const btsnoop_t* btsnoop_get_interface() { return &btsnoop; }
+
+static void data_received(UNUSED_ATTR const base::Location& from_here,
+                          BT_HDR* packet) {
+  osi_free(packet);
+}
+
+static const hci_t* start_hci() {
+  static const hci_t* hci = nullptr;
+  if (hci != nullptr) return hci;
+
+  hci = hci_layer_get_test_interface(buffer_allocator_get_interface(),
+                                     btsnoop_get_interface(),
+                                     packet_fragmenter_get_interface());
+  hci->set_data_cb(base::Bind(data_received));
+  controller_running = true;
+  controller_thread = std::thread(controller_run);
+  CHECK(future_await(hci_module.start_up()) == FUTURE_SUCCESS);
+  return hci;
+}
+
+static void stop_hci() {
+  if (!controller_thread.joinable()) return;
+
+  hci_module.shut_down();
+  {
+    std::lock_guard<std::mutex> lock(controller_mutex);
+    controller_running = false;
+    controller_cv.notify_one();
+  }
+  controller_thread.join();
+}
+
+static void command_complete(BT_HDR* response, UNUSED_ATTR void* context) {
+  osi_free(response);
+  commands_completed++;
+}
+
+static BT_HDR* make_command(uint16_t opcode) {
+  BT_HDR* command =
+      static_cast<BT_HDR*>(osi_malloc(BT_HDR_SIZE + HCIC_PREAMBLE_SIZE));
+  command->offset = 0;
+  command->len = HCIC_PREAMBLE_SIZE;
+  command->layer_specific = 0;
+  uint8_t* p = command->data;
+  UINT16_TO_STREAM(p, opcode);
+  UINT8_TO_STREAM(p, 0);
+  return command;
+}
+
+// Bursts of commands such as the stack sends while starting LE scanning and
+// advertising, with the controller granting |state.range(0)| credits and
+// answering after |state.range(1)| microseconds.
+static void BM_CommandBurst(State& state) {
+  const hci_t* hci = start_hci();
+  controller_credits = state.range(0);
+  controller_latency = std::chrono::microseconds(state.range(1));
+
+  uint64_t sent = commands_completed;
+  std::chrono::nanoseconds total_latency(0);
+  for (auto _ : state) {
+    time_point_t start = std::chrono::steady_clock::now();
+    for (int i = 0; i < COMMANDS_PER_BURST; i++) {
+      hci->transmit_command(
+          make_command(HCI_GRP_BLE_CMDS | (0x40 + i % OPCODES_PER_BURST)),
+          command_complete, NULL, NULL);
+    }
+    sent += COMMANDS_PER_BURST;
+    while (commands_completed < sent) std::this_thread::yield();
+    total_latency += std::chrono::steady_clock::now() - start;
+  }
+
+  uint64_t commands = state.iterations() * COMMANDS_PER_BURST;
+  state.counters["commands_per_second"] = Counter(commands, Counter::kIsRate);
+  state.counters["burst_us"] =
+      std::chrono::duration_cast<std::chrono::microseconds>(total_latency)
+          .count() /
+      (double)state.iterations();
+}
+BENCHMARK(BM_CommandBurst)
+    ->Args({1, 0})
+    ->Args({4, 0})
+    ->Args({1, 200})
+    ->Args({4, 200})
+    ->UseRealTime();
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  ::benchmark::RunSpecifiedBenchmarks();
+  stop_hci();
+  return 0;
+}
@@ -0,0 +1,318 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <base/location.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "bt_types.h"
+#include "btcore/include/module.h"
+#include "btsnoop.h"
+#include "buffer_allocator.h"
+#include "device/include/controller.h"
+#include "hci_layer.h"
+#include "hcidefs.h"
+#include "osi/include/allocator.h"
+#include "osi/include/future.h"
+#include "osi/include/osi.h"
+#include "packet_fragmenter.h"
+
+extern const module_t hci_module;
+extern void hci_event_received(const base::Location& from_here,
+                               BT_HDR* packet);
+extern void initialization_complete();
+
+#define OPCODE_A (HCI_GRP_BLE_CMDS | 0x41)
+#define OPCODE_B (HCI_GRP_BLE_CMDS | 0x42)
+#define OPCODE_C (HCI_GRP_BLE_CMDS | 0x43)
+#define OPCODE_X (HCI_GRP_BLE_CMDS | 0x44)
+#define OPCODE_VENDOR_1 (HCI_GRP_VENDOR_SPECIFIC | 0x01)
+#define OPCODE_VENDOR_2 (HCI_GRP_VENDOR_SPECIFIC | 0x02)
+
+// How long to wait for something that should happen, and for something that
+// should not
+static const std::chrono::seconds kTimeout(1);
+static const std::chrono::milliseconds kSettleTime(50);
+
+// What the fake HAL and the command callbacks saw
+static std::mutex events_mutex;
+static std::condition_variable events_cv;
+static std::vector<uint16_t> transmitted;
+static std::vector<uint16_t> completed;
+static std::vector<uint16_t> completed_before_transmitted;
+
+// When set, the controller answers a command with |answer_opcode| with a
+// Command Complete for |answer_with_opcode| before hci_transmit() returns. The
+// HAL delivers it on its own thread, and sets |answer_stalled| if that thread
+// could not get it handled while the send was in progress.
+static uint16_t answer_opcode;
+static uint16_t answer_with_opcode;
+static uint8_t answer_with_credits;
+static bool answer_stalled;
+
+static void send_command_complete(uint16_t opcode, uint8_t credits) {
+  BT_HDR* packet = static_cast<BT_HDR*>(osi_malloc(BT_HDR_SIZE + 6));
+  packet->event = MSG_HC_TO_STACK_HCI_EVT;
+  packet->offset = 0;
+  packet->len = 6;
+  uint8_t* p = packet->data;
+  UINT8_TO_STREAM(p, HCI_COMMAND_COMPLETE_EVT);
+  UINT8_TO_STREAM(p, 4);
+  UINT8_TO_STREAM(p, credits);
+  UINT16_TO_STREAM(p, opcode);
+  UINT8_TO_STREAM(p, HCI_SUCCESS);
+  hci_event_received(FROM_HERE, packet);
+}
+
+// The HAL
+void hci_initialize() { initialization_complete(); }
+void hci_close() {}
+int hci_open_firmware_log_file() { return INVALID_FD; }
+void hci_close_firmware_log_file(UNUSED_ATTR int fd) {}
+void hci_log_firmware_debug_packet(UNUSED_ATTR int fd,
+                                   UNUSED_ATTR BT_HDR* packet) {}
+
+hci_transmit_status_t hci_transmit(BT_HDR* packet) {
+  uint8_t* stream = packet->data + packet->offset;
+  uint16_t opcode;
+  STREAM_TO_UINT16(opcode, stream);
+  {
+    std::lock_guard<std::mutex> lock(events_mutex);
+    transmitted.push_back(opcode);
+    events_cv.notify_all();
+  }
+  if (opcode == answer_opcode) {
+    auto handled = std::make_shared<std::promise<void>>();
+    std::future<void> handled_future = handled->get_future();
+    uint16_t with_opcode = answer_with_opcode;
+    uint8_t with_credits = answer_with_credits;
+    std::thread hal_thread([handled, with_opcode, with_credits] {
+      send_command_complete(with_opcode, with_credits);
+      handled->set_value();
+    });
+    if (handled_future.wait_for(kTimeout) == std::future_status::ready) {
+      hal_thread.join();
+    } else {
+      answer_stalled = true;
+      hal_thread.detach();
+    }
+  }
+  return HCI_TRANSMIT_SUCCESS;
+}
+
+const controller_t* controller_get_interface() { return nullptr; }
+
+static void btsnoop_capture(UNUSED_ATTR const BT_HDR* packet,
+                            UNUSED_ATTR bool is_received) {}
+
+static const btsnoop_t btsnoop = {btsnoop_capture, NULL, NULL, NULL, NULL};
+
+const btsnoop_t* btsnoop_get_interface() { return &btsnoop; }
+
+static void data_received(UNUSED_ATTR const base::Location& from_here,
+                          BT_HDR* packet) {
+  osi_free(packet);
+}
+
+static void command_complete(BT_HDR* response, void* context) {
+  osi_free(response);
+  uint16_t opcode = (uint16_t)(uintptr_t)context;
+  std::lock_guard<std::mutex> lock(events_mutex);
+  if (std::find(transmitted.begin(), transmitted.end(), opcode) ==
+      transmitted.end())
+    completed_before_transmitted.push_back(opcode);
+  completed.push_back(opcode);
+  events_cv.notify_all();
+}
+
+static BT_HDR* make_command(uint16_t opcode) {
+  BT_HDR* command =
+      static_cast<BT_HDR*>(osi_malloc(BT_HDR_SIZE + HCIC_PREAMBLE_SIZE));
+  command->offset = 0;
+  command->len = HCIC_PREAMBLE_SIZE;
+  command->layer_specific = 0;
+  uint8_t* p = command->data;
+  UINT16_TO_STREAM(p, opcode);
+  UINT8_TO_STREAM(p, 0);
+  return command;
+}
+
+class HciLayerTest : public ::testing::Test {
+ protected:
+  static void SetUpTestCase() {
+    hci = hci_layer_get_test_interface(buffer_allocator_get_interface(),
+                                       btsnoop_get_interface(),
+                                       packet_fragmenter_get_interface());
+    hci->set_data_cb(base::Bind(data_received));
+    ASSERT_EQ(future_await(hci_module.start_up()), FUTURE_SUCCESS);
+  }
+
+  static void TearDownTestCase() { hci_module.shut_down(); }
+
+  void SetUp() override {
+    std::lock_guard<std::mutex> lock(events_mutex);
+    transmitted.clear();
+    completed.clear();
+    completed_before_transmitted.clear();
+    answer_opcode = HCI_COMMAND_NONE;
+    answer_stalled = false;
+  }
+
+  // Every test leaves no command awaiting a response, so these are what the
+  // controller grants from then on
+  static void GrantCredits(uint8_t credits) {
+    send_command_complete(HCI_COMMAND_NONE, credits);
+  }
+
+  static void Transmit(uint16_t opcode) {
+    hci->transmit_command(make_command(opcode), command_complete, NULL,
+                          (void*)(uintptr_t)opcode);
+  }
+
+  // Waits for |count| commands to be transmitted, then for any more to
+  // follow, and returns them all
+  static std::vector<uint16_t> Transmitted(size_t count) {
+    std::unique_lock<std::mutex> lock(events_mutex);
+    events_cv.wait_for(lock, kTimeout,
+                       [count] { return transmitted.size() >= count; });
+    events_cv.wait_for(lock, kSettleTime,
+                       [count] { return transmitted.size() > count; });
+    return transmitted;
+  }
+
+  static std::vector<uint16_t> Completed() {
+    std::lock_guard<std::mutex> lock(events_mutex);
+    return completed;
+  }
+
+  static const hci_t* hci;
+};
+
+const hci_t* HciLayerTest::hci;
+
+TEST_F(HciLayerTest, duplicate_opcode_held_back_until_answered) {
+  GrantCredits(4);
+  Transmit(OPCODE_A);
+  Transmit(OPCODE_A);
+  Transmit(OPCODE_B);
+
+  // Commands are sent in order, so B waits behind the second A
+  EXPECT_EQ(Transmitted(1), std::vector<uint16_t>({OPCODE_A}));
+
+  send_command_complete(OPCODE_A, 4);
+  EXPECT_EQ(Transmitted(3),
+            std::vector<uint16_t>({OPCODE_A, OPCODE_A, OPCODE_B}));
+
+  send_command_complete(OPCODE_A, 4);
+  send_command_complete(OPCODE_B, 4);
+  EXPECT_EQ(Completed(), std::vector<uint16_t>({OPCODE_A, OPCODE_A, OPCODE_B}));
+}
+
+TEST_F(HciLayerTest, vendor_command_answered_with_other_opcode) {
+  GrantCredits(4);
+  Transmit(OPCODE_VENDOR_1);
+  Transmit(OPCODE_VENDOR_2);
+
+  // Only one vendor specific command is awaiting a response at a time
+  EXPECT_EQ(Transmitted(1), std::vector<uint16_t>({OPCODE_VENDOR_1}));
+
+  // A vendor specific opcode that matches nothing, and then a credit only
+  // Command Complete, are taken as the responses
+  send_command_complete(HCI_GRP_VENDOR_SPECIFIC | 0x3ff, 4);
+  EXPECT_EQ(Transmitted(2),
+            std::vector<uint16_t>({OPCODE_VENDOR_1, OPCODE_VENDOR_2}));
+  send_command_complete(HCI_COMMAND_NONE, 4);
+  EXPECT_EQ(Completed(),
+            std::vector<uint16_t>({OPCODE_VENDOR_1, OPCODE_VENDOR_2}));
+}
+
+TEST_F(HciLayerTest, vendor_command_not_answered_before_sent) {
+  // Queue A, a vendor specific command and B while out of credits, so that
+  // they are all sent when the credits come
+  GrantCredits(1);
+  Transmit(OPCODE_X);
+  ASSERT_EQ(Transmitted(1), std::vector<uint16_t>({OPCODE_X}));
+  Transmit(OPCODE_A);
+  Transmit(OPCODE_VENDOR_1);
+  Transmit(OPCODE_B);
+
+  // A credit only Command Complete straight after A must not be taken as the
+  // response to the vendor specific command still waiting to be sent
+  answer_opcode = OPCODE_A;
+  answer_with_opcode = HCI_COMMAND_NONE;
+  answer_with_credits = 4;
+  send_command_complete(OPCODE_X, 4);
+  EXPECT_EQ(Transmitted(4), std::vector<uint16_t>({OPCODE_X, OPCODE_A,
+                                                   OPCODE_VENDOR_1, OPCODE_B}));
+  EXPECT_EQ(Completed(), std::vector<uint16_t>({OPCODE_X}));
+
+  send_command_complete(OPCODE_A, 4);
+  send_command_complete(OPCODE_VENDOR_1, 4);
+  send_command_complete(OPCODE_B, 4);
+  EXPECT_EQ(Completed(), std::vector<uint16_t>(
+                             {OPCODE_X, OPCODE_A, OPCODE_VENDOR_1, OPCODE_B}));
+  std::lock_guard<std::mutex> lock(events_mutex);
+  EXPECT_TRUE(completed_before_transmitted.empty());
+  EXPECT_FALSE(answer_stalled);
+}
+
+TEST_F(HciLayerTest, vendor_command_answered_while_being_sent) {
+  // The response arrives on the HAL thread before the send returns, which
+  // must not wait for the send to finish
+  answer_opcode = OPCODE_VENDOR_1;
+  answer_with_opcode = OPCODE_VENDOR_1;
+  answer_with_credits = 4;
+  GrantCredits(4);
+  Transmit(OPCODE_VENDOR_1);
+  Transmit(OPCODE_VENDOR_2);
+
+  EXPECT_EQ(Transmitted(2),
+            std::vector<uint16_t>({OPCODE_VENDOR_1, OPCODE_VENDOR_2}));
+  EXPECT_EQ(Completed(), std::vector<uint16_t>({OPCODE_VENDOR_1}));
+  EXPECT_FALSE(answer_stalled);
+
+  // The next vendor specific command takes responses with other opcodes again
+  send_command_complete(HCI_COMMAND_NONE, 4);
+  EXPECT_EQ(Completed(),
+            std::vector<uint16_t>({OPCODE_VENDOR_1, OPCODE_VENDOR_2}));
+}
+
+TEST_F(HciLayerTest, credits_exclude_commands_awaiting_response) {
+  GrantCredits(2);
+  Transmit(OPCODE_A);
+  Transmit(OPCODE_B);
+  Transmit(OPCODE_C);
+  EXPECT_EQ(Transmitted(2), std::vector<uint16_t>({OPCODE_A, OPCODE_B}));
+
+  // One credit, still taken by B
+  send_command_complete(OPCODE_A, 1);
+  EXPECT_EQ(Transmitted(2), std::vector<uint16_t>({OPCODE_A, OPCODE_B}));
+
+  send_command_complete(OPCODE_B, 1);
+  EXPECT_EQ(Transmitted(3),
+            std::vector<uint16_t>({OPCODE_A, OPCODE_B, OPCODE_C}));
+
+  send_command_complete(OPCODE_C, 1);
+  EXPECT_EQ(Completed(), std::vector<uint16_t>({OPCODE_A, OPCODE_B, OPCODE_C}));
+}
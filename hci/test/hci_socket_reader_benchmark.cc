@@ -0,0 +1,182 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <base/location.h>
+#include <base/logging.h>
+#include <benchmark/benchmark.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "bt_types.h"
+#include "buffer_allocator.h"
+#include "device/include/controller.h"
+#include "hcidefs.h"
+#include "osi/include/allocator.h"
+
+using ::benchmark::Counter;
+using ::benchmark::State;
+
+// Packets as the controller sends them, type byte first
+typedef std::vector<std::vector<uint8_t>> packet_list_t;
+
+extern void monitor_socket(int ctrl_fd, int fd);
+
+// The reader hands packets to the HCI layer through these. Here they only
+// count and free them.
+static std::atomic<uint64_t> packets_received;
+
+void hci_event_received(const base::Location& from_here, BT_HDR* packet) {
+  osi_free(packet);
+  packets_received++;
+}
+void acl_event_received(BT_HDR* packet) {
+  osi_free(packet);
+  packets_received++;
+}
+void sco_data_received(BT_HDR* packet) {
+  osi_free(packet);
+  packets_received++;
+}
+void initialization_complete() {}
+const controller_t* controller_get_interface() { return nullptr; }
+
+// How monitor_socket() read before: one read() into a stack buffer and one
+// select() per packet, then a copy into a new buffer.
+static void monitor_socket_reference(int ctrl_fd, int fd) {
+  const allocator_t* buffer_allocator = buffer_allocator_get_interface();
+  const size_t buf_size = 2000;
+  uint8_t buf[buf_size];
+  ssize_t len = read(fd, buf, buf_size);
+
+  while (len > 0) {
+    BT_HDR* packet = reinterpret_cast<BT_HDR*>(
+        buffer_allocator->alloc(len - 1 + BT_HDR_SIZE));
+    packet->offset = 0;
+    packet->len = len - 1;
+    memcpy(packet->data, buf + 1, len - 1);
+    if (buf[0] == 2)
+      acl_event_received(packet);
+    else
+      hci_event_received(FROM_HERE, packet);
+
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(ctrl_fd, &fds);
+    FD_SET(fd, &fds);
+    select(std::max(fd, ctrl_fd) + 1, &fds, NULL, NULL, NULL);
+    if (FD_ISSET(ctrl_fd, &fds)) return;
+
+    len = read(fd, buf, buf_size);
+  }
+}
+
+static std::vector<uint8_t> acl_packet(uint16_t length) {
+  std::vector<uint8_t> packet(1 + HCI_DATA_PREAMBLE_SIZE + length, 0xa5);
+  uint8_t* p = packet.data();
+  UINT8_TO_STREAM(p, 2);
+  // Continuation fragments, so that no reassembly capacity is reserved
+  UINT16_TO_STREAM(p, 0x1001);
+  UINT16_TO_STREAM(p, length);
+  return packet;
+}
+
+static std::vector<uint8_t> le_adv_report_event(uint8_t data_len) {
+  std::vector<uint8_t> packet(1 + HCIE_PREAMBLE_SIZE + 11 + data_len, 0);
+  uint8_t* p = packet.data();
+  UINT8_TO_STREAM(p, 4);
+  UINT8_TO_STREAM(p, HCI_BLE_EVENT);
+  UINT8_TO_STREAM(p, packet.size() - 1 - HCIE_PREAMBLE_SIZE);
+  UINT8_TO_STREAM(p, HCI_BLE_ADV_PKT_RPT_EVT);
+  UINT8_TO_STREAM(p, 1);
+  return packet;
+}
+
+// The controller stand-in writes bursts of |packets| to one end of a
+// SOCK_SEQPACKET socketpair while |reader| runs on the other end.
+static void replay(State& state, void (*reader)(int, int),
+                   const packet_list_t& packets) {
+  int sv[2], ctrl[2];
+  CHECK(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv) == 0);
+  CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, ctrl) == 0);
+
+  packets_received = 0;
+  std::thread reader_thread(reader, ctrl[1], sv[1]);
+
+  uint64_t sent = 0;
+  size_t bytes = 0;
+  for (auto _ : state) {
+    for (const std::vector<uint8_t>& packet : packets) {
+      CHECK(write(sv[0], packet.data(), packet.size()) ==
+            (ssize_t)packet.size());
+      bytes += packet.size();
+    }
+    sent += packets.size();
+    while (packets_received < sent) std::this_thread::yield();
+  }
+
+  uint8_t msg = 1;
+  CHECK(write(ctrl[0], &msg, 1) == 1);
+  // Wake the reference reader if it is blocked in read()
+  shutdown(sv[0], SHUT_WR);
+  reader_thread.join();
+  close(sv[0]);
+  close(sv[1]);
+  close(ctrl[0]);
+  close(ctrl[1]);
+
+  state.SetBytesProcessed(bytes);
+  state.counters["packets_per_second"] = Counter(sent, Counter::kIsRate);
+}
+
+// Inbound A2DP sink or file transfer: maximum size LE and BR/EDR ACL data
+static packet_list_t acl_burst() {
+  packet_list_t packets;
+  for (int i = 0; i < 64; i++)
+    packets.push_back(acl_packet(i % 2 ? 1021 : 251));
+  return packets;
+}
+
+// LE scanning in a crowded space: many small advertising reports
+static packet_list_t adv_report_burst() {
+  packet_list_t packets;
+  for (int i = 0; i < 64; i++) packets.push_back(le_adv_report_event(i % 31));
+  return packets;
+}
+
+static void BM_SocketReaderReference(State& state,
+                                     packet_list_t (*make_packets)()) {
+  replay(state, monitor_socket_reference, make_packets());
+}
+BENCHMARK_CAPTURE(BM_SocketReaderReference, acl, acl_burst)->UseRealTime();
+BENCHMARK_CAPTURE(BM_SocketReaderReference, adv_reports, adv_report_burst)
+    ->UseRealTime();
+
+static void BM_SocketReaderBatched(State& state,
+                                   packet_list_t (*make_packets)()) {
+  replay(state, monitor_socket, make_packets());
+}
+BENCHMARK_CAPTURE(BM_SocketReaderBatched, acl, acl_burst)->UseRealTime();
+BENCHMARK_CAPTURE(BM_SocketReaderBatched, adv_reports, adv_report_burst)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
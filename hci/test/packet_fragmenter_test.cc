@@ -21,6 +21,7 @@
 #include "AllocationTestHarness.h"
 
 #include <stdint.h>
+#include <vector>
 
 #include "device/include/controller.h"
 #include "hci_internals.h"
@@ -32,7 +33,7 @@
 DECLARE_TEST_MODES(init, set_data_sizes, no_fragmentation, fragmentation,
                    ble_no_fragmentation, ble_fragmentation,
                    non_acl_passthrough_fragmentation, no_reassembly, reassembly,
-                   non_acl_passthrough_reassembly);
+                   in_place_reassembly, non_acl_passthrough_reassembly);
 
 #define LOCAL_BLE_CONTROLLER_ID 1
 
@@ -56,6 +57,7 @@ static const uint16_t test_handle_start = (0x1992 & 0xCFFF) | 0x2000;
 static const uint16_t test_handle_continuation = (0x1992 & 0xCFFF) | 0x1000;
 static int packet_index;
 static unsigned int data_size_sum;
+static BT_HDR* first_fragment;
 
 static const packet_fragmenter_t* fragmenter;
 
@@ -129,7 +131,8 @@ static void expect_packet_fragmented(uint16_t event, int max_acl_data_size,
 
 static void manufacture_packet_and_then_reassemble(uint16_t event,
                                                    uint16_t acl_size,
-                                                   const char* data) {
+                                                   const char* data,
+                                                   bool size_like_hal = false) {
   uint16_t data_length = strlen(data);
 
   if (event == MSG_HC_TO_STACK_HCI_ACL) {
@@ -143,13 +146,8 @@ static void manufacture_packet_and_then_reassemble(uint16_t event,
       int length_to_send = (length_sent + (acl_size - 4) < total_length)
                                ? (acl_size - 4)
                                : (total_length - length_sent);
-      BT_HDR* packet = (BT_HDR*)osi_malloc(length_to_send + 4 + sizeof(BT_HDR));
-      packet->len = length_to_send + 4;
-      packet->offset = 0;
-      packet->event = event;
-      packet->layer_specific = 0;
-
-      uint8_t* packet_data = packet->data;
+      std::vector<uint8_t> fragment(length_to_send + 4);
+      uint8_t* packet_data = fragment.data();
       if (length_sent == 0) {  // first packet
         UINT16_TO_STREAM(packet_data, test_handle_start);
         UINT16_TO_STREAM(packet_data, length_to_send);
@@ -161,6 +159,21 @@ static void manufacture_packet_and_then_reassemble(uint16_t event,
         memcpy(packet_data, data + length_sent - 2, length_to_send);
       }
 
+      // Size the buffer the way the HALs do when asked to
+      uint16_t capacity = length_to_send + 4;
+      if (size_like_hal)
+        capacity =
+            packet_fragmenter_get_acl_rx_capacity(fragment.data(), length_to_send + 4);
+
+      BT_HDR* packet = (BT_HDR*)osi_malloc(capacity + sizeof(BT_HDR));
+      packet->len = length_to_send + 4;
+      packet->offset = 0;
+      packet->event = event;
+      packet->layer_specific =
+          (capacity > length_to_send + 4) ? capacity : 0;
+      memcpy(packet->data, fragment.data(), length_to_send + 4);
+      if (length_sent == 0) first_fragment = packet;
+
       length_sent += length_to_send;
       fragmenter->reassemble_and_dispatch(packet);
     } while (length_sent < total_length);
@@ -248,6 +261,14 @@ DURING(reassembly) AT_CALL(0) {
   return;
 }
 
+DURING(in_place_reassembly) AT_CALL(0) {
+  // Reassembled into the first fragment's buffer rather than a new one
+  EXPECT_EQ(first_fragment, packet);
+  EXPECT_EQ(0, packet->layer_specific);
+  expect_packet_reassembled(MSG_HC_TO_STACK_HCI_ACL, packet, sample_data);
+  return;
+}
+
 DURING(non_acl_passthrough_reassembly) AT_CALL(0) {
   expect_packet_reassembled(MSG_HC_TO_STACK_HCI_EVT, packet, sample_data);
   return;
@@ -386,6 +407,34 @@ TEST_F(PacketFragmenterTest, test_reassembly_necessary) {
   EXPECT_CALL_COUNT(reassembled_callback, 1);
 }
 
+TEST_F(PacketFragmenterTest, test_reassembly_in_place) {
+  reset_for(in_place_reassembly);
+  manufacture_packet_and_then_reassemble(MSG_HC_TO_STACK_HCI_ACL, 42,
+                                         sample_data, true);
+
+  EXPECT_EQ(strlen(sample_data), data_size_sum);
+  EXPECT_CALL_COUNT(reassembled_callback, 1);
+}
+
+TEST_F(PacketFragmenterTest, test_acl_rx_capacity) {
+  uint8_t fragment[10];
+  uint8_t* stream = fragment;
+  UINT16_TO_STREAM(stream, test_handle_start);
+  UINT16_TO_STREAM(stream, 6);
+  UINT16_TO_STREAM(stream, 100);  // L2CAP length
+  UINT16_TO_STREAM(stream, 0x0040);
+  // Start fragment of a longer PDU: room for ACL + L2CAP headers + payload
+  EXPECT_EQ(108, packet_fragmenter_get_acl_rx_capacity(fragment, 10));
+
+  // Continuation fragments are never enlarged
+  stream = fragment;
+  UINT16_TO_STREAM(stream, test_handle_continuation);
+  EXPECT_EQ(10, packet_fragmenter_get_acl_rx_capacity(fragment, 10));
+
+  // Neither are fragments too short to carry an L2CAP header
+  EXPECT_EQ(6, packet_fragmenter_get_acl_rx_capacity(fragment, 6));
+}
+
 TEST_F(PacketFragmenterTest, test_non_acl_passthrough_reasseembly) {
   reset_for(non_acl_passthrough_reassembly);
   manufacture_packet_and_then_reassemble(MSG_HC_TO_STACK_HCI_EVT, 42,
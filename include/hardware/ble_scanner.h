@@ -43,11 +43,36 @@ typedef void (*scan_result_callback)(uint16_t event_type, uint8_t addr_type,
                                      int8_t rssi, uint16_t periodic_adv_int,
                                      std::vector<uint8_t> adv_data);
 
+/** A scan result delivered through scan_results_batch_callback. Its
+ * advertising data is |adv_data_len| bytes at |adv_data_offset| in the
+ * batch's data buffer. */
+typedef struct {
+  uint16_t event_type;
+  uint8_t addr_type;
+  RawAddress bda;
+  uint8_t primary_phy;
+  uint8_t secondary_phy;
+  uint8_t advertising_sid;
+  int8_t tx_power;
+  int8_t rssi;
+  uint16_t periodic_adv_int;
+  uint32_t adv_data_offset;
+  uint16_t adv_data_len;
+} btgatt_scan_result_t;
+
+/** Callback for a batch of scan results, in the order they were received.
+ * When set, it is used instead of scan_result_callback. The references are
+ * only valid for the duration of the call. */
+typedef void (*scan_results_batch_callback)(
+    const std::vector<btgatt_scan_result_t>& results,
+    const std::vector<uint8_t>& adv_data);
+
 typedef struct {
   scan_result_callback scan_result_cb;
   batchscan_reports_callback batchscan_reports_cb;
   batchscan_threshold_callback batchscan_threshold_cb;
   track_adv_event_callback track_adv_event_cb;
+  scan_results_batch_callback scan_results_batch_cb;
 } btgatt_scanner_callbacks_t;
 
 class BleScannerInterface {
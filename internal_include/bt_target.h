@@ -379,6 +379,24 @@
 #define BTM_INQ_DB_SIZE 40
 #endif
 
+/* The number of LE devices whose advertising data can be held while waiting
+ * for a scan response or the rest of a chained advertisement. */
+#ifndef BTM_BLE_ADV_CACHE_SIZE
+#define BTM_BLE_ADV_CACHE_SIZE 32
+#endif
+
+/* The number of resolvable private addresses of bonded LE devices whose
+ * resolution is cached. */
+#ifndef BTM_BLE_RPA_CACHE_SIZE
+#define BTM_BLE_RPA_CACHE_SIZE 64
+#endif
+
+/* The number of resolvable private addresses remembered as matching none of
+ * the stored IRKs. */
+#ifndef BTM_BLE_RPA_NEG_CACHE_SIZE
+#define BTM_BLE_RPA_NEG_CACHE_SIZE 512
+#endif
+
 /* The default scan mode */
 #ifndef BTM_DEFAULT_SCAN_TYPE
 #define BTM_DEFAULT_SCAN_TYPE BTM_SCAN_TYPE_INTERLACED
@@ -694,6 +712,24 @@
 #define L2CAP_ROUND_ROBIN_CHANNEL_SERVICE TRUE
 #endif
 
+/* Share controller buffers between links by deficit round robin, weighted by
+ * the priority of the queued data. FALSE serves links in plain round robin. */
+#ifndef L2CAP_LINK_SCHED_DRR
+#define L2CAP_LINK_SCHED_DRR TRUE
+#endif
+
+/* Bytes a bulk link may send per DRR round. Normal and latency sensitive
+ * links get two and four times as much. */
+#ifndef L2CAP_LINK_SCHED_QUANTUM
+#define L2CAP_LINK_SCHED_QUANTUM 1021
+#endif
+
+/* Bytes a latency sensitive link may send ahead of its DRR share before it
+ * loses its precedence over the other links */
+#ifndef L2CAP_LINK_SCHED_FAST_PATH_DEBT
+#define L2CAP_LINK_SCHED_FAST_PATH_DEBT (4 * L2CAP_LINK_SCHED_QUANTUM)
+#endif
+
 /* used for monitoring eL2CAP data flow */
 #ifndef L2CAP_ERTM_STATS
 #define L2CAP_ERTM_STATS FALSE
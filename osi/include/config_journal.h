@@ -0,0 +1,89 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "osi/include/config.h"
+
+// An append-only log of mutations to a |config_t|. Persisting a change costs
+// one append instead of rewriting the whole config file; the log is replayed
+// on top of the last full save when the config is next loaded, and is reset
+// whenever the owner writes a full snapshot with |config_save|.
+//
+// The file starts with the generation of the full save the records apply to,
+// which the owner also stores in that save:
+//
+//   G <generation>\n
+//
+// Each record is then a header line followed by its payload:
+//
+//   S <section_len> <key_len> <value_len>\n<section><key><value>\n
+//   R <section_len> <key_len> 0\n<section><key>\n
+//
+// where S sets a key and R removes one. A record cut short by a crash fails
+// validation and ends the replay, so a torn tail is simply dropped.
+//
+// A journal is not thread-safe; callers must serialize access to it.
+
+typedef struct config_journal_t config_journal_t;
+
+// Opens (creating if needed) the journal at |filename| for appending. Returns
+// NULL on error. The caller must free the returned journal with
+// |config_journal_free|.
+config_journal_t* config_journal_new(const char* filename);
+
+// Closes |journal|. Records that have not been flushed are discarded.
+// |journal| may be NULL.
+void config_journal_free(config_journal_t* journal);
+
+// Queues a record setting |key| in |section| to |value|. Records are kept in
+// memory until |config_journal_flush| is called. No argument may be NULL.
+void config_journal_set(config_journal_t* journal, const char* section,
+                        const char* key, const char* value);
+
+// Queues a record removing |key| from |section|. No argument may be NULL.
+void config_journal_remove(config_journal_t* journal, const char* section,
+                           const char* key);
+
+// Returns true if records have been queued since the last flush.
+bool config_journal_has_pending(const config_journal_t* journal);
+
+// Appends the queued records to the journal file and syncs it to disk.
+// Returns false on I/O error, in which case the file may hold a partial
+// record and the caller should fall back to a full save followed by
+// |config_journal_reset|.
+bool config_journal_flush(config_journal_t* journal);
+
+// Returns the size of the journal file in bytes, excluding queued records.
+size_t config_journal_size(const config_journal_t* journal);
+
+// Truncates the journal file, drops queued records and starts the file over
+// for |generation|. Call this once the config has been written out in full as
+// |generation|. Returns false on I/O error.
+bool config_journal_reset(config_journal_t* journal, uint64_t generation);
+
+// Applies the records stored in the journal file at |filename| to |config|,
+// which must have been loaded from the full save of |generation|. Returns the
+// number of records applied; a missing file, or one started for another
+// generation, applies none.
+size_t config_journal_replay(const char* filename, uint64_t generation,
+                             config_t* config);
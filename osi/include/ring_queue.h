@@ -0,0 +1,124 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+// A bounded, lock-free alternative to |fixed_queue_t| for queues with one
+// consumer and any number of producers.
+//
+// Elements live in a preallocated power-of-two ring, so enqueue and dequeue do
+// not allocate or take a lock. The dequeue file descriptor is an eventfd that
+// is only written when the queue goes from empty to non-empty and only
+// cleared when the consumer drains it, so a steady stream of messages costs
+// no system calls. Producers only block (on a condition variable) when the
+// ring is full.
+//
+// Unlike |fixed_queue_t|, there is no way to peek at the tail, remove an
+// element from the middle, or obtain the backing list.
+
+struct ring_queue_t;
+typedef struct ring_queue_t ring_queue_t;
+typedef struct reactor_t reactor_t;
+
+typedef void (*ring_queue_free_cb)(void* data);
+typedef void (*ring_queue_cb)(ring_queue_t* queue, void* context);
+
+// Largest capacity a ring queue may be created with.
+#define RING_QUEUE_MAX_CAPACITY (1U << 20)
+
+// Creates a new ring queue that can hold at least |capacity| elements. The
+// capacity is rounded up to the next power of two and may not exceed
+// |RING_QUEUE_MAX_CAPACITY|. Returns NULL on failure. The caller must free
+// the returned queue with |ring_queue_free|.
+ring_queue_t* ring_queue_new(size_t capacity);
+
+// Frees a queue and (optionally) the enqueued elements.
+// |queue| is the queue to free. If the |free_cb| callback is not null,
+// it is called on each queue element to free it.
+// Freeing a queue that is currently in use (i.e. has waiters
+// blocked on it) results in undefined behaviour.
+void ring_queue_free(ring_queue_t* queue, ring_queue_free_cb free_cb);
+
+// Flushes a queue and (optionally) frees the enqueued elements.
+// |queue| is the queue to flush. If the |free_cb| callback is not null,
+// it is called on each queue element to free it. Must only be called from
+// the consumer thread.
+void ring_queue_flush(ring_queue_t* queue, ring_queue_free_cb free_cb);
+
+// Returns a value indicating whether the given |queue| is empty. If |queue|
+// is NULL, the return value is true.
+bool ring_queue_is_empty(ring_queue_t* queue);
+
+// Returns the length of the |queue|. The value is a snapshot and may be stale
+// by the time it is returned if other threads are using the queue. If |queue|
+// is NULL, the return value is 0.
+size_t ring_queue_length(ring_queue_t* queue);
+
+// Returns the maximum number of elements this queue may hold. |queue| may
+// not be NULL.
+size_t ring_queue_capacity(ring_queue_t* queue);
+
+// Enqueues the given |data| into the |queue|. The caller will be blocked
+// if no more space is available in the queue. Neither |queue| nor |data|
+// may be NULL.
+void ring_queue_enqueue(ring_queue_t* queue, void* data);
+
+// Dequeues the next element from |queue|. If the queue is currently empty,
+// this function will block the caller until an item is enqueued. This
+// function will never return NULL. |queue| may not be NULL. Must only be
+// called from the consumer thread.
+void* ring_queue_dequeue(ring_queue_t* queue);
+
+// Tries to enqueue |data| into the |queue|. This function will never block
+// the caller. If the queue is full, this function returns false immediately.
+// Otherwise, this function returns true. Neither |queue| nor |data| may be
+// NULL.
+bool ring_queue_try_enqueue(ring_queue_t* queue, void* data);
+
+// Tries to dequeue an element from |queue|. This function will never block
+// the caller. If the queue is empty or NULL, this function returns NULL
+// immediately. Otherwise, the next element in the queue is returned. Must
+// only be called from the consumer thread.
+void* ring_queue_try_dequeue(ring_queue_t* queue);
+
+// Returns the first element from |queue|, if present, without dequeuing it.
+// This function will never block the caller. Returns NULL if there are no
+// elements in the queue or |queue| is NULL. Must only be called from the
+// consumer thread.
+void* ring_queue_try_peek_first(ring_queue_t* queue);
+
+// This function returns a valid file descriptor. Callers may perform one
+// operation on the fd: select(2). If |select| indicates that the file
+// descriptor is readable, the queue is likely to be non-empty; callers should
+// use |ring_queue_try_dequeue| as the readiness may be stale. The caller must
+// not close the returned file descriptor. |queue| may not be NULL.
+int ring_queue_get_dequeue_fd(const ring_queue_t* queue);
+
+// Registers |queue| with |reactor| for dequeue operations. When there is an
+// element in the queue, ready_cb will be called. The |context| parameter is
+// passed, untouched, to the callback routine. Neither |queue|, nor |reactor|,
+// nor |read_cb| may be NULL. |context| may be NULL.
+void ring_queue_register_dequeue(ring_queue_t* queue, reactor_t* reactor,
+                                 ring_queue_cb ready_cb, void* context);
+
+// Unregisters the dequeue ready callback for |queue| from whichever reactor
+// it is registered with, if any. This function is idempotent.
+void ring_queue_unregister_dequeue(ring_queue_t* queue);
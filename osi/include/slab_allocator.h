@@ -0,0 +1,74 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Size-class slab allocator backing |osi_malloc| and friends.
+//
+// Requests up to |SLAB_ALLOCATOR_MAX_BLOCK_SIZE| bytes are served from
+// fixed-size blocks carved out of larger slabs. Each thread keeps a small
+// cache of free blocks per size class so that the common alloc/free pair on
+// the HCI, btu and A2DP threads does not take any lock. Larger requests fall
+// through to the system allocator. Slab memory is retained by the process
+// once carved; the high-water statistics below show how much that is.
+
+// Largest request (including any allocation tracker canaries) that is served
+// from a slab. Anything larger goes straight to malloc().
+#define SLAB_ALLOCATOR_MAX_BLOCK_SIZE 16384
+
+typedef struct {
+  size_t block_size;  // Usable size of blocks in this class
+  uint64_t hits;      // Allocations served from an already carved block
+  uint64_t misses;    // Allocations that required carving a new slab
+  size_t in_use;      // Blocks currently handed out
+  size_t high_water;  // Maximum of |in_use| over the process lifetime
+  size_t slabs;       // Slabs carved for this class
+} slab_allocator_class_stats_t;
+
+// Allocates |size| bytes. Never returns NULL; aborts if the system is out of
+// memory. The returned pointer is aligned to 16 bytes and must be released
+// with |slab_allocator_free|.
+void* slab_allocator_alloc(size_t size);
+
+// Releases a block obtained from |slab_allocator_alloc|. |ptr| may be NULL.
+void slab_allocator_free(void* ptr);
+
+// Returns all blocks cached by the calling thread to the shared pools. This
+// happens automatically when a thread exits; it is exposed for tests and for
+// threads that are about to become idle for a long time.
+void slab_allocator_flush_thread_cache(void);
+
+// Returns the number of size classes. Valid class indices for
+// |slab_allocator_get_class_stats| are [0, slab_allocator_num_classes()).
+size_t slab_allocator_num_classes(void);
+
+// Fills |stats| with a snapshot of the counters for size class |index|.
+// Returns false if |index| is out of range.
+bool slab_allocator_get_class_stats(size_t index,
+                                    slab_allocator_class_stats_t* stats);
+
+// Returns the number of allocations that bypassed the slabs because they were
+// larger than |SLAB_ALLOCATOR_MAX_BLOCK_SIZE|.
+uint64_t slab_allocator_get_large_allocations(void);
+
+// Dump slab allocator statistics to the |fd| file descriptor.
+// The information is in user-readable text format. The |fd| must be valid.
+void slab_allocator_debug_dump(int fd);
@@ -0,0 +1,102 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// A hierarchical timing wheel with millisecond ticks.
+//
+// Entries are intrusive: the caller embeds a |timer_wheel_entry_t| in its own
+// object, so inserting and removing never allocate. Insertion and removal are
+// O(1); entries far in the future sit in coarse slots and are cascaded into
+// finer ones as time advances. Expired entries are handed back ordered by
+// deadline, and entries with equal deadlines in the order they were inserted.
+//
+// The wheel is not thread-safe; callers must provide their own locking.
+
+struct timer_wheel_t;
+typedef struct timer_wheel_t timer_wheel_t;
+
+typedef struct timer_wheel_entry_t {
+  // Owned by the wheel while the entry is pending. After
+  // |timer_wheel_expire|, |next| links the expired entries together.
+  struct timer_wheel_entry_t* next;
+  struct timer_wheel_entry_t* prev;
+  uint64_t deadline;
+  uint64_t sequence;
+  uint16_t slot;
+
+  // Caller-owned pointer back to the object containing the entry.
+  void* data;
+} timer_wheel_entry_t;
+
+// Iterator callback prototype used for |timer_wheel_foreach|. Must return true
+// to continue iterating or false to stop.
+typedef bool (*timer_wheel_iter_cb)(void* data, void* context);
+
+// Returns a new, empty wheel whose clock starts at |now_ms|. The returned
+// wheel must be freed with |timer_wheel_free|.
+timer_wheel_t* timer_wheel_new(uint64_t now_ms);
+
+// Frees |wheel|. Pending entries are dropped, not freed. |wheel| may be NULL.
+void timer_wheel_free(timer_wheel_t* wheel);
+
+// Returns the number of pending entries in |wheel|. |wheel| may not be NULL.
+size_t timer_wheel_length(const timer_wheel_t* wheel);
+
+// Returns true if |wheel| has no pending entries. |wheel| may not be NULL.
+bool timer_wheel_is_empty(const timer_wheel_t* wheel);
+
+// Prepares |entry| for use with a wheel. |data| is returned through
+// |entry->data| and |timer_wheel_foreach|. |entry| may not be NULL.
+void timer_wheel_entry_init(timer_wheel_entry_t* entry, void* data);
+
+// Returns true if |entry| is currently pending in a wheel. |entry| may not be
+// NULL.
+bool timer_wheel_entry_is_pending(const timer_wheel_entry_t* entry);
+
+// Schedules |entry| to expire at |deadline_ms|. If |entry| is already pending
+// it is moved. A deadline that has already been passed expires on the next
+// call to |timer_wheel_expire|. Neither |wheel| nor |entry| may be NULL.
+void timer_wheel_insert(timer_wheel_t* wheel, timer_wheel_entry_t* entry,
+                        uint64_t deadline_ms);
+
+// Removes |entry| from |wheel|. Does nothing if |entry| is not pending.
+// Neither |wheel| nor |entry| may be NULL.
+void timer_wheel_remove(timer_wheel_t* wheel, timer_wheel_entry_t* entry);
+
+// Looks up the earliest deadline of any pending entry and stores it in
+// |deadline_ms|. Returns false, leaving |deadline_ms| untouched, if |wheel| is
+// empty. Neither |wheel| nor |deadline_ms| may be NULL.
+bool timer_wheel_next_deadline(timer_wheel_t* wheel, uint64_t* deadline_ms);
+
+// Advances the clock of |wheel| to |now_ms| and removes every entry whose
+// deadline is at or before it. Returns the removed entries linked through
+// their |next| field, or NULL if none expired. The entries are no longer
+// pending, so the caller may re-insert them while walking the list as long as
+// it reads |next| first. |wheel| may not be NULL.
+timer_wheel_entry_t* timer_wheel_expire(timer_wheel_t* wheel, uint64_t now_ms);
+
+// Iterates over every pending entry in |wheel|, in no particular order, until
+// |callback| returns false. |wheel| must not be modified from |callback|.
+// Neither |wheel| nor |callback| may be NULL.
+void timer_wheel_foreach(const timer_wheel_t* wheel,
+                         timer_wheel_iter_cb callback, void* context);
@@ -40,11 +40,11 @@
 
 #include "osi/include/allocator.h"
 #include "osi/include/fixed_queue.h"
-#include "osi/include/list.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
 #include "osi/include/semaphore.h"
 #include "osi/include/thread.h"
+#include "osi/include/timer_wheel.h"
 #include "osi/include/wakelock.h"
 
 using base::Bind;
@@ -99,6 +99,7 @@ struct alarm_t {
   period_ms_t deadline;
   period_ms_t prev_deadline;  // Previous deadline - used for accounting of
                               // periodic timers
+  timer_wheel_entry_t entry;  // Links the alarm into |alarms| while pending
   bool is_periodic;
   fixed_queue_t* queue;  // The processing queue to add this alarm to
   alarm_callback_t callback;
@@ -116,6 +117,12 @@ struct alarm_t {
 int64_t TIMER_INTERVAL_FOR_WAKELOCK_IN_MS = 3000;
 static const clockid_t CLOCK_ID = CLOCK_BOOTTIME;
 
+// Non-periodic alarms set at least |TIMER_INTERVAL_FOR_WAKELOCK_IN_MS| out
+// are protocol timeouts that bring the system out of suspend rather than
+// drive audio. Their deadlines are rounded up to a multiple of this value so
+// that timeouts armed around the same time expire on a single wakeup.
+static const period_ms_t ALARM_COALESCE_WINDOW_MS = 100;
+
 #if (KERNEL_MISSING_CLOCK_BOOTTIME_ALARM == TRUE)
 static const clockid_t CLOCK_ID_ALARM = CLOCK_BOOTTIME;
 #else
@@ -124,12 +131,14 @@ static const clockid_t CLOCK_ID_ALARM = CLOCK_BOOTTIME_ALARM;
 
 // This mutex ensures that the |alarm_set|, |alarm_cancel|, and alarm callback
 // functions execute serially and not concurrently. As a result, this mutex
-// also protects the |alarms| list.
+// also protects the |alarms| wheel.
 static std::mutex alarms_mutex;
-static list_t* alarms;
+static timer_wheel_t* alarms;
 static timer_t timer;
 static timer_t wakeup_timer;
 static bool timer_set;
+// Deadline the timers are currently armed for, or 0 if there is none.
+static period_ms_t root_deadline;
 
 // All alarm callbacks are dispatched from |dispatcher_thread|
 static thread_t* dispatcher_thread;
@@ -143,12 +152,13 @@ static fixed_queue_t* default_callback_queue;
 static alarm_t* alarm_new_internal(const char* name, bool is_periodic);
 static bool lazy_initialize(void);
 static period_ms_t now(void);
+static period_ms_t boottime_ms(void);
 static void alarm_set_internal(alarm_t* alarm, period_ms_t period,
                                alarm_callback_t cb, void* data,
                                fixed_queue_t* queue, bool for_msg_loop);
 static void alarm_cancel_internal(alarm_t* alarm);
 static void remove_pending_alarm(alarm_t* alarm);
-static void schedule_next_instance(alarm_t* alarm);
+static bool schedule_next_instance(alarm_t* alarm);
 static void reschedule_root_alarm(void);
 static void alarm_queue_ready(fixed_queue_t* queue, void* context);
 static void timer_callback(void* data);
@@ -174,7 +184,7 @@ alarm_t* alarm_new_periodic(const char* name) {
 }
 
 static alarm_t* alarm_new_internal(const char* name, bool is_periodic) {
-  // Make sure we have a list we can insert alarms into.
+  // Make sure we have a wheel we can insert alarms into.
   if (!alarms && !lazy_initialize()) {
     CHECK(false);  // if initialization failed, we should not continue
     return NULL;
@@ -184,6 +194,7 @@ static alarm_t* alarm_new_internal(const char* name, bool is_periodic) {
 
   std::shared_ptr<std::recursive_mutex> ptr(new std::recursive_mutex());
   ret->callback_mutex = ptr;
+  timer_wheel_entry_init(&ret->entry, ret);
   ret->is_periodic = is_periodic;
   ret->stats.name = osi_strdup(name);
 
@@ -246,7 +257,7 @@ static void alarm_set_internal(alarm_t* alarm, period_ms_t period,
   alarm->data = data;
   alarm->for_msg_loop = for_msg_loop;
 
-  schedule_next_instance(alarm);
+  if (schedule_next_instance(alarm)) reschedule_root_alarm();
   alarm->stats.scheduled_count++;
 }
 
@@ -268,8 +279,8 @@ void alarm_cancel(alarm_t* alarm) {
 // Internal implementation of canceling an alarm.
 // The caller must hold the |alarms_mutex|
 static void alarm_cancel_internal(alarm_t* alarm) {
-  bool needs_reschedule =
-      (!list_is_empty(alarms) && list_front(alarms) == alarm);
+  bool needs_reschedule = timer_wheel_entry_is_pending(&alarm->entry) &&
+                          alarm->deadline <= root_deadline;
 
   remove_pending_alarm(alarm);
 
@@ -309,8 +320,9 @@ void alarm_cleanup(void) {
   semaphore_free(alarm_expired);
   alarm_expired = NULL;
 
-  list_free(alarms);
+  timer_wheel_free(alarms);
   alarms = NULL;
+  root_deadline = 0;
 }
 
 static bool lazy_initialize(void) {
@@ -323,9 +335,9 @@ static bool lazy_initialize(void) {
 
   std::lock_guard<std::mutex> lock(alarms_mutex);
 
-  alarms = list_new(NULL);
+  alarms = timer_wheel_new(boottime_ms());
   if (!alarms) {
-    LOG_ERROR(LOG_TAG, "%s unable to allocate alarm list.", __func__);
+    LOG_ERROR(LOG_TAG, "%s unable to allocate alarm wheel.", __func__);
     goto error;
   }
 
@@ -386,7 +398,7 @@ error:
 
   if (timer_initialized) timer_delete(timer);
 
-  list_free(alarms);
+  timer_wheel_free(alarms);
   alarms = NULL;
 
   return false;
@@ -395,6 +407,10 @@ error:
 static period_ms_t now(void) {
   CHECK(alarms != NULL);
 
+  return boottime_ms();
+}
+
+static period_ms_t boottime_ms(void) {
   struct timespec ts;
   if (clock_gettime(CLOCK_ID, &ts) == -1) {
     LOG_ERROR(LOG_TAG, "%s unable to get current time: %s", __func__,
@@ -405,10 +421,10 @@ static period_ms_t now(void) {
   return (ts.tv_sec * 1000LL) + (ts.tv_nsec / 1000000LL);
 }
 
-// Remove alarm from internal alarm list and the processing queue
+// Remove alarm from internal alarm wheel and the processing queue
 // The caller must hold the |alarms_mutex|
 static void remove_pending_alarm(alarm_t* alarm) {
-  list_remove(alarms, alarm);
+  timer_wheel_remove(alarms, &alarm->entry);
 
   if (alarm->for_msg_loop) {
     alarm->closure.i.Cancel();
@@ -421,12 +437,14 @@ static void remove_pending_alarm(alarm_t* alarm) {
   }
 }
 
-// Must be called with |alarms_mutex| held
-static void schedule_next_instance(alarm_t* alarm) {
-  // If the alarm is currently set and it's at the start of the list,
-  // we'll need to re-schedule since we've adjusted the earliest deadline.
-  bool needs_reschedule =
-      (!list_is_empty(alarms) && list_front(alarms) == alarm);
+// Must be called with |alarms_mutex| held. Returns true if the earliest
+// deadline may have changed, in which case the caller must call
+// |reschedule_root_alarm|.
+static bool schedule_next_instance(alarm_t* alarm) {
+  // If the alarm is currently the one the timers are armed for, we'll need to
+  // re-schedule since we've adjusted the earliest deadline.
+  bool needs_reschedule = timer_wheel_entry_is_pending(&alarm->entry) &&
+                          alarm->deadline <= root_deadline;
   if (alarm->callback) remove_pending_alarm(alarm);
 
   // Calculate the next deadline for this alarm
@@ -436,28 +454,18 @@ static void schedule_next_instance(alarm_t* alarm) {
     ms_into_period = ((just_now - alarm->creation_time) % alarm->period);
   alarm->deadline = just_now + (alarm->period - ms_into_period);
 
-  // Add it into the timer list sorted by deadline (earliest deadline first).
-  if (list_is_empty(alarms) ||
-      ((alarm_t*)list_front(alarms))->deadline > alarm->deadline) {
-    list_prepend(alarms, alarm);
-  } else {
-    for (list_node_t* node = list_begin(alarms); node != list_end(alarms);
-         node = list_next(node)) {
-      list_node_t* next = list_next(node);
-      if (next == list_end(alarms) ||
-          ((alarm_t*)list_node(next))->deadline > alarm->deadline) {
-        list_insert_after(alarms, node, alarm);
-        break;
-      }
-    }
+  if (!alarm->is_periodic &&
+      alarm->period >= (period_ms_t)TIMER_INTERVAL_FOR_WAKELOCK_IN_MS) {
+    alarm->deadline += ALARM_COALESCE_WINDOW_MS - 1;
+    alarm->deadline -= alarm->deadline % ALARM_COALESCE_WINDOW_MS;
   }
 
+  timer_wheel_insert(alarms, &alarm->entry, alarm->deadline);
+
   // If the new alarm has the earliest deadline, we need to re-evaluate our
   // schedule.
-  if (needs_reschedule ||
-      (!list_is_empty(alarms) && list_front(alarms) == alarm)) {
-    reschedule_root_alarm();
-  }
+  return needs_reschedule || root_deadline == 0 ||
+         alarm->deadline < root_deadline;
 }
 
 // NOTE: must be called with |alarms_mutex| held
@@ -466,17 +474,16 @@ static void reschedule_root_alarm(void) {
   CHECK(alarms != NULL);
 
   const bool timer_was_set = timer_set;
-  alarm_t* next;
+  period_ms_t next_deadline = 0;
   int64_t next_expiration;
 
   // If used in a zeroed state, disarms the timer.
   struct itimerspec timer_time;
   memset(&timer_time, 0, sizeof(timer_time));
 
-  if (list_is_empty(alarms)) goto done;
+  if (!timer_wheel_next_deadline(alarms, &next_deadline)) goto done;
 
-  next = static_cast<alarm_t*>(list_front(alarms));
-  next_expiration = next->deadline - now();
+  next_expiration = next_deadline - now();
   if (next_expiration < TIMER_INTERVAL_FOR_WAKELOCK_IN_MS) {
     if (!timer_set) {
       if (!wakelock_acquire()) {
@@ -485,8 +492,8 @@ static void reschedule_root_alarm(void) {
       }
     }
 
-    timer_time.it_value.tv_sec = (next->deadline / 1000);
-    timer_time.it_value.tv_nsec = (next->deadline % 1000) * 1000000LL;
+    timer_time.it_value.tv_sec = (next_deadline / 1000);
+    timer_time.it_value.tv_nsec = (next_deadline % 1000) * 1000000LL;
 
     // It is entirely unsafe to call timer_settime(2) with a zeroed timerspec
     // for timers with *_ALARM clock IDs. Although the man page states that the
@@ -511,14 +518,15 @@ static void reschedule_root_alarm(void) {
     struct itimerspec wakeup_time;
     memset(&wakeup_time, 0, sizeof(wakeup_time));
 
-    wakeup_time.it_value.tv_sec = (next->deadline / 1000);
-    wakeup_time.it_value.tv_nsec = (next->deadline % 1000) * 1000000LL;
+    wakeup_time.it_value.tv_sec = (next_deadline / 1000);
+    wakeup_time.it_value.tv_nsec = (next_deadline % 1000) * 1000000LL;
     if (timer_settime(wakeup_timer, TIMER_ABSTIME, &wakeup_time, NULL) == -1)
       LOG_ERROR(LOG_TAG, "%s unable to set wakeup timer: %s", __func__,
                 strerror(errno));
   }
 
 done:
+  root_deadline = next_deadline;
   timer_set =
       timer_time.it_value.tv_sec != 0 || timer_time.it_value.tv_nsec != 0;
   if (timer_was_set && !timer_set) {
@@ -536,8 +544,7 @@ done:
   // milliseconds) and the timer expired normally before we called
   // |timer_gettime|. Worst case, |alarm_expired| is signaled twice for that
   // alarm. Nothing bad should happen in that case though since the callback
-  // dispatch function checks to make sure the timer at the head of the list
-  // actually expired.
+  // dispatch function only takes alarms whose deadline has actually passed.
   if (timer_set) {
     struct itimerspec time_to_expire;
     timer_gettime(timer, &time_to_expire);
@@ -613,48 +620,46 @@ static void timer_callback(UNUSED_ATTR void* ptr) {
 }
 
 // Function running on |dispatcher_thread| that performs the following:
-//   (1) Receives a signal using |alarm_exired| that the alarm has expired
-//   (2) Dispatches the alarm callback for processing by the corresponding
-// thread for that alarm.
+//   (1) Receives a signal using |alarm_exired| that an alarm has expired
+//   (2) Dispatches the callbacks of all expired alarms for processing by the
+// corresponding thread for each alarm, then re-arms the timers once.
 static void callback_dispatch(UNUSED_ATTR void* context) {
   while (true) {
     semaphore_wait(alarm_expired);
     if (!dispatcher_thread_active) break;
 
     std::lock_guard<std::mutex> lock(alarms_mutex);
-    alarm_t* alarm;
-
-    // Take into account that the alarm may get cancelled before we get to it.
-    // We're done here if there are no alarms or the alarm at the front is in
-    // the future. Exit right away since there's nothing left to do.
-    if (list_is_empty(alarms) ||
-        (alarm = static_cast<alarm_t*>(list_front(alarms)))->deadline > now()) {
-      reschedule_root_alarm();
-      continue;
-    }
 
-    list_remove(alarms, alarm);
-
-    if (alarm->is_periodic) {
-      alarm->prev_deadline = alarm->deadline;
-      schedule_next_instance(alarm);
-      alarm->stats.rescheduled_count++;
-    }
-    reschedule_root_alarm();
-
-    // Enqueue the alarm for processing
-    if (alarm->for_msg_loop) {
-      if (!get_message_loop()) {
-        LOG_ERROR(LOG_TAG, "%s: message loop already NULL. Alarm: %s", __func__,
-                  alarm->stats.name);
-        continue;
+    // Take into account that alarms may get cancelled before we get to them;
+    // the wheel only hands back the ones still pending whose deadline has
+    // passed, earliest first.
+    timer_wheel_entry_t* expired = timer_wheel_expire(alarms, now());
+    while (expired != NULL) {
+      alarm_t* alarm = static_cast<alarm_t*>(expired->data);
+      expired = expired->next;
+
+      if (alarm->is_periodic) {
+        alarm->prev_deadline = alarm->deadline;
+        schedule_next_instance(alarm);
+        alarm->stats.rescheduled_count++;
       }
 
-      alarm->closure.i.Reset(Bind(alarm_ready_mloop, alarm));
-      get_message_loop()->task_runner()->PostTask(FROM_HERE, alarm->closure.i.callback());
-    } else {
-      fixed_queue_enqueue(alarm->queue, alarm);
+      // Enqueue the alarm for processing
+      if (alarm->for_msg_loop) {
+        if (!get_message_loop()) {
+          LOG_ERROR(LOG_TAG, "%s: message loop already NULL. Alarm: %s",
+                    __func__, alarm->stats.name);
+          continue;
+        }
+
+        alarm->closure.i.Reset(Bind(alarm_ready_mloop, alarm));
+        get_message_loop()->task_runner()->PostTask(
+            FROM_HERE, alarm->closure.i.callback());
+      } else {
+        fixed_queue_enqueue(alarm->queue, alarm);
+      }
     }
+    reschedule_root_alarm();
   }
 
   LOG_DEBUG(LOG_TAG, "%s Callback thread exited", __func__);
@@ -725,53 +730,54 @@ static void dump_stat(int fd, stat_t* stat, const char* description) {
           (unsigned long long)average_time_ms);
 }
 
-void alarm_debug_dump(int fd) {
-  dprintf(fd, "\nBluetooth Alarms Statistics:\n");
+static bool dump_alarm(void* data, void* context) {
+  alarm_t* alarm = static_cast<alarm_t*>(data);
+  int fd = *static_cast<int*>(context);
+  alarm_stats_t* stats = &alarm->stats;
+  period_ms_t just_now = now();
 
-  std::lock_guard<std::mutex> lock(alarms_mutex);
+  dprintf(fd, "  Alarm : %s (%s)\n", stats->name,
+          (alarm->is_periodic) ? "PERIODIC" : "SINGLE");
 
-  if (alarms == NULL) {
-    dprintf(fd, "  None\n");
-    return;
-  }
+  dprintf(fd, "%-51s: %zu / %zu / %zu / %zu\n",
+          "    Action counts (sched/resched/exec/cancel)",
+          stats->scheduled_count, stats->rescheduled_count,
+          stats->callback_execution.count, stats->canceled_count);
 
-  period_ms_t just_now = now();
+  dprintf(fd, "%-51s: %zu / %zu\n", "    Deviation counts (overdue/premature)",
+          stats->overdue_scheduling.count, stats->premature_scheduling.count);
 
-  dprintf(fd, "  Total Alarms: %zu\n\n", list_length(alarms));
+  dprintf(fd, "%-51s: %llu / %llu / %lld\n",
+          "    Time in ms (since creation/interval/remaining)",
+          (unsigned long long)(just_now - alarm->creation_time),
+          (unsigned long long)alarm->period,
+          (long long)(alarm->deadline - just_now));
 
-  // Dump info for each alarm
-  for (list_node_t* node = list_begin(alarms); node != list_end(alarms);
-       node = list_next(node)) {
-    alarm_t* alarm = (alarm_t*)list_node(node);
-    alarm_stats_t* stats = &alarm->stats;
+  dump_stat(fd, &stats->callback_execution,
+            "    Callback execution time in ms (total/max/avg)");
 
-    dprintf(fd, "  Alarm : %s (%s)\n", stats->name,
-            (alarm->is_periodic) ? "PERIODIC" : "SINGLE");
+  dump_stat(fd, &stats->overdue_scheduling,
+            "    Overdue scheduling time in ms (total/max/avg)");
 
-    dprintf(fd, "%-51s: %zu / %zu / %zu / %zu\n",
-            "    Action counts (sched/resched/exec/cancel)",
-            stats->scheduled_count, stats->rescheduled_count,
-            stats->callback_execution.count, stats->canceled_count);
+  dump_stat(fd, &stats->premature_scheduling,
+            "    Premature scheduling time in ms (total/max/avg)");
 
-    dprintf(fd, "%-51s: %zu / %zu\n",
-            "    Deviation counts (overdue/premature)",
-            stats->overdue_scheduling.count, stats->premature_scheduling.count);
+  dprintf(fd, "\n");
+  return true;
+}
 
-    dprintf(fd, "%-51s: %llu / %llu / %lld\n",
-            "    Time in ms (since creation/interval/remaining)",
-            (unsigned long long)(just_now - alarm->creation_time),
-            (unsigned long long)alarm->period,
-            (long long)(alarm->deadline - just_now));
+void alarm_debug_dump(int fd) {
+  dprintf(fd, "\nBluetooth Alarms Statistics:\n");
 
-    dump_stat(fd, &stats->callback_execution,
-              "    Callback execution time in ms (total/max/avg)");
+  std::lock_guard<std::mutex> lock(alarms_mutex);
 
-    dump_stat(fd, &stats->overdue_scheduling,
-              "    Overdue scheduling time in ms (total/max/avg)");
+  if (alarms == NULL) {
+    dprintf(fd, "  None\n");
+    return;
+  }
 
-    dump_stat(fd, &stats->premature_scheduling,
-              "    Premature scheduling time in ms (total/max/avg)");
+  dprintf(fd, "  Total Alarms: %zu\n\n", timer_wheel_length(alarms));
 
-    dprintf(fd, "\n");
-  }
+  // Dump info for each alarm
+  timer_wheel_foreach(alarms, dump_alarm, &fd);
 }
@@ -21,13 +21,14 @@
 
 #include "osi/include/allocation_tracker.h"
 #include "osi/include/allocator.h"
+#include "osi/include/slab_allocator.h"
 
 static const allocator_id_t alloc_allocator_id = 42;
 
 char* osi_strdup(const char* str) {
   size_t size = strlen(str) + 1;  // + 1 for the null terminator
   size_t real_size = allocation_tracker_resize_for_canary(size);
-  void* ptr = malloc(real_size);
+  void* ptr = slab_allocator_alloc(real_size);
   CHECK(ptr);
 
   char* new_string = static_cast<char*>(
@@ -43,7 +44,7 @@ char* osi_strndup(const char* str, size_t len) {
   if (len < size) size = len;
 
   size_t real_size = allocation_tracker_resize_for_canary(size + 1);
-  void* ptr = malloc(real_size);
+  void* ptr = slab_allocator_alloc(real_size);
   CHECK(ptr);
 
   char* new_string = static_cast<char*>(
@@ -57,20 +58,21 @@ char* osi_strndup(const char* str, size_t len) {
 
 void* osi_malloc(size_t size) {
   size_t real_size = allocation_tracker_resize_for_canary(size);
-  void* ptr = malloc(real_size);
+  void* ptr = slab_allocator_alloc(real_size);
   CHECK(ptr);
   return allocation_tracker_notify_alloc(alloc_allocator_id, ptr, size);
 }
 
 void* osi_calloc(size_t size) {
   size_t real_size = allocation_tracker_resize_for_canary(size);
-  void* ptr = calloc(1, real_size);
+  void* ptr = slab_allocator_alloc(real_size);
   CHECK(ptr);
+  memset(ptr, 0, real_size);
   return allocation_tracker_notify_alloc(alloc_allocator_id, ptr, size);
 }
 
 void osi_free(void* ptr) {
-  free(allocation_tracker_notify_free(alloc_allocator_id, ptr));
+  slab_allocator_free(allocation_tracker_notify_free(alloc_allocator_id, ptr));
 }
 
 void osi_free_and_reset(void** p_ptr) {
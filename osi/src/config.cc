@@ -39,6 +39,23 @@
 #include "bt_target.h"
 #include <inttypes.h>
 
+// Open-addressing (linear probing) index from a name to the section or entry
+// that carries it. Names are not copied; each slot points at the indexed
+// object, whose list keeps the insertion order used by |config_save|.
+typedef struct {
+  uint32_t hash;
+  void* item;  // NULL if the slot is free
+} index_slot_t;
+
+typedef struct {
+  index_slot_t* slots;
+  size_t capacity;  // Always a power of two
+  size_t count;
+} name_index_t;
+
+#define SECTION_INDEX_INITIAL_CAPACITY 64
+#define ENTRY_INDEX_INITIAL_CAPACITY 16
+
 typedef struct {
   char* key;
   char* value;
@@ -47,10 +64,12 @@ typedef struct {
 typedef struct {
   char* name;
   list_t* entries;
+  name_index_t entry_index;
 } section_t;
 
 struct config_t {
   list_t* sections;
+  name_index_t section_index;
 };
 
 // Empty definition; this type is aliased to list_node_t.
@@ -58,6 +77,15 @@ struct config_section_iter_t {};
 
 static bool config_parse(FILE* fp, config_t* config);
 
+static void index_init(name_index_t* index, size_t capacity);
+static void index_free(name_index_t* index);
+template <typename T>
+static T* index_find(const name_index_t* index, const char* name);
+template <typename T>
+static void index_insert(name_index_t* index, T* item);
+template <typename T>
+static void index_remove(name_index_t* index, T* item);
+
 static section_t* section_new(const char* name);
 static void section_free(void* ptr);
 static section_t* section_find(const config_t* config, const char* section);
@@ -75,6 +103,7 @@ config_t* config_new_empty(void) {
     LOG_ERROR(LOG_TAG, "%s unable to allocate list for sections.", __func__);
     goto error;
   }
+  index_init(&config->section_index, SECTION_INDEX_INITIAL_CAPACITY);
 
   return config;
 
@@ -135,6 +164,7 @@ void config_free(config_t* config) {
   if (!config) return;
 
   list_free(config->sections);
+  index_free(&config->section_index);
   osi_free(config);
 }
 
@@ -270,9 +300,10 @@ void config_set_string(config_t* config, const char* section, const char* key,
   section_t* sec = section_find(config, section);
   if (!sec) {
     sec = section_new(section);
-    if (sec)
+    if (sec) {
       list_append(config->sections, sec);
-    else {
+      index_insert(&config->section_index, sec);
+    } else {
       LOG_ERROR(LOG_TAG,"%s: Unable to allocate memory for section", __func__);
     }
   }
@@ -288,18 +319,16 @@ void config_set_string(config_t* config, const char* section, const char* key,
   }
 
   if (sec) {
-    for (const list_node_t* node = list_begin(sec->entries);
-         node != list_end(sec->entries); node = list_next(node)) {
-      entry_t* entry = static_cast<entry_t*>(list_node(node));
-      if (!strcmp(entry->key, key)) {
-        osi_free(entry->value);
-        entry->value = osi_strdup(value_no_newline.c_str());
-        return;
-      }
+    entry_t* entry = index_find<entry_t>(&sec->entry_index, key);
+    if (entry) {
+      osi_free(entry->value);
+      entry->value = osi_strdup(value_no_newline.c_str());
+      return;
     }
 
-    entry_t* entry = entry_new(key, value_no_newline.c_str());
+    entry = entry_new(key, value_no_newline.c_str());
     list_append(sec->entries, entry);
+    index_insert(&sec->entry_index, entry);
   }
 }
 
@@ -310,6 +339,7 @@ bool config_remove_section(config_t* config, const char* section) {
   section_t* sec = section_find(config, section);
   if (!sec) return false;
 
+  index_remove(&config->section_index, sec);
   return list_remove(config->sections, sec);
 }
 
@@ -319,9 +349,12 @@ bool config_remove_key(config_t* config, const char* section, const char* key) {
   CHECK(key != NULL);
 
   section_t* sec = section_find(config, section);
-  entry_t* entry = entry_find(config, section, key);
-  if (!sec || !entry) return false;
+  if (!sec) return false;
+
+  entry_t* entry = index_find<entry_t>(&sec->entry_index, key);
+  if (!entry) return false;
 
+  index_remove(&sec->entry_index, entry);
   return list_remove(sec->entries, entry);
 }
 
@@ -383,6 +416,12 @@ void config_sections_sort_by_entry_key(config_t* config, compare_func comp) {
       p = q;
     }
 
+    // Keys were swapped between entries, so the index must be rebuilt.
+    index_free(&sec->entry_index);
+    index_init(&sec->entry_index, ENTRY_INDEX_INITIAL_CAPACITY);
+    for (list_node_t* enode = list_begin(sec->entries);
+         enode != list_end(sec->entries); enode = list_next(enode))
+      index_insert(&sec->entry_index, (entry_t*)list_node(enode));
   }
 }
 #endif
@@ -569,8 +608,10 @@ static bool config_parse(FILE* fp, config_t* config) {
 
         if(!section_find(config, comment)) {
             section_t *sec = section_new(comment);
-            if (sec)
+            if (sec) {
                 list_append(config->sections, sec);
+                index_insert(&config->section_index, sec);
+            }
         }
     } else if (*line_ptr == '[') {
       size_t len = strlen(line_ptr);
@@ -605,6 +646,7 @@ static section_t* section_new(const char* name) {
 
   section->name = osi_strdup(name);
   section->entries = list_new(entry_free);
+  index_init(&section->entry_index, ENTRY_INDEX_INITIAL_CAPACITY);
   return section;
 }
 
@@ -614,17 +656,12 @@ static void section_free(void* ptr) {
   section_t* section = static_cast<section_t*>(ptr);
   osi_free(section->name);
   list_free(section->entries);
+  index_free(&section->entry_index);
   osi_free(section);
 }
 
 static section_t* section_find(const config_t* config, const char* section) {
-  for (const list_node_t* node = list_begin(config->sections);
-       node != list_end(config->sections); node = list_next(node)) {
-    section_t* sec = static_cast<section_t*>(list_node(node));
-    if (sec && !strcmp(sec->name, section)) return sec;
-}
-
-  return NULL;
+  return index_find<section_t>(&config->section_index, section);
 }
 
 static entry_t* entry_new(const char* key, const char* value) {
@@ -649,11 +686,98 @@ static entry_t* entry_find(const config_t* config, const char* section,
   section_t* sec = section_find(config, section);
   if (!sec) return NULL;
 
-  for (const list_node_t* node = list_begin(sec->entries);
-       node != list_end(sec->entries); node = list_next(node)) {
-    entry_t* entry = static_cast<entry_t*>(list_node(node));
-    if (!strcmp(entry->key, key)) return entry;
+  return index_find<entry_t>(&sec->entry_index, key);
+}
+
+// FNV-1a
+static uint32_t name_hash(const char* name) {
+  uint32_t hash = 2166136261u;
+  for (const uint8_t* p = (const uint8_t*)name; *p; p++) {
+    hash ^= *p;
+    hash *= 16777619u;
   }
+  return hash;
+}
 
-  return NULL;
+static const char* item_name(const section_t* section) { return section->name; }
+
+static const char* item_name(const entry_t* entry) { return entry->key; }
+
+static void index_init(name_index_t* index, size_t capacity) {
+  index->slots =
+      static_cast<index_slot_t*>(osi_calloc(capacity * sizeof(index_slot_t)));
+  index->capacity = capacity;
+  index->count = 0;
+}
+
+static void index_free(name_index_t* index) {
+  osi_free(index->slots);
+  index->slots = NULL;
+  index->capacity = 0;
+  index->count = 0;
+}
+
+template <typename T>
+static T* index_find(const name_index_t* index, const char* name) {
+  uint32_t hash = name_hash(name);
+  size_t mask = index->capacity - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    const index_slot_t* slot = &index->slots[i];
+    if (!slot->item) return NULL;
+    if (slot->hash == hash &&
+        !strcmp(item_name(static_cast<T*>(slot->item)), name))
+      return static_cast<T*>(slot->item);
+  }
+}
+
+static void index_place(name_index_t* index, uint32_t hash, void* item) {
+  size_t mask = index->capacity - 1;
+  size_t i = hash & mask;
+  while (index->slots[i].item) i = (i + 1) & mask;
+  index->slots[i].hash = hash;
+  index->slots[i].item = item;
+}
+
+template <typename T>
+static void index_insert(name_index_t* index, T* item) {
+  // Keep the load factor below 3/4 so probe sequences stay short.
+  if ((index->count + 1) * 4 > index->capacity * 3) {
+    index_slot_t* old_slots = index->slots;
+    size_t old_capacity = index->capacity;
+    index->capacity *= 2;
+    index->slots = static_cast<index_slot_t*>(
+        osi_calloc(index->capacity * sizeof(index_slot_t)));
+    for (size_t i = 0; i < old_capacity; i++) {
+      if (old_slots[i].item)
+        index_place(index, old_slots[i].hash, old_slots[i].item);
+    }
+    osi_free(old_slots);
+  }
+
+  index_place(index, name_hash(item_name(item)), item);
+  index->count++;
+}
+
+template <typename T>
+static void index_remove(name_index_t* index, T* item) {
+  size_t mask = index->capacity - 1;
+  size_t i = name_hash(item_name(item)) & mask;
+  while (index->slots[i].item != item) {
+    CHECK(index->slots[i].item != NULL);
+    i = (i + 1) & mask;
+  }
+
+  // Backward-shift deletion: pull later members of the probe run into the
+  // hole so that lookups never need tombstones.
+  for (size_t j = (i + 1) & mask; index->slots[j].item; j = (j + 1) & mask) {
+    size_t home = index->slots[j].hash & mask;
+    // Move slot j into the hole at i unless its home lies cyclically in (i, j]
+    bool stays = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+    if (!stays) {
+      index->slots[i] = index->slots[j];
+      i = j;
+    }
+  }
+  index->slots[i].item = NULL;
+  index->count--;
 }
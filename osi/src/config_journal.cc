@@ -0,0 +1,252 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_osi_config_journal"
+
+#include "osi/include/config_journal.h"
+
+#include <base/logging.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "osi/include/allocator.h"
+#include "osi/include/log.h"
+#include "osi/include/osi.h"
+
+#define RECORD_GENERATION 'G'
+#define RECORD_SET 'S'
+#define RECORD_REMOVE 'R'
+
+// Longest record header: op, three lengths and separators.
+#define MAX_HEADER_LENGTH 64
+
+struct config_journal_t {
+  int fd;
+  size_t size;
+  std::string pending;
+};
+
+static void append_record(config_journal_t* journal, char op,
+                          const char* section, const char* key,
+                          const char* value) {
+  size_t section_len = strlen(section);
+  size_t key_len = strlen(key);
+  size_t value_len = strlen(value);
+
+  char header[MAX_HEADER_LENGTH];
+  snprintf(header, sizeof(header), "%c %zu %zu %zu\n", op, section_len,
+           key_len, value_len);
+
+  journal->pending.append(header);
+  journal->pending.append(section, section_len);
+  journal->pending.append(key, key_len);
+  journal->pending.append(value, value_len);
+  journal->pending.push_back('\n');
+}
+
+config_journal_t* config_journal_new(const char* filename) {
+  CHECK(filename != NULL);
+
+  int fd;
+  OSI_NO_INTR(fd = open(filename, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+                        S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP));
+  if (fd == INVALID_FD) {
+    LOG_ERROR(LOG_TAG, "%s unable to open '%s': %s", __func__, filename,
+              strerror(errno));
+    return NULL;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) == -1) {
+    LOG_ERROR(LOG_TAG, "%s unable to stat '%s': %s", __func__, filename,
+              strerror(errno));
+    close(fd);
+    return NULL;
+  }
+
+  config_journal_t* journal = new config_journal_t();
+  journal->fd = fd;
+  journal->size = st.st_size;
+  return journal;
+}
+
+void config_journal_free(config_journal_t* journal) {
+  if (!journal) return;
+
+  close(journal->fd);
+  delete journal;
+}
+
+void config_journal_set(config_journal_t* journal, const char* section,
+                        const char* key, const char* value) {
+  CHECK(journal != NULL);
+  CHECK(section != NULL);
+  CHECK(key != NULL);
+  CHECK(value != NULL);
+
+  append_record(journal, RECORD_SET, section, key, value);
+}
+
+void config_journal_remove(config_journal_t* journal, const char* section,
+                           const char* key) {
+  CHECK(journal != NULL);
+  CHECK(section != NULL);
+  CHECK(key != NULL);
+
+  append_record(journal, RECORD_REMOVE, section, key, "");
+}
+
+bool config_journal_has_pending(const config_journal_t* journal) {
+  CHECK(journal != NULL);
+  return !journal->pending.empty();
+}
+
+bool config_journal_flush(config_journal_t* journal) {
+  CHECK(journal != NULL);
+
+  if (journal->pending.empty()) return true;
+
+  const char* data = journal->pending.data();
+  size_t remaining = journal->pending.size();
+  while (remaining > 0) {
+    ssize_t ret;
+    OSI_NO_INTR(ret = write(journal->fd, data, remaining));
+    if (ret == -1) {
+      LOG_ERROR(LOG_TAG, "%s unable to write journal: %s", __func__,
+                strerror(errno));
+      return false;
+    }
+    data += ret;
+    remaining -= ret;
+    journal->size += ret;
+  }
+  journal->pending.clear();
+
+  if (fdatasync(journal->fd) == -1) {
+    LOG_WARN(LOG_TAG, "%s unable to sync journal: %s", __func__,
+             strerror(errno));
+  }
+  return true;
+}
+
+size_t config_journal_size(const config_journal_t* journal) {
+  CHECK(journal != NULL);
+  return journal->size;
+}
+
+bool config_journal_reset(config_journal_t* journal, uint64_t generation) {
+  CHECK(journal != NULL);
+
+  journal->pending.clear();
+  int ret;
+  OSI_NO_INTR(ret = ftruncate(journal->fd, 0));
+  if (ret == -1) {
+    LOG_ERROR(LOG_TAG, "%s unable to truncate journal: %s", __func__,
+              strerror(errno));
+    return false;
+  }
+  journal->size = 0;
+
+  char header[MAX_HEADER_LENGTH];
+  snprintf(header, sizeof(header), "%c %" PRIu64 "\n", RECORD_GENERATION,
+           generation);
+  journal->pending.append(header);
+  return config_journal_flush(journal);
+}
+
+size_t config_journal_replay(const char* filename, uint64_t generation,
+                             config_t* config) {
+  CHECK(filename != NULL);
+  CHECK(config != NULL);
+
+  FILE* fp = fopen(filename, "rb");
+  if (!fp) return 0;
+
+  std::string contents;
+  char buffer[4096];
+  size_t read;
+  while ((read = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+    contents.append(buffer, read);
+  fclose(fp);
+
+  // Records written on top of another full save must not be applied to this
+  // one, such as those left behind by a crash before the journal was reset.
+  char header[MAX_HEADER_LENGTH];
+  snprintf(header, sizeof(header), "%c %" PRIu64 "\n", RECORD_GENERATION,
+           generation);
+  if (contents.compare(0, strlen(header), header) != 0) {
+    if (!contents.empty()) {
+      LOG_WARN(LOG_TAG, "%s ignoring '%s', not written for generation %" PRIu64,
+               __func__, filename, generation);
+    }
+    return 0;
+  }
+
+  size_t applied = 0;
+  size_t offset = strlen(header);
+  while (offset < contents.size()) {
+    size_t header_end = contents.find('\n', offset);
+    if (header_end == std::string::npos ||
+        header_end - offset >= MAX_HEADER_LENGTH)
+      break;
+
+    char op;
+    size_t section_len, key_len, value_len;
+    std::string header = contents.substr(offset, header_end - offset);
+    if (sscanf(header.c_str(), "%c %zu %zu %zu", &op, &section_len, &key_len,
+               &value_len) != 4)
+      break;
+    if (op != RECORD_SET && op != RECORD_REMOVE) break;
+
+    size_t payload = header_end + 1;
+    size_t available = contents.size() - payload;
+    if (section_len > available || key_len > available ||
+        value_len > available)
+      break;
+    size_t payload_len = section_len + key_len + value_len;
+    if (payload_len >= available || contents[payload + payload_len] != '\n')
+      break;
+
+    std::string section = contents.substr(payload, section_len);
+    std::string key = contents.substr(payload + section_len, key_len);
+    if (op == RECORD_SET) {
+      std::string value =
+          contents.substr(payload + section_len + key_len, value_len);
+      config_set_string(config, section.c_str(), key.c_str(), value.c_str());
+    } else {
+      config_remove_key(config, section.c_str(), key.c_str());
+    }
+
+    applied++;
+    offset = payload + payload_len + 1;
+  }
+
+  if (offset < contents.size()) {
+    LOG_WARN(LOG_TAG, "%s ignoring %zu trailing bytes of '%s'", __func__,
+             contents.size() - offset, filename);
+  }
+
+  return applied;
+}
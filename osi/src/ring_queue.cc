@@ -0,0 +1,338 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_osi_ring_queue"
+
+#include "osi/include/ring_queue.h"
+
+#include <base/logging.h>
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+#include "osi/include/log.h"
+#include "osi/include/osi.h"
+#include "osi/include/reactor.h"
+
+// Bounded queue after Dmitry Vyukov's sequence-numbered ring: each cell
+// carries the position at which it may next be written (|pos|) or read
+// (|pos| + 1), which lets producers claim slots with a single CAS.
+typedef struct {
+  std::atomic<size_t> sequence;
+  void* data;
+} cell_t;
+
+#define CACHE_LINE_SIZE 64
+
+struct ring_queue_t {
+  cell_t* cells;
+  size_t mask;
+
+  // Producer and consumer positions are kept on separate cache lines.
+  uint8_t pad0[CACHE_LINE_SIZE];
+  std::atomic<size_t> enqueue_pos;
+  uint8_t pad1[CACHE_LINE_SIZE];
+  std::atomic<size_t> dequeue_pos;
+  uint8_t pad2[CACHE_LINE_SIZE];
+
+  // True while |dequeue_fd| is (or is about to be) readable.
+  std::atomic<bool> signalled;
+  int dequeue_fd;
+
+  // Slow path for producers that find the ring full.
+  std::mutex full_mutex;
+  std::condition_variable full_cv;
+  std::atomic<int> blocked_producers;
+
+  reactor_object_t* dequeue_object;
+  ring_queue_cb dequeue_ready;
+  void* dequeue_context;
+};
+
+static void internal_dequeue_ready(void* context);
+
+static size_t round_up_pow2(size_t value) {
+  size_t result = 1;
+  while (result < value) result <<= 1;
+  return result;
+}
+
+static bool ring_push(ring_queue_t* queue, void* data) {
+  size_t pos = queue->enqueue_pos.load(std::memory_order_relaxed);
+  cell_t* cell;
+  for (;;) {
+    cell = &queue->cells[pos & queue->mask];
+    size_t seq = cell->sequence.load(std::memory_order_acquire);
+    intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+    if (diff == 0) {
+      if (queue->enqueue_pos.compare_exchange_weak(pos, pos + 1,
+                                                   std::memory_order_relaxed))
+        break;
+    } else if (diff < 0) {
+      return false;  // Full
+    } else {
+      pos = queue->enqueue_pos.load(std::memory_order_relaxed);
+    }
+  }
+
+  cell->data = data;
+  cell->sequence.store(pos + 1, std::memory_order_release);
+  return true;
+}
+
+static void* ring_pop(ring_queue_t* queue) {
+  size_t pos = queue->dequeue_pos.load(std::memory_order_relaxed);
+  cell_t* cell;
+  for (;;) {
+    cell = &queue->cells[pos & queue->mask];
+    size_t seq = cell->sequence.load(std::memory_order_acquire);
+    intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+    if (diff == 0) {
+      if (queue->dequeue_pos.compare_exchange_weak(pos, pos + 1,
+                                                   std::memory_order_relaxed))
+        break;
+    } else if (diff < 0) {
+      return NULL;  // Empty
+    } else {
+      pos = queue->dequeue_pos.load(std::memory_order_relaxed);
+    }
+  }
+
+  void* data = cell->data;
+  cell->sequence.store(pos + queue->mask + 1, std::memory_order_release);
+  return data;
+}
+
+static bool ring_has_data(ring_queue_t* queue) {
+  size_t pos = queue->dequeue_pos.load(std::memory_order_relaxed);
+  cell_t* cell = &queue->cells[pos & queue->mask];
+  return cell->sequence.load(std::memory_order_acquire) == pos + 1;
+}
+
+// Makes |dequeue_fd| readable unless it already is. Called by producers
+// after publishing an element.
+static void signal_not_empty(ring_queue_t* queue) {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (queue->signalled.load(std::memory_order_relaxed)) return;
+  if (queue->signalled.exchange(true)) return;
+
+  if (eventfd_write(queue->dequeue_fd, 1ULL) == -1)
+    LOG_ERROR(LOG_TAG, "%s unable to signal queue: %s", __func__,
+              strerror(errno));
+}
+
+// Clears |dequeue_fd| once the consumer has drained the queue. An
+// element published concurrently is caught by the re-check and re-arms the
+// descriptor, so no wakeup is lost.
+static void clear_not_empty(ring_queue_t* queue) {
+  eventfd_t value;
+  eventfd_read(queue->dequeue_fd, &value);  // EAGAIN if already clear
+  queue->signalled.store(false, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (ring_has_data(queue)) signal_not_empty(queue);
+}
+
+static void wake_blocked_producers(ring_queue_t* queue) {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (queue->blocked_producers.load(std::memory_order_relaxed) == 0) return;
+
+  std::lock_guard<std::mutex> lock(queue->full_mutex);
+  queue->full_cv.notify_all();
+}
+
+ring_queue_t* ring_queue_new(size_t capacity) {
+  CHECK(capacity <= RING_QUEUE_MAX_CAPACITY);
+
+  size_t size = round_up_pow2(capacity);
+  ring_queue_t* ret = new ring_queue_t();
+
+  ret->dequeue_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (ret->dequeue_fd == INVALID_FD) {
+    LOG_ERROR(LOG_TAG, "%s unable to create eventfd: %s", __func__,
+              strerror(errno));
+    delete ret;
+    return NULL;
+  }
+
+  ret->cells = new cell_t[size];
+  for (size_t i = 0; i < size; i++)
+    ret->cells[i].sequence.store(i, std::memory_order_relaxed);
+  ret->mask = size - 1;
+  ret->enqueue_pos = 0;
+  ret->dequeue_pos = 0;
+  ret->signalled = false;
+  ret->blocked_producers = 0;
+  return ret;
+}
+
+void ring_queue_free(ring_queue_t* queue, ring_queue_free_cb free_cb) {
+  if (!queue) return;
+
+  ring_queue_unregister_dequeue(queue);
+  ring_queue_flush(queue, free_cb);
+
+  close(queue->dequeue_fd);
+  delete[] queue->cells;
+  delete queue;
+}
+
+void ring_queue_flush(ring_queue_t* queue, ring_queue_free_cb free_cb) {
+  if (!queue) return;
+
+  void* data;
+  while ((data = ring_queue_try_dequeue(queue)) != NULL) {
+    if (free_cb != NULL) free_cb(data);
+  }
+}
+
+bool ring_queue_is_empty(ring_queue_t* queue) {
+  if (queue == NULL) return true;
+
+  return ring_queue_length(queue) == 0;
+}
+
+size_t ring_queue_length(ring_queue_t* queue) {
+  if (queue == NULL) return 0;
+
+  // Read the consumer side first so a concurrent dequeue can only make the
+  // result larger than reality, never underflow.
+  size_t dequeue_pos = queue->dequeue_pos.load(std::memory_order_acquire);
+  size_t enqueue_pos = queue->enqueue_pos.load(std::memory_order_acquire);
+  return enqueue_pos - dequeue_pos;
+}
+
+size_t ring_queue_capacity(ring_queue_t* queue) {
+  CHECK(queue != NULL);
+
+  return queue->mask + 1;
+}
+
+void ring_queue_enqueue(ring_queue_t* queue, void* data) {
+  CHECK(queue != NULL);
+  CHECK(data != NULL);
+
+  if (!ring_push(queue, data)) {
+    std::unique_lock<std::mutex> lock(queue->full_mutex);
+    queue->blocked_producers.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    while (!ring_push(queue, data)) queue->full_cv.wait(lock);
+    queue->blocked_producers.fetch_sub(1);
+  }
+
+  signal_not_empty(queue);
+}
+
+void* ring_queue_dequeue(ring_queue_t* queue) {
+  CHECK(queue != NULL);
+
+  for (;;) {
+    void* ret = ring_queue_try_dequeue(queue);
+    if (ret != NULL) return ret;
+
+    clear_not_empty(queue);
+    if (ring_has_data(queue)) continue;
+
+    struct pollfd pfd = {.fd = queue->dequeue_fd, .events = POLLIN};
+    int rc;
+    OSI_NO_INTR(rc = poll(&pfd, 1, -1));
+    if (rc == -1)
+      LOG_ERROR(LOG_TAG, "%s unable to wait on queue: %s", __func__,
+                strerror(errno));
+  }
+}
+
+bool ring_queue_try_enqueue(ring_queue_t* queue, void* data) {
+  CHECK(queue != NULL);
+  CHECK(data != NULL);
+
+  if (!ring_push(queue, data)) return false;
+
+  signal_not_empty(queue);
+  return true;
+}
+
+void* ring_queue_try_dequeue(ring_queue_t* queue) {
+  if (queue == NULL) return NULL;
+
+  void* ret = ring_pop(queue);
+  if (ret == NULL) return NULL;
+
+  wake_blocked_producers(queue);
+  if (!ring_has_data(queue)) clear_not_empty(queue);
+  return ret;
+}
+
+void* ring_queue_try_peek_first(ring_queue_t* queue) {
+  if (queue == NULL) return NULL;
+
+  size_t pos = queue->dequeue_pos.load(std::memory_order_relaxed);
+  cell_t* cell = &queue->cells[pos & queue->mask];
+  if (cell->sequence.load(std::memory_order_acquire) != pos + 1) return NULL;
+  return cell->data;
+}
+
+int ring_queue_get_dequeue_fd(const ring_queue_t* queue) {
+  CHECK(queue != NULL);
+  return queue->dequeue_fd;
+}
+
+void ring_queue_register_dequeue(ring_queue_t* queue, reactor_t* reactor,
+                                 ring_queue_cb ready_cb, void* context) {
+  CHECK(queue != NULL);
+  CHECK(reactor != NULL);
+  CHECK(ready_cb != NULL);
+
+  // Make sure we're not already registered
+  ring_queue_unregister_dequeue(queue);
+
+  queue->dequeue_ready = ready_cb;
+  queue->dequeue_context = context;
+  queue->dequeue_object =
+      reactor_register(reactor, ring_queue_get_dequeue_fd(queue), queue,
+                       internal_dequeue_ready, NULL);
+}
+
+void ring_queue_unregister_dequeue(ring_queue_t* queue) {
+  CHECK(queue != NULL);
+
+  if (queue->dequeue_object) {
+    reactor_unregister(queue->dequeue_object);
+    queue->dequeue_object = NULL;
+  }
+}
+
+static void internal_dequeue_ready(void* context) {
+  CHECK(context != NULL);
+
+  ring_queue_t* queue = static_cast<ring_queue_t*>(context);
+
+  // The descriptor stays readable for as long as the queue is non-empty, so
+  // the reactor keeps calling back once per element. Readiness can be stale
+  // if the consumer drained the queue through another path.
+  if (ring_has_data(queue)) {
+    queue->dequeue_ready(queue, queue->dequeue_context);
+  } else {
+    clear_not_empty(queue);
+  }
+}
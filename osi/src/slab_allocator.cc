@@ -0,0 +1,335 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_osi_slab_allocator"
+
+#include "osi/include/slab_allocator.h"
+
+#include <base/logging.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+
+#include "osi/include/log.h"
+#include "osi/include/osi.h"
+
+// Every block, slab backed or not, is preceded by this header so that
+// |slab_allocator_free| can find its way back to the owning size class.
+typedef struct {
+  uint32_t magic;
+  uint32_t size_class;
+  uint64_t reserved;  // Keeps the user pointer 16-byte aligned
+} block_header_t;
+
+static_assert(sizeof(block_header_t) == 16, "block header must be 16 bytes");
+
+// Free blocks are chained through their own storage.
+typedef struct free_block_t {
+  struct free_block_t* next;
+} free_block_t;
+
+static const uint32_t kBlockMagic = 0x51ab51ab;
+static const uint32_t kLargeClass = UINT32_MAX;
+
+// Usable sizes of the slab classes. 4160 covers a BT_DEFAULT_BUFFER_SIZE
+// (4096 + 16) buffer together with the allocation tracker canaries.
+static const size_t kClassSizes[] = {64,   128,  256,  512,  1024,
+                                     2048, 4160, 8192, 16384};
+static const size_t kNumClasses = sizeof(kClassSizes) / sizeof(kClassSizes[0]);
+
+static const size_t kMinSlabSize = 64 * 1024;
+static const size_t kMinBlocksPerSlab = 8;
+
+// Upper bound on blocks cached per class per thread.
+#define THREAD_CACHE_MAX 32
+
+typedef struct {
+  std::mutex lock;
+  free_block_t* free_list;  // Guarded by |lock|
+  size_t free_count;        // Guarded by |lock|
+  size_t stride;            // Header + usable size
+  size_t blocks_per_slab;
+  size_t thread_cache_limit;
+
+  std::atomic<uint64_t> hits;
+  std::atomic<uint64_t> misses;
+  std::atomic<size_t> in_use;
+  std::atomic<size_t> high_water;
+  std::atomic<size_t> slabs;
+} size_class_pool_t;
+
+typedef struct {
+  void* blocks[THREAD_CACHE_MAX];
+  size_t count;
+} thread_class_cache_t;
+
+// Kept trivially destructible on purpose: other thread-local destructors may
+// still call osi_free() after our pthread key destructor has flushed the cache.
+typedef struct {
+  thread_class_cache_t classes[kNumClasses];
+  bool registered;
+  bool exiting;
+} thread_cache_t;
+
+static thread_local thread_cache_t tls_cache;
+
+static std::atomic<uint64_t> large_allocations(0);
+static pthread_key_t cache_key;
+static pthread_once_t cache_key_once = PTHREAD_ONCE_INIT;
+
+static void thread_cache_release(void* context);
+
+// Deliberately leaked so that allocations made during static destruction
+// still have somewhere to go.
+static size_class_pool_t* get_pools() {
+  static size_class_pool_t* pools = [] {
+    size_class_pool_t* p = new size_class_pool_t[kNumClasses];
+    for (size_t i = 0; i < kNumClasses; i++) {
+      p[i].free_list = NULL;
+      p[i].free_count = 0;
+      p[i].stride = sizeof(block_header_t) + kClassSizes[i];
+      p[i].blocks_per_slab = kMinSlabSize / p[i].stride;
+      if (p[i].blocks_per_slab < kMinBlocksPerSlab)
+        p[i].blocks_per_slab = kMinBlocksPerSlab;
+      p[i].thread_cache_limit = p[i].blocks_per_slab / 2;
+      if (p[i].thread_cache_limit > THREAD_CACHE_MAX)
+        p[i].thread_cache_limit = THREAD_CACHE_MAX;
+      p[i].hits = 0;
+      p[i].misses = 0;
+      p[i].in_use = 0;
+      p[i].high_water = 0;
+      p[i].slabs = 0;
+    }
+    return p;
+  }();
+  return pools;
+}
+
+static void create_cache_key() {
+  CHECK(pthread_key_create(&cache_key, thread_cache_release) == 0);
+}
+
+static size_t size_to_class(size_t size) {
+  for (size_t i = 0; i < kNumClasses; i++) {
+    if (size <= kClassSizes[i]) return i;
+  }
+  return kNumClasses;
+}
+
+static void note_in_use(size_class_pool_t* pool) {
+  size_t in_use = pool->in_use.fetch_add(1, std::memory_order_relaxed) + 1;
+  size_t high_water = pool->high_water.load(std::memory_order_relaxed);
+  while (in_use > high_water &&
+         !pool->high_water.compare_exchange_weak(high_water, in_use,
+                                                 std::memory_order_relaxed)) {
+  }
+}
+
+// Carves a new slab for |pool| and threads all of its blocks onto the free
+// list. Must be called with |pool->lock| held.
+static void carve_slab_locked(size_class_pool_t* pool, uint32_t size_class) {
+  uint8_t* slab =
+      static_cast<uint8_t*>(malloc(pool->stride * pool->blocks_per_slab));
+  CHECK(slab);
+
+  for (size_t i = 0; i < pool->blocks_per_slab; i++) {
+    block_header_t* header =
+        reinterpret_cast<block_header_t*>(slab + (i * pool->stride));
+    header->magic = kBlockMagic;
+    header->size_class = size_class;
+    free_block_t* block = reinterpret_cast<free_block_t*>(header + 1);
+    block->next = pool->free_list;
+    pool->free_list = block;
+  }
+  pool->free_count += pool->blocks_per_slab;
+  pool->slabs.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Moves up to |max| blocks from the shared pool into |out|. Returns the number
+// of blocks moved, which is always at least one.
+static size_t pool_take(size_class_pool_t* pool, uint32_t size_class,
+                        void** out, size_t max) {
+  std::lock_guard<std::mutex> lock(pool->lock);
+  if (pool->free_list == NULL) {
+    pool->misses.fetch_add(1, std::memory_order_relaxed);
+    carve_slab_locked(pool, size_class);
+  } else {
+    pool->hits.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  size_t taken = 0;
+  while (taken < max && pool->free_list != NULL) {
+    free_block_t* block = pool->free_list;
+    pool->free_list = block->next;
+    out[taken++] = block;
+  }
+  pool->free_count -= taken;
+  return taken;
+}
+
+static void pool_give(size_class_pool_t* pool, void** blocks, size_t count) {
+  std::lock_guard<std::mutex> lock(pool->lock);
+  for (size_t i = 0; i < count; i++) {
+    free_block_t* block = static_cast<free_block_t*>(blocks[i]);
+    block->next = pool->free_list;
+    pool->free_list = block;
+  }
+  pool->free_count += count;
+}
+
+static thread_cache_t* get_thread_cache() {
+  thread_cache_t* cache = &tls_cache;
+  if (cache->exiting) return NULL;
+
+  if (!cache->registered) {
+    pthread_once(&cache_key_once, create_cache_key);
+    // The value only needs to be non-NULL for the destructor to run.
+    pthread_setspecific(cache_key, cache);
+    cache->registered = true;
+  }
+  return cache;
+}
+
+static void thread_cache_release(UNUSED_ATTR void* context) {
+  slab_allocator_flush_thread_cache();
+  tls_cache.exiting = true;
+}
+
+void* slab_allocator_alloc(size_t size) {
+  size_t size_class = size_to_class(size);
+
+  if (size_class == kNumClasses) {
+    block_header_t* header =
+        static_cast<block_header_t*>(malloc(sizeof(block_header_t) + size));
+    CHECK(header);
+    header->magic = kBlockMagic;
+    header->size_class = kLargeClass;
+    large_allocations.fetch_add(1, std::memory_order_relaxed);
+    return header + 1;
+  }
+
+  size_class_pool_t* pool = &get_pools()[size_class];
+  void* block;
+
+  thread_cache_t* cache = get_thread_cache();
+  if (cache != NULL) {
+    thread_class_cache_t* class_cache = &cache->classes[size_class];
+    if (class_cache->count == 0) {
+      class_cache->count = pool_take(pool, size_class, class_cache->blocks,
+                                     pool->thread_cache_limit);
+    } else {
+      pool->hits.fetch_add(1, std::memory_order_relaxed);
+    }
+    block = class_cache->blocks[--class_cache->count];
+  } else {
+    pool_take(pool, size_class, &block, 1);
+  }
+
+  note_in_use(pool);
+  return block;
+}
+
+void slab_allocator_free(void* ptr) {
+  if (ptr == NULL) return;
+
+  block_header_t* header = static_cast<block_header_t*>(ptr) - 1;
+  CHECK(header->magic == kBlockMagic);
+
+  if (header->size_class == kLargeClass) {
+    free(header);
+    return;
+  }
+
+  CHECK(header->size_class < kNumClasses);
+  size_class_pool_t* pool = &get_pools()[header->size_class];
+  pool->in_use.fetch_sub(1, std::memory_order_relaxed);
+
+  thread_cache_t* cache = get_thread_cache();
+  if (cache == NULL) {
+    pool_give(pool, &ptr, 1);
+    return;
+  }
+
+  thread_class_cache_t* class_cache = &cache->classes[header->size_class];
+  if (class_cache->count == pool->thread_cache_limit) {
+    // Hand the older half back so that producer/consumer thread pairs do not
+    // pin every block in the consumer's cache.
+    size_t half = class_cache->count / 2;
+    pool_give(pool, class_cache->blocks, half);
+    memmove(class_cache->blocks, class_cache->blocks + half,
+            (class_cache->count - half) * sizeof(void*));
+    class_cache->count -= half;
+  }
+  class_cache->blocks[class_cache->count++] = ptr;
+}
+
+void slab_allocator_flush_thread_cache(void) {
+  thread_cache_t* cache = &tls_cache;
+  size_class_pool_t* pools = get_pools();
+  for (size_t i = 0; i < kNumClasses; i++) {
+    thread_class_cache_t* class_cache = &cache->classes[i];
+    if (class_cache->count == 0) continue;
+    pool_give(&pools[i], class_cache->blocks, class_cache->count);
+    class_cache->count = 0;
+  }
+}
+
+size_t slab_allocator_num_classes(void) { return kNumClasses; }
+
+bool slab_allocator_get_class_stats(size_t index,
+                                    slab_allocator_class_stats_t* stats) {
+  CHECK(stats != NULL);
+  if (index >= kNumClasses) return false;
+
+  size_class_pool_t* pool = &get_pools()[index];
+  stats->block_size = kClassSizes[index];
+  stats->hits = pool->hits.load(std::memory_order_relaxed);
+  stats->misses = pool->misses.load(std::memory_order_relaxed);
+  stats->in_use = pool->in_use.load(std::memory_order_relaxed);
+  stats->high_water = pool->high_water.load(std::memory_order_relaxed);
+  stats->slabs = pool->slabs.load(std::memory_order_relaxed);
+  return true;
+}
+
+uint64_t slab_allocator_get_large_allocations(void) {
+  return large_allocations.load(std::memory_order_relaxed);
+}
+
+void slab_allocator_debug_dump(int fd) {
+  dprintf(fd, "\nBluetooth Slab Allocator Statistics:\n");
+  dprintf(fd, "  %8s %12s %10s %8s %10s %6s %10s\n", "block", "hits",
+          "misses", "in use", "high water", "slabs", "retained");
+
+  size_t retained_total = 0;
+  for (size_t i = 0; i < kNumClasses; i++) {
+    slab_allocator_class_stats_t stats;
+    slab_allocator_get_class_stats(i, &stats);
+    size_t retained = stats.slabs * get_pools()[i].blocks_per_slab *
+                      get_pools()[i].stride;
+    retained_total += retained;
+    dprintf(fd, "  %8zu %12llu %10llu %8zu %10zu %6zu %10zu\n",
+            stats.block_size, (unsigned long long)stats.hits,
+            (unsigned long long)stats.misses, stats.in_use, stats.high_water,
+            stats.slabs, retained);
+  }
+  dprintf(fd, "  Total slab octets retained       : %zu\n", retained_total);
+  dprintf(fd, "  Large (system malloc) allocations: %llu\n",
+          (unsigned long long)slab_allocator_get_large_allocations());
+}
@@ -0,0 +1,341 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "osi/include/timer_wheel.h"
+
+#include <base/logging.h>
+
+#include "osi/include/allocator.h"
+
+// Each level has 64 slots, tracked by one bit each in |bitmap|. A slot at
+// level L spans 64^L ticks, so six levels cover 2^36 ms (about two years);
+// anything further out is parked in the last level and re-examined when that
+// slot is cascaded.
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 6
+#define WHEEL_MAX_DELTA ((1ULL << (WHEEL_BITS * WHEEL_LEVELS)) - 1)
+
+#define NO_SLOT 0xFFFF
+
+typedef struct {
+  timer_wheel_entry_t* head;
+  timer_wheel_entry_t* tail;
+  // Cached earliest deadline in the slot; recomputed lazily after the entry
+  // holding it is removed.
+  uint64_t min_deadline;
+  bool min_valid;
+} slot_t;
+
+struct timer_wheel_t {
+  // Every deadline before |next_tick| has been expired.
+  uint64_t next_tick;
+  uint64_t next_sequence;
+  size_t count;
+  uint64_t bitmap[WHEEL_LEVELS];
+  slot_t slots[WHEEL_LEVELS][WHEEL_SLOTS];
+};
+
+static_assert(WHEEL_LEVELS * WHEEL_SLOTS < NO_SLOT,
+              "slot numbers must fit in timer_wheel_entry_t::slot");
+
+static bool entry_before(const timer_wheel_entry_t* a,
+                         const timer_wheel_entry_t* b) {
+  if (a->deadline != b->deadline) return a->deadline < b->deadline;
+  return a->sequence < b->sequence;
+}
+
+// Index of the first occupied slot at or after |start|, wrapping around.
+// |bitmap| may not be zero.
+static int first_slot_from(uint64_t bitmap, int start) {
+  uint64_t rotated =
+      (bitmap >> start) | (bitmap << ((WHEEL_SLOTS - start) & WHEEL_MASK));
+  return __builtin_ctzll(rotated);
+}
+
+static slot_t* slot_of(timer_wheel_t* wheel, uint16_t slot) {
+  return &wheel->slots[slot >> WHEEL_BITS][slot & WHEEL_MASK];
+}
+
+// Links |entry| into the slot matching its deadline relative to |next_tick|.
+static void place(timer_wheel_t* wheel, timer_wheel_entry_t* entry) {
+  uint64_t deadline = entry->deadline;
+  if (deadline < wheel->next_tick) deadline = wheel->next_tick;
+
+  uint64_t delta = deadline - wheel->next_tick;
+  if (delta > WHEEL_MAX_DELTA) {
+    delta = WHEEL_MAX_DELTA;
+    deadline = wheel->next_tick + WHEEL_MAX_DELTA;
+  }
+
+  int level = 0;
+  while (delta >> (WHEEL_BITS * (level + 1))) level++;
+  int index = (deadline >> (WHEEL_BITS * level)) & WHEEL_MASK;
+  slot_t* slot = &wheel->slots[level][index];
+
+  // Slots at level 0 are kept sorted so that overdue entries come first and
+  // ties expire in insertion order. New entries carry the highest sequence
+  // number, so this is an append unless the entry was cascaded.
+  timer_wheel_entry_t* after = slot->tail;
+  if (level == 0) {
+    while (after && entry_before(entry, after)) after = after->prev;
+  }
+
+  entry->prev = after;
+  entry->next = after ? after->next : slot->head;
+  if (entry->next)
+    entry->next->prev = entry;
+  else
+    slot->tail = entry;
+  if (after)
+    after->next = entry;
+  else
+    slot->head = entry;
+
+  if (!(wheel->bitmap[level] & (1ULL << index))) {
+    wheel->bitmap[level] |= 1ULL << index;
+    slot->min_deadline = entry->deadline;
+    slot->min_valid = true;
+  } else if (slot->min_valid && entry->deadline < slot->min_deadline) {
+    slot->min_deadline = entry->deadline;
+  }
+
+  entry->slot = (level << WHEEL_BITS) | index;
+}
+
+// Detaches and returns the list in |slot|, leaving it empty.
+static timer_wheel_entry_t* take_slot(timer_wheel_t* wheel, int level,
+                                      int index) {
+  slot_t* slot = &wheel->slots[level][index];
+  timer_wheel_entry_t* head = slot->head;
+  slot->head = slot->tail = NULL;
+  slot->min_valid = false;
+  wheel->bitmap[level] &= ~(1ULL << index);
+  return head;
+}
+
+static uint64_t slot_min_deadline(slot_t* slot) {
+  if (!slot->min_valid) {
+    slot->min_deadline = slot->head->deadline;
+    for (timer_wheel_entry_t* entry = slot->head->next; entry;
+         entry = entry->next) {
+      if (entry->deadline < slot->min_deadline)
+        slot->min_deadline = entry->deadline;
+    }
+    slot->min_valid = true;
+  }
+  return slot->min_deadline;
+}
+
+// Returns the first tick at or after |next_tick| at which |level| has work:
+// an expiry for level 0, a cascade for the others. Stores the slot involved in
+// |index|. The level may not be empty.
+static uint64_t level_next_tick(const timer_wheel_t* wheel, int level,
+                                int* index) {
+  int shift = WHEEL_BITS * level;
+  uint64_t first = (wheel->next_tick + (1ULL << shift) - 1) >> shift;
+  int offset = first_slot_from(wheel->bitmap[level], first & WHEEL_MASK);
+  *index = (first + offset) & WHEEL_MASK;
+  return (first + offset) << shift;
+}
+
+static uint64_t next_event_tick(const timer_wheel_t* wheel) {
+  uint64_t tick = UINT64_MAX;
+  for (int level = 0; level < WHEEL_LEVELS; level++) {
+    if (!wheel->bitmap[level]) continue;
+    int index;
+    uint64_t level_tick = level_next_tick(wheel, level, &index);
+    if (level_tick < tick) tick = level_tick;
+  }
+  return tick;
+}
+
+timer_wheel_t* timer_wheel_new(uint64_t now_ms) {
+  timer_wheel_t* wheel =
+      static_cast<timer_wheel_t*>(osi_calloc(sizeof(timer_wheel_t)));
+  wheel->next_tick = now_ms;
+  return wheel;
+}
+
+void timer_wheel_free(timer_wheel_t* wheel) { osi_free(wheel); }
+
+size_t timer_wheel_length(const timer_wheel_t* wheel) {
+  CHECK(wheel != NULL);
+  return wheel->count;
+}
+
+bool timer_wheel_is_empty(const timer_wheel_t* wheel) {
+  CHECK(wheel != NULL);
+  return wheel->count == 0;
+}
+
+void timer_wheel_entry_init(timer_wheel_entry_t* entry, void* data) {
+  CHECK(entry != NULL);
+  entry->next = entry->prev = NULL;
+  entry->deadline = 0;
+  entry->sequence = 0;
+  entry->slot = NO_SLOT;
+  entry->data = data;
+}
+
+bool timer_wheel_entry_is_pending(const timer_wheel_entry_t* entry) {
+  CHECK(entry != NULL);
+  return entry->slot != NO_SLOT;
+}
+
+void timer_wheel_insert(timer_wheel_t* wheel, timer_wheel_entry_t* entry,
+                        uint64_t deadline_ms) {
+  CHECK(wheel != NULL);
+  CHECK(entry != NULL);
+
+  timer_wheel_remove(wheel, entry);
+
+  entry->deadline = deadline_ms;
+  entry->sequence = wheel->next_sequence++;
+  place(wheel, entry);
+  wheel->count++;
+}
+
+void timer_wheel_remove(timer_wheel_t* wheel, timer_wheel_entry_t* entry) {
+  CHECK(wheel != NULL);
+  CHECK(entry != NULL);
+
+  if (entry->slot == NO_SLOT) return;
+
+  slot_t* slot = slot_of(wheel, entry->slot);
+  if (entry->prev)
+    entry->prev->next = entry->next;
+  else
+    slot->head = entry->next;
+  if (entry->next)
+    entry->next->prev = entry->prev;
+  else
+    slot->tail = entry->prev;
+
+  if (!slot->head) {
+    wheel->bitmap[entry->slot >> WHEEL_BITS] &=
+        ~(1ULL << (entry->slot & WHEEL_MASK));
+    slot->min_valid = false;
+  } else if (entry->deadline == slot->min_deadline) {
+    slot->min_valid = false;
+  }
+
+  entry->next = entry->prev = NULL;
+  entry->slot = NO_SLOT;
+  wheel->count--;
+}
+
+bool timer_wheel_next_deadline(timer_wheel_t* wheel, uint64_t* deadline_ms) {
+  CHECK(wheel != NULL);
+  CHECK(deadline_ms != NULL);
+
+  if (wheel->count == 0) return false;
+
+  // Slots of one level that come due later hold strictly later deadlines, so
+  // only the first occupied slot of each level needs to be looked at.
+  uint64_t earliest = UINT64_MAX;
+  for (int level = 0; level < WHEEL_LEVELS; level++) {
+    if (!wheel->bitmap[level]) continue;
+    int index;
+    if (level_next_tick(wheel, level, &index) >= earliest) continue;
+    uint64_t deadline = slot_min_deadline(&wheel->slots[level][index]);
+    if (deadline < earliest) earliest = deadline;
+  }
+
+  *deadline_ms = earliest;
+  return true;
+}
+
+timer_wheel_entry_t* timer_wheel_expire(timer_wheel_t* wheel,
+                                        uint64_t now_ms) {
+  CHECK(wheel != NULL);
+
+  timer_wheel_entry_t* head = NULL;
+  timer_wheel_entry_t* tail = NULL;
+
+  // Jump straight from one occupied slot to the next instead of stepping
+  // through every tick.
+  while (wheel->count > 0) {
+    uint64_t tick = next_event_tick(wheel);
+    if (tick > now_ms) break;
+
+    wheel->next_tick = tick;
+    for (int level = 1; level < WHEEL_LEVELS; level++) {
+      int shift = WHEEL_BITS * level;
+      if (tick & ((1ULL << shift) - 1)) break;
+
+      timer_wheel_entry_t* entry =
+          take_slot(wheel, level, (tick >> shift) & WHEEL_MASK);
+      while (entry) {
+        timer_wheel_entry_t* next = entry->next;
+        place(wheel, entry);
+        entry = next;
+      }
+    }
+
+    timer_wheel_entry_t* expired = take_slot(wheel, 0, tick & WHEEL_MASK);
+    if (expired) {
+      if (tail)
+        tail->next = expired;
+      else
+        head = expired;
+      expired->prev = tail;
+      for (tail = expired;; tail = tail->next) {
+        tail->slot = NO_SLOT;
+        wheel->count--;
+        if (!tail->next) break;
+      }
+    }
+
+    wheel->next_tick = tick + 1;
+  }
+
+  if (now_ms >= wheel->next_tick) wheel->next_tick = now_ms + 1;
+
+  // Entries inserted with a deadline at or before the current tick wait at
+  // the front of the slot for |next_tick|; hand those back too.
+  slot_t* slot = &wheel->slots[0][wheel->next_tick & WHEEL_MASK];
+  while (slot->head && slot->head->deadline <= now_ms) {
+    timer_wheel_entry_t* entry = slot->head;
+    timer_wheel_remove(wheel, entry);
+    if (tail)
+      tail->next = entry;
+    else
+      head = entry;
+    entry->prev = tail;
+    tail = entry;
+  }
+
+  return head;
+}
+
+void timer_wheel_foreach(const timer_wheel_t* wheel,
+                         timer_wheel_iter_cb callback, void* context) {
+  CHECK(wheel != NULL);
+  CHECK(callback != NULL);
+
+  for (int level = 0; level < WHEEL_LEVELS; level++) {
+    for (int index = 0; index < WHEEL_SLOTS; index++) {
+      for (timer_wheel_entry_t* entry = wheel->slots[level][index].head; entry;
+           entry = entry->next) {
+        if (!callback(entry->data, context)) return;
+      }
+    }
+  }
+}
@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "AllocationTestHarness.h"
+
+#include "osi/include/config.h"
+#include "osi/include/config_journal.h"
+
+static const char JOURNAL_FILE[] = "/data/local/tmp/config_journal_test.log";
+static const uint64_t GENERATION = 7;
+
+class ConfigJournalTest : public AllocationTestHarness {
+ protected:
+  virtual void SetUp() {
+    AllocationTestHarness::SetUp();
+    unlink(JOURNAL_FILE);
+  }
+
+  virtual void TearDown() {
+    unlink(JOURNAL_FILE);
+    AllocationTestHarness::TearDown();
+  }
+};
+
+TEST_F(ConfigJournalTest, config_journal_new_free) {
+  config_journal_t* journal = config_journal_new(JOURNAL_FILE);
+  ASSERT_TRUE(journal != NULL);
+  EXPECT_EQ(0U, config_journal_size(journal));
+  EXPECT_FALSE(config_journal_has_pending(journal));
+  config_journal_free(journal);
+  config_journal_free(NULL);
+}
+
+TEST_F(ConfigJournalTest, config_journal_replay_missing_file) {
+  config_t* config = config_new_empty();
+  EXPECT_EQ(0U, config_journal_replay(JOURNAL_FILE, GENERATION, config));
+  config_free(config);
+}
+
+TEST_F(ConfigJournalTest, config_journal_records_are_buffered_until_flush) {
+  config_journal_t* journal = config_journal_new(JOURNAL_FILE);
+  EXPECT_TRUE(config_journal_reset(journal, GENERATION));
+  size_t reset_size = config_journal_size(journal);
+  config_journal_set(journal, "Adapter", "Name", "phone");
+  EXPECT_TRUE(config_journal_has_pending(journal));
+  EXPECT_EQ(reset_size, config_journal_size(journal));
+
+  EXPECT_TRUE(config_journal_flush(journal));
+  EXPECT_FALSE(config_journal_has_pending(journal));
+  EXPECT_LT(reset_size, config_journal_size(journal));
+  config_journal_free(journal);
+}
+
+TEST_F(ConfigJournalTest, config_journal_replay) {
+  config_journal_t* journal = config_journal_new(JOURNAL_FILE);
+  EXPECT_TRUE(config_journal_reset(journal, GENERATION));
+  config_journal_set(journal, "aa:bb:cc:dd:ee:ff", "Name", "headset");
+  config_journal_set(journal, "aa:bb:cc:dd:ee:ff", "LinkKey", "0011");
+  config_journal_set(journal, "Adapter", "Name", "with spaces = and equals");
+  config_journal_set(journal, "aa:bb:cc:dd:ee:ff", "Name", "renamed");
+  config_journal_remove(journal, "aa:bb:cc:dd:ee:ff", "LinkKey");
+  config_journal_set(journal, "Adapter", "Empty", "");
+  EXPECT_TRUE(config_journal_flush(journal));
+  config_journal_free(journal);
+
+  config_t* config = config_new_empty();
+  config_set_string(config, "Adapter", "Address", "00:11:22:33:44:55");
+  EXPECT_EQ(6U, config_journal_replay(JOURNAL_FILE, GENERATION, config));
+
+  EXPECT_STREQ("renamed",
+               config_get_string(config, "aa:bb:cc:dd:ee:ff", "Name", NULL));
+  EXPECT_FALSE(config_has_key(config, "aa:bb:cc:dd:ee:ff", "LinkKey"));
+  EXPECT_STREQ("with spaces = and equals",
+               config_get_string(config, "Adapter", "Name", NULL));
+  EXPECT_STREQ("", config_get_string(config, "Adapter", "Empty", NULL));
+  EXPECT_STREQ("00:11:22:33:44:55",
+               config_get_string(config, "Adapter", "Address", NULL));
+  config_free(config);
+}
+
+TEST_F(ConfigJournalTest, config_journal_replay_drops_torn_tail) {
+  config_journal_t* journal = config_journal_new(JOURNAL_FILE);
+  EXPECT_TRUE(config_journal_reset(journal, GENERATION));
+  config_journal_set(journal, "Adapter", "Name", "phone");
+  EXPECT_TRUE(config_journal_flush(journal));
+  size_t complete_size = config_journal_size(journal);
+  config_journal_set(journal, "Adapter", "Address", "00:11:22:33:44:55");
+  EXPECT_TRUE(config_journal_flush(journal));
+  config_journal_free(journal);
+
+  // Cut the second record short, as if the device lost power mid-write.
+  ASSERT_EQ(0, truncate(JOURNAL_FILE, complete_size + 12));
+
+  config_t* config = config_new_empty();
+  EXPECT_EQ(1U, config_journal_replay(JOURNAL_FILE, GENERATION, config));
+  EXPECT_STREQ("phone", config_get_string(config, "Adapter", "Name", NULL));
+  EXPECT_FALSE(config_has_key(config, "Adapter", "Address"));
+  config_free(config);
+}
+
+TEST_F(ConfigJournalTest, config_journal_reset) {
+  config_journal_t* journal = config_journal_new(JOURNAL_FILE);
+  EXPECT_TRUE(config_journal_reset(journal, GENERATION));
+  size_t reset_size = config_journal_size(journal);
+  config_journal_set(journal, "Adapter", "Name", "phone");
+  EXPECT_TRUE(config_journal_flush(journal));
+  config_journal_set(journal, "Adapter", "Name", "pending");
+
+  EXPECT_TRUE(config_journal_reset(journal, GENERATION + 1));
+  EXPECT_EQ(reset_size, config_journal_size(journal));
+  EXPECT_FALSE(config_journal_has_pending(journal));
+
+  // Appends after a reset start from the beginning of the file.
+  config_journal_set(journal, "Adapter", "Name", "tablet");
+  EXPECT_TRUE(config_journal_flush(journal));
+  config_journal_free(journal);
+
+  config_t* config = config_new_empty();
+  EXPECT_EQ(1U, config_journal_replay(JOURNAL_FILE, GENERATION + 1, config));
+  EXPECT_STREQ("tablet", config_get_string(config, "Adapter", "Name", NULL));
+  config_free(config);
+}
+
+TEST_F(ConfigJournalTest, config_journal_replay_other_generation) {
+  config_journal_t* journal = config_journal_new(JOURNAL_FILE);
+  EXPECT_TRUE(config_journal_reset(journal, GENERATION));
+  config_journal_set(journal, "Adapter", "Name", "phone");
+  EXPECT_TRUE(config_journal_flush(journal));
+  config_journal_free(journal);
+
+  // Neither an older nor a newer full save takes the records
+  config_t* config = config_new_empty();
+  EXPECT_EQ(0U, config_journal_replay(JOURNAL_FILE, GENERATION - 1, config));
+  EXPECT_EQ(0U, config_journal_replay(JOURNAL_FILE, GENERATION + 1, config));
+  EXPECT_EQ(0U, config_journal_replay(JOURNAL_FILE, GENERATION * 10, config));
+  EXPECT_FALSE(config_has_key(config, "Adapter", "Name"));
+  config_free(config);
+}
+
+TEST_F(ConfigJournalTest, config_journal_replay_without_generation) {
+  // Records appended to a journal that was never reset
+  config_journal_t* journal = config_journal_new(JOURNAL_FILE);
+  config_journal_set(journal, "Adapter", "Name", "phone");
+  EXPECT_TRUE(config_journal_flush(journal));
+  config_journal_free(journal);
+
+  config_t* config = config_new_empty();
+  EXPECT_EQ(0U, config_journal_replay(JOURNAL_FILE, 0, config));
+  EXPECT_FALSE(config_has_key(config, "Adapter", "Name"));
+  config_free(config);
+}
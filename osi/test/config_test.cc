@@ -200,3 +200,87 @@ TEST_F(ConfigTest, config_save_basic) {
   EXPECT_TRUE(config_save(config, CONFIG_FILE));
   config_free(config);
 }
+
+TEST_F(ConfigTest, config_many_sections_and_keys) {
+  const int kSections = 500;
+  const int kKeys = 20;
+  char section[32];
+  char key[32];
+
+  config_t* config = config_new_empty();
+  for (int i = 0; i < kSections; i++) {
+    snprintf(section, sizeof(section), "00:11:22:33:%02x:%02x", i >> 8,
+             i & 0xff);
+    for (int j = 0; j < kKeys; j++) {
+      snprintf(key, sizeof(key), "Key%d", j);
+      config_set_int(config, section, key, i * kKeys + j);
+    }
+  }
+
+  for (int i = 0; i < kSections; i++) {
+    snprintf(section, sizeof(section), "00:11:22:33:%02x:%02x", i >> 8,
+             i & 0xff);
+    EXPECT_TRUE(config_has_section(config, section));
+    for (int j = 0; j < kKeys; j++) {
+      snprintf(key, sizeof(key), "Key%d", j);
+      EXPECT_EQ(i * kKeys + j, config_get_int(config, section, key, -1));
+    }
+  }
+
+  // Remove every other section and every other key of the rest, then make
+  // sure lookups still find exactly what is left.
+  for (int i = 0; i < kSections; i++) {
+    snprintf(section, sizeof(section), "00:11:22:33:%02x:%02x", i >> 8,
+             i & 0xff);
+    if (i % 2) {
+      EXPECT_TRUE(config_remove_section(config, section));
+      continue;
+    }
+    for (int j = 0; j < kKeys; j += 2) {
+      snprintf(key, sizeof(key), "Key%d", j);
+      EXPECT_TRUE(config_remove_key(config, section, key));
+    }
+  }
+
+  for (int i = 0; i < kSections; i++) {
+    snprintf(section, sizeof(section), "00:11:22:33:%02x:%02x", i >> 8,
+             i & 0xff);
+    EXPECT_EQ(i % 2 == 0, config_has_section(config, section));
+    for (int j = 0; j < kKeys; j++) {
+      snprintf(key, sizeof(key), "Key%d", j);
+      EXPECT_EQ(i % 2 == 0 && j % 2 == 1,
+                config_has_key(config, section, key));
+    }
+  }
+
+  // Removed names can be added back.
+  config_set_string(config, "00:11:22:33:00:01", "Key0", "readded");
+  EXPECT_STREQ("readded",
+               config_get_string(config, "00:11:22:33:00:01", "Key0", NULL));
+  config_free(config);
+}
+
+TEST_F(ConfigTest, config_save_keeps_insertion_order) {
+  config_t* config = config_new_empty();
+  config_set_string(config, "zeta", "b", "1");
+  config_set_string(config, "alpha", "z", "2");
+  config_set_string(config, "zeta", "a", "3");
+  config_set_string(config, "mu", "m", "4");
+  config_set_string(config, "alpha", "y", "5");
+  config_remove_section(config, "mu");
+  config_set_string(config, "mu", "m", "6");
+  EXPECT_TRUE(config_save(config, CONFIG_FILE));
+  config_free(config);
+
+  config = config_new(CONFIG_FILE);
+  const char* expected[] = {"zeta", "alpha", "mu"};
+  const config_section_node_t* node = config_section_begin(config);
+  for (const char* name : expected) {
+    ASSERT_NE(node, config_section_end(config));
+    EXPECT_STREQ(name, config_section_name(node));
+    node = config_section_next(node);
+  }
+  EXPECT_EQ(node, config_section_end(config));
+  EXPECT_STREQ("6", config_get_string(config, "mu", "m", NULL));
+  config_free(config);
+}
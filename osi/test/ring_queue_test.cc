@@ -0,0 +1,183 @@
+#include <gtest/gtest.h>
+
+#include <sys/select.h>
+#include <thread>
+#include <vector>
+
+#include "AllocationTestHarness.h"
+
+#include "osi/include/future.h"
+#include "osi/include/osi.h"
+#include "osi/include/ring_queue.h"
+#include "osi/include/thread.h"
+
+static const size_t TEST_QUEUE_SIZE = 16;
+static const char* DUMMY_DATA_STRING1 = "Dummy data string1";
+static const char* DUMMY_DATA_STRING2 = "Dummy data string2";
+static const char* DUMMY_DATA_STRING3 = "Dummy data string3";
+static future_t* received_message_future = NULL;
+
+static int test_queue_entry_free_counter = 0;
+
+// Test whether a file descriptor |fd| is readable.
+// Return true if the file descriptor is readable, otherwise false.
+static bool is_fd_readable(int fd) {
+  fd_set rfds;
+  struct timeval tv;
+
+  FD_ZERO(&rfds);
+  tv.tv_sec = 0;
+  tv.tv_usec = 0;
+  FD_SET(fd, &rfds);
+  int result = select(FD_SETSIZE, &rfds, NULL, NULL, &tv);
+  EXPECT_TRUE(result >= 0);
+
+  return FD_ISSET(fd, &rfds);
+}
+
+static void ring_queue_ready(ring_queue_t* queue, UNUSED_ATTR void* context) {
+  void* msg = ring_queue_try_dequeue(queue);
+  EXPECT_TRUE(msg != NULL);
+  future_ready(received_message_future, msg);
+}
+
+static void test_queue_entry_free_cb(UNUSED_ATTR void* data) {
+  test_queue_entry_free_counter++;
+}
+
+class RingQueueTest : public AllocationTestHarness {};
+
+TEST_F(RingQueueTest, test_ring_queue_new_free) {
+  ring_queue_t* queue = ring_queue_new(TEST_QUEUE_SIZE);
+  ASSERT_TRUE(queue != NULL);
+  ring_queue_free(queue, NULL);
+
+  // Capacity is rounded up to a power of two
+  queue = ring_queue_new(10);
+  ASSERT_TRUE(queue != NULL);
+  EXPECT_EQ(16U, ring_queue_capacity(queue));
+  ring_queue_free(queue, NULL);
+
+  // Free a NULL queue
+  ring_queue_free(NULL, NULL);
+
+  // Free with elements and a callback
+  test_queue_entry_free_counter = 0;
+  queue = ring_queue_new(TEST_QUEUE_SIZE);
+  ring_queue_enqueue(queue, (void*)DUMMY_DATA_STRING1);
+  ring_queue_enqueue(queue, (void*)DUMMY_DATA_STRING2);
+  ring_queue_free(queue, test_queue_entry_free_cb);
+  EXPECT_EQ(2, test_queue_entry_free_counter);
+}
+
+TEST_F(RingQueueTest, test_ring_queue_length_and_fifo_order) {
+  ring_queue_t* queue = ring_queue_new(TEST_QUEUE_SIZE);
+  EXPECT_TRUE(ring_queue_is_empty(queue));
+  EXPECT_EQ(0U, ring_queue_length(queue));
+
+  ring_queue_enqueue(queue, (void*)DUMMY_DATA_STRING1);
+  ring_queue_enqueue(queue, (void*)DUMMY_DATA_STRING2);
+  ring_queue_enqueue(queue, (void*)DUMMY_DATA_STRING3);
+  EXPECT_FALSE(ring_queue_is_empty(queue));
+  EXPECT_EQ(3U, ring_queue_length(queue));
+  EXPECT_EQ(DUMMY_DATA_STRING1, ring_queue_try_peek_first(queue));
+
+  EXPECT_EQ(DUMMY_DATA_STRING1, ring_queue_dequeue(queue));
+  EXPECT_EQ(DUMMY_DATA_STRING2, ring_queue_try_dequeue(queue));
+  EXPECT_EQ(DUMMY_DATA_STRING3, ring_queue_dequeue(queue));
+  EXPECT_TRUE(ring_queue_try_dequeue(queue) == NULL);
+  EXPECT_TRUE(ring_queue_try_peek_first(queue) == NULL);
+  EXPECT_TRUE(ring_queue_is_empty(queue));
+
+  ring_queue_free(queue, NULL);
+}
+
+TEST_F(RingQueueTest, test_ring_queue_full) {
+  ring_queue_t* queue = ring_queue_new(TEST_QUEUE_SIZE);
+  for (size_t i = 0; i < TEST_QUEUE_SIZE; i++)
+    EXPECT_TRUE(ring_queue_try_enqueue(queue, (void*)DUMMY_DATA_STRING1));
+  EXPECT_FALSE(ring_queue_try_enqueue(queue, (void*)DUMMY_DATA_STRING2));
+  EXPECT_EQ(TEST_QUEUE_SIZE, ring_queue_length(queue));
+
+  // A blocked producer is released once the consumer makes room
+  std::thread producer(
+      [queue]() { ring_queue_enqueue(queue, (void*)DUMMY_DATA_STRING3); });
+  for (size_t i = 0; i < TEST_QUEUE_SIZE; i++)
+    EXPECT_EQ(DUMMY_DATA_STRING1, ring_queue_dequeue(queue));
+  EXPECT_EQ(DUMMY_DATA_STRING3, ring_queue_dequeue(queue));
+  producer.join();
+
+  ring_queue_free(queue, NULL);
+}
+
+TEST_F(RingQueueTest, test_ring_queue_dequeue_fd_tracks_emptiness) {
+  ring_queue_t* queue = ring_queue_new(TEST_QUEUE_SIZE);
+  int dequeue_fd = ring_queue_get_dequeue_fd(queue);
+  EXPECT_TRUE(dequeue_fd >= 0);
+  EXPECT_FALSE(is_fd_readable(dequeue_fd));
+
+  ring_queue_enqueue(queue, (void*)DUMMY_DATA_STRING1);
+  EXPECT_TRUE(is_fd_readable(dequeue_fd));
+  ring_queue_enqueue(queue, (void*)DUMMY_DATA_STRING2);
+  EXPECT_TRUE(is_fd_readable(dequeue_fd));
+
+  ring_queue_dequeue(queue);
+  EXPECT_TRUE(is_fd_readable(dequeue_fd));
+  ring_queue_dequeue(queue);
+  EXPECT_FALSE(is_fd_readable(dequeue_fd));
+
+  ring_queue_free(queue, NULL);
+}
+
+TEST_F(RingQueueTest, test_ring_queue_register_dequeue) {
+  ring_queue_t* queue = ring_queue_new(TEST_QUEUE_SIZE);
+  ASSERT_TRUE(queue != NULL);
+
+  thread_t* worker_thread = thread_new("test_ring_queue_worker_thread");
+  ASSERT_TRUE(worker_thread != NULL);
+
+  ring_queue_register_dequeue(queue, thread_get_reactor(worker_thread),
+                              ring_queue_ready, NULL);
+
+  const char* messages[] = {DUMMY_DATA_STRING1, DUMMY_DATA_STRING2,
+                            DUMMY_DATA_STRING3};
+  for (const char* message : messages) {
+    received_message_future = future_new();
+    ASSERT_TRUE(received_message_future != NULL);
+    ring_queue_enqueue(queue, (void*)message);
+    EXPECT_EQ(message, (const char*)future_await(received_message_future));
+  }
+
+  ring_queue_unregister_dequeue(queue);
+  thread_free(worker_thread);
+  ring_queue_free(queue, NULL);
+}
+
+TEST_F(RingQueueTest, test_ring_queue_multiple_producers) {
+  const size_t kProducers = 4;
+  const size_t kMessagesPerProducer = 10000;
+  ring_queue_t* queue = ring_queue_new(TEST_QUEUE_SIZE);
+
+  std::vector<std::thread> producers;
+  for (size_t p = 0; p < kProducers; p++) {
+    producers.emplace_back([queue, p]() {
+      for (size_t i = 1; i <= kMessagesPerProducer; i++)
+        ring_queue_enqueue(queue, (void*)((p << 24) | i));
+    });
+  }
+
+  // Each producer's messages must come out in order
+  size_t last_seen[kProducers] = {0};
+  for (size_t n = 0; n < kProducers * kMessagesPerProducer; n++) {
+    uintptr_t value = (uintptr_t)ring_queue_dequeue(queue);
+    size_t p = value >> 24;
+    size_t i = value & 0xFFFFFF;
+    ASSERT_LT(p, kProducers);
+    EXPECT_EQ(last_seen[p] + 1, i);
+    last_seen[p] = i;
+  }
+
+  for (auto& producer : producers) producer.join();
+  EXPECT_TRUE(ring_queue_is_empty(queue));
+  ring_queue_free(queue, NULL);
+}
@@ -0,0 +1,123 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <stdint.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "AllocationTestHarness.h"
+
+#include "osi/include/allocator.h"
+#include "osi/include/slab_allocator.h"
+
+class SlabAllocatorTest : public AllocationTestHarness {};
+
+static size_t class_for_size(size_t size) {
+  slab_allocator_class_stats_t stats;
+  for (size_t i = 0; i < slab_allocator_num_classes(); i++) {
+    slab_allocator_get_class_stats(i, &stats);
+    if (size <= stats.block_size) return i;
+  }
+  return slab_allocator_num_classes();
+}
+
+TEST_F(SlabAllocatorTest, test_alloc_free_all_sizes) {
+  for (size_t size = 1; size <= SLAB_ALLOCATOR_MAX_BLOCK_SIZE + 64;
+       size += 61) {
+    uint8_t* ptr = static_cast<uint8_t*>(slab_allocator_alloc(size));
+    ASSERT_TRUE(ptr != NULL);
+    EXPECT_EQ(0U, reinterpret_cast<uintptr_t>(ptr) % 16);
+    memset(ptr, 0xA5, size);
+    slab_allocator_free(ptr);
+  }
+  slab_allocator_free(NULL);
+}
+
+TEST_F(SlabAllocatorTest, test_blocks_are_reused) {
+  void* first = slab_allocator_alloc(100);
+  slab_allocator_free(first);
+  void* second = slab_allocator_alloc(100);
+  EXPECT_EQ(first, second);
+  slab_allocator_free(second);
+}
+
+TEST_F(SlabAllocatorTest, test_stats_track_in_use_and_high_water) {
+  const size_t kCount = 10;
+  size_t index = class_for_size(300);
+  ASSERT_LT(index, slab_allocator_num_classes());
+
+  slab_allocator_class_stats_t before;
+  ASSERT_TRUE(slab_allocator_get_class_stats(index, &before));
+
+  std::vector<void*> blocks;
+  for (size_t i = 0; i < kCount; i++) blocks.push_back(slab_allocator_alloc(300));
+
+  slab_allocator_class_stats_t during;
+  slab_allocator_get_class_stats(index, &during);
+  EXPECT_EQ(before.in_use + kCount, during.in_use);
+  EXPECT_GE(during.high_water, during.in_use);
+  EXPECT_EQ(before.hits + before.misses + kCount, during.hits + during.misses);
+
+  for (void* block : blocks) slab_allocator_free(block);
+
+  slab_allocator_class_stats_t after;
+  slab_allocator_get_class_stats(index, &after);
+  EXPECT_EQ(before.in_use, after.in_use);
+  EXPECT_EQ(during.high_water, after.high_water);
+
+  EXPECT_FALSE(
+      slab_allocator_get_class_stats(slab_allocator_num_classes(), &after));
+}
+
+TEST_F(SlabAllocatorTest, test_large_allocations_bypass_slabs) {
+  uint64_t before = slab_allocator_get_large_allocations();
+  void* ptr = slab_allocator_alloc(SLAB_ALLOCATOR_MAX_BLOCK_SIZE + 1);
+  ASSERT_TRUE(ptr != NULL);
+  EXPECT_EQ(before + 1, slab_allocator_get_large_allocations());
+  slab_allocator_free(ptr);
+}
+
+TEST_F(SlabAllocatorTest, test_cross_thread_free) {
+  const size_t kCount = 1000;
+  std::vector<void*> blocks;
+  std::thread producer([&blocks]() {
+    for (size_t i = 0; i < kCount; i++) {
+      void* ptr = osi_malloc(64 + (i % 4000));
+      memset(ptr, 0x5A, 64);
+      blocks.push_back(ptr);
+    }
+  });
+  producer.join();
+
+  for (void* ptr : blocks) osi_free(ptr);
+  slab_allocator_flush_thread_cache();
+}
+
+TEST_F(SlabAllocatorTest, test_osi_calloc_is_zeroed) {
+  // Dirty a block, return it and make sure calloc hands it back cleared.
+  uint8_t* dirty = static_cast<uint8_t*>(osi_malloc(200));
+  memset(dirty, 0xFF, 200);
+  osi_free(dirty);
+
+  uint8_t* ptr = static_cast<uint8_t*>(osi_calloc(200));
+  for (size_t i = 0; i < 200; i++) EXPECT_EQ(0, ptr[i]);
+  osi_free(ptr);
+}
@@ -0,0 +1,203 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "AllocationTestHarness.h"
+
+#include "osi/include/osi.h"
+#include "osi/include/timer_wheel.h"
+
+static const uint64_t START_MS = 1000000;
+
+class TimerWheelTest : public AllocationTestHarness {};
+
+static std::vector<int> expire_ids(timer_wheel_t* wheel, uint64_t now_ms) {
+  std::vector<int> ids;
+  for (timer_wheel_entry_t* entry = timer_wheel_expire(wheel, now_ms); entry;
+       entry = entry->next) {
+    EXPECT_FALSE(timer_wheel_entry_is_pending(entry));
+    ids.push_back(PTR_TO_INT(entry->data));
+  }
+  return ids;
+}
+
+TEST_F(TimerWheelTest, test_new_free) {
+  timer_wheel_t* wheel = timer_wheel_new(START_MS);
+  ASSERT_TRUE(wheel != NULL);
+  EXPECT_TRUE(timer_wheel_is_empty(wheel));
+  EXPECT_EQ(0U, timer_wheel_length(wheel));
+
+  uint64_t deadline = 42;
+  EXPECT_FALSE(timer_wheel_next_deadline(wheel, &deadline));
+  EXPECT_EQ(42U, deadline);
+  EXPECT_TRUE(timer_wheel_expire(wheel, START_MS + 100) == NULL);
+
+  timer_wheel_free(wheel);
+  timer_wheel_free(NULL);
+}
+
+TEST_F(TimerWheelTest, test_insert_remove) {
+  timer_wheel_t* wheel = timer_wheel_new(START_MS);
+  timer_wheel_entry_t entries[3];
+  for (int i = 0; i < 3; i++) timer_wheel_entry_init(&entries[i], INT_TO_PTR(i));
+
+  EXPECT_FALSE(timer_wheel_entry_is_pending(&entries[0]));
+  timer_wheel_insert(wheel, &entries[0], START_MS + 10);
+  timer_wheel_insert(wheel, &entries[1], START_MS + 5000);
+  timer_wheel_insert(wheel, &entries[2], START_MS + 3);
+  EXPECT_TRUE(timer_wheel_entry_is_pending(&entries[0]));
+  EXPECT_EQ(3U, timer_wheel_length(wheel));
+
+  uint64_t deadline;
+  EXPECT_TRUE(timer_wheel_next_deadline(wheel, &deadline));
+  EXPECT_EQ(START_MS + 3, deadline);
+
+  timer_wheel_remove(wheel, &entries[2]);
+  timer_wheel_remove(wheel, &entries[2]);  // Idempotent
+  EXPECT_FALSE(timer_wheel_entry_is_pending(&entries[2]));
+  EXPECT_EQ(2U, timer_wheel_length(wheel));
+  EXPECT_TRUE(timer_wheel_next_deadline(wheel, &deadline));
+  EXPECT_EQ(START_MS + 10, deadline);
+
+  // Re-inserting a pending entry moves it
+  timer_wheel_insert(wheel, &entries[1], START_MS + 7);
+  EXPECT_EQ(2U, timer_wheel_length(wheel));
+  EXPECT_TRUE(timer_wheel_next_deadline(wheel, &deadline));
+  EXPECT_EQ(START_MS + 7, deadline);
+
+  EXPECT_TRUE(expire_ids(wheel, START_MS + 6).empty());
+  EXPECT_EQ(std::vector<int>({1, 0}), expire_ids(wheel, START_MS + 10));
+  EXPECT_TRUE(timer_wheel_is_empty(wheel));
+
+  timer_wheel_free(wheel);
+}
+
+TEST_F(TimerWheelTest, test_equal_deadlines_keep_insertion_order) {
+  timer_wheel_t* wheel = timer_wheel_new(START_MS);
+  timer_wheel_entry_t entries[4];
+  for (int i = 0; i < 4; i++) timer_wheel_entry_init(&entries[i], INT_TO_PTR(i));
+
+  // The first two are far enough out to start in a coarser level than the
+  // last two, which are inserted after the wheel has moved on.
+  timer_wheel_insert(wheel, &entries[0], START_MS + 200);
+  timer_wheel_insert(wheel, &entries[1], START_MS + 200);
+  EXPECT_TRUE(expire_ids(wheel, START_MS + 150).empty());
+  timer_wheel_insert(wheel, &entries[2], START_MS + 200);
+  timer_wheel_insert(wheel, &entries[3], START_MS + 200);
+
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 3}), expire_ids(wheel, START_MS + 200));
+
+  timer_wheel_free(wheel);
+}
+
+TEST_F(TimerWheelTest, test_overdue_and_distant_deadlines) {
+  timer_wheel_t* wheel = timer_wheel_new(START_MS);
+  timer_wheel_entry_t entries[3];
+  for (int i = 0; i < 3; i++) timer_wheel_entry_init(&entries[i], INT_TO_PTR(i));
+
+  EXPECT_TRUE(expire_ids(wheel, START_MS + 10).empty());
+
+  // Already in the past, or due at the tick that was just processed
+  timer_wheel_insert(wheel, &entries[0], START_MS + 10);
+  timer_wheel_insert(wheel, &entries[1], START_MS);
+  uint64_t deadline;
+  EXPECT_TRUE(timer_wheel_next_deadline(wheel, &deadline));
+  EXPECT_EQ(START_MS, deadline);
+  EXPECT_EQ(std::vector<int>({1, 0}), expire_ids(wheel, START_MS + 10));
+
+  // Beyond the range of the wheel
+  const uint64_t distant = START_MS + (1ULL << 40);
+  timer_wheel_insert(wheel, &entries[2], distant);
+  EXPECT_TRUE(timer_wheel_next_deadline(wheel, &deadline));
+  EXPECT_EQ(distant, deadline);
+  EXPECT_TRUE(expire_ids(wheel, distant - 1).empty());
+  EXPECT_EQ(std::vector<int>({2}), expire_ids(wheel, distant));
+
+  timer_wheel_free(wheel);
+}
+
+static bool count_entries(UNUSED_ATTR void* data, void* context) {
+  (*static_cast<int*>(context))++;
+  return true;
+}
+
+TEST_F(TimerWheelTest, test_foreach) {
+  timer_wheel_t* wheel = timer_wheel_new(START_MS);
+  timer_wheel_entry_t entries[10];
+  for (int i = 0; i < 10; i++) {
+    timer_wheel_entry_init(&entries[i], INT_TO_PTR(i));
+    timer_wheel_insert(wheel, &entries[i], START_MS + (1ULL << (3 * i)));
+  }
+
+  int count = 0;
+  timer_wheel_foreach(wheel, count_entries, &count);
+  EXPECT_EQ(10, count);
+
+  timer_wheel_free(wheel);
+}
+
+// Compares the wheel against a brute-force model under a random mix of
+// inserts, removals and time steps.
+TEST_F(TimerWheelTest, test_matches_sorted_model) {
+  const int kEntries = 500;
+  std::mt19937 rng(7);
+  timer_wheel_t* wheel = timer_wheel_new(START_MS);
+  std::vector<timer_wheel_entry_t> entries(kEntries);
+  for (int i = 0; i < kEntries; i++)
+    timer_wheel_entry_init(&entries[i], INT_TO_PTR(i));
+
+  // Model: (deadline, insertion order) per pending entry
+  std::vector<std::pair<uint64_t, uint64_t>> model(kEntries, {0, 0});
+  std::vector<bool> pending(kEntries, false);
+  uint64_t order = 0;
+  uint64_t now_ms = START_MS;
+
+  for (int step = 0; step < 20000; step++) {
+    int i = rng() % kEntries;
+    switch (rng() % 4) {
+      case 0:
+      case 1: {
+        static const uint64_t kRanges[] = {1, 64, 5000, 300000, 1ULL << 34};
+        uint64_t deadline = now_ms + rng() % kRanges[rng() % 5];
+        if (rng() % 16 == 0) deadline = now_ms - rng() % 10;
+        timer_wheel_insert(wheel, &entries[i], deadline);
+        model[i] = {deadline, order++};
+        pending[i] = true;
+        break;
+      }
+      case 2:
+        timer_wheel_remove(wheel, &entries[i]);
+        pending[i] = false;
+        break;
+      case 3: {
+        now_ms += rng() % ((rng() % 8 == 0) ? 100000 : 100);
+        std::vector<int> expected;
+        for (int j = 0; j < kEntries; j++)
+          if (pending[j] && model[j].first <= now_ms) expected.push_back(j);
+        std::sort(expected.begin(), expected.end(),
+                  [&](int a, int b) { return model[a] < model[b]; });
+        for (int j : expected) pending[j] = false;
+        ASSERT_EQ(expected, expire_ids(wheel, now_ms));
+        break;
+      }
+    }
+
+    size_t length = std::count(pending.begin(), pending.end(), true);
+    ASSERT_EQ(length, timer_wheel_length(wheel));
+
+    uint64_t deadline;
+    if (length == 0) {
+      ASSERT_FALSE(timer_wheel_next_deadline(wheel, &deadline));
+    } else {
+      uint64_t earliest = UINT64_MAX;
+      for (int j = 0; j < kEntries; j++)
+        if (pending[j]) earliest = std::min(earliest, model[j].first);
+      ASSERT_TRUE(timer_wheel_next_deadline(wheel, &deadline));
+      ASSERT_EQ(earliest, deadline);
+    }
+  }
+
+  timer_wheel_free(wheel);
+}
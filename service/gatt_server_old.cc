@@ -452,6 +452,7 @@ const btgatt_scanner_callbacks_t gatt_scanner_callbacks = {
     nullptr, /* batchscan_reports_cb; */
     nullptr, /* batchscan_threshold_cb; */
     nullptr, /* track_adv_event_cb; */
+    nullptr, /* scan_results_batch_cb; */
 };
 
 const btgatt_callbacks_t gatt_callbacks = {
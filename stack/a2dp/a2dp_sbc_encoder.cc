@@ -25,6 +25,8 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <algorithm>
+
 #include "a2dp_sbc.h"
 #include "a2dp_sbc_up_sample.h"
 #include "bt_common.h"
@@ -84,6 +86,9 @@
 
 #define A2DP_SBC_MAX_PCM_ITER_NUM_PER_TICK 3
 
+/* The frame count of the SBC media payload header is four bits */
+#define A2DP_SBC_MAX_FRAMES_PER_PACKET 15
+
 #define A2DP_SBC_MAX_HQ_FRAME_SIZE_44_1 165
 #define A2DP_SBC_MAX_HQ_FRAME_SIZE_48 165
 
@@ -140,7 +145,8 @@ typedef struct {
   SBC_ENC_PARAMS sbc_encoder_params;
   tA2DP_FEEDING_PARAMS feeding_params;
   tA2DP_SBC_FEEDING_STATE feeding_state;
-  int16_t pcmBuffer[SBC_MAX_PCM_BUFFER_SIZE];
+  int16_t pcmBuffer[SBC_MAX_PCM_BUFFER_SIZE * A2DP_SBC_MAX_FRAMES_PER_PACKET];
+  BT_HDR* spare_packet; /* Empty packet kept for the next encode */
 
   a2dp_sbc_encoder_stats_t stats;
 } tA2DP_SBC_ENCODER_CB;
@@ -154,7 +160,9 @@ static void a2dp_sbc_encoder_update(uint16_t peer_mtu,
                                     bool* p_restart_input,
                                     bool* p_restart_output,
                                     bool* p_config_updated);
-static bool a2dp_sbc_read_feeding(uint32_t* bytes);
+static uint8_t a2dp_sbc_read_feeding(uint8_t nb_frame, uint32_t* bytes_read);
+static bool a2dp_sbc_read_up_sampled(uint8_t* pcm, uint32_t sbc_sampling,
+                                     uint16_t bytes_needed);
 static void a2dp_sbc_encode_frames(uint8_t nb_frame);
 static void a2dp_sbc_get_num_frame_iteration(uint8_t* num_of_iterations,
                                              uint8_t* num_of_frames,
@@ -180,6 +188,7 @@ void a2dp_sbc_encoder_init(const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
     LOG_INFO(LOG_TAG,"sbc is running in offload mode");
     return;
   }
+  osi_free(a2dp_sbc_encoder_cb.spare_packet);
   memset(&a2dp_sbc_encoder_cb, 0, sizeof(a2dp_sbc_encoder_cb));
 
   a2dp_sbc_encoder_cb.stats.session_start_us = time_get_os_boottime_us();
@@ -426,6 +435,7 @@ static void a2dp_sbc_encoder_update(uint16_t peer_mtu,
 }
 
 void a2dp_sbc_encoder_cleanup(void) {
+  osi_free(a2dp_sbc_encoder_cb.spare_packet);
   memset(&a2dp_sbc_encoder_cb, 0, sizeof(a2dp_sbc_encoder_cb));
 }
 
@@ -594,55 +604,74 @@ static void a2dp_sbc_get_num_frame_iteration(uint8_t* num_of_iterations,
   *num_of_iterations = noi;
 }
 
+// Returns an empty media packet, reusing the spare one if there is one.
+static BT_HDR* a2dp_sbc_get_packet(void) {
+  BT_HDR* p_buf = a2dp_sbc_encoder_cb.spare_packet;
+  if (p_buf != NULL) {
+    a2dp_sbc_encoder_cb.spare_packet = NULL;
+  } else {
+    p_buf = (BT_HDR*)osi_malloc(A2DP_SBC_BUFFER_SIZE);
+  }
+  p_buf->offset = A2DP_SBC_OFFSET;
+  p_buf->len = 0;
+  p_buf->layer_specific = 0;
+  return p_buf;
+}
+
+// Keeps |p_buf|, which was never enqueued, for the next packet.
+static void a2dp_sbc_put_packet(BT_HDR* p_buf) {
+  if (a2dp_sbc_encoder_cb.spare_packet == NULL) {
+    a2dp_sbc_encoder_cb.spare_packet = p_buf;
+  } else {
+    osi_free(p_buf);
+  }
+}
+
 static void a2dp_sbc_encode_frames(uint8_t nb_frame) {
   SBC_ENC_PARAMS* p_encoder_params = &a2dp_sbc_encoder_cb.sbc_encoder_params;
   uint8_t remain_nb_frame = nb_frame;
   uint16_t blocm_x_subband =
       p_encoder_params->s16NumOfSubBands * p_encoder_params->s16NumOfBlocks;
+  uint32_t frame_len = SBC_FrameLength(p_encoder_params);
+
+  // Add frames to a packet while one more still fits below the MTU.
+  uint8_t max_frames_per_packet = 1;
+  while (((max_frames_per_packet + 1) * frame_len <
+          a2dp_sbc_encoder_cb.TxAaMtuSize) &&
+         (max_frames_per_packet < A2DP_SBC_MAX_FRAMES_PER_PACKET)) {
+    max_frames_per_packet++;
+  }
 
-  uint8_t last_frame_len = 0;
   while (nb_frame) {
-    BT_HDR* p_buf = (BT_HDR*)osi_malloc(A2DP_SBC_BUFFER_SIZE);
+    BT_HDR* p_buf = a2dp_sbc_get_packet();
     uint32_t bytes_read = 0;
-    p_buf->offset = A2DP_SBC_OFFSET;
-    p_buf->len = 0;
-    p_buf->layer_specific = 0;
     a2dp_sbc_encoder_cb.stats.media_read_total_expected_packets++;
 
-    do {
-      /* Fill allocated buffer with 0 */
-      memset(a2dp_sbc_encoder_cb.pcmBuffer, 0,
-             blocm_x_subband * p_encoder_params->s16NumOfChannels);
-
-      //
-      // Read the PCM data and encode it. If necessary, upsample the data.
-      //
-      uint32_t num_bytes = 0;
-      if (a2dp_sbc_read_feeding(&num_bytes)) {
-        uint8_t* output = (uint8_t*)(p_buf + 1) + p_buf->offset + p_buf->len;
-        int16_t* input = a2dp_sbc_encoder_cb.pcmBuffer;
-        uint16_t output_len = SBC_Encode(p_encoder_params, input, output);
-        last_frame_len = output_len;
-
-        /* Update SBC frame length */
-        p_buf->len += output_len;
-        nb_frame--;
-        p_buf->layer_specific++;
-        bytes_read += num_bytes;
-      } else {
-        LOG_WARN(LOG_TAG, "%s: underflow %d, %d", __func__, nb_frame,
-                 a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue);
-        a2dp_sbc_encoder_cb.feeding_state.counter +=
-            nb_frame * p_encoder_params->s16NumOfSubBands *
-            p_encoder_params->s16NumOfBlocks *
-            a2dp_sbc_encoder_cb.feeding_params.channel_count *
-            a2dp_sbc_encoder_cb.feeding_params.bits_per_sample / 8;
-        /* no more pcm to read */
-        nb_frame = 0;
-      }
-    } while (
-        ((p_buf->len + last_frame_len) < a2dp_sbc_encoder_cb.TxAaMtuSize) &&
-        (p_buf->layer_specific < 0x0F) && nb_frame);
+    //
+    // Read the PCM data of the whole packet and encode it. If necessary,
+    // upsample the data.
+    //
+    uint8_t packet_nb_frame = std::min(nb_frame, max_frames_per_packet);
+    uint8_t read_nb_frame = a2dp_sbc_read_feeding(packet_nb_frame, &bytes_read);
+    if (read_nb_frame) {
+      uint8_t* output = (uint8_t*)(p_buf + 1) + p_buf->offset;
+      p_buf->len = SBC_EncodeFrames(p_encoder_params,
+                                    a2dp_sbc_encoder_cb.pcmBuffer,
+                                    read_nb_frame, output);
+      p_buf->layer_specific = read_nb_frame;
+      nb_frame -= read_nb_frame;
+    }
+    if (read_nb_frame < packet_nb_frame) {
+      LOG_WARN(LOG_TAG, "%s: underflow %d, %d", __func__, nb_frame,
+               a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue);
+      a2dp_sbc_encoder_cb.feeding_state.counter +=
+          nb_frame * p_encoder_params->s16NumOfSubBands *
+          p_encoder_params->s16NumOfBlocks *
+          a2dp_sbc_encoder_cb.feeding_params.channel_count *
+          a2dp_sbc_encoder_cb.feeding_params.bits_per_sample / 8;
+      /* no more pcm to read */
+      nb_frame = 0;
+    }
 
     if (p_buf->len) {
       /*
@@ -660,33 +689,27 @@ static void a2dp_sbc_encode_frames(uint8_t nb_frame) {
         return;
     } else {
       a2dp_sbc_encoder_cb.stats.media_read_total_dropped_packets++;
-      osi_free(p_buf);
+      a2dp_sbc_put_packet(p_buf);
     }
   }
 }
 
-static bool a2dp_sbc_read_feeding(uint32_t* bytes_read) {
+// Reads the PCM data of up to |nb_frame| frames into consecutive frames of
+// |pcmBuffer| and returns the number of complete frames. |bytes_read| is set
+// to the number of bytes read from the source.
+static uint8_t a2dp_sbc_read_feeding(uint8_t nb_frame, uint32_t* bytes_read) {
   SBC_ENC_PARAMS* p_encoder_params = &a2dp_sbc_encoder_cb.sbc_encoder_params;
   uint16_t blocm_x_subband =
       p_encoder_params->s16NumOfSubBands * p_encoder_params->s16NumOfBlocks;
   uint32_t read_size;
   uint32_t sbc_sampling = 48000;
-  uint32_t src_samples;
   uint16_t bytes_needed = blocm_x_subband * p_encoder_params->s16NumOfChannels *
                           a2dp_sbc_encoder_cb.feeding_params.bits_per_sample /
                           8;
-  static uint16_t up_sampled_buffer[SBC_MAX_NUM_FRAME * SBC_MAX_NUM_OF_BLOCKS *
-                                    SBC_MAX_NUM_OF_CHANNELS *
-                                    SBC_MAX_NUM_OF_SUBBANDS * 2];
-  static uint16_t read_buffer[SBC_MAX_NUM_FRAME * SBC_MAX_NUM_OF_BLOCKS *
-                              SBC_MAX_NUM_OF_CHANNELS *
-                              SBC_MAX_NUM_OF_SUBBANDS];
-  uint32_t src_size_used;
-  uint32_t dst_size_used;
-  bool fract_needed;
-  int32_t fract_max;
-  int32_t fract_threshold;
+  uint8_t* pcm = (uint8_t*)a2dp_sbc_encoder_cb.pcmBuffer;
   uint32_t nb_byte_read;
+  uint32_t residue;
+  uint8_t nb_frame_read;
 
   /* Get the SBC sampling rate */
   switch (p_encoder_params->s16SamplingFreq) {
@@ -704,27 +727,62 @@ static bool a2dp_sbc_read_feeding(uint32_t* bytes_read) {
       break;
   }
 
-  a2dp_sbc_encoder_cb.stats.media_read_total_expected_reads_count++;
-  if (sbc_sampling == a2dp_sbc_encoder_cb.feeding_params.sample_rate) {
-    read_size =
-        bytes_needed - a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue;
-    a2dp_sbc_encoder_cb.stats.media_read_total_expected_read_bytes += read_size;
-    nb_byte_read = a2dp_sbc_encoder_cb.read_callback(
-        ((uint8_t*)a2dp_sbc_encoder_cb.pcmBuffer) +
-            a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue,
-        read_size);
-    a2dp_sbc_encoder_cb.stats.media_read_total_actual_read_bytes +=
-        nb_byte_read;
-
-    *bytes_read = nb_byte_read;
-    if (nb_byte_read != read_size) {
-      a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue += nb_byte_read;
-      return false;
+  *bytes_read = 0;
+  if (sbc_sampling != a2dp_sbc_encoder_cb.feeding_params.sample_rate) {
+    for (nb_frame_read = 0; nb_frame_read < nb_frame; nb_frame_read++) {
+      if (!a2dp_sbc_read_up_sampled(pcm + nb_frame_read * bytes_needed,
+                                    sbc_sampling, bytes_needed))
+        break;
     }
+    return nb_frame_read;
+  }
+
+  /* A partial frame left by the last read is at the start of pcmBuffer */
+  a2dp_sbc_encoder_cb.stats.media_read_total_expected_reads_count++;
+  residue = a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue;
+  read_size = nb_frame * bytes_needed - residue;
+  a2dp_sbc_encoder_cb.stats.media_read_total_expected_read_bytes += read_size;
+  nb_byte_read = a2dp_sbc_encoder_cb.read_callback(pcm + residue, read_size);
+  a2dp_sbc_encoder_cb.stats.media_read_total_actual_read_bytes += nb_byte_read;
+  *bytes_read = nb_byte_read;
+
+  residue += nb_byte_read;
+  nb_frame_read = residue / bytes_needed;
+  residue -= nb_frame_read * bytes_needed;
+  if (nb_frame_read != 0 && residue != 0) {
+    memmove(pcm, pcm + nb_frame_read * bytes_needed, residue);
+  }
+  a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue = residue;
+  if (nb_byte_read == read_size) {
     a2dp_sbc_encoder_cb.stats.media_read_total_actual_reads_count++;
-    a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue = 0;
-    return true;
   }
+  return nb_frame_read;
+}
+
+// Reads and up-samples the PCM data of one frame of |bytes_needed| bytes at
+// |sbc_sampling| Hz into |pcm|. Returns false if there is not enough data
+// yet.
+static bool a2dp_sbc_read_up_sampled(uint8_t* pcm, uint32_t sbc_sampling,
+                                     uint16_t bytes_needed) {
+  SBC_ENC_PARAMS* p_encoder_params = &a2dp_sbc_encoder_cb.sbc_encoder_params;
+  uint16_t blocm_x_subband =
+      p_encoder_params->s16NumOfSubBands * p_encoder_params->s16NumOfBlocks;
+  uint32_t read_size;
+  uint32_t src_samples;
+  static uint16_t up_sampled_buffer[SBC_MAX_NUM_FRAME * SBC_MAX_NUM_OF_BLOCKS *
+                                    SBC_MAX_NUM_OF_CHANNELS *
+                                    SBC_MAX_NUM_OF_SUBBANDS * 2];
+  static uint16_t read_buffer[SBC_MAX_NUM_FRAME * SBC_MAX_NUM_OF_BLOCKS *
+                              SBC_MAX_NUM_OF_CHANNELS *
+                              SBC_MAX_NUM_OF_SUBBANDS];
+  uint32_t src_size_used;
+  uint32_t dst_size_used;
+  bool fract_needed;
+  int32_t fract_max;
+  int32_t fract_threshold;
+  uint32_t nb_byte_read;
+
+  a2dp_sbc_encoder_cb.stats.media_read_total_expected_reads_count++;
 
   /*
    * Some Feeding PCM frequencies require to split the number of sample
@@ -810,8 +868,7 @@ static bool a2dp_sbc_read_feeding(uint32_t* bytes_read) {
     return false;
 
   /* Copy the output pcm samples in SBC encoding buffer */
-  memcpy((uint8_t*)a2dp_sbc_encoder_cb.pcmBuffer, (uint8_t*)up_sampled_buffer,
-         bytes_needed);
+  memcpy(pcm, (uint8_t*)up_sampled_buffer, bytes_needed);
   /* update the residue */
   a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue -= bytes_needed;
 
@@ -86,6 +86,49 @@ void btm_acl_init(void) {
   btm_cb.acl_disc_reason = 0xff;
 }
 
+/*******************************************************************************
+ *
+ * Function         btm_acl_reindex_handle
+ *
+ * Description      Point the handle index entry for |hci_handle| at the first
+ *                  active acl_db entry using that handle.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_acl_reindex_handle(uint16_t hci_handle) {
+  uint8_t xx;
+
+  if (hci_handle >= HCI_NUM_HANDLES) return;
+
+  btm_cb.acl_index_by_handle[hci_handle] = 0;
+  for (xx = 0; xx < MAX_L2CAP_LINKS; xx++) {
+    if (btm_cb.acl_db[xx].in_use &&
+        btm_cb.acl_db[xx].hci_handle == hci_handle) {
+      btm_cb.acl_index_by_handle[hci_handle] = xx + 1;
+      break;
+    }
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_acl_set_handle
+ *
+ * Description      Set the HCI handle of an acl_db entry and update the handle
+ *                  index.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_acl_set_handle(tACL_CONN* p, uint16_t hci_handle) {
+  uint16_t old_handle = p->hci_handle;
+
+  p->hci_handle = hci_handle;
+  btm_acl_reindex_handle(old_handle);
+  btm_acl_reindex_handle(hci_handle);
+}
+
 /*******************************************************************************
  *
  * Function         btm_get_bredr_acl_count
@@ -157,6 +200,11 @@ uint8_t btm_handle_to_acl_index(uint16_t hci_handle) {
   tACL_CONN* p = &btm_cb.acl_db[0];
   uint8_t xx;
   BTM_TRACE_DEBUG("btm_handle_to_acl_index");
+  if (hci_handle < HCI_NUM_HANDLES) {
+    xx = btm_cb.acl_index_by_handle[hci_handle];
+    return (xx ? xx - 1 : MAX_L2CAP_LINKS);
+  }
+
   for (xx = 0; xx < MAX_L2CAP_LINKS; xx++, p++) {
     if ((p->in_use) && (p->hci_handle == hci_handle)) {
       break;
@@ -240,7 +288,7 @@ void btm_acl_created(const RawAddress& bda, DEV_CLASS dc, BD_NAME bdn,
   /* Ensure we don't have duplicates */
   p = btm_bda_to_acl(bda, transport);
   if (p != (tACL_CONN*)NULL) {
-    p->hci_handle = hci_handle;
+    btm_acl_set_handle(p, hci_handle);
     p->link_role = link_role;
     p->transport = transport;
     VLOG(1) << "Duplicate btm_acl_created: RemBdAddr: " << bda;
@@ -253,7 +301,7 @@ void btm_acl_created(const RawAddress& bda, DEV_CLASS dc, BD_NAME bdn,
   for (xx = 0, p = &btm_cb.acl_db[0]; xx < MAX_L2CAP_LINKS; xx++, p++) {
     if (!p->in_use) {
       p->in_use = true;
-      p->hci_handle = hci_handle;
+      btm_acl_set_handle(p, hci_handle);
       p->link_role = link_role;
       p->link_up_issued = false;
       p->remote_addr = bda;
@@ -405,6 +453,7 @@ void btm_acl_removed(const RawAddress& bda, tBT_TRANSPORT transport) {
   p = btm_bda_to_acl(bda, transport);
   if (p != (tACL_CONN*)NULL) {
     p->in_use = false;
+    btm_acl_reindex_handle(p->hci_handle);
 
     /* if the disconnected channel has a pending role switch, clear it now */
     btm_acl_report_role_change(HCI_ERR_NO_CONNECTION, &bda);
@@ -23,16 +23,23 @@
  ******************************************************************************/
 
 #include <base/bind.h>
+#include <stdio.h>
 #include <string.h>
 
+#include <algorithm>
+#include <vector>
+
 #include "bt_types.h"
+#include "btm_device_table.h"
 #include "btm_int.h"
 #include "btu.h"
 #include "device/include/controller.h"
 #include "gap_api.h"
 #include "hcimsgs.h"
+#include "osi/include/time.h"
 
 #include "btm_ble_int.h"
+#include "stack/crypto_toolbox/aes_fast.h"
 #include "stack/crypto_toolbox/crypto_toolbox.h"
 
 /* This function generates Resolvable Private Address (RPA) from Identity
@@ -216,31 +223,150 @@ bool btm_ble_addr_resolvable(const RawAddress& rpa,
   return false;
 }
 
-/** This function match the random address to the appointed device record,
- * starting from calculating IRK. If the record index exceeds the maximum record
- * number, matching failed and send a callback. */
-static bool btm_ble_match_random_bda(void* data, void* context) {
-  BTM_TRACE_EVENT("%s next iteration", __func__);
-  RawAddress* random_bda = (RawAddress*)context;
+namespace {
+
+/* Resolves peer RPAs against the IRKs of the security records, remembering
+ * the outcome.
+ *
+ * Resolved addresses and addresses matching no IRK are kept in separate
+ * tables, so the many unknown devices of a busy scan cannot push out bonded
+ * ones. Entries expire after BTM_BLE_RPA_CACHE_TTL_MS. The IRKs are keyed once
+ * into a snapshot of the records, which is checked in a single pass on a
+ * miss.
+ *
+ * Cached records are only valid until the next Flush(), which must follow any
+ * change to the IRKs or to the set of records. Records are added to the
+ * snapshot before they are known to be LE, so the LE bit is checked on each
+ * match, and an address whose IRK belongs to a record that is not LE yet is
+ * not cached. */
+class RpaResolver {
+ public:
+  RpaResolver()
+      : resolved(BTM_BLE_RPA_CACHE_SIZE),
+        resolved_items(BTM_BLE_RPA_CACHE_SIZE),
+        unresolved(BTM_BLE_RPA_NEG_CACHE_SIZE),
+        unresolved_expiry(BTM_BLE_RPA_NEG_CACHE_SIZE) {}
+
+  tBTM_SEC_DEV_REC* Resolve(const RawAddress& rpa) {
+    period_ms_t now = time_get_os_boottime_ms();
+
+    size_t slot = resolved.Find(rpa);
+    if (slot != resolved.kNoSlot) {
+      if (resolved_items[slot].expiry_ms > now) {
+        resolved.Touch(slot);
+        stats.hits++;
+        return resolved_items[slot].p_dev_rec;
+      }
+      resolved.EraseSlot(slot);
+      stats.expired++;
+    }
 
-  tBTM_SEC_DEV_REC* p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(data);
+    slot = unresolved.Find(rpa);
+    if (slot != unresolved.kNoSlot) {
+      if (unresolved_expiry[slot] > now) {
+        unresolved.Touch(slot);
+        stats.negative_hits++;
+        return nullptr;
+      }
+      unresolved.EraseSlot(slot);
+      stats.expired++;
+    }
 
-  BTM_TRACE_DEBUG("sec_flags = %02x device_type = %d", p_dev_rec->sec_flags,
-                  p_dev_rec->device_type);
+    stats.misses++;
+    bool cacheable = true;
+    tBTM_SEC_DEV_REC* p_dev_rec = MatchIrks(rpa, &cacheable);
+    if (!cacheable) return p_dev_rec;
 
-  if (!(p_dev_rec->device_type & BT_DEVICE_TYPE_BLE) ||
-      !(p_dev_rec->ble.key_type & BTM_LE_KEY_PID))
-    return true;
+    if (p_dev_rec != nullptr) {
+      slot = resolved.Insert(rpa, NULL);
+      resolved_items[slot] = {p_dev_rec, now + BTM_BLE_RPA_CACHE_TTL_MS};
+    } else {
+      slot = unresolved.Insert(rpa, NULL);
+      unresolved_expiry[slot] = now + BTM_BLE_RPA_CACHE_TTL_MS;
+    }
+    return p_dev_rec;
+  }
 
-  if (rpa_matches_irk(*random_bda, p_dev_rec->ble.keys.irk)) {
-    BTM_TRACE_EVENT("match is found");
-    // if it was match, finish iteration, otherwise continue
-    return false;
+  void Flush() {
+    resolved.Clear();
+    unresolved.Clear();
+    irks.clear();
+    irks_loaded = false;
+    stats.flushes++;
   }
 
-  // not a match, continue iteration
-  return true;
-}
+  tBTM_BLE_RPA_CACHE_STATS stats = {};
+
+ private:
+  struct Resolved {
+    tBTM_SEC_DEV_REC* p_dev_rec;
+    period_ms_t expiry_ms;
+  };
+
+  struct Irk {
+    crypto_toolbox::Aes128Key key;
+    tBTM_SEC_DEV_REC* p_dev_rec;
+  };
+
+  /* Returns the first LE record, in list order, whose IRK generated |rpa|.
+   * |p_cacheable| is cleared if a record that is not LE matched. */
+  tBTM_SEC_DEV_REC* MatchIrks(const RawAddress& rpa, bool* p_cacheable) {
+    if (!irks_loaded) LoadIrks();
+
+    /* ah(IRK, prand) encrypts prand padded with zeros. In FIPS-197 byte order
+     * the padding comes first and the 3 MSB of the address are the prand. */
+    uint8_t prand[OCTET16_LEN] = {0};
+    prand[13] = rpa.address[0];
+    prand[14] = rpa.address[1];
+    prand[15] = rpa.address[2];
+
+    for (const Irk& irk : irks) {
+      uint8_t x[OCTET16_LEN];
+      crypto_toolbox::aes_128_encrypt_block(irk.key, prand, x);
+      stats.irk_checks++;
+      if (x[15] != rpa.address[5] || x[14] != rpa.address[4] ||
+          x[13] != rpa.address[3])
+        continue;
+
+      if (irk.p_dev_rec->device_type & BT_DEVICE_TYPE_BLE)
+        return irk.p_dev_rec;
+      *p_cacheable = false;
+    }
+    return nullptr;
+  }
+
+  void LoadIrks() {
+    irks.clear();
+    list_node_t* end = list_end(btm_cb.sec_dev_rec);
+    for (list_node_t* node = list_begin(btm_cb.sec_dev_rec); node != end;
+         node = list_next(node)) {
+      tBTM_SEC_DEV_REC* p_dev_rec =
+          static_cast<tBTM_SEC_DEV_REC*>(list_node(node));
+      if (!(p_dev_rec->ble.key_type & BTM_LE_KEY_PID)) continue;
+
+      /* The IRK is stored in little endian byte order */
+      uint8_t key[OCTET16_LEN];
+      std::reverse_copy(p_dev_rec->ble.keys.irk.begin(),
+                        p_dev_rec->ble.keys.irk.end(), key);
+      irks.emplace_back();
+      crypto_toolbox::aes_128_expand_key(&irks.back().key, key);
+      irks.back().p_dev_rec = p_dev_rec;
+    }
+    irks_loaded = true;
+  }
+
+  BtmDeviceTable<RawAddress, BtmAddressHash> resolved;
+  std::vector<Resolved> resolved_items;
+  BtmDeviceTable<RawAddress, BtmAddressHash> unresolved;
+  std::vector<period_ms_t> unresolved_expiry;
+
+  std::vector<Irk> irks;
+  bool irks_loaded = false;
+};
+
+RpaResolver rpa_resolver;
+
+}  // namespace
 
 /** This function is called to resolve a random address.
  * Returns pointer to the security record of the device whom a random address is
@@ -249,19 +375,53 @@ static bool btm_ble_match_random_bda(void* data, void* context) {
 tBTM_SEC_DEV_REC* btm_ble_resolve_random_addr(const RawAddress& random_bda) {
   BTM_TRACE_EVENT("%s", __func__);
 
-  /* start to resolve random address */
-  /* check for next security record */
-
-  list_node_t* n = list_foreach(btm_cb.sec_dev_rec, btm_ble_match_random_bda,
-                                (void*)&random_bda);
-  tBTM_SEC_DEV_REC* p_dev_rec = nullptr;
-  if (n != nullptr) p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+  tBTM_SEC_DEV_REC* p_dev_rec = rpa_resolver.Resolve(random_bda);
 
   BTM_TRACE_EVENT("%s:  %sresolved", __func__,
                   (p_dev_rec == nullptr ? "not " : ""));
   return p_dev_rec;
 }
 
+/** This function drops every cached RPA resolution. It is called when a
+ * security record is freed or its IRK is set or cleared. */
+void btm_ble_rpa_cache_flush(void) { rpa_resolver.Flush(); }
+
+void btm_ble_rpa_cache_get_stats(tBTM_BLE_RPA_CACHE_STATS* p_stats) {
+  *p_stats = rpa_resolver.stats;
+}
+
+/*******************************************************************************
+ *
+ * Function         BTM_BleRpaCacheDumpStatistics
+ *
+ * Description      Write the RPA resolution cache counters to |fd|.
+ *
+ ******************************************************************************/
+void BTM_BleRpaCacheDumpStatistics(int fd) {
+  const tBTM_BLE_RPA_CACHE_STATS& stats = rpa_resolver.stats;
+  uint64_t lookups = stats.hits + stats.negative_hits + stats.misses;
+
+  dprintf(fd, "\nLE RPA resolution cache:\n");
+  dprintf(fd, "  Lookups                      : %llu\n",
+          (unsigned long long)lookups);
+  dprintf(fd, "  Resolved from cache          : %llu\n",
+          (unsigned long long)stats.hits);
+  dprintf(fd, "  Unresolvable from cache      : %llu\n",
+          (unsigned long long)stats.negative_hits);
+  dprintf(fd, "  Misses (expired)             : %llu (%llu)\n",
+          (unsigned long long)stats.misses,
+          (unsigned long long)stats.expired);
+  dprintf(fd, "  Hit rate                     : %llu%%\n",
+          (unsigned long long)(lookups
+                                   ? (stats.hits + stats.negative_hits) * 100 /
+                                         lookups
+                                   : 0));
+  dprintf(fd, "  IRKs checked                 : %llu\n",
+          (unsigned long long)stats.irk_checks);
+  dprintf(fd, "  Flushes                      : %llu\n",
+          (unsigned long long)stats.flushes);
+}
+
 /*******************************************************************************
  *  address mapping between pseudo address and real connection address
  ******************************************************************************/
@@ -30,12 +30,12 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <string.h>
-#include <list>
 #include <vector>
 
 #include "bt_types.h"
 #include "bt_utils.h"
 #include "btm_ble_api.h"
+#include "btm_device_table.h"
 #include "btm_int.h"
 #include "btu.h"
 #include "device/include/controller.h"
@@ -67,70 +67,64 @@ namespace {
 
 class AdvertisingCache {
  public:
+  AdvertisingCache()
+      : table(BTM_BLE_ADV_CACHE_SIZE), items(BTM_BLE_ADV_CACHE_SIZE) {}
+
   /* Set the data to |data| for device |addr_type, addr| */
   const std::vector<uint8_t>& Set(uint8_t addr_type, const RawAddress& addr,
-                                  std::vector<uint8_t> data) {
-    auto it = Find(addr_type, addr);
-    if (it != items.end()) {
-      it->data = std::move(data);
-      return it->data;
-    }
-
-    if (items.size() > cache_max) {
-      items.pop_back();
-    }
-
-    items.emplace_front(addr_type, addr, std::move(data));
-    return items.front().data;
+                                  const std::vector<uint8_t>& data) {
+    size_t slot = table.Insert({addr_type, addr}, NULL);
+    items[slot].assign(data.begin(), data.end());
+    return items[slot];
   }
 
   /* Append |data| for device |addr_type, addr| */
   const std::vector<uint8_t>& Append(uint8_t addr_type, const RawAddress& addr,
-                                     std::vector<uint8_t> data) {
-    auto it = Find(addr_type, addr);
-    if (it != items.end()) {
-      it->data.insert(it->data.end(), data.begin(), data.end());
-      return it->data;
-    }
-
-    if (items.size() > cache_max) {
-      items.pop_back();
+                                     const std::vector<uint8_t>& data) {
+    bool is_new;
+    size_t slot = table.Insert({addr_type, addr}, &is_new);
+    if (is_new) {
+      items[slot].assign(data.begin(), data.end());
+    } else {
+      items[slot].insert(items[slot].end(), data.begin(), data.end());
     }
+    return items[slot];
+  }
 
-    items.emplace_front(addr_type, addr, std::move(data));
-    return items.front().data;
+  /* Return true if data is held for device |addr_type, addr| */
+  bool Contains(uint8_t addr_type, const RawAddress& addr) const {
+    return table.Find({addr_type, addr}) != table.kNoSlot;
   }
 
   /* Clear data for device |addr_type, addr| */
   void Clear(uint8_t addr_type, const RawAddress& addr) {
-    auto it = Find(addr_type, addr);
-    if (it != items.end()) {
-      items.erase(it);
+    size_t slot = table.Find({addr_type, addr});
+    if (slot != table.kNoSlot) {
+      table.EraseSlot(slot);
+      items[slot].clear();
     }
   }
 
  private:
-  struct Item {
+  struct Key {
     uint8_t addr_type;
     RawAddress addr;
-    std::vector<uint8_t> data;
 
-    Item(uint8_t addr_type, const RawAddress& addr, std::vector<uint8_t> data)
-        : addr_type(addr_type), addr(addr), data(data) {}
+    bool operator==(const Key& other) const {
+      return addr_type == other.addr_type && addr == other.addr;
+    }
   };
 
-  std::list<Item>::iterator Find(uint8_t addr_type, const RawAddress& addr) {
-    for (auto it = items.begin(); it != items.end(); it++) {
-      if (it->addr_type == addr_type && it->addr == addr) {
-        return it;
-      }
+  struct KeyHash {
+    std::size_t operator()(const Key& key) const {
+      return BtmAddressHash()(key.addr) ^ (key.addr_type << 16);
     }
-    return items.end();
-  }
+  };
 
-  /* we keep maximum 7 devices in the cache */
-  const size_t cache_max = 7;
-  std::list<Item> items;
+  /* Devices are dropped least recently updated first once the cache is full.
+   * Their buffers are kept for the next device taking the slot. */
+  BtmDeviceTable<Key, KeyHash> table;
+  std::vector<std::vector<uint8_t>> items;
 };
 
 /* Devices in this cache are waiting for eiter scan response, or chained packets
@@ -1835,7 +1829,7 @@ void btm_clear_all_pending_le_entry(void) {
     if ((p_ent->in_use) &&
         (p_ent->inq_info.results.device_type == BT_DEVICE_TYPE_BLE) &&
         !p_ent->scan_rsp)
-      p_ent->in_use = false;
+      btm_inq_db_free(p_ent);
   }
 }
 
@@ -2018,8 +2012,10 @@ static void btm_ble_process_adv_pkt_cont(
   tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
   bool update = true;
 
-  std::vector<uint8_t> tmp;
-  if (data_len != 0) tmp.insert(tmp.begin(), data, data + data_len);
+  // Reused for every report, so that reports are handled without allocating.
+  // Only used on the btu thread.
+  static std::vector<uint8_t> tmp;
+  tmp.assign(data, data + data_len);
 
   bool is_scannable = ble_evt_type_is_scannable(evt_type);
   bool is_scan_resp = ble_evt_type_is_scan_resp(evt_type);
@@ -2030,14 +2026,24 @@ static void btm_ble_process_adv_pkt_cont(
   if (ble_evt_type_is_legacy(evt_type))
     AdvertiseDataParser::RemoveTrailingZeros(tmp);
 
-  // We might have send scan request to this device before, but didn't get the
-  // response. In such case make sure data is put at start, not appended to
-  // already existing data.
-  std::vector<uint8_t> const& adv_data =
-      is_start ? cache.Set(addr_type, bda, std::move(tmp))
-               : cache.Append(addr_type, bda, std::move(tmp));
-
   bool data_complete = (ble_evt_type_data_status(evt_type) != 0x01);
+  bool is_active_scan =
+      btm_cb.ble_ctr_cb.inq_var.scan_type == BTM_BLE_SCAN_MODE_ACTI;
+  bool is_waiting =
+      !data_complete || (is_active_scan && is_scannable && !is_scan_resp);
+
+  // Only data that is incomplete, or completes data received earlier, needs
+  // to go through the cache. We might have send scan request to this device
+  // before, but didn't get the response. In such case make sure data is put at
+  // start, not appended to already existing data.
+  const std::vector<uint8_t>* p_adv_data = &tmp;
+  if (is_waiting || (!is_start && cache.Contains(addr_type, bda))) {
+    p_adv_data = is_start ? &cache.Set(addr_type, bda, tmp)
+                          : &cache.Append(addr_type, bda, tmp);
+  } else if (is_start) {
+    cache.Clear(addr_type, bda);
+  }
+  std::vector<uint8_t> const& adv_data = *p_adv_data;
 
   if (!data_complete) {
     // If we didn't receive whole adv data yet, don't report the device.
@@ -2045,8 +2051,6 @@ static void btm_ble_process_adv_pkt_cont(
     return;
   }
 
-  bool is_active_scan =
-      btm_cb.ble_ctr_cb.inq_var.scan_type == BTM_BLE_SCAN_MODE_ACTI;
   if (is_active_scan && is_scannable && !is_scan_resp) {
     // If we didn't receive scan response yet, don't report the device.
     VLOG(1) << " Waiting for scan response " << bda;
@@ -2089,7 +2093,7 @@ static void btm_ble_process_adv_pkt_cont(
     p_inq->inq_cmpl_info.num_resp++;
   }
 
-  p_i->time_of_resp = time_get_os_boottime_ms();
+  btm_inq_db_touch(p_i);
 
   /* update the LE device information in inquiry database */
   btm_ble_update_inq_result(p_i, addr_type, bda, evt_type, primary_phy,
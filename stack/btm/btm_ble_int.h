@@ -139,6 +139,8 @@ extern void btm_gen_non_resolvable_private_addr(tBTM_BLE_ADDR_CBACK* p_cback,
                                                 void* p);
 extern tBTM_SEC_DEV_REC* btm_ble_resolve_random_addr(
     const RawAddress& random_bda);
+extern void btm_ble_rpa_cache_flush(void);
+extern void btm_ble_rpa_cache_get_stats(tBTM_BLE_RPA_CACHE_STATS* p_stats);
 extern void btm_gen_resolve_paddr_low(const RawAddress& address);
 
 /*  privacy function */
@@ -128,6 +128,20 @@ typedef struct {
 /* 15 minutes minimum for random address refreshing */
 #define BTM_BLE_PRIVATE_ADDR_INT_MS (15 * 60 * 1000)
 
+/* How long a peer RPA stays in the resolution cache. Peers should not keep an
+ * RPA for longer than the recommended timeout, which this matches. */
+#define BTM_BLE_RPA_CACHE_TTL_MS BTM_BLE_PRIVATE_ADDR_INT_MS
+
+/* Counters of btm_ble_resolve_random_addr() */
+typedef struct {
+  uint64_t hits;          /* resolved from the cache */
+  uint64_t negative_hits; /* known from the cache not to resolve */
+  uint64_t misses;        /* checked against the stored IRKs */
+  uint64_t expired;       /* misses due to an entry past its TTL */
+  uint64_t irk_checks;    /* IRKs evaluated on misses */
+  uint64_t flushes;       /* cache invalidations after key changes */
+} tBTM_BLE_RPA_CACHE_STATS;
+
 typedef struct {
   uint16_t discoverable_mode;
   uint16_t connectable_mode;
@@ -62,15 +62,30 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <unordered_map>
+
 #include "bt_common.h"
 #include "bt_types.h"
 #include "btm_api.h"
+#include "btm_device_table.h"
 #include "btm_int.h"
 #include "btu.h"
 #include "device/include/controller.h"
 #include "hcidefs.h"
 #include "hcimsgs.h"
 #include "l2c_api.h"
+#include "osi/include/allocator.h"
+
+// Records last found by btm_find_dev_by_handle and btm_find_dev. A hint is
+// only used after checking that the record still matches, and is dropped when
+// the record is freed, so a stale hint costs one full search.
+static std::unordered_map<uint16_t, tBTM_SEC_DEV_REC*> dev_rec_by_handle;
+static std::unordered_map<RawAddress, tBTM_SEC_DEV_REC*, BtmAddressHash>
+    dev_rec_by_addr;
+
+// Every private address a peer uses resolves to its record; start over rather
+// than let the address hints grow without bound.
+#define DEV_REC_MAX_ADDR_HINTS (2 * BTM_SEC_MAX_DEVICE_RECORDS)
 
 /*******************************************************************************
  *
@@ -394,6 +409,47 @@ bool btm_dev_support_switch(const RawAddress& bd_addr) {
   return (false);
 }
 
+/*******************************************************************************
+ *
+ * Function         btm_sec_dev_rec_free
+ *
+ * Description      Free callback of btm_cb.sec_dev_rec. Drops the lookup hints
+ *                  and cached RPA resolutions pointing at the record before
+ *                  freeing it.
+ *
+ ******************************************************************************/
+void btm_sec_dev_rec_free(void* data) {
+  tBTM_SEC_DEV_REC* p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(data);
+
+  for (auto it = dev_rec_by_handle.begin(); it != dev_rec_by_handle.end();) {
+    if (it->second == p_dev_rec)
+      it = dev_rec_by_handle.erase(it);
+    else
+      ++it;
+  }
+  for (auto it = dev_rec_by_addr.begin(); it != dev_rec_by_addr.end();) {
+    if (it->second == p_dev_rec)
+      it = dev_rec_by_addr.erase(it);
+    else
+      ++it;
+  }
+  btm_ble_rpa_cache_flush();
+
+  osi_free(p_dev_rec);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_dev_clear_lookup_hints
+ *
+ * Description      Drop all device record lookup hints.
+ *
+ ******************************************************************************/
+void btm_dev_clear_lookup_hints(void) {
+  dev_rec_by_handle.clear();
+  dev_rec_by_addr.clear();
+}
+
 bool is_handle_equal(void* data, void* context) {
   tBTM_SEC_DEV_REC* p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(data);
   uint16_t* handle = static_cast<uint16_t*>(context);
@@ -415,8 +471,22 @@ bool is_handle_equal(void* data, void* context) {
  *
  ******************************************************************************/
 tBTM_SEC_DEV_REC* btm_find_dev_by_handle(uint16_t handle) {
+  /* Many records share BTM_SEC_INVALID_HANDLE; only hint real handles */
+  bool use_hint = handle < HCI_NUM_HANDLES;
+
+  if (use_hint) {
+    auto hint = dev_rec_by_handle.find(handle);
+    if (hint != dev_rec_by_handle.end() &&
+        !is_handle_equal(hint->second, &handle))
+      return hint->second;
+  }
+
   list_node_t* n = list_foreach(btm_cb.sec_dev_rec, is_handle_equal, &handle);
-  if (n) return static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+  if (n) {
+    tBTM_SEC_DEV_REC* p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+    if (use_hint) dev_rec_by_handle[handle] = p_dev_rec;
+    return p_dev_rec;
+  }
 
   return NULL;
 }
@@ -445,9 +515,20 @@ bool is_address_equal(void* data, void* context) {
  *
  ******************************************************************************/
 tBTM_SEC_DEV_REC* btm_find_dev(const RawAddress& bd_addr) {
+  auto hint = dev_rec_by_addr.find(bd_addr);
+  if (hint != dev_rec_by_addr.end() &&
+      !is_address_equal(hint->second, (void*)&bd_addr))
+    return hint->second;
+
   list_node_t* n =
       list_foreach(btm_cb.sec_dev_rec, is_address_equal, (void*)&bd_addr);
-  if (n) return static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+  if (n) {
+    tBTM_SEC_DEV_REC* p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+    if (dev_rec_by_addr.size() >= DEV_REC_MAX_ADDR_HINTS)
+      dev_rec_by_addr.clear();
+    dev_rec_by_addr[bd_addr] = p_dev_rec;
+    return p_dev_rec;
+  }
 
   return NULL;
 }
@@ -466,6 +547,10 @@ void btm_consolidate_dev(tBTM_SEC_DEV_REC* p_target_rec) {
 
   BTM_TRACE_DEBUG("%s", __func__);
 
+  /* Records are about to be merged; which one matches an address or handle
+   * first may change */
+  btm_dev_clear_lookup_hints();
+
   list_node_t* end = list_end(btm_cb.sec_dev_rec);
   list_node_t* node = list_begin(btm_cb.sec_dev_rec);
   while (node != end) {
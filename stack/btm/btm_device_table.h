@@ -0,0 +1,187 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include <base/logging.h>
+
+#include "raw_address.h"
+
+struct BtmAddressHash {
+  std::size_t operator()(const RawAddress& x) const {
+    const uint8_t* a = x.address;
+    return a[0] ^ (a[1] << 8) ^ (a[2] << 16) ^ (a[3] << 24) ^ a[4] ^
+           (a[5] << 8);
+  }
+};
+
+/* A bounded table of per-device state, looked up by hashing |Key|.
+ *
+ * The table only hands out slot numbers in [0, capacity()); callers keep the
+ * state itself in an array of that size, so pointers to it stay valid while
+ * the device is in the table. Once every slot is used, adding a device evicts
+ * the one least recently added or touched.
+ *
+ * Not thread-safe; BTM uses it from the btu thread only. */
+template <typename Key, typename Hash>
+class BtmDeviceTable {
+ public:
+  static constexpr size_t kNoSlot = SIZE_MAX;
+
+  explicit BtmDeviceTable(size_t capacity) : slots_(capacity) {
+    CHECK(capacity > 0);
+    index_.reserve(capacity);
+    Clear();
+  }
+
+  size_t capacity() const { return slots_.size(); }
+  size_t size() const { return index_.size(); }
+
+  /* Returns the slot of |key|, or kNoSlot. Does not change its recency. */
+  size_t Find(const Key& key) const {
+    auto it = index_.find(key);
+    return it == index_.end() ? kNoSlot : it->second;
+  }
+
+  /* Returns the slot of |key|, adding it if needed, and marks it the most
+   * recently used. When added, |*is_new| is set and the slot may have been
+   * taken from another device; the caller must reset its state. |is_new| may
+   * be NULL. */
+  size_t Insert(const Key& key, bool* is_new) {
+    size_t slot = Find(key);
+    if (is_new) *is_new = (slot == kNoSlot);
+    if (slot != kNoSlot) {
+      Touch(slot);
+      return slot;
+    }
+
+    if (free_ != kNoSlot) {
+      slot = free_;
+      free_ = slots_[slot].next;
+    } else {
+      slot = lru_tail_;
+      Unlink(slot);
+      index_.erase(slots_[slot].key);
+    }
+
+    Assign(slot, key);
+    return slot;
+  }
+
+  /* Marks |slot|, which must be in use, as the most recently used. */
+  void Touch(size_t slot) {
+    CHECK(slot < slots_.size() && slots_[slot].in_use);
+    if (slot == lru_head_) return;
+    Unlink(slot);
+    LinkHead(slot);
+  }
+
+  /* Removes the device in |slot|, if any. */
+  void EraseSlot(size_t slot) {
+    CHECK(slot < slots_.size());
+    if (!slots_[slot].in_use) return;
+    Unlink(slot);
+    index_.erase(slots_[slot].key);
+    slots_[slot].in_use = false;
+    slots_[slot].next = free_;
+    free_ = slot;
+  }
+
+  /* Removes |key|, if present. */
+  void Erase(const Key& key) {
+    size_t slot = Find(key);
+    if (slot != kNoSlot) EraseSlot(slot);
+  }
+
+  /* Places |key|, which must not be in the table, in the free |slot| as the
+   * most recently used. For callers rebuilding the table from their own
+   * state. */
+  void Restore(size_t slot, const Key& key) {
+    CHECK(slot < slots_.size() && !slots_[slot].in_use);
+    CHECK(Find(key) == kNoSlot);
+
+    size_t* p_free = &free_;
+    while (*p_free != slot) p_free = &slots_[*p_free].next;
+    *p_free = slots_[slot].next;
+
+    Assign(slot, key);
+  }
+
+  /* Removes every device. */
+  void Clear() {
+    index_.clear();
+    lru_head_ = lru_tail_ = kNoSlot;
+    free_ = kNoSlot;
+    for (size_t slot = slots_.size(); slot-- > 0;) {
+      slots_[slot].in_use = false;
+      slots_[slot].next = free_;
+      free_ = slot;
+    }
+  }
+
+ private:
+  struct Slot {
+    Key key;
+    bool in_use;
+    /* Neighbours in the recency list when in use; |next| links the free list
+     * otherwise. */
+    size_t prev;
+    size_t next;
+  };
+
+  void Assign(size_t slot, const Key& key) {
+    slots_[slot].key = key;
+    slots_[slot].in_use = true;
+    index_[key] = slot;
+    LinkHead(slot);
+  }
+
+  void LinkHead(size_t slot) {
+    slots_[slot].prev = kNoSlot;
+    slots_[slot].next = lru_head_;
+    if (lru_head_ != kNoSlot)
+      slots_[lru_head_].prev = slot;
+    else
+      lru_tail_ = slot;
+    lru_head_ = slot;
+  }
+
+  void Unlink(size_t slot) {
+    Slot& s = slots_[slot];
+    if (s.prev != kNoSlot)
+      slots_[s.prev].next = s.next;
+    else
+      lru_head_ = s.next;
+    if (s.next != kNoSlot)
+      slots_[s.next].prev = s.prev;
+    else
+      lru_tail_ = s.prev;
+  }
+
+  std::vector<Slot> slots_;
+  std::unordered_map<Key, size_t, Hash> index_;
+  size_t lru_head_;
+  size_t lru_tail_;
+  size_t free_;
+};
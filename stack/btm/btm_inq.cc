@@ -30,6 +30,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <algorithm>
+#include <unordered_map>
+
 #include "device/include/controller.h"
 #include "osi/include/osi.h"
 #include "osi/include/time.h"
@@ -38,6 +41,7 @@
 #include "bt_common.h"
 #include "bt_types.h"
 #include "btm_api.h"
+#include "btm_device_table.h"
 #include "btm_int.h"
 #include "btu.h"
 #include "hcidefs.h"
@@ -59,6 +63,15 @@ using bluetooth::Uuid;
 static const LAP general_inq_lap = {0x9e, 0x8b, 0x33};
 static const LAP limited_inq_lap = {0x9e, 0x8b, 0x00};
 
+/* Maps addresses to their index in btm_cb.btm_inq_vars.inq_db. When the
+ * database is full, the entry least recently found or answered is reused. */
+static BtmDeviceTable<RawAddress, BtmAddressHash> inq_db_index(
+    BTM_INQ_DB_SIZE);
+
+/* Position of each address in btm_cb.btm_inq_vars.p_bd_db */
+static std::unordered_map<RawAddress, uint16_t, BtmAddressHash>
+    inq_bd_db_index;
+
 const uint16_t BTM_EIR_UUID_LKUP_TBL[BTM_EIR_MAX_SERVICES] = {
     UUID_SERVCLASS_SERVICE_DISCOVERY_SERVER,
     /*    UUID_SERVCLASS_BROWSE_GROUP_DESCRIPTOR,   */
@@ -116,6 +129,7 @@ static void btm_initiate_inquiry(tBTM_INQUIRY_VAR_ST* p_inq);
 static tBTM_STATUS btm_set_inq_event_filter(uint8_t filter_cond_type,
                                             tBTM_INQ_FILT_COND* p_filt_cond);
 static void btm_clr_inq_result_flt(void);
+static void btm_inq_db_reindex(void);
 
 static uint8_t btm_convert_uuid_to_eir_service(uint16_t uuid16);
 static void btm_set_eir_uuid(uint8_t* p_eir, tBTM_INQ_RESULTS* p_results);
@@ -1222,6 +1236,9 @@ void btm_inq_db_reset(void) {
  *
  ******************************************************************************/
 void btm_inq_db_init(void) {
+  inq_db_index.Clear();
+  inq_bd_db_index.clear();
+
   alarm_free(btm_cb.btm_inq_vars.remote_name_timer);
   btm_cb.btm_inq_vars.remote_name_timer =
       alarm_new("btm_inq.remote_name_timer");
@@ -1302,7 +1319,7 @@ void btm_clr_inq_db(const RawAddress* p_bda) {
     if (p_ent->in_use) {
       /* If this is the specified BD_ADDR or clearing all devices */
       if (p_bda == NULL || (p_ent->inq_info.results.remote_bd_addr == *p_bda)) {
-        p_ent->in_use = false;
+        btm_inq_db_free(p_ent);
       }
     }
   }
@@ -1326,6 +1343,7 @@ static void btm_clr_inq_result_flt(void) {
   tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
 
   osi_free_and_reset((void**)&p_inq->p_bd_db);
+  inq_bd_db_index.clear();
   p_inq->num_bd_entries = 0;
   p_inq->max_bd_entries = 0;
 }
@@ -1343,21 +1361,26 @@ static void btm_clr_inq_result_flt(void) {
 bool btm_inq_find_bdaddr(const RawAddress& p_bda) {
   tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
   tINQ_BDADDR* p_db = &p_inq->p_bd_db[0];
-  uint16_t xx;
 
   /* Don't bother searching, database doesn't exist or periodic mode */
   if ((p_inq->inq_active & BTM_PERIODIC_INQUIRY_ACTIVE) || !p_db)
     return (false);
 
-  for (xx = 0; xx < p_inq->num_bd_entries; xx++, p_db++) {
-    if (p_db->bd_addr == p_bda && p_db->inq_count == p_inq->inq_counter)
-      return (true);
+  auto it = inq_bd_db_index.find(p_bda);
+  if (it != inq_bd_db_index.end()) {
+    p_db += it->second;
+    if (p_db->inq_count == p_inq->inq_counter) return (true);
+
+    /* Seen in an earlier inquiry; count it for this one */
+    p_db->inq_count = p_inq->inq_counter;
+    return (false);
   }
 
-  if (xx < p_inq->max_bd_entries) {
+  if (p_inq->num_bd_entries < p_inq->max_bd_entries) {
+    p_db += p_inq->num_bd_entries;
     p_db->inq_count = p_inq->inq_counter;
     p_db->bd_addr = p_bda;
-    p_inq->num_bd_entries++;
+    inq_bd_db_index[p_bda] = p_inq->num_bd_entries++;
   }
 
   /* If here, New Entry */
@@ -1375,16 +1398,10 @@ bool btm_inq_find_bdaddr(const RawAddress& p_bda) {
  *
  ******************************************************************************/
 tINQ_DB_ENT* btm_inq_db_find(const RawAddress& p_bda) {
-  uint16_t xx;
-  tINQ_DB_ENT* p_ent = btm_cb.btm_inq_vars.inq_db;
-
-  for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++) {
-    if (p_ent->in_use && p_ent->inq_info.results.remote_bd_addr == p_bda)
-      return (p_ent);
-  }
+  size_t xx = inq_db_index.Find(p_bda);
+  if (xx == inq_db_index.kNoSlot) return (NULL);
 
-  /* If here, not found */
-  return (NULL);
+  return (&btm_cb.btm_inq_vars.inq_db[xx]);
 }
 
 /*******************************************************************************
@@ -1392,40 +1409,85 @@ tINQ_DB_ENT* btm_inq_db_find(const RawAddress& p_bda) {
  * Function         btm_inq_db_new
  *
  * Description      This function looks through the inquiry database for an
- *                  unused entry. If no entry is free, it allocates the oldest
- *                  entry.
+ *                  unused entry. If no entry is free, it allocates the entry
+ *                  least recently found or touched.
  *
  * Returns          pointer to entry
  *
  ******************************************************************************/
 tINQ_DB_ENT* btm_inq_db_new(const RawAddress& p_bda) {
-  uint16_t xx;
-  tINQ_DB_ENT* p_ent = btm_cb.btm_inq_vars.inq_db;
-  tINQ_DB_ENT* p_old = btm_cb.btm_inq_vars.inq_db;
-  uint32_t ot = 0xFFFFFFFF;
+  size_t xx = inq_db_index.Insert(p_bda, NULL);
+  tINQ_DB_ENT* p_ent = &btm_cb.btm_inq_vars.inq_db[xx];
 
-  for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++) {
-    if (!p_ent->in_use) {
-      memset(p_ent, 0, sizeof(tINQ_DB_ENT));
-      p_ent->inq_info.results.remote_bd_addr = p_bda;
-      p_ent->in_use = true;
+  memset(p_ent, 0, sizeof(tINQ_DB_ENT));
+  p_ent->inq_info.results.remote_bd_addr = p_bda;
+  p_ent->in_use = true;
 
-      return (p_ent);
-    }
+  return (p_ent);
+}
 
-    if (p_ent->time_of_resp < ot) {
-      p_old = p_ent;
-      ot = p_ent->time_of_resp;
-    }
-  }
+/*******************************************************************************
+ *
+ * Function         btm_inq_db_touch
+ *
+ * Description      This function records a response from the device in the
+ *                  inquiry database entry |p_ent|, which makes it the last
+ *                  entry to be reused.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_inq_db_touch(tINQ_DB_ENT* p_ent) {
+  p_ent->time_of_resp = time_get_os_boottime_ms();
+  inq_db_index.Touch(p_ent - btm_cb.btm_inq_vars.inq_db);
+}
 
-  /* If here, no free entry found. Return the oldest. */
+/*******************************************************************************
+ *
+ * Function         btm_inq_db_free
+ *
+ * Description      This function removes the entry |p_ent| from the inquiry
+ *                  database.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_inq_db_free(tINQ_DB_ENT* p_ent) {
+  p_ent->in_use = false;
+  inq_db_index.EraseSlot(p_ent - btm_cb.btm_inq_vars.inq_db);
+}
 
-  memset(p_old, 0, sizeof(tINQ_DB_ENT));
-  p_old->inq_info.results.remote_bd_addr = p_bda;
-  p_old->in_use = true;
+/*******************************************************************************
+ *
+ * Function         btm_inq_db_reindex
+ *
+ * Description      This function rebuilds the address index after entries of
+ *                  the inquiry database were moved, keeping the oldest
+ *                  responses first in line for reuse.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_inq_db_reindex(void) {
+  tINQ_DB_ENT* p_db = btm_cb.btm_inq_vars.inq_db;
+  std::vector<uint16_t> order;
 
-  return (p_old);
+  inq_db_index.Clear();
+  for (uint16_t xx = 0; xx < BTM_INQ_DB_SIZE; xx++) {
+    if (p_db[xx].in_use) order.push_back(xx);
+  }
+  std::stable_sort(order.begin(), order.end(), [p_db](uint16_t a, uint16_t b) {
+    return p_db[a].time_of_resp < p_db[b].time_of_resp;
+  });
+
+  for (uint16_t xx : order) {
+    if (inq_db_index.Find(p_db[xx].inq_info.results.remote_bd_addr) ==
+        inq_db_index.kNoSlot) {
+      inq_db_index.Restore(xx, p_db[xx].inq_info.results.remote_bd_addr);
+    } else {
+      p_db[xx].in_use = false;
+    }
+  }
 }
 
 /*******************************************************************************
@@ -1820,7 +1882,7 @@ void btm_process_inq_results(uint8_t* p, uint8_t inq_res_mode) {
       BTM_TRACE_WARNING ("btm_process_inq_results: Dev class: %02x-%02x-%02x",
                   p_cur->dev_class[0], p_cur->dev_class[1], p_cur->dev_class[2]);
 
-      p_i->time_of_resp = time_get_os_boottime_ms();
+      btm_inq_db_touch(p_i);
 
       if (p_i->inq_count != p_inq->inq_counter)
         p_inq->inq_cmpl_info.num_resp++; /* A new response was found */
@@ -1905,6 +1967,7 @@ void btm_sort_inq_result(void) {
   }
 
   osi_free(p_tmp);
+  btm_inq_db_reindex();
 }
 
 /*******************************************************************************
@@ -215,6 +215,8 @@ extern bool btm_dev_support_switch(const RawAddress& bd_addr);
 extern tBTM_SEC_DEV_REC* btm_sec_allocate_dev_rec(void);
 extern tBTM_SEC_DEV_REC* btm_sec_alloc_dev(const RawAddress& bd_addr);
 extern void btm_sec_free_dev(tBTM_SEC_DEV_REC* p_dev_rec);
+extern void btm_sec_dev_rec_free(void* data);
+extern void btm_dev_clear_lookup_hints(void);
 extern tBTM_SEC_DEV_REC* btm_find_dev(const RawAddress& bd_addr);
 extern tBTM_SEC_DEV_REC* btm_find_or_alloc_dev(const RawAddress& bd_addr);
 extern tBTM_SEC_DEV_REC* btm_find_dev_by_handle(uint16_t handle);
@@ -287,6 +289,8 @@ extern tL2CAP_LE_RESULT_CODE btm_ble_start_sec_check(
     tBTM_SEC_CALLBACK* p_callback, void* p_ref_data);
 
 extern tINQ_DB_ENT* btm_inq_db_new(const RawAddress& p_bda);
+extern void btm_inq_db_touch(tINQ_DB_ENT* p_ent);
+extern void btm_inq_db_free(tINQ_DB_ENT* p_ent);
 
 extern void btm_rem_oob_req(uint8_t* p);
 extern void btm_read_local_oob_complete(uint8_t* p);
@@ -806,6 +806,8 @@ typedef struct {
   **      ACL Management
   ****************************************************/
   tACL_CONN acl_db[MAX_L2CAP_LINKS];
+  /* For each HCI handle, 1 + index of the acl_db entry using it, or 0 */
+  uint8_t acl_index_by_handle[HCI_NUM_HANDLES];
   uint8_t btm_scn[BTM_MAX_SCN]; /* current SCNs: true if SCN is in use */
   uint16_t btm_def_link_policy;
   uint16_t btm_def_link_super_tout;
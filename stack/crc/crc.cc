@@ -0,0 +1,201 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "stack/crc/crc.h"
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace bluetooth {
+namespace crc {
+
+namespace {
+
+/* Generators, bit reversed */
+constexpr uint16_t kCrc16Poly = 0xa001;
+constexpr uint8_t kCrc8Poly = 0xe0;
+
+/* Below this length crc16() does not set up the carry-less folding */
+constexpr size_t kClmulMinLen = 64;
+
+/* t[0] is the usual byte table. t[k][x] is the CRC of byte x followed by k
+ * zero bytes, so that eight bytes can be looked up independently. */
+template <typename T>
+struct CrcTables {
+  T t[8][256];
+};
+
+template <typename T>
+constexpr CrcTables<T> make_tables(T poly) {
+  CrcTables<T> tables{};
+  for (int x = 0; x < 256; x++) {
+    T crc = (T)x;
+    for (int bit = 0; bit < 8; bit++)
+      crc = (T)((crc & 1) ? (crc >> 1) ^ poly : crc >> 1);
+    tables.t[0][x] = crc;
+  }
+  for (int k = 1; k < 8; k++) {
+    for (int x = 0; x < 256; x++) {
+      T prev = tables.t[k - 1][x];
+      tables.t[k][x] = (T)((prev >> 8) ^ tables.t[0][prev & 0xff]);
+    }
+  }
+  return tables;
+}
+
+constexpr CrcTables<uint16_t> crc16_tables = make_tables(kCrc16Poly);
+constexpr CrcTables<uint8_t> crc8_tables = make_tables(kCrc8Poly);
+
+inline uint64_t load_le64(const uint8_t* p) {
+  uint64_t x = 0;
+  for (int i = 7; i >= 0; i--) x = (x << 8) | p[i];
+  return x;
+}
+
+template <typename T>
+T crc_bytewise(const CrcTables<T>& tables, T crc, const uint8_t* p,
+               size_t len) {
+  while (len--) crc = (T)((crc >> 8) ^ tables.t[0][(crc ^ *p++) & 0xff]);
+  return crc;
+}
+
+template <typename T>
+T crc_slice_by_8(const CrcTables<T>& tables, T crc, const uint8_t* p,
+                 size_t len) {
+  const T(*t)[256] = tables.t;
+  for (; len >= 8; p += 8, len -= 8) {
+    uint64_t x = load_le64(p) ^ crc;
+    crc = t[7][x & 0xff] ^ t[6][(x >> 8) & 0xff] ^ t[5][(x >> 16) & 0xff] ^
+          t[4][(x >> 24) & 0xff] ^ t[3][(x >> 32) & 0xff] ^
+          t[2][(x >> 40) & 0xff] ^ t[1][(x >> 48) & 0xff] ^ t[0][x >> 56];
+  }
+  return crc_bytewise(tables, crc, p, len);
+}
+
+#if defined(__i386__) || defined(__x86_64__)
+
+/* x^n mod (x^16 + x^15 + x^2 + 1), bit d holding the coefficient of x^d */
+constexpr uint16_t crc16_xpow_mod(int n) {
+  uint32_t r = 1;
+  for (int i = 0; i < n; i++) {
+    r <<= 1;
+    if (r & 0x10000) r ^= 0x18005;
+  }
+  return (uint16_t)r;
+}
+
+/* |r| bit reversed into a 64 bit lane, the order of the folded data */
+constexpr uint64_t reflect64(uint16_t r) {
+  uint64_t x = 0;
+  for (int d = 0; d < 16; d++) {
+    if (r & (1 << d)) x |= (uint64_t)1 << (63 - d);
+  }
+  return x;
+}
+
+/* A 128 bit block B, bit i of byte k being the coefficient of x^(127-8k-i),
+ * is B = H x^64 + L with H and L its low and high lanes. Folding it n bits
+ * further, B x^n = H (x^(64+n) mod P) + L (x^n mod P), is two carry-less
+ * multiplications. The product of bit reversed operands comes out one bit
+ * short, hence the constants for one power less. */
+constexpr uint64_t kFold128H = reflect64(crc16_xpow_mod(64 + 128 - 1));
+constexpr uint64_t kFold128L = reflect64(crc16_xpow_mod(128 - 1));
+constexpr uint64_t kFold512H = reflect64(crc16_xpow_mod(64 + 512 - 1));
+constexpr uint64_t kFold512L = reflect64(crc16_xpow_mod(512 - 1));
+
+__attribute__((target("pclmul,sse2"))) inline __m128i fold(__m128i x,
+                                                          __m128i k) {
+  return _mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00),
+                       _mm_clmulepi64_si128(x, k, 0x11));
+}
+
+#endif
+
+crc16_fn select_crc16() {
+#if defined(__i386__) || defined(__x86_64__)
+  if (crc16_clmul_supported()) return crc16_clmul;
+#endif
+  return crc16_slice_by_8;
+}
+
+}  // namespace
+
+uint16_t crc16_bytewise(uint16_t crc, const uint8_t* data, size_t len) {
+  return crc_bytewise(crc16_tables, crc, data, len);
+}
+
+uint16_t crc16_slice_by_8(uint16_t crc, const uint8_t* data, size_t len) {
+  return crc_slice_by_8(crc16_tables, crc, data, len);
+}
+
+#if defined(__i386__) || defined(__x86_64__)
+
+__attribute__((target("pclmul,sse2"))) uint16_t crc16_clmul(
+    uint16_t crc, const uint8_t* data, size_t len) {
+  if (len < kClmulMinLen) return crc16_slice_by_8(crc, data, len);
+
+  const __m128i* p = (const __m128i*)data;
+  const __m128i k512 = _mm_set_epi64x(kFold512L, kFold512H);
+  const __m128i k128 = _mm_set_epi64x(kFold128L, kFold128H);
+
+  /* The CRC so far adds to the first bytes of the message */
+  __m128i x0 = _mm_xor_si128(_mm_loadu_si128(p), _mm_cvtsi32_si128(crc));
+  __m128i x1 = _mm_loadu_si128(p + 1);
+  __m128i x2 = _mm_loadu_si128(p + 2);
+  __m128i x3 = _mm_loadu_si128(p + 3);
+  p += 4;
+  len -= 64;
+
+  for (; len >= 64; p += 4, len -= 64) {
+    x0 = _mm_xor_si128(fold(x0, k512), _mm_loadu_si128(p));
+    x1 = _mm_xor_si128(fold(x1, k512), _mm_loadu_si128(p + 1));
+    x2 = _mm_xor_si128(fold(x2, k512), _mm_loadu_si128(p + 2));
+    x3 = _mm_xor_si128(fold(x3, k512), _mm_loadu_si128(p + 3));
+  }
+
+  x1 = _mm_xor_si128(fold(x0, k128), x1);
+  x2 = _mm_xor_si128(fold(x1, k128), x2);
+  x3 = _mm_xor_si128(fold(x2, k128), x3);
+  for (; len >= 16; p++, len -= 16)
+    x3 = _mm_xor_si128(fold(x3, k128), _mm_loadu_si128(p));
+
+  /* The folded block is congruent to everything before it, so its CRC
+   * continued over the remaining bytes is the CRC of the message. */
+  uint8_t folded[16];
+  _mm_storeu_si128((__m128i*)folded, x3);
+  crc = crc16_slice_by_8(0, folded, sizeof(folded));
+  return crc16_slice_by_8(crc, (const uint8_t*)p, len);
+}
+
+bool crc16_clmul_supported() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse2");
+}
+
+#endif
+
+uint16_t crc16(uint16_t crc, const uint8_t* data, size_t len) {
+  static const crc16_fn crc16_impl = select_crc16();
+  return crc16_impl(crc, data, len);
+}
+
+uint8_t crc8(uint8_t crc, const uint8_t* data, size_t len) {
+  return crc_slice_by_8(crc8_tables, crc, data, len);
+}
+
+}  // namespace crc
+}  // namespace bluetooth
@@ -0,0 +1,51 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace bluetooth {
+namespace crc {
+
+/* The L2CAP FCS: CRC-16 with generator x^16 + x^15 + x^2 + 1, bit reversed,
+ * continued from |crc| over |len| bytes. Uses the fastest backend the CPU
+ * supports. */
+uint16_t crc16(uint16_t crc, const uint8_t* data, size_t len);
+
+/* The RFCOMM FCS (TS 07.10): CRC-8 with generator x^8 + x^2 + x + 1, bit
+ * reversed, continued from |crc| over |len| bytes. The caller applies the
+ * final ones complement. */
+uint8_t crc8(uint8_t crc, const uint8_t* data, size_t len);
+
+typedef uint16_t (*crc16_fn)(uint16_t crc, const uint8_t* data, size_t len);
+
+/* One table lookup per byte */
+uint16_t crc16_bytewise(uint16_t crc, const uint8_t* data, size_t len);
+
+/* Eight table lookups per eight bytes, available everywhere */
+uint16_t crc16_slice_by_8(uint16_t crc, const uint8_t* data, size_t len);
+
+#if defined(__i386__) || defined(__x86_64__)
+/* Folds 64 bytes at a time with carry-less multiplication. Only call it if
+ * crc16_clmul_supported() returns true. */
+uint16_t crc16_clmul(uint16_t crc, const uint8_t* data, size_t len);
+bool crc16_clmul_supported();
+#endif
+
+}  // namespace crc
+}  // namespace bluetooth
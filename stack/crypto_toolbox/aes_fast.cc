@@ -0,0 +1,200 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "stack/crypto_toolbox/aes_fast.h"
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace crypto_toolbox {
+
+namespace {
+
+constexpr uint8_t rotl8(uint8_t x, int n) {
+  return (uint8_t)((x << n) | (x >> (8 - n)));
+}
+
+constexpr uint8_t xtime(uint8_t x) {
+  return (uint8_t)((x << 1) ^ ((x >> 7) * 0x1b));
+}
+
+constexpr uint32_t rotl32(uint32_t x, int n) {
+  return (x << n) | (x >> ((32 - n) & 31));
+}
+
+/* The S-box and the four encryption T-tables. te[r][x] is the MixColumns
+ * output for S-box byte x in row r, as a little endian column word. */
+struct AesTables {
+  uint8_t sbox[256];
+  uint32_t te[4][256];
+};
+
+constexpr AesTables make_tables() {
+  AesTables t{};
+
+  // Walk the multiplicative group with generator 3, tracking the inverse
+  // with generator 1/3, and apply the affine map to each inverse.
+  uint8_t p = 1, q = 1;
+  do {
+    p = (uint8_t)(p ^ xtime(p));
+    q ^= (uint8_t)(q << 1);
+    q ^= (uint8_t)(q << 2);
+    q ^= (uint8_t)(q << 4);
+    if (q & 0x80) q ^= 0x09;
+    t.sbox[p] = (uint8_t)(q ^ rotl8(q, 1) ^ rotl8(q, 2) ^ rotl8(q, 3) ^
+                          rotl8(q, 4) ^ 0x63);
+  } while (p != 1);
+  t.sbox[0] = 0x63;
+
+  for (int x = 0; x < 256; x++) {
+    uint32_t s = t.sbox[x];
+    uint32_t s2 = xtime(t.sbox[x]);
+    uint32_t word = s2 | (s << 8) | (s << 16) | ((s2 ^ s) << 24);
+    for (int r = 0; r < 4; r++) t.te[r][x] = rotl32(word, 8 * r);
+  }
+  return t;
+}
+
+constexpr AesTables tables = make_tables();
+
+inline uint32_t load_le32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+inline void store_le32(uint8_t* p, uint32_t x) {
+  p[0] = (uint8_t)x;
+  p[1] = (uint8_t)(x >> 8);
+  p[2] = (uint8_t)(x >> 16);
+  p[3] = (uint8_t)(x >> 24);
+}
+
+inline uint32_t sub_word(uint32_t x) {
+  return (uint32_t)tables.sbox[x & 0xff] |
+         ((uint32_t)tables.sbox[(x >> 8) & 0xff] << 8) |
+         ((uint32_t)tables.sbox[(x >> 16) & 0xff] << 16) |
+         ((uint32_t)tables.sbox[x >> 24] << 24);
+}
+
+aes_128_encrypt_fn select_encrypt() {
+#if defined(__i386__) || defined(__x86_64__)
+  if (aes_128_aesni_supported()) return aes_128_encrypt_aesni;
+#endif
+  return aes_128_encrypt_table;
+}
+
+}  // namespace
+
+void aes_128_expand_key(Aes128Key* key, const uint8_t in[16]) {
+  uint32_t* w = key->rk;
+  uint8_t rcon = 1;
+
+  for (int i = 0; i < 4; i++) w[i] = load_le32(in + 4 * i);
+  for (int i = 4; i < 44; i++) {
+    uint32_t temp = w[i - 1];
+    if (i % 4 == 0) {
+      // RotWord moves byte 1 to byte 0, which is a right rotation here.
+      temp = sub_word((temp >> 8) | (temp << 24)) ^ rcon;
+      rcon = xtime(rcon);
+    }
+    w[i] = w[i - 4] ^ temp;
+  }
+}
+
+void aes_128_encrypt_table(const Aes128Key& key, const uint8_t in[16],
+                           uint8_t out[16]) {
+  const uint32_t* rk = key.rk;
+  const uint32_t(*te)[256] = tables.te;
+  uint32_t s0 = load_le32(in) ^ rk[0];
+  uint32_t s1 = load_le32(in + 4) ^ rk[1];
+  uint32_t s2 = load_le32(in + 8) ^ rk[2];
+  uint32_t s3 = load_le32(in + 12) ^ rk[3];
+  uint32_t t0, t1, t2, t3;
+
+  // Row r of output column c comes from input column c + r (ShiftRows).
+  for (int round = 1; round < 10; round++) {
+    rk += 4;
+    t0 = te[0][s0 & 0xff] ^ te[1][(s1 >> 8) & 0xff] ^
+         te[2][(s2 >> 16) & 0xff] ^ te[3][s3 >> 24] ^ rk[0];
+    t1 = te[0][s1 & 0xff] ^ te[1][(s2 >> 8) & 0xff] ^
+         te[2][(s3 >> 16) & 0xff] ^ te[3][s0 >> 24] ^ rk[1];
+    t2 = te[0][s2 & 0xff] ^ te[1][(s3 >> 8) & 0xff] ^
+         te[2][(s0 >> 16) & 0xff] ^ te[3][s1 >> 24] ^ rk[2];
+    t3 = te[0][s3 & 0xff] ^ te[1][(s0 >> 8) & 0xff] ^
+         te[2][(s1 >> 16) & 0xff] ^ te[3][s2 >> 24] ^ rk[3];
+    s0 = t0;
+    s1 = t1;
+    s2 = t2;
+    s3 = t3;
+  }
+
+  // The last round has no MixColumns.
+  const uint8_t* sbox = tables.sbox;
+  rk += 4;
+  t0 = ((uint32_t)sbox[s0 & 0xff] | ((uint32_t)sbox[(s1 >> 8) & 0xff] << 8) |
+        ((uint32_t)sbox[(s2 >> 16) & 0xff] << 16) |
+        ((uint32_t)sbox[s3 >> 24] << 24)) ^
+       rk[0];
+  t1 = ((uint32_t)sbox[s1 & 0xff] | ((uint32_t)sbox[(s2 >> 8) & 0xff] << 8) |
+        ((uint32_t)sbox[(s3 >> 16) & 0xff] << 16) |
+        ((uint32_t)sbox[s0 >> 24] << 24)) ^
+       rk[1];
+  t2 = ((uint32_t)sbox[s2 & 0xff] | ((uint32_t)sbox[(s3 >> 8) & 0xff] << 8) |
+        ((uint32_t)sbox[(s0 >> 16) & 0xff] << 16) |
+        ((uint32_t)sbox[s1 >> 24] << 24)) ^
+       rk[2];
+  t3 = ((uint32_t)sbox[s3 & 0xff] | ((uint32_t)sbox[(s0 >> 8) & 0xff] << 8) |
+        ((uint32_t)sbox[(s1 >> 16) & 0xff] << 16) |
+        ((uint32_t)sbox[s2 >> 24] << 24)) ^
+       rk[3];
+
+  store_le32(out, t0);
+  store_le32(out + 4, t1);
+  store_le32(out + 8, t2);
+  store_le32(out + 12, t3);
+}
+
+#if defined(__i386__) || defined(__x86_64__)
+
+__attribute__((target("aes,sse2"))) void aes_128_encrypt_aesni(
+    const Aes128Key& key, const uint8_t in[16], uint8_t out[16]) {
+  // x86 is little endian, so the round key words are the byte schedule.
+  const __m128i* rk = (const __m128i*)key.rk;
+  __m128i b = _mm_loadu_si128((const __m128i*)in);
+
+  b = _mm_xor_si128(b, _mm_load_si128(rk));
+  for (int round = 1; round < 10; round++) {
+    b = _mm_aesenc_si128(b, _mm_load_si128(rk + round));
+  }
+  b = _mm_aesenclast_si128(b, _mm_load_si128(rk + 10));
+  _mm_storeu_si128((__m128i*)out, b);
+}
+
+bool aes_128_aesni_supported() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("aes") && __builtin_cpu_supports("sse2");
+}
+
+#endif
+
+void aes_128_encrypt_block(const Aes128Key& key, const uint8_t in[16],
+                           uint8_t out[16]) {
+  static const aes_128_encrypt_fn encrypt = select_encrypt();
+  encrypt(key, in, out);
+}
+
+}  // namespace crypto_toolbox
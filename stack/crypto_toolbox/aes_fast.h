@@ -0,0 +1,52 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace crypto_toolbox {
+
+/* Expanded AES-128 encryption key. Each round key word holds four key
+ * schedule bytes read in little endian order, so on little endian hosts the
+ * words are laid out exactly like the FIPS-197 byte schedule. */
+struct Aes128Key {
+  alignas(16) uint32_t rk[44];
+};
+
+typedef void (*aes_128_encrypt_fn)(const Aes128Key& key, const uint8_t in[16],
+                                   uint8_t out[16]);
+
+/* Expands |key|, given in FIPS-197 byte order. */
+void aes_128_expand_key(Aes128Key* key, const uint8_t in[16]);
+
+/* Encrypts one block in FIPS-197 byte order with the fastest backend the CPU
+ * supports. |in| and |out| may be the same buffer. */
+void aes_128_encrypt_block(const Aes128Key& key, const uint8_t in[16],
+                           uint8_t out[16]);
+
+/* Table driven backend, available everywhere */
+void aes_128_encrypt_table(const Aes128Key& key, const uint8_t in[16],
+                           uint8_t out[16]);
+
+#if defined(__i386__) || defined(__x86_64__)
+/* AES-NI backend. Only call it if aes_128_aesni_supported() returns true. */
+void aes_128_encrypt_aesni(const Aes128Key& key, const uint8_t in[16],
+                           uint8_t out[16]);
+bool aes_128_aesni_supported();
+#endif
+
+}  // namespace crypto_toolbox
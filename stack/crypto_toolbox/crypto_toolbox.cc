@@ -52,10 +52,11 @@ Octet16 f4(uint8_t* u, uint8_t* v, const Octet16& x, uint8_t z) {
 }
 
 /** helper for f5 */
-static Octet16 calculate_mac_key_or_ltk(const Octet16& t, uint8_t counter,
-                                        uint8_t* key_id, const Octet16& n1,
-                                        const Octet16& n2, uint8_t* a1,
-                                        uint8_t* a2, uint8_t* length) {
+static Octet16 calculate_mac_key_or_ltk(const AesCmacContext& t,
+                                        uint8_t counter, uint8_t* key_id,
+                                        const Octet16& n1, const Octet16& n2,
+                                        uint8_t* a1, uint8_t* a2,
+                                        uint8_t* length) {
   constexpr size_t msg_len = 1 /* Counter size */ + 4 /* keyID size */ +
                              OCTET16_LEN /* N1 size */ +
                              OCTET16_LEN /* N2 size */ + 7 /* A1 size*/ +
@@ -89,9 +90,14 @@ void f5(uint8_t* w, const Octet16& n1, const Octet16& n2, uint8_t* a1,
   uint8_t key_id[4] = {0x65, 0x6c, 0x74, 0x62}; /* 0x62746c65 */
   uint8_t length[2] = {0x00, 0x01};             /* 0x0100 */
 
-  *mac_key = calculate_mac_key_or_ltk(t, 0, key_id, n1, n2, a1, a2, length);
+  /* both keys are keyed with T */
+  AesCmacContext t_context;
+  aes_cmac_init(&t_context, t);
 
-  *ltk = calculate_mac_key_or_ltk(t, 1, key_id, n1, n2, a1, a2, length);
+  *mac_key =
+      calculate_mac_key_or_ltk(t_context, 0, key_id, n1, n2, a1, a2, length);
+
+  *ltk = calculate_mac_key_or_ltk(t_context, 1, key_id, n1, n2, a1, a2, length);
 
   DVLOG(2) << "mac_key=" << HexEncode(mac_key->data(), mac_key->size());
   DVLOG(2) << "ltk=" << HexEncode(ltk->data(), ltk->size());
@@ -16,10 +16,26 @@
 
 #pragma once
 
+#include "stack/crypto_toolbox/aes_fast.h"
 #include "stack/include/bt_types.h"
 
 namespace crypto_toolbox {
 
+/* An AES-128 key prepared for repeated use: the expanded key schedule and
+ * the two CMAC subkeys, both in FIPS-197 byte order. Keep one around for keys
+ * that are used many times, such as IRKs and CSRKs. */
+struct AesCmacContext {
+  Aes128Key key;
+  Octet16 k1;
+  Octet16 k2;
+};
+
+/* |key| is in little endian byte order, like every key in this file. */
+extern void aes_cmac_init(AesCmacContext* context, const Octet16& key);
+extern Octet16 aes_128(const AesCmacContext& context, const Octet16& message);
+extern Octet16 aes_cmac(const AesCmacContext& context, const uint8_t* message,
+                        uint16_t length);
+
 extern Octet16 aes_128(const Octet16& key, const Octet16& message);
 extern Octet16 aes_cmac(const Octet16& key, const uint8_t* message,
                         uint16_t length);
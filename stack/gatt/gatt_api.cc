@@ -134,6 +134,8 @@ static void gatt_update_last_srv_info() {
   for (tGATT_SRV_LIST_ELEM& el : *gatt_cb.srv_list_info) {
     gatt_cb.last_service_handle = el.s_hdl;
   }
+
+  gatt_sr_update_srv_list_index();
 }
 
 /*******************************************************************************
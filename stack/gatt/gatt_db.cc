@@ -29,6 +29,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <algorithm>
 #include "btm_int.h"
 #include "gatt_int.h"
 #include "l2c_api.h"
@@ -261,8 +262,10 @@ tGATT_STATUS gatts_db_read_attr_value_by_type(
   uint8_t* p = (uint8_t*)(p_rsp + 1) + p_rsp->len + L2CAP_MIN_OFFSET;
 
   if (p_db) {
-    for (tGATT_ATTR& attr : p_db->attr_list) {
-      if (attr.handle >= s_handle && type == attr.uuid) {
+    for (size_t i = gatts_db_attr_index(*p_db, s_handle);
+         i < p_db->attr_list.size(); i++) {
+      tGATT_ATTR& attr = p_db->attr_list[i];
+      if (type == attr.uuid) {
         if (*p_len <= 2) {
           status = GATT_NO_RESOURCES;
           break;
@@ -409,15 +412,24 @@ uint16_t gatts_add_char_descr(tGATT_SVC_DB& db, tGATT_PERM perm,
 /******************************************************************************/
 /* Service Attribute Database Query Utility Functions */
 /******************************************************************************/
+/* Handles are allocated sequentially within a service, so the attribute for a
+ * handle sits at a fixed offset from the first one. Returns the index of the
+ * first attribute with a handle of at least |handle|. */
+size_t gatts_db_attr_index(const tGATT_SVC_DB& db, uint16_t handle) {
+  if (db.attr_list.empty() || handle <= db.attr_list.front().handle) return 0;
+
+  size_t index = handle - db.attr_list.front().handle;
+  return std::min(index, db.attr_list.size());
+}
+
 tGATT_ATTR* find_attr_by_handle(tGATT_SVC_DB* p_db, uint16_t handle) {
   if (!p_db) return nullptr;
 
-  for (auto& attr : p_db->attr_list) {
-    if (attr.handle == handle) return &attr;
-    if (attr.handle > handle) return nullptr;
-  }
+  size_t index = gatts_db_attr_index(*p_db, handle);
+  if (index == p_db->attr_list.size()) return nullptr;
 
-  return nullptr;
+  tGATT_ATTR& attr = p_db->attr_list[index];
+  return attr.handle == handle ? &attr : nullptr;
 }
 
 /*******************************************************************************
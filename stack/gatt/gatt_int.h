@@ -363,6 +363,8 @@ typedef struct {
   tGATT_IF gatt_if;
   std::list<tGATT_HDL_LIST_ELEM>* hdl_list_info;
   std::list<tGATT_SRV_LIST_ELEM>* srv_list_info;
+  /* |srv_list_info| entries in start handle order, for binary search */
+  std::vector<std::list<tGATT_SRV_LIST_ELEM>::iterator> srv_list_index;
 
   fixed_queue_t* srv_chg_clt_q; /* service change clients queue */
   tGATT_REG cl_rcb[GATT_MAX_APPS];
@@ -476,6 +478,9 @@ extern bool gatt_auto_connect_dev_remove(tGATT_IF gatt_if,
 /* server function */
 extern std::list<tGATT_SRV_LIST_ELEM>::iterator gatt_sr_find_i_rcb_by_handle(
     uint16_t handle);
+extern std::list<tGATT_SRV_LIST_ELEM>::iterator
+gatt_sr_find_first_srv_from_handle(uint16_t handle);
+extern void gatt_sr_update_srv_list_index();
 extern tGATT_STATUS gatt_sr_process_app_rsp(tGATT_TCB& tcb, tGATT_IF gatt_if,
                                             uint32_t trans_id, uint8_t op_code,
                                             tGATT_STATUS status,
@@ -574,5 +579,7 @@ extern tGATT_STATUS gatts_read_attr_perm_check(tGATT_SVC_DB* p_db, bool is_long,
                                                tGATT_SEC_FLAG sec_flag,
                                                uint8_t key_size);
 extern bluetooth::Uuid* gatts_get_service_uuid(tGATT_SVC_DB* p_db);
+extern size_t gatts_db_attr_index(const tGATT_SVC_DB& db, uint16_t handle);
+extern tGATT_ATTR* find_attr_by_handle(tGATT_SVC_DB* p_db, uint16_t handle);
 
 #endif
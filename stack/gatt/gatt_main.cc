@@ -183,6 +183,7 @@ void gatt_free(void) {
     gatt_cb.hdl_list_info = nullptr;
   }
 
+  gatt_cb.srv_list_index.clear();
   if (gatt_cb.srv_list_info != nullptr) {
     gatt_cb.srv_list_info->clear();
     delete(gatt_cb.srv_list_info);
@@ -458,11 +458,10 @@ static tGATT_STATUS gatt_build_primary_service_rsp(
 
   uint8_t* p = (uint8_t*)(p_msg + 1) + L2CAP_MIN_OFFSET;
 
-  for (tGATT_SRV_LIST_ELEM& el : *gatt_cb.srv_list_info) {
-    if (el.s_hdl < s_hdl || el.s_hdl > e_hdl ||
-        el.type != GATT_UUID_PRI_SERVICE) {
-      continue;
-    }
+  for (auto it = gatt_sr_find_first_srv_from_handle(s_hdl);
+       it != gatt_cb.srv_list_info->end() && it->s_hdl <= e_hdl; it++) {
+    tGATT_SRV_LIST_ELEM& el = *it;
+    if (el.s_hdl < s_hdl || el.type != GATT_UUID_PRI_SERVICE) continue;
 
     Uuid* p_uuid = gatts_get_service_uuid(el.p_db);
     if (!p_uuid) continue;
@@ -528,11 +527,11 @@ static tGATT_STATUS gatt_build_find_info_rsp(tGATT_SRV_LIST_ELEM& el,
 
   uint8_t* p = (uint8_t*)(p_msg + 1) + L2CAP_MIN_OFFSET + p_msg->len;
 
-  for (auto& attr : el.p_db->attr_list) {
+  for (size_t i = gatts_db_attr_index(*el.p_db, s_hdl);
+       i < el.p_db->attr_list.size(); i++) {
+    tGATT_ATTR& attr = el.p_db->attr_list[i];
     if (attr.handle > e_hdl) break;
 
-    if (attr.handle < s_hdl) continue;
-
     uint8_t uuid_len = attr.uuid.GetShortestRepresentationSize();
     if (p_msg->offset == 0)
       p_msg->offset = (uuid_len == Uuid::kNumBytes16) ? GATT_INFO_TYPE_PAIR_16
@@ -694,13 +693,12 @@ static void gatts_process_find_info(tGATT_TCB& tcb, uint8_t op_code,
 
   buf_len = tcb.payload_size - 2;
 
-  for (tGATT_SRV_LIST_ELEM& el : *gatt_cb.srv_list_info) {
-    if (el.s_hdl <= e_hdl && el.e_hdl >= s_hdl) {
-      reason = gatt_build_find_info_rsp(el, p_msg, buf_len, s_hdl, e_hdl);
-      if (reason == GATT_NO_RESOURCES) {
-        reason = GATT_SUCCESS;
-        break;
-      }
+  for (auto it = gatt_sr_find_first_srv_from_handle(s_hdl);
+       it != gatt_cb.srv_list_info->end() && it->s_hdl <= e_hdl; it++) {
+    reason = gatt_build_find_info_rsp(*it, p_msg, buf_len, s_hdl, e_hdl);
+    if (reason == GATT_NO_RESOURCES) {
+      reason = GATT_SUCCESS;
+      break;
     }
   }
 
@@ -823,23 +821,22 @@ void gatts_process_read_by_type_req(tGATT_TCB& tcb, uint8_t op_code,
   uint16_t buf_len = tcb.payload_size - 2;
 
   reason = GATT_NOT_FOUND;
-  for (tGATT_SRV_LIST_ELEM& el : *gatt_cb.srv_list_info) {
-    if (el.s_hdl <= e_hdl && el.e_hdl >= s_hdl) {
-      uint8_t sec_flag, key_size;
-      gatt_sr_get_sec_info(tcb.peer_bda, tcb.transport, &sec_flag, &key_size);
-
-      tGATT_STATUS ret = gatts_db_read_attr_value_by_type(
-          tcb, el.p_db, op_code, p_msg, s_hdl, e_hdl, uuid, &buf_len, sec_flag,
-          key_size, 0, &err_hdl);
-      if (ret != GATT_NOT_FOUND) {
-        reason = ret;
-        if (ret == GATT_NO_RESOURCES) reason = GATT_SUCCESS;
-      }
+  uint8_t sec_flag, key_size;
+  gatt_sr_get_sec_info(tcb.peer_bda, tcb.transport, &sec_flag, &key_size);
 
-      if (ret != GATT_SUCCESS && ret != GATT_NOT_FOUND) {
-        s_hdl = err_hdl;
-        break;
-      }
+  for (auto it = gatt_sr_find_first_srv_from_handle(s_hdl);
+       it != gatt_cb.srv_list_info->end() && it->s_hdl <= e_hdl; it++) {
+    tGATT_STATUS ret = gatts_db_read_attr_value_by_type(
+        tcb, it->p_db, op_code, p_msg, s_hdl, e_hdl, uuid, &buf_len, sec_flag,
+        key_size, 0, &err_hdl);
+    if (ret != GATT_NOT_FOUND) {
+      reason = ret;
+      if (ret == GATT_NO_RESOURCES) reason = GATT_SUCCESS;
+    }
+
+    if (ret != GATT_SUCCESS && ret != GATT_NOT_FOUND) {
+      s_hdl = err_hdl;
+      break;
     }
   }
   *p = (uint8_t)p_msg->offset;
@@ -1039,32 +1036,30 @@ void gatts_process_attribute_req(tGATT_TCB& tcb, uint8_t op_code, uint16_t len,
 #endif
 
   if (GATT_HANDLE_IS_VALID(handle)) {
-    for (auto& el : *gatt_cb.srv_list_info) {
-      if (el.s_hdl <= handle && el.e_hdl >= handle) {
-        for (const auto& attr : el.p_db->attr_list) {
-          if (attr.handle == handle) {
-            switch (op_code) {
-              case GATT_REQ_READ: /* read char/char descriptor value */
-              case GATT_REQ_READ_BLOB:
-                gatts_process_read_req(tcb, el, op_code, handle, len, p);
-                break;
-
-              case GATT_REQ_WRITE: /* write char/char descriptor value */
-              case GATT_CMD_WRITE:
-              case GATT_SIGN_CMD_WRITE:
-              case GATT_REQ_PREPARE_WRITE:
-                gatts_process_write_req(tcb, el, handle, op_code, len, p,
-                                        attr.gatt_type);
-                break;
-              default:
-                break;
-            }
-            status = GATT_SUCCESS;
-            break;
-          }
-        }
-        break;
+    auto it = gatt_sr_find_i_rcb_by_handle(handle);
+    tGATT_ATTR* p_attr = nullptr;
+    if (it != gatt_cb.srv_list_info->end())
+      p_attr = find_attr_by_handle(it->p_db, handle);
+
+    if (p_attr) {
+      tGATT_SRV_LIST_ELEM& el = *it;
+      switch (op_code) {
+        case GATT_REQ_READ: /* read char/char descriptor value */
+        case GATT_REQ_READ_BLOB:
+          gatts_process_read_req(tcb, el, op_code, handle, len, p);
+          break;
+
+        case GATT_REQ_WRITE: /* write char/char descriptor value */
+        case GATT_CMD_WRITE:
+        case GATT_SIGN_CMD_WRITE:
+        case GATT_REQ_PREPARE_WRITE:
+          gatts_process_write_req(tcb, el, handle, op_code, len, p,
+                                  p_attr->gatt_type);
+          break;
+        default:
+          break;
       }
+      status = GATT_SUCCESS;
     }
   }
 
@@ -26,6 +26,7 @@
 #include "osi/include/osi.h"
 
 #include <string.h>
+#include <algorithm>
 #include "bt_common.h"
 #include "stdio.h"
 
@@ -662,15 +663,47 @@ void gatt_ind_ack_timeout(void* data) {
  ******************************************************************************/
 std::list<tGATT_SRV_LIST_ELEM>::iterator gatt_sr_find_i_rcb_by_handle(
     uint16_t handle) {
-  auto it = gatt_cb.srv_list_info->begin();
+  auto it = gatt_sr_find_first_srv_from_handle(handle);
+  if (it != gatt_cb.srv_list_info->end() && it->s_hdl <= handle) return it;
 
-  for (; it != gatt_cb.srv_list_info->end(); it++) {
-    if (it->s_hdl <= handle && it->e_hdl >= handle) {
-      return it;
-    }
-  }
+  return gatt_cb.srv_list_info->end();
+}
 
-  return it;
+/*******************************************************************************
+ *
+ * Description      Search for the first service, in start handle order, that
+ *                  ends at or after |handle|. Services in a handle range are
+ *                  found by walking the list from the returned element.
+ *
+ * Returns          end() of the service list if not found.
+ *
+ ******************************************************************************/
+std::list<tGATT_SRV_LIST_ELEM>::iterator gatt_sr_find_first_srv_from_handle(
+    uint16_t handle) {
+  // Service ranges do not overlap, so end handles are sorted as well.
+  const auto& index = gatt_cb.srv_list_index;
+  auto pos = std::lower_bound(
+      index.begin(), index.end(), handle,
+      [](const std::list<tGATT_SRV_LIST_ELEM>::iterator& el, uint16_t handle) {
+        return el->e_hdl < handle;
+      });
+
+  if (pos == index.end()) return gatt_cb.srv_list_info->end();
+  return *pos;
+}
+
+/*******************************************************************************
+ *
+ * Description      Rebuild the service index after a service has been added to
+ *                  or removed from the service list.
+ *
+ ******************************************************************************/
+void gatt_sr_update_srv_list_index() {
+  gatt_cb.srv_list_index.clear();
+  for (auto it = gatt_cb.srv_list_info->begin();
+       it != gatt_cb.srv_list_info->end(); it++) {
+    gatt_cb.srv_list_index.push_back(it);
+  }
 }
 
 /*******************************************************************************
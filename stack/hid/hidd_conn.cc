@@ -86,6 +86,8 @@ static void hidd_check_config_done() {
        HID_CONN_FLAGS_ALL_CONFIGURED) &&
       (p_hcon->conn_state == HID_CONN_STATE_CONFIG)) {
     p_hcon->conn_state = HID_CONN_STATE_CONNECTED;
+    /* Reports go ahead of bulk traffic on the ACL links */
+    L2CA_SetTxPriority(p_hcon->intr_cid, L2CAP_CHNL_PRIORITY_HIGH);
 
     hd_cb.device.state = HIDD_DEV_CONNECTED;
 
@@ -532,6 +532,8 @@ static void hidh_l2cif_config_ind(uint16_t l2cap_cid, tL2CAP_CFG_INFO* p_cfg) {
     p_hcon->conn_state = HID_CONN_STATE_CONNECTED;
     /* Reset disconnect reason to success, as connection successful */
     p_hcon->disc_reason = HID_SUCCESS;
+    /* Reports go ahead of bulk traffic on the ACL links */
+    L2CA_SetTxPriority(p_hcon->intr_cid, L2CAP_CHNL_PRIORITY_HIGH);
 
     hh_cb.devices[dhandle].state = HID_DEV_CONNECTED;
     hh_cb.callback(dhandle, hh_cb.devices[dhandle].addr, HID_HDEV_EVT_OPEN, 0,
@@ -614,6 +616,8 @@ static void hidh_l2cif_config_cfm(uint16_t l2cap_cid, tL2CAP_CFG_INFO* p_cfg) {
     p_hcon->conn_state = HID_CONN_STATE_CONNECTED;
     /* Reset disconnect reason to success, as connection successful */
     p_hcon->disc_reason = HID_SUCCESS;
+    /* Reports go ahead of bulk traffic on the ACL links */
+    L2CA_SetTxPriority(p_hcon->intr_cid, L2CAP_CHNL_PRIORITY_HIGH);
 
     hh_cb.devices[dhandle].state = HID_DEV_CONNECTED;
     hh_cb.callback(dhandle, hh_cb.devices[dhandle].addr, HID_HDEV_EVT_OPEN, 0,
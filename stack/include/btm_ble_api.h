@@ -806,4 +806,13 @@ extern void btm_ble_multi_adv_cleanup(void);
  ******************************************************************************/
 extern bool BTM_GetRemoteDeviceName(const RawAddress& bd_addr, BD_NAME bdname);
 
+/*******************************************************************************
+ *
+ * Function         BTM_BleRpaCacheDumpStatistics
+ *
+ * Description      Write the hit rate of the peer RPA resolution cache to |fd|
+ *
+ ******************************************************************************/
+extern void BTM_BleRpaCacheDumpStatistics(int fd);
+
 #endif
@@ -1186,6 +1186,9 @@ constexpr uint8_t HCI_LE_STATES_INIT_MASTER_SLAVE_BIT = 41;
 /* Define an invalid value for a handle */
 #define HCI_INVALID_HANDLE 0xFFFF
 
+/* Number of distinct connection handles (handles are 12 bits) */
+#define HCI_NUM_HANDLES 0x1000
+
 /* Define max ammount of data in the HCI command */
 #define HCI_COMMAND_SIZE 255
 
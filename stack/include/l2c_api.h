@@ -1329,4 +1329,16 @@ extern bool L2CA_isMediaChannel(uint16_t handle, uint16_t channel_id, bool is_lo
 extern void L2CA_AdjustConnectionIntervals(uint16_t* min_interval,
                                            uint16_t* max_interval,
                                            uint16_t floor_interval);
+
+/*******************************************************************************
+**
+** Function         L2CA_DumpTxStatistics
+**
+** Description      Write the ACL link scheduler state, and the packets, queue
+**                  depths and wait times of each link and channel, to |fd|
+**
+** Returns          void
+**
+*******************************************************************************/
+extern void L2CA_DumpTxStatistics(int fd);
 #endif /* L2C_API_H */
@@ -1267,7 +1267,7 @@ uint16_t L2CA_LocalLoopbackReq(uint16_t psm, uint16_t handle,
   }
 
   p_lcb->link_state = LST_CONNECTED;
-  p_lcb->handle = handle;
+  l2cu_set_lcb_handle(p_lcb, handle);
 
   /* Allocate a channel control block */
   p_ccb = l2cu_allocate_ccb(p_lcb, 0);
@@ -2367,3 +2367,15 @@ bool L2CA_isMediaChannel(uint16_t handle, uint16_t channel_id, bool is_local_cid
 
     return ret;
 }
+
+/*******************************************************************************
+**
+** Function         L2CA_DumpTxStatistics
+**
+** Description      Write the ACL link scheduler state, and the packets, queue
+**                  depths and wait times of each link and channel, to |fd|
+**
+** Returns          void
+**
+*******************************************************************************/
+void L2CA_DumpTxStatistics(int fd) { l2c_link_sched_dump(fd); }
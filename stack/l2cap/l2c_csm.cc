@@ -1424,6 +1424,7 @@ void l2c_enqueue_peer_data(tL2C_CCB* p_ccb, BT_HDR* p_buf) {
         p_ccb->remote_cid);
   }
   fixed_queue_enqueue(p_ccb->xmit_hold_q, p_buf);
+  l2c_link_sched_chnl_enqueued(p_ccb);
 
   l2cu_check_channel_congestion(p_ccb);
 
@@ -284,6 +284,15 @@ typedef struct {
   void* p_ref_data;
 } tL2CAP_SEC_DATA;
 
+/* Transmit statistics of a channel or a link, for dumpsys */
+typedef struct {
+  uint64_t packets;
+  uint64_t bytes;
+  uint64_t total_wait_us; /* Head of line wait of the packets sent */
+  uint64_t max_wait_us;
+  uint16_t max_queue_depth;
+} tL2C_TX_STATS;
+
 /* Define a channel control block (CCB). There may be many channel control
  * blocks between the same two Bluetooth devices (i.e. on the same link).
  * Each CCB has unique local and remote CIDs. All channel control blocks on
@@ -364,6 +373,9 @@ typedef struct t_l2c_ccb {
   /* Number of LE frames that the remote can send to us (credit count in
    * remote). Valid only for LE CoC */
   uint16_t remote_credit_count;
+
+  tL2C_TX_STATS tx_stats;
+  uint64_t tx_hol_since_us; /* When the head of xmit_hold_q was queued */
 } tL2C_CCB;
 
 /***********************************************************************
@@ -484,6 +496,11 @@ typedef struct t_l2c_linkcb {
   uint8_t rr_pri; /* current serving priority group */
 #endif
 
+  /* Link scheduler state, see l2c_link_sched.cc */
+  int32_t sched_deficit;        /* Bytes the link may still send this round */
+  uint64_t sched_wait_since_us; /* When the link last had data waiting */
+  uint64_t sched_fast_path;     /* Packets sent through the fast path */
+  tL2C_TX_STATS tx_stats;
 } tL2C_LCB;
 
 /* Define the L2CAP control structure
@@ -505,6 +522,9 @@ typedef struct {
   tL2C_CCB* p_free_ccb_first; /* Pointer to first free CCB */
   tL2C_CCB* p_free_ccb_last;  /* Pointer to last  free CCB */
 
+  /* For each HCI handle, 1 + index of the LCB using it, or 0 if none */
+  uint8_t lcb_index_by_handle[HCI_NUM_HANDLES];
+
   uint8_t
       desire_role; /* desire to be master/slave when accepting a connection */
   bool disallow_switch;     /* false, to allow switch at create conn */
@@ -628,6 +648,7 @@ extern void l2cu_release_lcb(tL2C_LCB* p_lcb);
 extern tL2C_LCB* l2cu_find_lcb_by_bd_addr(const RawAddress& p_bd_addr,
                                           tBT_TRANSPORT transport);
 extern tL2C_LCB* l2cu_find_lcb_by_handle(uint16_t handle);
+extern void l2cu_set_lcb_handle(tL2C_LCB* p_lcb, uint16_t handle);
 extern void l2cu_update_lcb_4_bonding(const RawAddress& p_bd_addr,
                                       bool is_bonding);
 
@@ -782,6 +803,49 @@ extern void l2c_link_adjust_chnl_allocation(void);
 
 extern void l2c_link_processs_ble_num_bufs(uint16_t num_lm_acl_bufs);
 
+/* Functions provided by l2c_link_sched.cc
+ ***********************************
+*/
+
+/* Whether a link can be given the next controller buffer */
+typedef enum {
+  L2C_LINK_SCHED_IDLE,    /* Nothing queued */
+  L2C_LINK_SCHED_BLOCKED, /* Data queued, but no window, quota or credits */
+  L2C_LINK_SCHED_READY
+} tL2C_LINK_SCHED_STATE;
+
+typedef tL2C_LINK_SCHED_STATE(tL2C_LINK_SCHED_STATE_CB)(tL2C_LCB* p_lcb);
+
+/* Service classes of links, from the most latency sensitive data queued */
+#define L2C_LINK_CLASS_LATENCY 0 /* High ACL or channel priority, signalling */
+#define L2C_LINK_CLASS_NORMAL 1  /* Medium priority and fixed channels */
+#define L2C_LINK_CLASS_BULK 2    /* Low priority channels only */
+#define L2C_LINK_NUM_CLASSES 3
+
+/* A policy choosing which link gets the next controller buffer */
+typedef struct {
+  const char* name;
+  /* Returns the link of |transport| to send one packet on, among the ones
+   * |state_cb| reports ready, or NULL if there is none */
+  tL2C_LCB* (*next_link)(tBT_TRANSPORT transport,
+                         tL2C_LINK_SCHED_STATE_CB* state_cb);
+  /* Charges |len| bytes sent to the link */
+  void (*packet_sent)(tL2C_LCB* p_lcb, uint16_t len);
+} tL2C_LINK_SCHED;
+
+extern const tL2C_LINK_SCHED l2c_link_sched_rr;
+extern const tL2C_LINK_SCHED l2c_link_sched_drr;
+
+extern void l2c_link_sched_set(const tL2C_LINK_SCHED* p_sched);
+extern tL2C_LCB* l2c_link_sched_next(tBT_TRANSPORT transport,
+                                     tL2C_LINK_SCHED_STATE_CB* state_cb);
+extern void l2c_link_sched_sent(tL2C_LCB* p_lcb, uint16_t len);
+extern bool l2c_link_sched_has_data(tL2C_LCB* p_lcb);
+extern uint8_t l2c_link_sched_class(tL2C_LCB* p_lcb);
+extern void l2c_link_sched_chnl_enqueued(tL2C_CCB* p_ccb);
+extern void l2c_link_sched_chnl_sent(tL2C_CCB* p_ccb, uint16_t len);
+extern void l2c_link_sched_dump(int fd);
+
 #if (L2CAP_WAKE_PARKED_LINK == TRUE)
 extern bool l2c_link_check_power_mode(tL2C_LCB* p_lcb);
 #define L2C_LINK_CHECK_POWER_MODE(x) l2c_link_check_power_mode((x))
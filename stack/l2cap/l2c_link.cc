@@ -199,7 +199,7 @@ bool l2c_link_hci_conn_comp(uint8_t status, uint16_t handle,
   }
 
   /* Save the handle */
-  p_lcb->handle = handle;
+  l2cu_set_lcb_handle(p_lcb, handle);
 
   if (ci.status == HCI_SUCCESS) {
     /* Connected OK. Change state to connected */
@@ -251,7 +251,7 @@ bool l2c_link_hci_conn_comp(uint8_t status, uint16_t handle,
   else if ((ci.status == HCI_ERR_MAX_NUM_OF_CONNECTIONS) &&
            l2cu_lcb_disconnecting()) {
     p_lcb->link_state = LST_CONNECT_HOLDING;
-    p_lcb->handle = HCI_INVALID_HANDLE;
+    l2cu_set_lcb_handle(p_lcb, HCI_INVALID_HANDLE);
   } else {
     /* Just in case app decides to try again in the callback context */
     p_lcb->link_state = LST_DISCONNECTING;
@@ -1032,6 +1032,90 @@ bool l2c_link_check_power_mode(tL2C_LCB* p_lcb) {
 }
 #endif /* L2CAP_WAKE_PARKED_LINK == TRUE) */
 
+/* Links found with data queued but nothing to send during the current
+ * l2c_link_send_pkts() pass, e.g. while waiting for LE credits */
+static bool l2c_link_stalled[MAX_L2CAP_LINKS];
+
+/*******************************************************************************
+ *
+ * Function         l2c_link_sched_state_cb
+ *
+ * Description      Tells the link scheduler whether a link has data queued,
+ *                  and whether the controller window, the link quota (or the
+ *                  round-robin quota) and its power mode let it send now.
+ *
+ ******************************************************************************/
+static tL2C_LINK_SCHED_STATE l2c_link_sched_state_cb(tL2C_LCB* p_lcb) {
+  if (p_lcb->link_state != LST_CONNECTED || !l2c_link_sched_has_data(p_lcb))
+    return L2C_LINK_SCHED_IDLE;
+
+  if (l2c_link_stalled[p_lcb - l2cb.lcb_pool] ||
+      p_lcb->partial_segment_being_sent)
+    return L2C_LINK_SCHED_BLOCKED;
+
+  if (p_lcb->transport == BT_TRANSPORT_LE) {
+    if (l2cb.controller_le_xmit_window == 0) return L2C_LINK_SCHED_BLOCKED;
+    if (p_lcb->link_xmit_quota == 0
+            ? l2cb.ble_round_robin_unacked >= l2cb.ble_round_robin_quota
+            : p_lcb->sent_not_acked >= p_lcb->link_xmit_quota)
+      return L2C_LINK_SCHED_BLOCKED;
+  } else {
+    if (l2cb.controller_xmit_window == 0) return L2C_LINK_SCHED_BLOCKED;
+    if (p_lcb->link_xmit_quota == 0
+            ? l2cb.round_robin_unacked >= l2cb.round_robin_quota
+            : p_lcb->sent_not_acked >= p_lcb->link_xmit_quota)
+      return L2C_LINK_SCHED_BLOCKED;
+  }
+
+  if (L2C_LINK_CHECK_POWER_MODE(p_lcb)) return L2C_LINK_SCHED_BLOCKED;
+
+  return L2C_LINK_SCHED_READY;
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_link_send_pkts
+ *
+ * Description      Sends packets of the links of |transport| to the
+ *                  controller, one at a time on the link the scheduler
+ *                  picks, until no link can send.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void l2c_link_send_pkts(tBT_TRANSPORT transport) {
+  tL2C_LCB* p_lcb;
+
+  memset(l2c_link_stalled, 0, sizeof(l2c_link_stalled));
+
+  while ((p_lcb = l2c_link_sched_next(transport, l2c_link_sched_state_cb)) !=
+         NULL) {
+    tL2C_TX_COMPLETE_CB_INFO cbi;
+    tL2C_TX_COMPLETE_CB_INFO* p_cbi = NULL;
+    BT_HDR* p_buf;
+
+    /* The link queue goes first */
+    if (!list_is_empty(p_lcb->link_xmit_data_q)) {
+      p_buf = (BT_HDR*)list_front(p_lcb->link_xmit_data_q);
+      list_remove(p_lcb->link_xmit_data_q, p_buf);
+    } else {
+      p_buf = l2cu_get_next_buffer_to_send(p_lcb, &cbi);
+      p_cbi = &cbi;
+    }
+
+    if (p_buf == NULL) {
+      l2c_link_stalled[p_lcb - l2cb.lcb_pool] = true;
+      continue;
+    }
+
+    uint16_t len = p_buf->len;
+    l2c_link_send_to_lower(p_lcb, p_buf, p_cbi);
+    l2c_link_sched_sent(p_lcb, len);
+  }
+
+  memset(l2c_link_stalled, 0, sizeof(l2c_link_stalled));
+}
+
 /*******************************************************************************
  *
  * Function         l2c_link_check_send_pkts
@@ -1044,7 +1128,6 @@ bool l2c_link_check_power_mode(tL2C_LCB* p_lcb) {
  *
  ******************************************************************************/
 void l2c_link_check_send_pkts(tL2C_LCB* p_lcb, tL2C_CCB* p_ccb, BT_HDR* p_buf) {
-  int xx;
   bool single_write = false;
 
   /* Save the channel ID for faster counting */
@@ -1072,108 +1155,44 @@ void l2c_link_check_send_pkts(tL2C_LCB* p_lcb, tL2C_CCB* p_ccb, BT_HDR* p_buf) {
   */
   if (l2cb.is_cong_cback_context) return;
 
-  /* If we are in a scenario where there are not enough buffers for each link to
-  ** have at least 1, then do a round-robin for all the LCBs
-  */
-  if ((p_lcb == NULL) || (p_lcb->link_xmit_quota == 0)) {
-    if (p_lcb == NULL)
-      p_lcb = l2cb.lcb_pool;
-    else if (!single_write)
-      p_lcb++;
-
-    /* Loop through, starting at the next */
-    for (xx = 0; xx < MAX_L2CAP_LINKS; xx++, p_lcb++) {
-      /* Check for wraparound */
-      if (p_lcb == &l2cb.lcb_pool[MAX_L2CAP_LINKS]) p_lcb = &l2cb.lcb_pool[0];
-
-      /* If controller window is full, nothing to do */
-      if (((l2cb.controller_xmit_window == 0 ||
-            (l2cb.round_robin_unacked >= l2cb.round_robin_quota)) &&
-           (p_lcb->transport == BT_TRANSPORT_BR_EDR)) ||
-          (p_lcb->transport == BT_TRANSPORT_LE &&
-           (l2cb.ble_round_robin_unacked >= l2cb.ble_round_robin_quota ||
-            l2cb.controller_le_xmit_window == 0)))
-        continue;
-
-      if ((!p_lcb->in_use) || (p_lcb->partial_segment_being_sent) ||
-          (p_lcb->link_state != LST_CONNECTED) ||
-          (p_lcb->link_xmit_quota != 0) || (L2C_LINK_CHECK_POWER_MODE(p_lcb)))
-        continue;
-
-      /* See if we can send anything from the Link Queue */
-      if (!list_is_empty(p_lcb->link_xmit_data_q)) {
-        p_buf = (BT_HDR*)list_front(p_lcb->link_xmit_data_q);
-        list_remove(p_lcb->link_xmit_data_q, p_buf);
-        l2c_link_send_to_lower(p_lcb, p_buf, NULL);
-      } else if (single_write) {
-        /* If only doing one write, break out */
-        break;
-      }
-      /* If nothing on the link queue, check the channel queue */
-      else {
-        tL2C_TX_COMPLETE_CB_INFO cbi;
-        p_buf = l2cu_get_next_buffer_to_send(p_lcb, &cbi);
-        if (p_buf != NULL) {
-          l2c_link_send_to_lower(p_lcb, p_buf, &cbi);
-        }
-      }
-    }
-
-    /* If we finished without using up our quota, no need for a safety check */
-    if ((l2cb.controller_xmit_window > 0) &&
-        (l2cb.round_robin_unacked < l2cb.round_robin_quota) &&
-        (p_lcb->transport == BT_TRANSPORT_BR_EDR))
-      l2cb.check_round_robin = false;
-
-    if ((l2cb.controller_le_xmit_window > 0) &&
-        (l2cb.ble_round_robin_unacked < l2cb.ble_round_robin_quota) &&
-        (p_lcb->transport == BT_TRANSPORT_LE))
-      l2cb.ble_check_round_robin = false;
-  } else /* if this is not round-robin service */
-  {
-    /* If a partial segment is being sent, can't send anything else */
-    if ((p_lcb->partial_segment_being_sent) ||
-        (p_lcb->link_state != LST_CONNECTED) ||
-        (L2C_LINK_CHECK_POWER_MODE(p_lcb)))
-      return;
-
-    /* See if we can send anything from the link queue */
-    while (((l2cb.controller_xmit_window != 0 &&
-             (p_lcb->transport == BT_TRANSPORT_BR_EDR)) ||
-            (l2cb.controller_le_xmit_window != 0 &&
-             (p_lcb->transport == BT_TRANSPORT_LE))) &&
-           (p_lcb->sent_not_acked < p_lcb->link_xmit_quota)) {
-      if (list_is_empty(p_lcb->link_xmit_data_q)) break;
-
+  if (single_write) {
+    /* Only the link queue of this link is served */
+    while (!list_is_empty(p_lcb->link_xmit_data_q) &&
+           l2c_link_sched_state_cb(p_lcb) == L2C_LINK_SCHED_READY) {
       p_buf = (BT_HDR*)list_front(p_lcb->link_xmit_data_q);
       list_remove(p_lcb->link_xmit_data_q, p_buf);
-      if (!l2c_link_send_to_lower(p_lcb, p_buf, NULL)) break;
-    }
 
-    if (!single_write) {
-      /* See if we can send anything for any channel */
-      while (((l2cb.controller_xmit_window != 0 &&
-               (p_lcb->transport == BT_TRANSPORT_BR_EDR)) ||
-              (l2cb.controller_le_xmit_window != 0 &&
-               (p_lcb->transport == BT_TRANSPORT_LE))) &&
-             (p_lcb->sent_not_acked < p_lcb->link_xmit_quota)) {
-        tL2C_TX_COMPLETE_CB_INFO cbi;
-        p_buf = l2cu_get_next_buffer_to_send(p_lcb, &cbi);
-        if (p_buf == NULL) break;
-
-        if (!l2c_link_send_to_lower(p_lcb, p_buf, &cbi)) break;
-      }
+      uint16_t len = p_buf->len;
+      l2c_link_send_to_lower(p_lcb, p_buf, NULL);
+      l2c_link_sched_sent(p_lcb, len);
     }
+  } else {
+    /* The scheduler shares the window between all the links of the
+     * transport, even when a single link has new data */
+    if (p_lcb == NULL || p_lcb->transport == BT_TRANSPORT_BR_EDR)
+      l2c_link_send_pkts(BT_TRANSPORT_BR_EDR);
+    if (p_lcb == NULL || p_lcb->transport == BT_TRANSPORT_LE)
+      l2c_link_send_pkts(BT_TRANSPORT_LE);
+  }
 
-    /* There is a special case where we have readjusted the link quotas and  */
-    /* this link may have sent anything but some other link sent packets so  */
-    /* so we may need a timer to kick off this link's transmissions.         */
-    if ((!list_is_empty(p_lcb->link_xmit_data_q)) &&
-        (p_lcb->sent_not_acked < p_lcb->link_xmit_quota)) {
-      alarm_set_on_mloop(p_lcb->l2c_lcb_timer,
-                         L2CAP_LINK_FLOW_CONTROL_TIMEOUT_MS,
-                         l2c_lcb_timer_timeout, p_lcb);
-    }
+  /* If we finished without using up our quota, no need for a safety check */
+  if ((l2cb.controller_xmit_window > 0) &&
+      (l2cb.round_robin_unacked < l2cb.round_robin_quota))
+    l2cb.check_round_robin = false;
+
+  if ((l2cb.controller_le_xmit_window > 0) &&
+      (l2cb.ble_round_robin_unacked < l2cb.ble_round_robin_quota))
+    l2cb.ble_check_round_robin = false;
+
+  /* There is a special case where we have readjusted the link quotas and  */
+  /* this link may have sent anything but some other link sent packets so  */
+  /* so we may need a timer to kick off this link's transmissions.         */
+  if ((p_lcb != NULL) && (p_lcb->link_xmit_quota != 0) &&
+      (!list_is_empty(p_lcb->link_xmit_data_q)) &&
+      (p_lcb->sent_not_acked < p_lcb->link_xmit_quota)) {
+    alarm_set_on_mloop(p_lcb->l2c_lcb_timer,
+                       L2CAP_LINK_FLOW_CONTROL_TIMEOUT_MS,
+                       l2c_lcb_timer_timeout, p_lcb);
   }
 }
 
@@ -0,0 +1,390 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/******************************************************************************
+ *
+ *  This file contains the policies sharing the controller ACL buffers
+ *  between the links of a transport, and the transmit statistics of links
+ *  and channels.
+ *
+ *  l2c_link_check_send_pkts() asks the scheduler for a link each time a
+ *  buffer can be sent. The deficit round robin scheduler gives each link
+ *  with data a byte quantum per round, weighted by the class of the data it
+ *  has queued, and lets latency sensitive links (A2DP streaming, HID,
+ *  signalling) go first as long as they do not overdraw their share by more
+ *  than L2CAP_LINK_SCHED_FAST_PATH_DEBT bytes.
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+
+#include "bt_target.h"
+#include "bt_types.h"
+#include "l2c_api.h"
+#include "l2c_int.h"
+#include "osi/include/fixed_queue.h"
+#include "osi/include/list.h"
+#include "osi/include/osi.h"
+#include "osi/include/time.h"
+
+#define L2C_SCHED_TRANSPORT_IDX(transport) \
+  ((transport) == BT_TRANSPORT_LE ? 1 : 0)
+
+/* DRR quantum of a link of class |cls| */
+#define L2C_SCHED_QUANTUM(cls) \
+  (L2CAP_LINK_SCHED_QUANTUM << (L2C_LINK_NUM_CLASSES - 1 - (cls)))
+
+#if (L2CAP_LINK_SCHED_DRR == TRUE)
+static const tL2C_LINK_SCHED* link_sched = &l2c_link_sched_drr;
+#else
+static const tL2C_LINK_SCHED* link_sched = &l2c_link_sched_rr;
+#endif
+
+/* State callback and time of the l2c_link_sched_next() call in progress */
+static tL2C_LINK_SCHED_STATE_CB* sched_state_cb;
+static uint64_t sched_now_us;
+
+/* Statistics by transport and class, kept across links */
+static tL2C_TX_STATS class_stats[2][L2C_LINK_NUM_CLASSES];
+
+static const char* const class_names[L2C_LINK_NUM_CLASSES] = {
+    "latency", "normal", "bulk"};
+
+static bool l2c_link_sched_chnl_has_data(tL2C_CCB* p_ccb) {
+  return !fixed_queue_is_empty(p_ccb->xmit_hold_q) ||
+         !fixed_queue_is_empty(p_ccb->fcrb.retrans_q);
+}
+
+static void l2c_link_sched_record(tL2C_TX_STATS* p_stats, uint16_t len,
+                                  uint64_t wait_us) {
+  p_stats->packets++;
+  p_stats->bytes += len;
+  p_stats->total_wait_us += wait_us;
+  if (wait_us > p_stats->max_wait_us) p_stats->max_wait_us = wait_us;
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_link_sched_state
+ *
+ * Description      Queries the state of a link for the scheduler, and notes
+ *                  since when it has been waiting to send.
+ *
+ ******************************************************************************/
+static tL2C_LINK_SCHED_STATE l2c_link_sched_state(tL2C_LCB* p_lcb) {
+  tL2C_LINK_SCHED_STATE state = sched_state_cb(p_lcb);
+
+  if (state == L2C_LINK_SCHED_IDLE) {
+    p_lcb->sched_wait_since_us = 0;
+  } else if (p_lcb->sched_wait_since_us == 0) {
+    p_lcb->sched_wait_since_us = sched_now_us;
+  }
+  return state;
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_link_sched_has_data
+ *
+ * Description      Checks if a link has anything queued for the controller
+ *
+ ******************************************************************************/
+bool l2c_link_sched_has_data(tL2C_LCB* p_lcb) {
+  if (!list_is_empty(p_lcb->link_xmit_data_q)) return true;
+
+  for (tL2C_CCB* p_ccb = p_lcb->ccb_queue.p_first_ccb; p_ccb != NULL;
+       p_ccb = p_ccb->p_next_ccb) {
+    if (l2c_link_sched_chnl_has_data(p_ccb)) return true;
+  }
+  return false;
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_link_sched_class
+ *
+ * Description      Classifies a link by the most latency sensitive data it
+ *                  has queued. A link set to high ACL priority, such as one
+ *                  streaming A2DP, is always latency sensitive.
+ *
+ * Returns          L2C_LINK_CLASS_LATENCY, _NORMAL or _BULK
+ *
+ ******************************************************************************/
+uint8_t l2c_link_sched_class(tL2C_LCB* p_lcb) {
+  uint8_t cls = L2C_LINK_CLASS_BULK;
+
+  if (p_lcb->acl_priority == L2CAP_PRIORITY_HIGH ||
+      !list_is_empty(p_lcb->link_xmit_data_q))
+    return L2C_LINK_CLASS_LATENCY;
+
+  for (tL2C_CCB* p_ccb = p_lcb->ccb_queue.p_first_ccb; p_ccb != NULL;
+       p_ccb = p_ccb->p_next_ccb) {
+    if (!l2c_link_sched_chnl_has_data(p_ccb)) continue;
+
+    if (p_ccb->ccb_priority == L2CAP_CHNL_PRIORITY_HIGH)
+      return L2C_LINK_CLASS_LATENCY;
+    if (p_ccb->ccb_priority == L2CAP_CHNL_PRIORITY_MEDIUM ||
+        p_ccb->local_cid < L2CAP_BASE_APPL_CID)
+      cls = L2C_LINK_CLASS_NORMAL;
+  }
+  return cls;
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_link_sched_set
+ *
+ * Description      Replaces the link scheduler, e.g. for tests
+ *
+ ******************************************************************************/
+void l2c_link_sched_set(const tL2C_LINK_SCHED* p_sched) {
+  link_sched = p_sched;
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_link_sched_next
+ *
+ * Description      Picks the link of |transport| to send the next packet on.
+ *                  |state_cb| tells whether a link has data and may send.
+ *
+ * Returns          the link, or NULL if no link is ready
+ *
+ ******************************************************************************/
+tL2C_LCB* l2c_link_sched_next(tBT_TRANSPORT transport,
+                              tL2C_LINK_SCHED_STATE_CB* state_cb) {
+  sched_state_cb = state_cb;
+  sched_now_us = time_get_os_boottime_us();
+  return link_sched->next_link(transport, l2c_link_sched_state);
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_link_sched_sent
+ *
+ * Description      Accounts for a packet of |len| bytes handed to the
+ *                  controller on a link picked by l2c_link_sched_next().
+ *
+ ******************************************************************************/
+void l2c_link_sched_sent(tL2C_LCB* p_lcb, uint16_t len) {
+  uint64_t wait_us = 0;
+  if (p_lcb->sched_wait_since_us != 0 &&
+      sched_now_us > p_lcb->sched_wait_since_us)
+    wait_us = sched_now_us - p_lcb->sched_wait_since_us;
+  p_lcb->sched_wait_since_us = 0;
+
+  l2c_link_sched_record(&p_lcb->tx_stats, len, wait_us);
+  l2c_link_sched_record(&class_stats[L2C_SCHED_TRANSPORT_IDX(
+                            p_lcb->transport)][l2c_link_sched_class(p_lcb)],
+                        len, wait_us);
+
+  link_sched->packet_sent(p_lcb, len);
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_link_sched_chnl_enqueued
+ *
+ * Description      Notes the depth of the transmit queue of a channel after
+ *                  a packet was added to it.
+ *
+ ******************************************************************************/
+void l2c_link_sched_chnl_enqueued(tL2C_CCB* p_ccb) {
+  size_t depth = fixed_queue_length(p_ccb->xmit_hold_q);
+
+  if (depth == 1) p_ccb->tx_hol_since_us = time_get_os_boottime_us();
+  if (depth > p_ccb->tx_stats.max_queue_depth)
+    p_ccb->tx_stats.max_queue_depth = depth;
+
+  if (p_ccb->p_lcb != NULL) {
+    tL2C_TX_STATS* p_stats = &p_ccb->p_lcb->tx_stats;
+    depth += list_length(p_ccb->p_lcb->link_xmit_data_q);
+    if (depth > p_stats->max_queue_depth) p_stats->max_queue_depth = depth;
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_link_sched_chnl_sent
+ *
+ * Description      Accounts for a packet of |len| bytes taken from a channel
+ *                  for the controller.
+ *
+ ******************************************************************************/
+void l2c_link_sched_chnl_sent(tL2C_CCB* p_ccb, uint16_t len) {
+  uint64_t now_us = time_get_os_boottime_us();
+  uint64_t wait_us = 0;
+
+  if (p_ccb->tx_hol_since_us != 0 && now_us > p_ccb->tx_hol_since_us)
+    wait_us = now_us - p_ccb->tx_hol_since_us;
+  l2c_link_sched_record(&p_ccb->tx_stats, len, wait_us);
+
+  /* The next packet has been at the head of the queue from now on */
+  p_ccb->tx_hol_since_us = l2c_link_sched_chnl_has_data(p_ccb) ? now_us : 0;
+}
+
+/*******************************************************************************
+ *
+ * Round robin: one packet per ready link in turn, whatever it carries
+ *
+ ******************************************************************************/
+static uint8_t rr_last_link[2];
+
+static tL2C_LCB* rr_next_link(tBT_TRANSPORT transport,
+                              tL2C_LINK_SCHED_STATE_CB* state_cb) {
+  uint8_t* p_last = &rr_last_link[L2C_SCHED_TRANSPORT_IDX(transport)];
+
+  for (int xx = 1; xx <= MAX_L2CAP_LINKS; xx++) {
+    uint8_t idx = (*p_last + xx) % MAX_L2CAP_LINKS;
+    tL2C_LCB* p_lcb = &l2cb.lcb_pool[idx];
+
+    if (!p_lcb->in_use || p_lcb->transport != transport) continue;
+    if (state_cb(p_lcb) != L2C_LINK_SCHED_READY) continue;
+
+    *p_last = idx;
+    return p_lcb;
+  }
+  return NULL;
+}
+
+static void rr_packet_sent(UNUSED_ATTR tL2C_LCB* p_lcb,
+                           UNUSED_ATTR uint16_t len) {}
+
+const tL2C_LINK_SCHED l2c_link_sched_rr = {"round robin", rr_next_link,
+                                           rr_packet_sent};
+
+/*******************************************************************************
+ *
+ * Deficit round robin with a fast path for latency sensitive links
+ *
+ ******************************************************************************/
+static uint8_t drr_cur_link[2];
+
+static tL2C_LCB* drr_next_link(tBT_TRANSPORT transport,
+                               tL2C_LINK_SCHED_STATE_CB* state_cb) {
+  uint8_t* p_cur = &drr_cur_link[L2C_SCHED_TRANSPORT_IDX(transport)];
+  uint8_t cls[MAX_L2CAP_LINKS];
+  bool ready[MAX_L2CAP_LINKS];
+  bool any_ready = false;
+  tL2C_LCB* p_fast = NULL;
+
+  /* Visit every link once, from the one after the current, so that idle
+   * links lose their deficit and waiting ones are timestamped */
+  for (int xx = 1; xx <= MAX_L2CAP_LINKS; xx++) {
+    uint8_t idx = (*p_cur + xx) % MAX_L2CAP_LINKS;
+    tL2C_LCB* p_lcb = &l2cb.lcb_pool[idx];
+
+    ready[idx] = false;
+    if (!p_lcb->in_use || p_lcb->transport != transport) continue;
+
+    tL2C_LINK_SCHED_STATE state = state_cb(p_lcb);
+    if (state == L2C_LINK_SCHED_IDLE) p_lcb->sched_deficit = 0;
+    if (state != L2C_LINK_SCHED_READY) continue;
+
+    ready[idx] = any_ready = true;
+    cls[idx] = l2c_link_sched_class(p_lcb);
+    if (p_fast == NULL && cls[idx] == L2C_LINK_CLASS_LATENCY &&
+        p_lcb->sched_deficit > -L2CAP_LINK_SCHED_FAST_PATH_DEBT)
+      p_fast = p_lcb;
+  }
+
+  if (p_fast != NULL) {
+    p_fast->sched_fast_path++;
+    return p_fast;
+  }
+  if (!any_ready) return NULL;
+
+  /* The current link keeps the turn while its deficit lasts */
+  if (ready[*p_cur] && l2cb.lcb_pool[*p_cur].sched_deficit > 0)
+    return &l2cb.lcb_pool[*p_cur];
+
+  /* Each link passed gets its quantum. A link that overdrew through the fast
+   * path, or with a large packet, may need several rounds. */
+  for (;;) {
+    for (int xx = 1; xx <= MAX_L2CAP_LINKS; xx++) {
+      uint8_t idx = (*p_cur + xx) % MAX_L2CAP_LINKS;
+      if (!ready[idx]) continue;
+
+      tL2C_LCB* p_lcb = &l2cb.lcb_pool[idx];
+      p_lcb->sched_deficit += L2C_SCHED_QUANTUM(cls[idx]);
+      if (p_lcb->sched_deficit > 0) {
+        *p_cur = idx;
+        return p_lcb;
+      }
+    }
+  }
+}
+
+static void drr_packet_sent(tL2C_LCB* p_lcb, uint16_t len) {
+  p_lcb->sched_deficit -= len;
+}
+
+const tL2C_LINK_SCHED l2c_link_sched_drr = {"deficit round robin",
+                                            drr_next_link, drr_packet_sent};
+
+static void l2c_link_sched_dump_stats(int fd, const char* prefix,
+                                      const tL2C_TX_STATS* p_stats) {
+  dprintf(fd,
+          "%spackets: %llu bytes: %llu max queue: %u wait avg/max: %llu/%llu "
+          "us\n",
+          prefix, (unsigned long long)p_stats->packets,
+          (unsigned long long)p_stats->bytes, p_stats->max_queue_depth,
+          (unsigned long long)(p_stats->packets
+                                   ? p_stats->total_wait_us / p_stats->packets
+                                   : 0),
+          (unsigned long long)p_stats->max_wait_us);
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_link_sched_dump
+ *
+ * Description      Writes the transmit statistics by class, link and channel
+ *                  to |fd|.
+ *
+ ******************************************************************************/
+void l2c_link_sched_dump(int fd) {
+  dprintf(fd, "\nL2CAP link scheduler: %s\n", link_sched->name);
+
+  for (int t = 0; t < 2; t++) {
+    for (int cls = 0; cls < L2C_LINK_NUM_CLASSES; cls++) {
+      if (class_stats[t][cls].packets == 0) continue;
+      dprintf(fd, "  %s %-7s ", t ? "LE   " : "BR/EDR", class_names[cls]);
+      l2c_link_sched_dump_stats(fd, "", &class_stats[t][cls]);
+    }
+  }
+
+  for (int xx = 0; xx < MAX_L2CAP_LINKS; xx++) {
+    tL2C_LCB* p_lcb = &l2cb.lcb_pool[xx];
+    if (!p_lcb->in_use) continue;
+
+    dprintf(fd, "  Link %s handle 0x%04x %s quota: %u deficit: %d "
+            "fast path: %llu\n",
+            p_lcb->remote_bd_addr.ToString().c_str(), p_lcb->handle,
+            p_lcb->transport == BT_TRANSPORT_LE ? "LE" : "BR/EDR",
+            p_lcb->link_xmit_quota, p_lcb->sched_deficit,
+            (unsigned long long)p_lcb->sched_fast_path);
+    l2c_link_sched_dump_stats(fd, "    ", &p_lcb->tx_stats);
+
+    for (tL2C_CCB* p_ccb = p_lcb->ccb_queue.p_first_ccb; p_ccb != NULL;
+         p_ccb = p_ccb->p_next_ccb) {
+      if (p_ccb->tx_stats.packets == 0) continue;
+      dprintf(fd, "    CID 0x%04x priority %u queued %zu ", p_ccb->local_cid,
+              p_ccb->ccb_priority, fixed_queue_length(p_ccb->xmit_hold_q));
+      l2c_link_sched_dump_stats(fd, "", &p_ccb->tx_stats);
+    }
+  }
+}
@@ -41,6 +41,11 @@
 #include "osi/include/allocator.h"
 #include "osi/include/time.h"
 
+static_assert(MAX_L2CAP_LINKS < 0xFF,
+              "tL2C_CB::lcb_index_by_handle cannot hold every LCB index");
+
+static void l2cu_reindex_lcb_handle(uint16_t handle);
+
 /*******************************************************************************
  *
  * Function         l2cu_can_allocate_lcb
@@ -148,6 +153,7 @@ void l2cu_release_lcb(tL2C_LCB* p_lcb) {
 
   p_lcb->in_use = false;
   p_lcb->is_bonding = false;
+  l2cu_reindex_lcb_handle(p_lcb->handle);
 
   /* Stop the timers */
   alarm_cancel(p_lcb->l2c_lcb_timer);
@@ -1435,6 +1441,9 @@ tL2C_CCB* l2cu_allocate_ccb(tL2C_LCB* p_lcb, uint16_t cid) {
 
   if (p_lcb) l2cu_enqueue_ccb(p_ccb);
 
+  memset(&p_ccb->tx_stats, 0, sizeof(tL2C_TX_STATS));
+  p_ccb->tx_hol_since_us = 0;
+
   /* clear what peer wants to configure */
   p_ccb->peer_cfg_bits = 0;
 
@@ -3096,6 +3105,12 @@ tL2C_LCB* l2cu_find_lcb_by_handle(uint16_t handle) {
   int xx;
   tL2C_LCB* p_lcb = &l2cb.lcb_pool[0];
 
+  if (handle < HCI_NUM_HANDLES) {
+    xx = l2cb.lcb_index_by_handle[handle];
+    return (xx ? &l2cb.lcb_pool[xx - 1] : NULL);
+  }
+
+  /* Links that are not connected yet have HCI_INVALID_HANDLE */
   for (xx = 0; xx < MAX_L2CAP_LINKS; xx++, p_lcb++) {
     if ((p_lcb->in_use) && (p_lcb->handle == handle)) {
       return (p_lcb);
@@ -3106,6 +3121,49 @@ tL2C_LCB* l2cu_find_lcb_by_handle(uint16_t handle) {
   return (NULL);
 }
 
+/*******************************************************************************
+ *
+ * Function         l2cu_reindex_lcb_handle
+ *
+ * Description      Point the handle index entry for |handle| at the first
+ *                  active LCB using that handle, as l2cu_find_lcb_by_handle
+ *                  would find by searching the pool.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void l2cu_reindex_lcb_handle(uint16_t handle) {
+  int xx;
+
+  if (handle >= HCI_NUM_HANDLES) return;
+
+  l2cb.lcb_index_by_handle[handle] = 0;
+  for (xx = 0; xx < MAX_L2CAP_LINKS; xx++) {
+    if (l2cb.lcb_pool[xx].in_use && l2cb.lcb_pool[xx].handle == handle) {
+      l2cb.lcb_index_by_handle[handle] = xx + 1;
+      break;
+    }
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         l2cu_set_lcb_handle
+ *
+ * Description      Set the HCI handle of an LCB and update the handle index.
+ *                  The handle must only be changed through this function.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void l2cu_set_lcb_handle(tL2C_LCB* p_lcb, uint16_t handle) {
+  uint16_t old_handle = p_lcb->handle;
+
+  p_lcb->handle = handle;
+  l2cu_reindex_lcb_handle(old_handle);
+  l2cu_reindex_lcb_handle(handle);
+}
+
 /*******************************************************************************
  *
  * Function         l2cu_find_ccb_by_cid
@@ -3341,6 +3399,7 @@ BT_HDR* l2cu_get_next_buffer_to_send(tL2C_LCB* p_lcb,
 
       p_buf = l2c_fcr_get_next_xmit_sdu_seg(p_ccb, 0);
       if (p_buf != NULL) {
+        l2c_link_sched_chnl_sent(p_ccb, p_buf->len);
         l2cu_check_channel_congestion(p_ccb);
         l2cu_set_acl_hci_header(p_buf, p_ccb);
         return (p_buf);
@@ -3358,6 +3417,7 @@ BT_HDR* l2cu_get_next_buffer_to_send(tL2C_LCB* p_lcb,
         p_cbi->local_cid = p_ccb->local_cid;
         p_cbi->num_sdu = 1;
 
+        l2c_link_sched_chnl_sent(p_ccb, p_buf->len);
         l2cu_check_channel_congestion(p_ccb);
         l2cu_set_acl_hci_header(p_buf, p_ccb);
         return (p_buf);
@@ -3403,6 +3463,7 @@ BT_HDR* l2cu_get_next_buffer_to_send(tL2C_LCB* p_lcb,
       (p_ccb->peer_cfg.fcr.mode != L2CAP_FCR_ERTM_MODE))
     (*p_ccb->p_rcb->api.pL2CA_TxComplete_Cb)(p_ccb->local_cid, 1);
 
+  l2c_link_sched_chnl_sent(p_ccb, p_buf->len);
   l2cu_check_channel_congestion(p_ccb);
 
   l2cu_set_acl_hci_header(p_buf, p_ccb);
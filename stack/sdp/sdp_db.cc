@@ -72,12 +72,22 @@
 #include "sdp_api.h"
 #include "sdpint.h"
 
+using bluetooth::Uuid;
+
 #if (SDP_SERVER_ENABLED == TRUE)
 /******************************************************************************/
 /*            L O C A L    F U N C T I O N     P R O T O T Y P E S            */
 /******************************************************************************/
 static bool find_uuid_in_seq(uint8_t* p, uint32_t seq_len, uint8_t* p_his_uuid,
                              uint16_t his_len, int nest_level);
+static tSDP_RECORD* sdp_db_service_search_index(tSDP_RECORD* p_rec,
+                                                tSDP_UUID_SEQ* p_seq);
+static void sdp_db_build_uuid_index(void);
+static void sdp_db_index_seq(uint8_t* p, uint32_t seq_len, uint16_t rec_idx,
+                             int nest_level);
+
+static_assert(SDP_MAX_RECORDS <= 64,
+              "tSDP_UUID_INDEX_ENT::record_mask cannot hold every record");
 
 /*******************************************************************************
  *
@@ -95,6 +105,10 @@ tSDP_RECORD* sdp_db_service_search(tSDP_RECORD* p_rec, tSDP_UUID_SEQ* p_seq) {
   tSDP_ATTRIBUTE* p_attr;
   tSDP_RECORD* p_end = &sdp_cb.server_db.record[sdp_cb.server_db.num_records];
 
+  if (!sdp_cb.server_db.uuid_index_valid) sdp_db_build_uuid_index();
+  if (!sdp_cb.server_db.uuid_index_overflow)
+    return sdp_db_service_search_index(p_rec, p_seq);
+
   /* If NULL, start at the beginning, else start at the first specified record
    */
   if (!p_rec)
@@ -171,6 +185,204 @@ static bool find_uuid_in_seq(uint8_t* p, uint32_t seq_len, uint8_t* p_uuid,
   return (false);
 }
 
+/*******************************************************************************
+ *
+ * Function         sdp_db_expand_uuid
+ *
+ * Description      This function expands a BE UUID of 2, 4 or 16 bytes to its
+ *                  128-bit form.
+ *
+ * Returns          true if the length was valid, else false
+ *
+ ******************************************************************************/
+static bool sdp_db_expand_uuid(uint8_t* p_uuid, uint32_t len,
+                               uint8_t* p_uuid128) {
+  if (len == Uuid::kNumBytes128) {
+    memcpy(p_uuid128, p_uuid, Uuid::kNumBytes128);
+  } else if (len == Uuid::kNumBytes32) {
+    memcpy(p_uuid128, Uuid::kBase.To128BitBE().data(), Uuid::kNumBytes128);
+    memcpy(p_uuid128, p_uuid, Uuid::kNumBytes32);
+  } else if (len == Uuid::kNumBytes16) {
+    memcpy(p_uuid128, Uuid::kBase.To128BitBE().data(), Uuid::kNumBytes128);
+    memcpy(p_uuid128 + 2, p_uuid, Uuid::kNumBytes16);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_db_find_index_ent
+ *
+ * Description      This function does a binary search of the UUID index.
+ *
+ * Returns          Position of the UUID in the index, or the position at which
+ *                  it would be inserted. |*p_found| tells which.
+ *
+ ******************************************************************************/
+static uint16_t sdp_db_find_index_ent(uint8_t* p_uuid128, bool* p_found) {
+  tSDP_DB* p_db = &sdp_cb.server_db;
+  uint16_t lo = 0, hi = p_db->num_indexed_uuids;
+
+  while (lo < hi) {
+    uint16_t mid = (lo + hi) / 2;
+    int cmp =
+        memcmp(p_db->uuid_index[mid].uuid, p_uuid128, Uuid::kNumBytes128);
+    if (cmp == 0) {
+      *p_found = true;
+      return mid;
+    }
+    if (cmp < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  *p_found = false;
+  return lo;
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_db_index_uuid
+ *
+ * Description      This function records that record |rec_idx| contains the
+ *                  given UUID.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void sdp_db_index_uuid(uint8_t* p_uuid, uint32_t len, uint16_t rec_idx) {
+  tSDP_DB* p_db = &sdp_cb.server_db;
+  uint8_t uuid128[Uuid::kNumBytes128];
+  bool found;
+
+  /* Such UUIDs never match, as in sdpu_compare_uuid_arrays */
+  if (!sdp_db_expand_uuid(p_uuid, len, uuid128)) return;
+
+  uint16_t pos = sdp_db_find_index_ent(uuid128, &found);
+  if (!found) {
+    if (p_db->num_indexed_uuids == SDP_MAX_INDEXED_UUIDS) {
+      p_db->uuid_index_overflow = true;
+      return;
+    }
+    memmove(&p_db->uuid_index[pos + 1], &p_db->uuid_index[pos],
+            (p_db->num_indexed_uuids - pos) * sizeof(tSDP_UUID_INDEX_ENT));
+    memcpy(p_db->uuid_index[pos].uuid, uuid128, Uuid::kNumBytes128);
+    p_db->uuid_index[pos].record_mask = 0;
+    p_db->num_indexed_uuids++;
+  }
+  p_db->uuid_index[pos].record_mask |= (uint64_t)1 << rec_idx;
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_db_index_seq
+ *
+ * Description      This function adds the UUIDs of a data element sequence to
+ *                  the index. It walks the sequence the same way as
+ *                  find_uuid_in_seq, so that both find the same UUIDs.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void sdp_db_index_seq(uint8_t* p, uint32_t seq_len, uint16_t rec_idx,
+                             int nest_level) {
+  uint8_t* p_end = p + seq_len;
+  uint8_t type;
+  uint32_t len;
+
+  if (nest_level > 3) return;
+
+  while (p < p_end) {
+    type = *p++;
+    p = sdpu_get_len_from_type(p, p_end, type, &len);
+    if (p == NULL || (p + len) > p_end) {
+      SDP_TRACE_WARNING("%s: bad length", __func__);
+      break;
+    }
+    type = type >> 3;
+    if (type == UUID_DESC_TYPE) {
+      sdp_db_index_uuid(p, len, rec_idx);
+    } else if (type == DATA_ELE_SEQ_DESC_TYPE) {
+      sdp_db_index_seq(p, len, rec_idx, nest_level + 1);
+    }
+    p = p + len;
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_db_build_uuid_index
+ *
+ * Description      This function rebuilds the UUID index from the records in
+ *                  the database.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void sdp_db_build_uuid_index(void) {
+  tSDP_DB* p_db = &sdp_cb.server_db;
+  tSDP_ATTRIBUTE* p_attr;
+  uint16_t xx, yy;
+
+  p_db->num_indexed_uuids = 0;
+  p_db->uuid_index_overflow = false;
+
+  for (xx = 0; xx < p_db->num_records; xx++) {
+    p_attr = &p_db->record[xx].attribute[0];
+    for (yy = 0; yy < p_db->record[xx].num_attributes; yy++, p_attr++) {
+      if (p_attr->type == UUID_DESC_TYPE)
+        sdp_db_index_uuid(p_attr->value_ptr, p_attr->len, xx);
+      else if (p_attr->type == DATA_ELE_SEQ_DESC_TYPE)
+        sdp_db_index_seq(p_attr->value_ptr, p_attr->len, xx, 0);
+    }
+  }
+
+  if (p_db->uuid_index_overflow)
+    SDP_TRACE_WARNING("%s: more than %d UUIDs, index disabled", __func__,
+                      SDP_MAX_INDEXED_UUIDS);
+  p_db->uuid_index_valid = true;
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_db_service_search_index
+ *
+ * Description      This function is sdp_db_service_search using the UUID
+ *                  index. A record matches if it is in the record set of
+ *                  every passed UUID.
+ *
+ * Returns          Pointer to the record, or NULL if not found.
+ *
+ ******************************************************************************/
+static tSDP_RECORD* sdp_db_service_search_index(tSDP_RECORD* p_rec,
+                                                tSDP_UUID_SEQ* p_seq) {
+  tSDP_DB* p_db = &sdp_cb.server_db;
+  uint8_t uuid128[Uuid::kNumBytes128];
+  uint64_t mask;
+  uint16_t start, xx, pos;
+  bool found;
+
+  start = p_rec ? (uint16_t)(p_rec - &p_db->record[0]) + 1 : 0;
+  if (start >= p_db->num_records) return (NULL);
+
+  /* As in the scan, an empty sequence matches every record */
+
+  mask = ~(((uint64_t)1 << start) - 1);
+  for (xx = 0; xx < p_seq->num_uids && mask; xx++) {
+    if (!sdp_db_expand_uuid(&p_seq->uuid_entry[xx].value[0],
+                            p_seq->uuid_entry[xx].len, uuid128))
+      return (NULL);
+    pos = sdp_db_find_index_ent(uuid128, &found);
+    if (!found) return (NULL);
+    mask &= p_db->uuid_index[pos].record_mask;
+  }
+
+  if (!mask) return (NULL);
+  return &p_db->record[__builtin_ctzll(mask)];
+}
+
 /*******************************************************************************
  *
  * Function         sdp_db_find_record
@@ -183,11 +395,18 @@ static bool find_uuid_in_seq(uint8_t* p, uint32_t seq_len, uint8_t* p_uuid,
  ******************************************************************************/
 tSDP_RECORD* sdp_db_find_record(uint32_t handle) {
   tSDP_RECORD* p_rec;
-  tSDP_RECORD* p_end = &sdp_cb.server_db.record[sdp_cb.server_db.num_records];
+  uint16_t lo = 0, hi = sdp_cb.server_db.num_records;
 
-  /* Look through the records for the caller's handle */
-  for (p_rec = &sdp_cb.server_db.record[0]; p_rec < p_end; p_rec++) {
+  /* Handles are allocated in increasing order and deleting a record keeps the
+  ** order, so the records are sorted by handle */
+  while (lo < hi) {
+    uint16_t mid = (lo + hi) / 2;
+    p_rec = &sdp_cb.server_db.record[mid];
     if (p_rec->record_handle == handle) return (p_rec);
+    if (p_rec->record_handle < handle)
+      lo = mid + 1;
+    else
+      hi = mid;
   }
 
   /* Record with that handle not found. */
@@ -209,18 +428,45 @@ tSDP_RECORD* sdp_db_find_record(uint32_t handle) {
 tSDP_ATTRIBUTE* sdp_db_find_attr_in_rec(tSDP_RECORD* p_rec, uint16_t start_attr,
                                         uint16_t end_attr) {
   tSDP_ATTRIBUTE* p_at;
-  uint16_t xx;
+  uint16_t lo = 0, hi = p_rec->num_attributes;
+
+  /* Note that the attributes in a record are assumed to be in sorted order.
+  ** Find the first attribute with an ID of at least start_attr. */
+  while (lo < hi) {
+    uint16_t mid = (lo + hi) / 2;
+    if (p_rec->attribute[mid].id < start_attr)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
 
-  /* Note that the attributes in a record are assumed to be in sorted order */
-  for (xx = 0, p_at = &p_rec->attribute[0]; xx < p_rec->num_attributes;
-       xx++, p_at++) {
-    if ((p_at->id >= start_attr) && (p_at->id <= end_attr)) return (p_at);
+  if (lo < p_rec->num_attributes) {
+    p_at = &p_rec->attribute[lo];
+    if (p_at->id <= end_attr) return (p_at);
   }
 
   /* No matching attribute found */
   return (NULL);
 }
 
+/*******************************************************************************
+ *
+ * Function         sdp_db_record_changed
+ *
+ * Description      This function is called when a record is added, deleted or
+ *                  modified. Changes to records outside the database, such as
+ *                  the copies built for a particular peer, are ignored.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void sdp_db_record_changed(tSDP_RECORD* p_rec) {
+  tSDP_DB* p_db = &sdp_cb.server_db;
+
+  if (p_rec >= &p_db->record[0] && p_rec < &p_db->record[SDP_MAX_RECORDS])
+    p_db->uuid_index_valid = false;
+}
+
 /*******************************************************************************
  *
  * Function         sdp_compose_proto_list
@@ -306,6 +552,7 @@ uint32_t SDP_CreateRecord(void) {
     p_db->record[p_db->num_records].record_handle = handle;
 
     p_db->num_records++;
+    sdp_db_record_changed(&p_db->record[p_db->num_records - 1]);
     SDP_TRACE_DEBUG("SDP_CreateRecord ok, num_records:%d", p_db->num_records);
     /* Add the first attribute (the handle) automatically */
     UINT32_TO_BE_FIELD(buf, handle);
@@ -341,6 +588,7 @@ bool SDP_DeleteRecord(uint32_t handle) {
   if (handle == 0 || sdp_cb.server_db.num_records == 0) {
     /* Delete all records in the database */
     sdp_cb.server_db.num_records = 0;
+    sdp_cb.server_db.uuid_index_valid = false;
 
     /* require new DI record to be created in SDP_SetLocalDiRecord */
     sdp_cb.server_db.di_primary_handle = 0;
@@ -362,6 +610,7 @@ bool SDP_DeleteRecord(uint32_t handle) {
         }
 
         sdp_cb.server_db.num_records--;
+        sdp_cb.server_db.uuid_index_valid = false;
 
         SDP_TRACE_DEBUG("SDP_DeleteRecord ok, num_records:%d",
                         sdp_cb.server_db.num_records);
@@ -396,8 +645,7 @@ bool SDP_DeleteRecord(uint32_t handle) {
 bool SDP_AddAttribute(uint32_t handle, uint16_t attr_id, uint8_t attr_type,
                       uint32_t attr_len, uint8_t* p_val) {
 #if (SDP_SERVER_ENABLED == TRUE)
-  uint16_t xx;
-  tSDP_RECORD* p_rec = &sdp_cb.server_db.record[0];
+  tSDP_RECORD* p_rec;
 
   if (sdp_cb.trace_level >= BT_TRACE_LEVEL_DEBUG) {
     if ((attr_type == UINT_DESC_TYPE) ||
@@ -431,11 +679,9 @@ bool SDP_AddAttribute(uint32_t handle, uint16_t attr_id, uint8_t attr_type,
   }
 
   /* Find the record in the database */
-  for (xx = 0; xx < sdp_cb.server_db.num_records; xx++, p_rec++) {
-    if (p_rec->record_handle == handle) {
-      return SDP_AddAttributeToRecord (p_rec, attr_id, attr_type, attr_len, p_val);
-    }
-  }
+  p_rec = sdp_db_find_record(handle);
+  if (p_rec != NULL)
+    return SDP_AddAttributeToRecord(p_rec, attr_id, attr_type, attr_len, p_val);
 #endif
   return (false);
 }
@@ -461,6 +707,10 @@ bool SDP_AddAttributeToRecord (tSDP_RECORD *p_rec, uint16_t attr_id,
     uint16_t xx, yy;
     tSDP_ATTRIBUTE* p_attr = &p_rec->attribute[0];
 
+#if (SDP_SERVER_ENABLED == TRUE)
+    sdp_db_record_changed(p_rec);
+#endif
+
     /* Found the record. Now, see if the attribute already exists */
     for (xx = 0; xx < p_rec->num_attributes; xx++, p_attr++) {
       /* The attribute exists. replace it */
@@ -953,17 +1203,15 @@ bool SDP_AddServiceClassIdListUuid128(uint32_t handle, uint8_t* p_service_uuids)
  ******************************************************************************/
 bool SDP_DeleteAttribute(uint32_t handle, uint16_t attr_id) {
 #if (SDP_SERVER_ENABLED == TRUE)
-  uint16_t xx;
-  tSDP_RECORD* p_rec = &sdp_cb.server_db.record[0];
+  tSDP_RECORD* p_rec;
 
   /* Find the record in the database */
-  for (xx = 0; xx < sdp_cb.server_db.num_records; xx++, p_rec++) {
-    if (p_rec->record_handle == handle) {
-      SDP_TRACE_API("Deleting attr_id 0x%04x for handle 0x%x",
-          attr_id, handle);
-      if (SDP_DeleteAttributeFromRecord (p_rec, attr_id))
-        return (true);
-    }
+  p_rec = sdp_db_find_record(handle);
+  if (p_rec != NULL) {
+    SDP_TRACE_API("Deleting attr_id 0x%04x for handle 0x%x",
+        attr_id, handle);
+    if (SDP_DeleteAttributeFromRecord (p_rec, attr_id))
+      return (true);
   }
 #endif
   /* If here, not found */
@@ -1011,6 +1259,10 @@ bool SDP_DeleteAttributeFromRecord (tSDP_RECORD* p_rec, uint16_t attr_id)
         }
       }
 
+#if (SDP_SERVER_ENABLED == TRUE)
+      sdp_db_record_changed(p_rec);
+#endif
+
       /* Found it. Shift everything up one */
       p_rec->num_attributes--;
 
@@ -125,12 +125,30 @@ typedef struct {
   uint8_t attr_pad[SDP_MAX_PAD_LEN];
 } tSDP_RECORD;
 
+/* Number of distinct UUIDs the server database index can hold. If the
+ * records contain more, service searches fall back to parsing each record.
+ */
+#define SDP_MAX_INDEXED_UUIDS (SDP_MAX_RECORDS * 4)
+
+/* One UUID of the server database index, expanded to 128 bits */
+typedef struct {
+  uint8_t uuid[bluetooth::Uuid::kNumBytes128];
+  uint64_t record_mask; /* Bit n is set if record[n] contains the UUID */
+} tSDP_UUID_INDEX_ENT;
+
 /* Define the SDP database */
 typedef struct {
   uint32_t
       di_primary_handle; /* Device ID Primary record or NULL if nonexistent */
   uint16_t num_records;
   tSDP_RECORD record[SDP_MAX_RECORDS];
+
+  /* UUID index, sorted by UUID. Rebuilt on the next search after any change
+   * to the records. */
+  bool uuid_index_valid;
+  bool uuid_index_overflow;
+  uint16_t num_indexed_uuids;
+  tSDP_UUID_INDEX_ENT uuid_index[SDP_MAX_INDEXED_UUIDS];
 } tSDP_DB;
 
 enum {
@@ -0,0 +1,515 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/*******************************************************************************
+ *
+ *  This file contains constant-time P-256 scalar multiplication for LE Secure
+ *  Connections and BR/EDR Secure Simple Pairing.
+ *
+ *  Field elements are four 64-bit limbs in Montgomery form. Points are in
+ *  homogeneous projective coordinates and use the complete addition and
+ *  doubling formulas for a = -3 from Renes, Costello and Batina, "Complete
+ *  addition formulas for prime order elliptic curves" (2015), so no input,
+ *  including the point at infinity, takes a different path. Table lookups
+ *  read every entry, and nothing branches on the scalar.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "p_256_ecc_pp.h"
+
+typedef uint64_t p_256_felem[4];
+
+typedef struct {
+  p_256_felem x;
+  p_256_felem y;
+  p_256_felem z;
+} p_256_point;
+
+typedef struct {
+  p_256_felem x;
+  p_256_felem y;
+} p_256_affine;
+
+// p = 2^256 - 2^224 + 2^192 + 2^96 - 1
+static const p_256_felem p_256_p = {0xffffffffffffffff, 0x00000000ffffffff,
+                                    0x0000000000000000, 0xffffffff00000001};
+
+// R^2 mod p, R = 2^256
+static const p_256_felem p_256_r2 = {0x0000000000000003, 0xfffffffbffffffff,
+                                     0xfffffffffffffffe, 0x00000004fffffffd};
+
+// 1 and b in Montgomery form
+static const p_256_felem p_256_one = {0x0000000000000001, 0xffffffff00000000,
+                                      0xffffffffffffffff, 0x00000000fffffffe};
+static const p_256_felem p_256_b = {0xd89cdf6229c4bddf, 0xacf005cd78843090,
+                                    0xe5a220abf7212ed6, 0xdc30061d04874834};
+
+// Precomputed comb for the base point G: entry j of table t is
+// sum over k = 0..3 of bit k of j times 2^(64 * k + 32 * t) * G. Entry 0
+// stands for the point at infinity.
+static p_256_affine p_256_base_comb[2][16];
+static bool p_256_base_comb_ready = false;
+
+// Returns a * b + c + d, with the high half in |hi|.
+static inline uint64_t mul_add(uint64_t a, uint64_t b, uint64_t c, uint64_t d,
+                               uint64_t* hi) {
+#if defined(__SIZEOF_INT128__)
+  unsigned __int128 t = (unsigned __int128)a * b + c + d;
+  *hi = (uint64_t)(t >> 64);
+  return (uint64_t)t;
+#else
+  uint64_t a0 = (uint32_t)a, a1 = a >> 32;
+  uint64_t b0 = (uint32_t)b, b1 = b >> 32;
+  uint64_t p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+  uint64_t mid = (p00 >> 32) + (uint32_t)p01 + (uint32_t)p10;
+  uint64_t lo = (mid << 32) | (uint32_t)p00;
+  uint64_t h = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+  lo += c;
+  h += lo < c;
+  lo += d;
+  h += lo < d;
+  *hi = h;
+  return lo;
+#endif
+}
+
+// Returns a + b + carry, with the carry out in |carry|.
+static inline uint64_t add_carry(uint64_t a, uint64_t b, uint64_t* carry) {
+#if defined(__SIZEOF_INT128__)
+  unsigned __int128 t = (unsigned __int128)a + b + *carry;
+  *carry = (uint64_t)(t >> 64);
+  return (uint64_t)t;
+#else
+  uint64_t s = a + b;
+  uint64_t c = s < a;
+  uint64_t r = s + *carry;
+  *carry = c | (r < s);
+  return r;
+#endif
+}
+
+// Returns a - b - borrow, with the borrow out in |borrow|.
+static inline uint64_t sub_borrow(uint64_t a, uint64_t b, uint64_t* borrow) {
+#if defined(__SIZEOF_INT128__)
+  unsigned __int128 t = (unsigned __int128)a - b - *borrow;
+  *borrow = (uint64_t)(t >> 127);
+  return (uint64_t)t;
+#else
+  uint64_t d = a - b;
+  uint64_t w = a < b;
+  uint64_t r = d - *borrow;
+  *borrow = w | (d < *borrow);
+  return r;
+#endif
+}
+
+// r = a if mask is all ones, unchanged if mask is zero
+static inline void fe_cmov(p_256_felem r, const p_256_felem a, uint64_t mask) {
+  for (int i = 0; i < 4; i++) r[i] ^= mask & (r[i] ^ a[i]);
+}
+
+// r = t - p if t (with |top| as a fifth limb) is at least p, otherwise t.
+// t must be below 2p.
+static inline void fe_reduce_once(p_256_felem r, uint64_t t0, uint64_t t1,
+                                  uint64_t t2, uint64_t t3, uint64_t top) {
+  uint64_t borrow = 0;
+  uint64_t u0 = sub_borrow(t0, p_256_p[0], &borrow);
+  uint64_t u1 = sub_borrow(t1, p_256_p[1], &borrow);
+  uint64_t u2 = sub_borrow(t2, p_256_p[2], &borrow);
+  uint64_t u3 = sub_borrow(t3, p_256_p[3], &borrow);
+  // Keep t only if subtracting p borrowed out of the fifth limb too.
+  uint64_t keep_t = 0 - (borrow & (top ^ 1));
+  r[0] = (t0 & keep_t) | (u0 & ~keep_t);
+  r[1] = (t1 & keep_t) | (u1 & ~keep_t);
+  r[2] = (t2 & keep_t) | (u2 & ~keep_t);
+  r[3] = (t3 & keep_t) | (u3 & ~keep_t);
+}
+
+static void fe_add(p_256_felem r, const p_256_felem a, const p_256_felem b) {
+  uint64_t carry = 0;
+  uint64_t t0 = add_carry(a[0], b[0], &carry);
+  uint64_t t1 = add_carry(a[1], b[1], &carry);
+  uint64_t t2 = add_carry(a[2], b[2], &carry);
+  uint64_t t3 = add_carry(a[3], b[3], &carry);
+  fe_reduce_once(r, t0, t1, t2, t3, carry);
+}
+
+static void fe_sub(p_256_felem r, const p_256_felem a, const p_256_felem b) {
+  uint64_t borrow = 0;
+  uint64_t t0 = sub_borrow(a[0], b[0], &borrow);
+  uint64_t t1 = sub_borrow(a[1], b[1], &borrow);
+  uint64_t t2 = sub_borrow(a[2], b[2], &borrow);
+  uint64_t t3 = sub_borrow(a[3], b[3], &borrow);
+  // Add p back if the difference went negative.
+  uint64_t mask = 0 - borrow;
+  uint64_t carry = 0;
+  r[0] = add_carry(t0, p_256_p[0] & mask, &carry);
+  r[1] = add_carry(t1, p_256_p[1] & mask, &carry);
+  r[2] = add_carry(t2, p_256_p[2] & mask, &carry);
+  r[3] = add_carry(t3, p_256_p[3] & mask, &carry);
+}
+
+// One Montgomery reduction round: adds m * p to t0..t4, m = t0, which clears
+// t0. Since p = -1 mod 2^64 the multiplier is t0 itself, and the sparse limbs
+// of p leave a single multiplication: t0 + m * (p0 + 2^64 * p1) = m * 2^96.
+// |top| carries into t4 on entry and out of it on return.
+static inline void mont_round(uint64_t t0, uint64_t* t1, uint64_t* t2,
+                              uint64_t* t3, uint64_t* t4, uint64_t* top) {
+  uint64_t carry = 0, hi;
+  *t1 = add_carry(*t1, t0 << 32, &carry);
+  *t2 = add_carry(*t2, t0 >> 32, &carry);
+  *t3 = mul_add(t0, p_256_p[3], *t3, carry, &hi);
+  *t4 = add_carry(*t4, hi, top);
+}
+
+// Montgomery multiplication, r = a * b / R mod p
+static void fe_mul(p_256_felem r, const p_256_felem a, const p_256_felem b) {
+  uint64_t t0, t1, t2, t3, t4, t5, t6, t7, c, top;
+
+  t0 = mul_add(a[0], b[0], 0, 0, &c);
+  t1 = mul_add(a[1], b[0], 0, c, &c);
+  t2 = mul_add(a[2], b[0], 0, c, &c);
+  t3 = mul_add(a[3], b[0], 0, c, &t4);
+
+  t1 = mul_add(a[0], b[1], t1, 0, &c);
+  t2 = mul_add(a[1], b[1], t2, c, &c);
+  t3 = mul_add(a[2], b[1], t3, c, &c);
+  t4 = mul_add(a[3], b[1], t4, c, &t5);
+
+  t2 = mul_add(a[0], b[2], t2, 0, &c);
+  t3 = mul_add(a[1], b[2], t3, c, &c);
+  t4 = mul_add(a[2], b[2], t4, c, &c);
+  t5 = mul_add(a[3], b[2], t5, c, &t6);
+
+  t3 = mul_add(a[0], b[3], t3, 0, &c);
+  t4 = mul_add(a[1], b[3], t4, c, &c);
+  t5 = mul_add(a[2], b[3], t5, c, &c);
+  t6 = mul_add(a[3], b[3], t6, c, &t7);
+
+  top = 0;
+  mont_round(t0, &t1, &t2, &t3, &t4, &top);
+  mont_round(t1, &t2, &t3, &t4, &t5, &top);
+  mont_round(t2, &t3, &t4, &t5, &t6, &top);
+  mont_round(t3, &t4, &t5, &t6, &t7, &top);
+
+  fe_reduce_once(r, t4, t5, t6, t7, top);
+}
+
+static void fe_sqr(p_256_felem r, const p_256_felem a) { fe_mul(r, a, a); }
+
+static void fe_sqr_n(p_256_felem r, const p_256_felem a, int n) {
+  fe_sqr(r, a);
+  while (--n > 0) fe_sqr(r, r);
+}
+
+// r = a^(p - 2) = 1 / a, or 0 if a is 0
+static void fe_inv(p_256_felem r, const p_256_felem a) {
+  p_256_felem x2, x4, x8, x16, x30, x32, t;
+
+  fe_sqr(t, a);
+  fe_mul(x2, t, a);  // a^(2^2 - 1)
+  fe_sqr_n(t, x2, 2);
+  fe_mul(x4, t, x2);  // a^(2^4 - 1)
+  fe_sqr_n(t, x4, 4);
+  fe_mul(x8, t, x4);  // a^(2^8 - 1)
+  fe_sqr_n(t, x8, 8);
+  fe_mul(x16, t, x8);  // a^(2^16 - 1)
+  fe_sqr_n(t, x16, 8);
+  fe_mul(t, t, x8);  // a^(2^24 - 1)
+  fe_sqr_n(t, t, 4);
+  fe_mul(t, t, x4);  // a^(2^28 - 1)
+  fe_sqr_n(t, t, 2);
+  fe_mul(x30, t, x2);  // a^(2^30 - 1)
+  fe_sqr_n(t, x30, 2);
+  fe_mul(x32, t, x2);  // a^(2^32 - 1)
+
+  // p - 2 = ffffffff 00000001 00000000 00000000
+  //         00000000 ffffffff ffffffff fffffffd
+  fe_sqr_n(t, x32, 32);
+  fe_mul(t, t, a);
+  fe_sqr_n(t, t, 128);
+  fe_mul(t, t, x32);
+  fe_sqr_n(t, t, 32);
+  fe_mul(t, t, x32);
+  fe_sqr_n(t, t, 30);
+  fe_mul(t, t, x30);
+  fe_sqr_n(t, t, 2);
+  fe_mul(r, t, a);
+}
+
+static void fe_from_words(p_256_felem r, const uint32_t* w) {
+  p_256_felem t;
+  for (int i = 0; i < 4; i++) {
+    t[i] = (uint64_t)w[2 * i] | ((uint64_t)w[2 * i + 1] << 32);
+  }
+  fe_mul(r, t, p_256_r2);
+}
+
+static void fe_to_words(uint32_t* w, const p_256_felem a) {
+  static const p_256_felem one = {1, 0, 0, 0};
+  p_256_felem t;
+  fe_mul(t, a, one);
+  for (int i = 0; i < 4; i++) {
+    w[2 * i] = (uint32_t)t[i];
+    w[2 * i + 1] = (uint32_t)(t[i] >> 32);
+  }
+}
+
+// r = p + q, for any p and q
+static void point_add(p_256_point* r, const p_256_point* p,
+                      const p_256_point* q) {
+  p_256_felem t0, t1, t2, t3, t4, x3, y3, z3;
+
+  fe_mul(t0, p->x, q->x);
+  fe_mul(t1, p->y, q->y);
+  fe_mul(t2, p->z, q->z);
+  fe_add(t3, p->x, p->y);
+  fe_add(t4, q->x, q->y);
+  fe_mul(t3, t3, t4);
+  fe_add(t4, t0, t1);
+  fe_sub(t3, t3, t4);
+  fe_add(t4, p->y, p->z);
+  fe_add(x3, q->y, q->z);
+  fe_mul(t4, t4, x3);
+  fe_add(x3, t1, t2);
+  fe_sub(t4, t4, x3);
+  fe_add(x3, p->x, p->z);
+  fe_add(y3, q->x, q->z);
+  fe_mul(x3, x3, y3);
+  fe_add(y3, t0, t2);
+  fe_sub(y3, x3, y3);
+  fe_mul(z3, p_256_b, t2);
+  fe_sub(x3, y3, z3);
+  fe_add(z3, x3, x3);
+  fe_add(x3, x3, z3);
+  fe_sub(z3, t1, x3);
+  fe_add(x3, t1, x3);
+  fe_mul(y3, p_256_b, y3);
+  fe_add(t1, t2, t2);
+  fe_add(t2, t1, t2);
+  fe_sub(y3, y3, t2);
+  fe_sub(y3, y3, t0);
+  fe_add(t1, y3, y3);
+  fe_add(y3, t1, y3);
+  fe_add(t1, t0, t0);
+  fe_add(t0, t1, t0);
+  fe_sub(t0, t0, t2);
+  fe_mul(t1, t4, y3);
+  fe_mul(t2, t0, y3);
+  fe_mul(y3, x3, z3);
+  fe_add(y3, y3, t2);
+  fe_mul(x3, t3, x3);
+  fe_sub(x3, x3, t1);
+  fe_mul(z3, t4, z3);
+  fe_mul(t1, t3, t0);
+  fe_add(z3, z3, t1);
+
+  memcpy(r->x, x3, sizeof(x3));
+  memcpy(r->y, y3, sizeof(y3));
+  memcpy(r->z, z3, sizeof(z3));
+}
+
+// r = 2p, for any p
+static void point_double(p_256_point* r, const p_256_point* p) {
+  p_256_felem t0, t1, t2, t3, x3, y3, z3;
+
+  fe_sqr(t0, p->x);
+  fe_sqr(t1, p->y);
+  fe_sqr(t2, p->z);
+  fe_mul(t3, p->x, p->y);
+  fe_add(t3, t3, t3);
+  fe_mul(z3, p->x, p->z);
+  fe_add(z3, z3, z3);
+  fe_mul(y3, p_256_b, t2);
+  fe_sub(y3, y3, z3);
+  fe_add(x3, y3, y3);
+  fe_add(y3, x3, y3);
+  fe_sub(x3, t1, y3);
+  fe_add(y3, t1, y3);
+  fe_mul(y3, x3, y3);
+  fe_mul(x3, x3, t3);
+  fe_add(t3, t2, t2);
+  fe_add(t2, t2, t3);
+  fe_mul(z3, p_256_b, z3);
+  fe_sub(z3, z3, t2);
+  fe_sub(z3, z3, t0);
+  fe_add(t3, z3, z3);
+  fe_add(z3, z3, t3);
+  fe_add(t3, t0, t0);
+  fe_add(t0, t3, t0);
+  fe_sub(t0, t0, t2);
+  fe_mul(t0, t0, z3);
+  fe_add(y3, y3, t0);
+  fe_mul(t0, p->y, p->z);
+  fe_add(t0, t0, t0);
+  fe_mul(z3, t0, z3);
+  fe_sub(x3, x3, z3);
+  fe_mul(z3, t0, t1);
+  fe_add(z3, z3, z3);
+  fe_add(z3, z3, z3);
+
+  memcpy(r->x, x3, sizeof(x3));
+  memcpy(r->y, y3, sizeof(y3));
+  memcpy(r->z, z3, sizeof(z3));
+}
+
+static void point_set_infinity(p_256_point* r) {
+  memset(r->x, 0, sizeof(r->x));
+  memcpy(r->y, p_256_one, sizeof(p_256_one));
+  memset(r->z, 0, sizeof(r->z));
+}
+
+static void point_to_affine(p_256_felem x, p_256_felem y,
+                            const p_256_point* p) {
+  p_256_felem z_inv;
+  fe_inv(z_inv, p->z);
+  fe_mul(x, p->x, z_inv);
+  fe_mul(y, p->y, z_inv);
+}
+
+// All ones if a == b, zero otherwise
+static inline uint64_t eq_mask(uint32_t a, uint32_t b) {
+  uint64_t x = a ^ b;
+  return 0 - ((x - 1) >> 63);
+}
+
+// r = table[index], reading every entry
+static void point_lookup(p_256_point* r, const p_256_point table[16],
+                         uint32_t index) {
+  memset(r, 0, sizeof(*r));
+  for (uint32_t i = 0; i < 16; i++) {
+    uint64_t mask = eq_mask(i, index);
+    fe_cmov(r->x, table[i].x, mask);
+    fe_cmov(r->y, table[i].y, mask);
+    fe_cmov(r->z, table[i].z, mask);
+  }
+}
+
+// r = comb[index] as a projective point, reading every entry
+static void affine_lookup(p_256_point* r, const p_256_affine comb[16],
+                          uint32_t index) {
+  memset(r, 0, sizeof(*r));
+  for (uint32_t i = 0; i < 16; i++) {
+    uint64_t mask = eq_mask(i, index);
+    fe_cmov(r->x, comb[i].x, mask);
+    fe_cmov(r->y, comb[i].y, mask);
+  }
+  // Entry 0 holds (0, 1), which becomes the point at infinity (0 : 1 : 0).
+  memcpy(r->z, p_256_one, sizeof(p_256_one));
+  fe_cmov(r->z, r->x, eq_mask(0, index));
+}
+
+static inline uint32_t scalar_bit(const uint32_t* n, int i) {
+  return (n[i >> 5] >> (i & 31)) & 1;
+}
+
+static void point_from_curve(p_256_point* r, const Point* p) {
+  fe_from_words(r->x, p->x);
+  fe_from_words(r->y, p->y);
+  memcpy(r->z, p_256_one, sizeof(p_256_one));
+}
+
+static void point_to_curve(Point* q, const p_256_point* r) {
+  p_256_felem x, y;
+  point_to_affine(x, y, r);
+  fe_to_words(q->x, x);
+  fe_to_words(q->y, y);
+  multiprecision_init(q->z, KEY_LENGTH_DWORDS_P256);
+  q->z[0] = 1;
+}
+
+void p_256_init_base_comb(void) {
+  if (p_256_base_comb_ready) return;
+
+  p_256_point base[2][4];
+  Point g;
+  p_256_init_curve(KEY_LENGTH_DWORDS_P256);
+  memcpy(&g, &curve_p256.G, sizeof(g));
+  point_from_curve(&base[0][0], &g);
+
+  // base[t][k] = 2^(64 * k + 32 * t) * G
+  for (int i = 1; i < 8; i++) {
+    p_256_point* prev = (i % 2) ? &base[0][(i - 1) / 2] : &base[1][i / 2 - 1];
+    p_256_point* next = (i % 2) ? &base[1][i / 2] : &base[0][i / 2];
+    memcpy(next, prev, sizeof(*next));
+    for (int j = 0; j < 32; j++) point_double(next, next);
+  }
+
+  for (int t = 0; t < 2; t++) {
+    memset(p_256_base_comb[t][0].x, 0, sizeof(p_256_felem));
+    memcpy(p_256_base_comb[t][0].y, p_256_one, sizeof(p_256_one));
+    for (int j = 1; j < 16; j++) {
+      p_256_point sum;
+      point_set_infinity(&sum);
+      for (int k = 0; k < 4; k++) {
+        if (j & (1 << k)) point_add(&sum, &sum, &base[t][k]);
+      }
+      point_to_affine(p_256_base_comb[t][j].x, p_256_base_comb[t][j].y, &sum);
+    }
+  }
+  p_256_base_comb_ready = true;
+}
+
+void ECC_PointMult_P256(Point* q, const Point* p, const uint32_t* n) {
+  p_256_point table[16];
+  p_256_point r, t;
+
+  // table[i] = i * p
+  point_set_infinity(&table[0]);
+  point_from_curve(&table[1], p);
+  for (int i = 2; i < 16; i++) {
+    if (i % 2)
+      point_add(&table[i], &table[i - 1], &table[1]);
+    else
+      point_double(&table[i], &table[i / 2]);
+  }
+
+  // Fixed 4-bit windows from the top
+  point_set_infinity(&r);
+  for (int i = 252; i >= 0; i -= 4) {
+    for (int j = 0; j < 4; j++) point_double(&r, &r);
+    uint32_t index = (n[i >> 5] >> (i & 31)) & 0x0F;
+    point_lookup(&t, table, index);
+    point_add(&r, &r, &t);
+  }
+
+  point_to_curve(q, &r);
+}
+
+void ECC_PointMultBase_P256(Point* q, const uint32_t* n) {
+  p_256_point r, t;
+
+  p_256_init_base_comb();
+
+  point_set_infinity(&r);
+  for (int i = 31; i >= 0; i--) {
+    point_double(&r, &r);
+    for (int c = 0; c < 2; c++) {
+      int bit = i + 32 * c;
+      uint32_t index = scalar_bit(n, bit) | (scalar_bit(n, bit + 64) << 1) |
+                       (scalar_bit(n, bit + 128) << 2) |
+                       (scalar_bit(n, bit + 192) << 3);
+      affine_lookup(&t, p_256_base_comb[c], index);
+      point_add(&r, &r, &t);
+    }
+  }
+
+  point_to_curve(q, &r);
+}
@@ -63,4 +63,15 @@ void ECC_PointMult_Bin_NAF(Point* q, Point* p, uint32_t* n, uint32_t keyLength);
 #define ECC_PointMult(q, p, n, keyLength) \
   ECC_PointMult_Bin_NAF(q, p, n, keyLength)
 
+// Constant-time P-256 scalar multiplication, q = n * p, with q in affine
+// coordinates (q->z = 1). p->z is ignored and neither p nor n is modified.
+void ECC_PointMult_P256(Point* q, const Point* p, const uint32_t* n);
+
+// Constant-time q = n * G using a precomputed comb for the base point.
+void ECC_PointMultBase_P256(Point* q, const uint32_t* n);
+
+// Builds the base point comb used by ECC_PointMultBase_P256(). It is built
+// on first use otherwise.
+void p_256_init_base_comb(void);
+
 void p_256_init_curve(uint32_t keyLength);
@@ -0,0 +1,200 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <arpa/inet.h>
+#include <benchmark/benchmark.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "btm_ble_int.h"
+#include "btm_int.h"
+#include "hcidefs.h"
+#include "osi/include/allocator.h"
+#include "osi/include/list.h"
+
+using ::benchmark::State;
+
+// LE Advertising Report events, each starting at the Num_Reports field as
+// passed to btm_ble_process_adv_pkt.
+typedef std::vector<std::vector<uint8_t>> adv_trace_t;
+
+// Trace loaded from the btsnoop file given with --btsnoop=<file>, if any.
+static adv_trace_t recorded_trace;
+
+// Reads the LE Advertising Report events out of a btsnoop capture.
+static bool load_btsnoop(const char* path, adv_trace_t* trace) {
+  static const size_t BTSNOOP_FILE_HEADER_SIZE = 16;
+  static const size_t BTSNOOP_RECORD_HEADER_SIZE = 24;
+
+  FILE* fp = fopen(path, "rb");
+  if (fp == NULL) return false;
+
+  uint8_t header[BTSNOOP_RECORD_HEADER_SIZE];
+  if (fread(header, 1, BTSNOOP_FILE_HEADER_SIZE, fp) !=
+      BTSNOOP_FILE_HEADER_SIZE) {
+    fclose(fp);
+    return false;
+  }
+
+  std::vector<uint8_t> packet;
+  while (fread(header, 1, sizeof(header), fp) == sizeof(header)) {
+    uint32_t length;
+    memcpy(&length, header + 4, sizeof(length));
+    packet.resize(ntohl(length));
+    if (fread(packet.data(), 1, packet.size(), fp) != packet.size()) break;
+
+    // Type, event code, length, subevent code
+    if (packet.size() > 4 && packet[0] == HCIT_TYPE_EVENT &&
+        packet[1] == HCI_BLE_EVENT && packet[3] == HCI_BLE_ADV_PKT_RPT_EVT)
+      trace->emplace_back(packet.begin() + 4, packet.end());
+  }
+
+  fclose(fp);
+  return !trace->empty();
+}
+
+// Builds a trace shaped like a capture taken in a crowded space: mostly
+// non-connectable beacons, plus scannable devices whose scan responses follow
+// their advertisements, up to three reports per event.
+static adv_trace_t synthesize_trace(int num_devices) {
+  static const int NUM_EVENTS = 4096;
+  std::mt19937 rng(num_devices);
+  adv_trace_t trace;
+
+  std::vector<uint8_t> event;
+  int num_reports = 0;
+  auto add_report = [&](uint8_t evt_type, int device, uint8_t payload_len) {
+    if (num_reports == 0) event.assign(1, 0);
+    event.push_back(evt_type);
+    event.push_back(BLE_ADDR_PUBLIC);
+    uint8_t addr[] = {(uint8_t)device, (uint8_t)(device >> 8), 0x00,
+                      0xdc, 0x1b, 0x00};
+    event.insert(event.end(), addr, addr + sizeof(addr));
+    event.push_back(payload_len);
+    // Flags, then manufacturer data
+    uint8_t flags[] = {0x02, BTM_BLE_AD_TYPE_FLAG, BTM_BLE_GEN_DISC_FLAG};
+    event.insert(event.end(), flags, flags + sizeof(flags));
+    event.push_back(payload_len - sizeof(flags) - 1);
+    event.push_back(0xff);
+    for (int i = sizeof(flags) + 2; i < payload_len; i++)
+      event.push_back(device + i);
+    event.push_back((uint8_t)(-60 - (int)(rng() % 30)));
+    event[0] = ++num_reports;
+    if (num_reports == 3) {
+      trace.push_back(event);
+      num_reports = 0;
+    }
+  };
+
+  while (trace.size() < NUM_EVENTS) {
+    int device = rng() % num_devices;
+    if (device % 4 == 0) {
+      add_report(0x00 /* ADV_IND */, device, 20);
+      add_report(0x04 /* SCAN_RSP */, device, 31);
+    } else {
+      add_report(0x03 /* ADV_NONCONN_IND */, device, 30);
+    }
+  }
+  return trace;
+}
+
+static int num_results;
+
+static void count_results_cb(tBTM_INQ_RESULTS* p_inq_results,
+                             uint8_t* p_eir, uint16_t eir_len) {
+  num_results++;
+}
+
+// Actively scanning for LE general discovery and observers, as while the
+// device picker is open.
+static void start_scan() {
+  if (btm_cb.sec_dev_rec == NULL)
+    btm_cb.sec_dev_rec = list_new(btm_sec_dev_rec_free);
+
+  btm_inq_db_init();
+  btm_clr_inq_db(NULL);
+
+  tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
+  osi_free(p_inq->p_bd_db);
+  p_inq->p_bd_db = (tINQ_BDADDR*)osi_calloc(BT_DEFAULT_BUFFER_SIZE);
+  p_inq->num_bd_entries = 0;
+  p_inq->max_bd_entries =
+      (uint16_t)(BT_DEFAULT_BUFFER_SIZE / sizeof(tINQ_BDADDR));
+  p_inq->inq_active = BTM_BLE_GENERAL_INQUIRY;
+  p_inq->inq_counter++;
+
+  btm_cb.ble_ctr_cb.scan_activity =
+      BTM_LE_OBSERVE_ACTIVE | BTM_LE_GENERAL_INQUIRY_ACTIVE;
+  btm_cb.ble_ctr_cb.inq_var.scan_type = BTM_BLE_SCAN_MODE_ACTI;
+  btm_cb.ble_ctr_cb.p_obs_results_cb = count_results_cb;
+}
+
+static void replay(State& state, const adv_trace_t& trace) {
+  start_scan();
+  num_results = 0;
+
+  size_t num_reports = 0;
+  for (const std::vector<uint8_t>& event : trace) num_reports += event[0];
+
+  for (auto _ : state) {
+    for (const std::vector<uint8_t>& event : trace)
+      btm_ble_process_adv_pkt(event.size(),
+                              const_cast<uint8_t*>(event.data()));
+  }
+  state.SetItemsProcessed(state.iterations() * num_reports);
+  state.counters["results"] = benchmark::Counter(
+      num_results, benchmark::Counter::kAvgIterations);
+}
+
+static void BM_AdvReportReplay(State& state) {
+  replay(state, synthesize_trace(state.range(0)));
+}
+BENCHMARK(BM_AdvReportReplay)->Arg(10)->Arg(100)->Arg(1000);
+
+static void BM_AdvReportReplayRecorded(State& state) {
+  if (recorded_trace.empty()) {
+    state.SkipWithError("no --btsnoop=<file> given");
+    return;
+  }
+  replay(state, recorded_trace);
+}
+BENCHMARK(BM_AdvReportReplayRecorded);
+
+int main(int argc, char** argv) {
+  static const char BTSNOOP_FLAG[] = "--btsnoop=";
+
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], BTSNOOP_FLAG, strlen(BTSNOOP_FLAG)) != 0) continue;
+
+    const char* path = argv[i] + strlen(BTSNOOP_FLAG);
+    if (!load_btsnoop(path, &recorded_trace)) {
+      fprintf(stderr, "No LE advertising reports in %s\n", path);
+      return 1;
+    }
+    for (int j = i; j < argc - 1; j++) argv[j] = argv[j + 1];
+    argc--;
+    break;
+  }
+
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  ::benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
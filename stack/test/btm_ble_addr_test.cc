@@ -0,0 +1,242 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "bt_trace.h"
+#include "btm_ble_int.h"
+#include "btm_int.h"
+#include "osi/include/allocator.h"
+#include "osi/include/list.h"
+#include "osi/include/time.h"
+
+extern RawAddress generate_rpa_from_irk_and_rand(const Octet16& irk,
+                                                 BT_OCTET8 random);
+
+// The rest of BTM is not linked in
+tBTM_CB btm_cb;
+uint8_t appl_trace_level = BT_TRACE_LEVEL_NONE;
+void LogMsg(uint32_t trace_set_mask, const char* fmt_str, ...) {}
+void vnd_LogMsg(uint32_t trace_set_mask, const char* fmt_str, ...) {}
+
+tBTM_INQ_INFO* BTM_InqDbRead(const RawAddress& p_bda) { return NULL; }
+uint16_t BTM_GetHCIConnHandle(const RawAddress& remote_bda,
+                              tBT_TRANSPORT transport) {
+  return HCI_INVALID_HANDLE;
+}
+
+// The cache expiry is driven from here rather than by the system clock
+static uint32_t now_ms = 1000;
+uint32_t time_get_os_boottime_ms(void) { return now_ms; }
+
+#define NUM_BONDED_DEVICES 16
+
+static Octet16 device_irk(int device, bool bonded = true) {
+  Octet16 irk;
+  for (int i = 0; i < OCTET16_LEN; i++) irk[i] = device * 13 + i * 29 + 1;
+  irk[15] = bonded ? 0x00 : 0xff;
+  return irk;
+}
+
+static RawAddress device_rpa(const Octet16& irk, uint32_t seed) {
+  BT_OCTET8 random = {(uint8_t)seed, (uint8_t)(seed >> 8),
+                      (uint8_t)(seed >> 16)};
+  return generate_rpa_from_irk_and_rand(irk, random);
+}
+
+static RawAddress identity_addr(int device) {
+  return RawAddress({0x00, 0x1b, 0xdc, 0x00, 0x00, (uint8_t)device});
+}
+
+// What btm_ble_resolve_random_addr() did before the cache
+static tBTM_SEC_DEV_REC* resolve_reference(const RawAddress& rpa) {
+  list_node_t* end = list_end(btm_cb.sec_dev_rec);
+  for (list_node_t* node = list_begin(btm_cb.sec_dev_rec); node != end;
+       node = list_next(node)) {
+    tBTM_SEC_DEV_REC* p_dev_rec =
+        static_cast<tBTM_SEC_DEV_REC*>(list_node(node));
+    if (btm_ble_addr_resolvable(rpa, p_dev_rec)) return p_dev_rec;
+  }
+  return nullptr;
+}
+
+class RpaResolverTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    btm_cb.sec_dev_rec = list_new(btm_sec_dev_rec_free);
+    btm_ble_rpa_cache_flush();
+    btm_ble_rpa_cache_get_stats(&stats_before_);
+  }
+
+  void TearDown() override {
+    list_free(btm_cb.sec_dev_rec);
+    btm_cb.sec_dev_rec = NULL;
+  }
+
+  // A record as BTM_SecAddBleDevice() leaves it, before any keys
+  static tBTM_SEC_DEV_REC* AddLeDevice(int device) {
+    tBTM_SEC_DEV_REC* p_dev_rec = btm_sec_alloc_dev(identity_addr(device));
+    p_dev_rec->device_type = BT_DEVICE_TYPE_BLE;
+    return p_dev_rec;
+  }
+
+  static void SavePidKey(int device) {
+    tBTM_LE_KEY_VALUE keys;
+    memset(&keys, 0, sizeof(keys));
+    keys.pid_key.irk = device_irk(device);
+    keys.pid_key.identity_addr = identity_addr(device);
+    keys.pid_key.identity_addr_type = BLE_ADDR_PUBLIC;
+    btm_sec_save_le_key(identity_addr(device), BTM_LE_KEY_PID, &keys, false);
+  }
+
+  static tBTM_SEC_DEV_REC* AddBondedDevice(int device) {
+    tBTM_SEC_DEV_REC* p_dev_rec = AddLeDevice(device);
+    SavePidKey(device);
+    return p_dev_rec;
+  }
+
+  // The counters since SetUp()
+  tBTM_BLE_RPA_CACHE_STATS Stats() {
+    tBTM_BLE_RPA_CACHE_STATS stats;
+    btm_ble_rpa_cache_get_stats(&stats);
+    stats.hits -= stats_before_.hits;
+    stats.negative_hits -= stats_before_.negative_hits;
+    stats.misses -= stats_before_.misses;
+    stats.expired -= stats_before_.expired;
+    return stats;
+  }
+
+ private:
+  tBTM_BLE_RPA_CACHE_STATS stats_before_;
+};
+
+TEST_F(RpaResolverTest, matches_btm_ble_addr_resolvable) {
+  for (int device = 0; device < NUM_BONDED_DEVICES; device++)
+    AddBondedDevice(device);
+
+  // Records without an IRK, or not LE, are skipped
+  AddLeDevice(NUM_BONDED_DEVICES);
+  tBTM_SEC_DEV_REC* p_classic = AddBondedDevice(NUM_BONDED_DEVICES + 1);
+  p_classic->device_type = BT_DEVICE_TYPE_BREDR;
+
+  // Two records with the same IRK resolve to the first one
+  AddBondedDevice(NUM_BONDED_DEVICES + 2)->ble.keys.irk = device_irk(3);
+  btm_ble_rpa_cache_flush();
+
+  std::vector<RawAddress> rpas;
+  for (int device = 0; device < NUM_BONDED_DEVICES + 2; device++)
+    rpas.push_back(device_rpa(device_irk(device), device * 7 + 1));
+  for (int device = 0; device < 8; device++)
+    rpas.push_back(device_rpa(device_irk(device, false), device + 100));
+  // Not resolvable addresses at all
+  rpas.push_back(identity_addr(1));
+  rpas.push_back(RawAddress({0xc0, 0x01, 0x02, 0x03, 0x04, 0x05}));
+
+  // Twice, the second time from the cache
+  for (int pass = 0; pass < 2; pass++) {
+    for (const RawAddress& rpa : rpas) {
+      SCOPED_TRACE(rpa.ToString());
+      EXPECT_EQ(btm_ble_resolve_random_addr(rpa), resolve_reference(rpa));
+    }
+  }
+
+  // Except for the address of the record that is not LE, which is not cached
+  tBTM_BLE_RPA_CACHE_STATS stats = Stats();
+  EXPECT_EQ(stats.misses, rpas.size() + 1);
+  EXPECT_EQ(stats.hits + stats.negative_hits, rpas.size() - 1);
+  EXPECT_GT(stats.hits, 0u);
+  EXPECT_GT(stats.negative_hits, 0u);
+}
+
+TEST_F(RpaResolverTest, saved_pid_key_drops_negative_entry) {
+  tBTM_SEC_DEV_REC* p_dev_rec = AddLeDevice(1);
+  RawAddress rpa = device_rpa(device_irk(1), 42);
+
+  // Seen advertising before pairing: unresolvable, and remembered as such
+  EXPECT_EQ(btm_ble_resolve_random_addr(rpa), nullptr);
+  EXPECT_EQ(btm_ble_resolve_random_addr(rpa), nullptr);
+  EXPECT_EQ(Stats().negative_hits, 1u);
+
+  // Pairing distributes the IRK
+  SavePidKey(1);
+  EXPECT_EQ(btm_ble_resolve_random_addr(rpa), p_dev_rec);
+}
+
+TEST_F(RpaResolverTest, record_becoming_le_resolves) {
+  AddBondedDevice(1);
+  tBTM_SEC_DEV_REC* p_dev_rec = AddBondedDevice(2);
+  p_dev_rec->device_type = BT_DEVICE_TYPE_BREDR;
+  RawAddress rpa = device_rpa(device_irk(2), 42);
+
+  // The IRKs are keyed while the record is not LE
+  EXPECT_EQ(btm_ble_resolve_random_addr(rpa), nullptr);
+  EXPECT_EQ(btm_ble_resolve_random_addr(rpa), resolve_reference(rpa));
+  EXPECT_EQ(Stats().negative_hits, 0u);
+
+  // As when the device is then seen over LE, without the IRKs changing
+  p_dev_rec->device_type |= BT_DEVICE_TYPE_BLE;
+  EXPECT_EQ(resolve_reference(rpa), p_dev_rec);
+  EXPECT_EQ(btm_ble_resolve_random_addr(rpa), p_dev_rec);
+  EXPECT_EQ(btm_ble_resolve_random_addr(rpa), p_dev_rec);
+  EXPECT_EQ(Stats().hits, 1u);
+}
+
+TEST_F(RpaResolverTest, entries_expire) {
+  AddBondedDevice(1);
+  RawAddress bonded_rpa = device_rpa(device_irk(1), 42);
+  RawAddress unknown_rpa = device_rpa(device_irk(1, false), 42);
+
+  ASSERT_NE(btm_ble_resolve_random_addr(bonded_rpa), nullptr);
+  ASSERT_EQ(btm_ble_resolve_random_addr(unknown_rpa), nullptr);
+  EXPECT_EQ(Stats().misses, 2u);
+
+  now_ms += BTM_BLE_RPA_CACHE_TTL_MS - 1;
+  btm_ble_resolve_random_addr(bonded_rpa);
+  btm_ble_resolve_random_addr(unknown_rpa);
+  tBTM_BLE_RPA_CACHE_STATS stats = Stats();
+  EXPECT_EQ(stats.hits, 1u);
+  EXPECT_EQ(stats.negative_hits, 1u);
+  EXPECT_EQ(stats.expired, 0u);
+
+  // Lookups do not extend the lifetime of an entry
+  now_ms += 1;
+  EXPECT_NE(btm_ble_resolve_random_addr(bonded_rpa), nullptr);
+  EXPECT_EQ(btm_ble_resolve_random_addr(unknown_rpa), nullptr);
+  stats = Stats();
+  EXPECT_EQ(stats.expired, 2u);
+  EXPECT_EQ(stats.misses, 4u);
+  EXPECT_EQ(stats.hits, 1u);
+  EXPECT_EQ(stats.negative_hits, 1u);
+}
+
+TEST_F(RpaResolverTest, freed_record_is_not_returned) {
+  AddBondedDevice(1);
+  tBTM_SEC_DEV_REC* p_dev_rec = AddBondedDevice(2);
+  RawAddress rpa = device_rpa(device_irk(2), 42);
+  ASSERT_EQ(btm_ble_resolve_random_addr(rpa), p_dev_rec);
+
+  // As btm_sec_free_dev() does; the list frees it with btm_sec_dev_rec_free()
+  list_remove(btm_cb.sec_dev_rec, p_dev_rec);
+  EXPECT_EQ(btm_ble_resolve_random_addr(rpa), nullptr);
+
+  // Bonding again gives a new record, which the address now resolves to
+  p_dev_rec = AddBondedDevice(2);
+  EXPECT_EQ(btm_ble_resolve_random_addr(rpa), p_dev_rec);
+}
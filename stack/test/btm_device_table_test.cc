@@ -0,0 +1,188 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <set>
+
+#include "btm_device_table.h"
+
+using Table = BtmDeviceTable<RawAddress, BtmAddressHash>;
+
+static RawAddress address(uint8_t n) {
+  return RawAddress({0x00, 0x11, 0x22, 0x33, 0x44, n});
+}
+
+TEST(BtmDeviceTableTest, insert_and_find) {
+  Table table(4);
+  EXPECT_EQ(table.capacity(), 4u);
+  EXPECT_EQ(table.size(), 0u);
+  EXPECT_EQ(table.Find(address(1)), Table::kNoSlot);
+
+  bool is_new = false;
+  size_t slot1 = table.Insert(address(1), &is_new);
+  EXPECT_TRUE(is_new);
+  size_t slot2 = table.Insert(address(2), &is_new);
+  EXPECT_TRUE(is_new);
+  EXPECT_NE(slot1, slot2);
+  EXPECT_LT(slot1, table.capacity());
+  EXPECT_LT(slot2, table.capacity());
+  EXPECT_EQ(table.size(), 2u);
+
+  // Inserting a known device hands back its slot
+  EXPECT_EQ(table.Insert(address(1), &is_new), slot1);
+  EXPECT_FALSE(is_new);
+  EXPECT_EQ(table.Insert(address(2), nullptr), slot2);
+  EXPECT_EQ(table.size(), 2u);
+
+  EXPECT_EQ(table.Find(address(1)), slot1);
+  EXPECT_EQ(table.Find(address(2)), slot2);
+  EXPECT_EQ(table.Find(address(3)), Table::kNoSlot);
+}
+
+TEST(BtmDeviceTableTest, fills_every_slot_before_evicting) {
+  Table table(8);
+  std::set<size_t> slots;
+  for (uint8_t i = 0; i < 8; i++)
+    slots.insert(table.Insert(address(i), nullptr));
+  EXPECT_EQ(slots.size(), 8u);
+  EXPECT_EQ(table.size(), 8u);
+  for (uint8_t i = 0; i < 8; i++)
+    EXPECT_NE(table.Find(address(i)), Table::kNoSlot);
+}
+
+TEST(BtmDeviceTableTest, evicts_least_recently_added) {
+  Table table(3);
+  size_t slot0 = table.Insert(address(0), nullptr);
+  size_t slot1 = table.Insert(address(1), nullptr);
+  table.Insert(address(2), nullptr);
+
+  bool is_new = false;
+  EXPECT_EQ(table.Insert(address(3), &is_new), slot0);
+  EXPECT_TRUE(is_new);
+  EXPECT_EQ(table.Find(address(0)), Table::kNoSlot);
+  EXPECT_EQ(table.size(), 3u);
+
+  EXPECT_EQ(table.Insert(address(4), nullptr), slot1);
+  EXPECT_EQ(table.Find(address(1)), Table::kNoSlot);
+}
+
+TEST(BtmDeviceTableTest, touch_and_insert_refresh_recency) {
+  Table table(3);
+  size_t slot0 = table.Insert(address(0), nullptr);
+  size_t slot1 = table.Insert(address(1), nullptr);
+  size_t slot2 = table.Insert(address(2), nullptr);
+
+  // Oldest first: 1 is touched, 0 inserted again, leaving 2 the oldest
+  table.Touch(slot1);
+  table.Insert(address(0), nullptr);
+  EXPECT_EQ(table.Insert(address(3), nullptr), slot2);
+  EXPECT_EQ(table.Insert(address(4), nullptr), slot1);
+  EXPECT_EQ(table.Insert(address(5), nullptr), slot0);
+
+  // Touching the most recent device changes nothing
+  size_t slot5 = table.Find(address(5));
+  table.Touch(slot5);
+  EXPECT_EQ(table.Insert(address(6), nullptr), slot2);
+}
+
+TEST(BtmDeviceTableTest, find_does_not_refresh_recency) {
+  Table table(2);
+  size_t slot0 = table.Insert(address(0), nullptr);
+  table.Insert(address(1), nullptr);
+
+  EXPECT_EQ(table.Find(address(0)), slot0);
+  EXPECT_EQ(table.Insert(address(2), nullptr), slot0);
+}
+
+TEST(BtmDeviceTableTest, erase_slot_frees_it_for_reuse) {
+  Table table(3);
+  table.Insert(address(0), nullptr);
+  size_t slot1 = table.Insert(address(1), nullptr);
+  table.Insert(address(2), nullptr);
+
+  table.EraseSlot(slot1);
+  EXPECT_EQ(table.size(), 2u);
+  EXPECT_EQ(table.Find(address(1)), Table::kNoSlot);
+
+  // Erasing a free slot is a no-op
+  table.EraseSlot(slot1);
+  EXPECT_EQ(table.size(), 2u);
+
+  // A free slot is taken before anything is evicted
+  bool is_new = false;
+  EXPECT_EQ(table.Insert(address(3), &is_new), slot1);
+  EXPECT_TRUE(is_new);
+  EXPECT_NE(table.Find(address(0)), Table::kNoSlot);
+  EXPECT_NE(table.Find(address(2)), Table::kNoSlot);
+}
+
+TEST(BtmDeviceTableTest, erased_device_leaves_recency_order) {
+  Table table(3);
+  size_t slot0 = table.Insert(address(0), nullptr);
+  size_t slot1 = table.Insert(address(1), nullptr);
+  size_t slot2 = table.Insert(address(2), nullptr);
+
+  // Erasing the oldest makes the next one the eviction candidate
+  table.EraseSlot(slot0);
+  table.Insert(address(3), nullptr);
+  EXPECT_EQ(table.Insert(address(4), nullptr), slot1);
+  EXPECT_EQ(table.Insert(address(5), nullptr), slot2);
+
+  // And erasing by key behaves the same
+  table.Erase(address(3));
+  EXPECT_EQ(table.Find(address(3)), Table::kNoSlot);
+  EXPECT_EQ(table.Insert(address(6), nullptr), slot0);
+  EXPECT_EQ(table.size(), 3u);
+}
+
+TEST(BtmDeviceTableTest, clear_empties_the_table) {
+  Table table(4);
+  for (uint8_t i = 0; i < 4; i++) table.Insert(address(i), nullptr);
+
+  table.Clear();
+  EXPECT_EQ(table.size(), 0u);
+  for (uint8_t i = 0; i < 4; i++)
+    EXPECT_EQ(table.Find(address(i)), Table::kNoSlot);
+
+  // Every slot is free again, so nothing is evicted while refilling
+  std::set<size_t> slots;
+  for (uint8_t i = 10; i < 14; i++) {
+    bool is_new = false;
+    slots.insert(table.Insert(address(i), &is_new));
+    EXPECT_TRUE(is_new);
+  }
+  EXPECT_EQ(slots.size(), 4u);
+  for (uint8_t i = 10; i < 14; i++)
+    EXPECT_NE(table.Find(address(i)), Table::kNoSlot);
+}
+
+TEST(BtmDeviceTableTest, restore_places_device_in_given_slot) {
+  Table table(3);
+  table.Restore(2, address(0));
+  table.Restore(0, address(1));
+  EXPECT_EQ(table.Find(address(0)), 2u);
+  EXPECT_EQ(table.Find(address(1)), 0u);
+
+  // The only free slot left is the one not restored
+  EXPECT_EQ(table.Insert(address(2), nullptr), 1u);
+
+  // Restored devices are aged in the order they were restored
+  EXPECT_EQ(table.Insert(address(3), nullptr), 2u);
+  EXPECT_EQ(table.Insert(address(4), nullptr), 0u);
+}
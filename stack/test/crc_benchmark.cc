@@ -0,0 +1,83 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "stack/crc/crc.h"
+
+using ::benchmark::State;
+using namespace bluetooth::crc;
+
+// L2CAP_FCR_INIT_CRC
+#define INIT_CRC 0
+
+static std::vector<uint8_t> test_frame(size_t len) {
+  std::vector<uint8_t> frame(len);
+  for (size_t i = 0; i < len; i++) frame[i] = i * 31 + 7;
+  return frame;
+}
+
+// The FCS of an ERTM I-frame of |state.range(0)| bytes: a 672 byte SBC
+// packet, a 1021 byte DH5 payload, and a large OBEX frame.
+static void BM_L2capFcs(State& state, crc16_fn fn) {
+  std::vector<uint8_t> frame = test_frame(state.range(0));
+  uint16_t fcs = 0;
+  for (auto _ : state) {
+    fcs ^= fn(INIT_CRC, frame.data(), frame.size());
+    benchmark::ClobberMemory();
+  }
+  benchmark::DoNotOptimize(fcs);
+  state.SetBytesProcessed(state.iterations() * frame.size());
+}
+BENCHMARK_CAPTURE(BM_L2capFcs, bytewise, crc16_bytewise)
+    ->Arg(672)
+    ->Arg(1021)
+    ->Arg(4096);
+BENCHMARK_CAPTURE(BM_L2capFcs, slice_by_8, crc16_slice_by_8)
+    ->Arg(672)
+    ->Arg(1021)
+    ->Arg(4096);
+
+// The RFCOMM FCS only covers the address, control and length fields
+static void BM_RfcommFcs(State& state) {
+  std::vector<uint8_t> header = test_frame(state.range(0));
+  uint8_t fcs = 0;
+  for (auto _ : state) {
+    fcs ^= 0xFF - crc8(0xFF, header.data(), header.size());
+    benchmark::ClobberMemory();
+  }
+  benchmark::DoNotOptimize(fcs);
+  state.SetBytesProcessed(state.iterations() * header.size());
+}
+BENCHMARK(BM_RfcommFcs)->Arg(2)->Arg(3);
+
+int main(int argc, char** argv) {
+#if defined(__i386__) || defined(__x86_64__)
+  if (crc16_clmul_supported()) {
+    benchmark::RegisterBenchmark("BM_L2capFcs/clmul", BM_L2capFcs, crc16_clmul)
+        ->Arg(672)
+        ->Arg(1021)
+        ->Arg(4096);
+  }
+#endif
+
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  ::benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -0,0 +1,196 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "bt_trace.h"
+#include "rfc_int.h"
+#include "stack/crc/crc.h"
+
+using namespace bluetooth::crc;
+
+// The rest of RFCOMM is not linked in
+tRFC_CB rfc_cb;
+void LogMsg(uint32_t trace_set_mask, const char* fmt_str, ...) {}
+void vnd_LogMsg(uint32_t trace_set_mask, const char* fmt_str, ...) {}
+
+// The tables the L2CAP and RFCOMM FCS were computed with before
+static const uint16_t l2c_crctab[256] = {
+    0x0000, 0xc0c1, 0xc181, 0x0140, 0xc301, 0x03c0, 0x0280, 0xc241, 0xc601,
+    0x06c0, 0x0780, 0xc741, 0x0500, 0xc5c1, 0xc481, 0x0440, 0xcc01, 0x0cc0,
+    0x0d80, 0xcd41, 0x0f00, 0xcfc1, 0xce81, 0x0e40, 0x0a00, 0xcac1, 0xcb81,
+    0x0b40, 0xc901, 0x09c0, 0x0880, 0xc841, 0xd801, 0x18c0, 0x1980, 0xd941,
+    0x1b00, 0xdbc1, 0xda81, 0x1a40, 0x1e00, 0xdec1, 0xdf81, 0x1f40, 0xdd01,
+    0x1dc0, 0x1c80, 0xdc41, 0x1400, 0xd4c1, 0xd581, 0x1540, 0xd701, 0x17c0,
+    0x1680, 0xd641, 0xd201, 0x12c0, 0x1380, 0xd341, 0x1100, 0xd1c1, 0xd081,
+    0x1040, 0xf001, 0x30c0, 0x3180, 0xf141, 0x3300, 0xf3c1, 0xf281, 0x3240,
+    0x3600, 0xf6c1, 0xf781, 0x3740, 0xf501, 0x35c0, 0x3480, 0xf441, 0x3c00,
+    0xfcc1, 0xfd81, 0x3d40, 0xff01, 0x3fc0, 0x3e80, 0xfe41, 0xfa01, 0x3ac0,
+    0x3b80, 0xfb41, 0x3900, 0xf9c1, 0xf881, 0x3840, 0x2800, 0xe8c1, 0xe981,
+    0x2940, 0xeb01, 0x2bc0, 0x2a80, 0xea41, 0xee01, 0x2ec0, 0x2f80, 0xef41,
+    0x2d00, 0xedc1, 0xec81, 0x2c40, 0xe401, 0x24c0, 0x2580, 0xe541, 0x2700,
+    0xe7c1, 0xe681, 0x2640, 0x2200, 0xe2c1, 0xe381, 0x2340, 0xe101, 0x21c0,
+    0x2080, 0xe041, 0xa001, 0x60c0, 0x6180, 0xa141, 0x6300, 0xa3c1, 0xa281,
+    0x6240, 0x6600, 0xa6c1, 0xa781, 0x6740, 0xa501, 0x65c0, 0x6480, 0xa441,
+    0x6c00, 0xacc1, 0xad81, 0x6d40, 0xaf01, 0x6fc0, 0x6e80, 0xae41, 0xaa01,
+    0x6ac0, 0x6b80, 0xab41, 0x6900, 0xa9c1, 0xa881, 0x6840, 0x7800, 0xb8c1,
+    0xb981, 0x7940, 0xbb01, 0x7bc0, 0x7a80, 0xba41, 0xbe01, 0x7ec0, 0x7f80,
+    0xbf41, 0x7d00, 0xbdc1, 0xbc81, 0x7c40, 0xb401, 0x74c0, 0x7580, 0xb541,
+    0x7700, 0xb7c1, 0xb681, 0x7640, 0x7200, 0xb2c1, 0xb381, 0x7340, 0xb101,
+    0x71c0, 0x7080, 0xb041, 0x5000, 0x90c1, 0x9181, 0x5140, 0x9301, 0x53c0,
+    0x5280, 0x9241, 0x9601, 0x56c0, 0x5780, 0x9741, 0x5500, 0x95c1, 0x9481,
+    0x5440, 0x9c01, 0x5cc0, 0x5d80, 0x9d41, 0x5f00, 0x9fc1, 0x9e81, 0x5e40,
+    0x5a00, 0x9ac1, 0x9b81, 0x5b40, 0x9901, 0x59c0, 0x5880, 0x9841, 0x8801,
+    0x48c0, 0x4980, 0x8941, 0x4b00, 0x8bc1, 0x8a81, 0x4a40, 0x4e00, 0x8ec1,
+    0x8f81, 0x4f40, 0x8d01, 0x4dc0, 0x4c80, 0x8c41, 0x4400, 0x84c1, 0x8581,
+    0x4540, 0x8701, 0x47c0, 0x4680, 0x8641, 0x8201, 0x42c0, 0x4380, 0x8341,
+    0x4100, 0x81c1, 0x8081, 0x4040,
+};
+
+static const uint8_t rfc_crctable[256] = {
+    0x00, 0x91, 0xE3, 0x72, 0x07, 0x96, 0xE4, 0x75, 0x0E, 0x9F, 0xED,
+    0x7C, 0x09, 0x98, 0xEA, 0x7B, 0x1C, 0x8D, 0xFF, 0x6E, 0x1B, 0x8A,
+    0xF8, 0x69, 0x12, 0x83, 0xF1, 0x60, 0x15, 0x84, 0xF6, 0x67, 0x38,
+    0xA9, 0xDB, 0x4A, 0x3F, 0xAE, 0xDC, 0x4D, 0x36, 0xA7, 0xD5, 0x44,
+    0x31, 0xA0, 0xD2, 0x43, 0x24, 0xB5, 0xC7, 0x56, 0x23, 0xB2, 0xC0,
+    0x51, 0x2A, 0xBB, 0xC9, 0x58, 0x2D, 0xBC, 0xCE, 0x5F, 0x70, 0xE1,
+    0x93, 0x02, 0x77, 0xE6, 0x94, 0x05, 0x7E, 0xEF, 0x9D, 0x0C, 0x79,
+    0xE8, 0x9A, 0x0B, 0x6C, 0xFD, 0x8F, 0x1E, 0x6B, 0xFA, 0x88, 0x19,
+    0x62, 0xF3, 0x81, 0x10, 0x65, 0xF4, 0x86, 0x17, 0x48, 0xD9, 0xAB,
+    0x3A, 0x4F, 0xDE, 0xAC, 0x3D, 0x46, 0xD7, 0xA5, 0x34, 0x41, 0xD0,
+    0xA2, 0x33, 0x54, 0xC5, 0xB7, 0x26, 0x53, 0xC2, 0xB0, 0x21, 0x5A,
+    0xCB, 0xB9, 0x28, 0x5D, 0xCC, 0xBE, 0x2F, 0xE0, 0x71, 0x03, 0x92,
+    0xE7, 0x76, 0x04, 0x95, 0xEE, 0x7F, 0x0D, 0x9C, 0xE9, 0x78, 0x0A,
+    0x9B, 0xFC, 0x6D, 0x1F, 0x8E, 0xFB, 0x6A, 0x18, 0x89, 0xF2, 0x63,
+    0x11, 0x80, 0xF5, 0x64, 0x16, 0x87, 0xD8, 0x49, 0x3B, 0xAA, 0xDF,
+    0x4E, 0x3C, 0xAD, 0xD6, 0x47, 0x35, 0xA4, 0xD1, 0x40, 0x32, 0xA3,
+    0xC4, 0x55, 0x27, 0xB6, 0xC3, 0x52, 0x20, 0xB1, 0xCA, 0x5B, 0x29,
+    0xB8, 0xCD, 0x5C, 0x2E, 0xBF, 0x90, 0x01, 0x73, 0xE2, 0x97, 0x06,
+    0x74, 0xE5, 0x9E, 0x0F, 0x7D, 0xEC, 0x99, 0x08, 0x7A, 0xEB, 0x8C,
+    0x1D, 0x6F, 0xFE, 0x8B, 0x1A, 0x68, 0xF9, 0x82, 0x13, 0x61, 0xF0,
+    0x85, 0x14, 0x66, 0xF7, 0xA8, 0x39, 0x4B, 0xDA, 0xAF, 0x3E, 0x4C,
+    0xDD, 0xA6, 0x37, 0x45, 0xD4, 0xA1, 0x30, 0x42, 0xD3, 0xB4, 0x25,
+    0x57, 0xC6, 0xB3, 0x22, 0x50, 0xC1, 0xBA, 0x2B, 0x59, 0xC8, 0xBD,
+    0x2C, 0x5E, 0xCF,
+};
+
+static uint16_t l2c_fcr_updcrc(uint16_t crc, const uint8_t* p, size_t len) {
+  while (len--) crc = ((crc >> 8) & 0xff) ^ l2c_crctab[(crc & 0xff) ^ *p++];
+  return crc;
+}
+
+static uint8_t rfc_updcrc(uint8_t fcs, const uint8_t* p, size_t len) {
+  while (len--) fcs = rfc_crctable[fcs ^ *p++];
+  return fcs;
+}
+
+// Long enough for the wide backends to take several blocks, and the tail
+#define MAX_LEN 300
+#define MAX_OFFSET 16
+
+static std::vector<uint8_t> test_data(size_t len) {
+  std::vector<uint8_t> data(len);
+  uint32_t x = 0x12345678;
+  for (size_t i = 0; i < len; i++) {
+    x = x * 1103515245 + 12345;
+    data[i] = x >> 24;
+  }
+  return data;
+}
+
+static const uint16_t init_crcs[] = {0x0000, 0xffff, 0x1d0f, 0x8005};
+
+static void check_crc16_backend(crc16_fn fn) {
+  std::vector<uint8_t> data = test_data(MAX_LEN + MAX_OFFSET);
+  for (uint16_t init : init_crcs) {
+    for (size_t offset = 0; offset < MAX_OFFSET; offset++) {
+      for (size_t len = 0; len <= MAX_LEN; len++) {
+        const uint8_t* p = data.data() + offset;
+        ASSERT_EQ(fn(init, p, len), l2c_fcr_updcrc(init, p, len))
+            << "init " << init << " offset " << offset << " len " << len;
+      }
+    }
+  }
+}
+
+TEST(CrcTest, crc16_bytewise_matches_table) {
+  check_crc16_backend(crc16_bytewise);
+}
+
+TEST(CrcTest, crc16_slice_by_8_matches_table) {
+  check_crc16_backend(crc16_slice_by_8);
+}
+
+#if defined(__i386__) || defined(__x86_64__)
+TEST(CrcTest, crc16_clmul_matches_table) {
+  if (!crc16_clmul_supported()) return;
+  check_crc16_backend(crc16_clmul);
+}
+#endif
+
+TEST(CrcTest, crc16_matches_table) { check_crc16_backend(crc16); }
+
+TEST(CrcTest, crc16_continues_across_calls) {
+  std::vector<uint8_t> data = test_data(MAX_LEN);
+  uint16_t whole = l2c_fcr_updcrc(0, data.data(), data.size());
+  for (size_t split = 0; split <= MAX_LEN; split++) {
+    uint16_t crc = crc16(0, data.data(), split);
+    EXPECT_EQ(crc16(crc, data.data() + split, MAX_LEN - split), whole)
+        << "split " << split;
+  }
+}
+
+TEST(CrcTest, crc8_matches_table) {
+  std::vector<uint8_t> data = test_data(MAX_LEN + MAX_OFFSET);
+  for (int init = 0; init < 256; init++) {
+    // Every length from the initial value RFCOMM uses, a sample otherwise
+    size_t step = init == 0xFF ? 1 : 37;
+    for (size_t offset = 0; offset < MAX_OFFSET; offset++) {
+      for (size_t len = 0; len <= MAX_LEN; len += step) {
+        const uint8_t* p = data.data() + offset;
+        ASSERT_EQ(crc8(init, p, len), rfc_updcrc(init, p, len))
+            << "init " << init << " offset " << offset << " len " << len;
+      }
+    }
+  }
+}
+
+// The FCS of RFCOMM frames covers the address and control fields, and the
+// length field too for all but UIH frames
+TEST(CrcTest, rfc_fcs_round_trip) {
+  std::vector<uint8_t> data = test_data(3 * 256);
+  for (size_t i = 0; i < data.size(); i += 3) {
+    for (uint16_t len = 2; len <= 3; len++) {
+      uint8_t* p = &data[i];
+      uint8_t fcs = rfc_calc_fcs(len, p);
+      EXPECT_EQ(fcs, 0xFF - rfc_updcrc(0xFF, p, len));
+      EXPECT_TRUE(rfc_check_fcs(len, p, fcs));
+      EXPECT_FALSE(rfc_check_fcs(len, p, fcs ^ 0x01));
+      EXPECT_FALSE(rfc_check_fcs(len, p, fcs ^ 0x80));
+
+      p[len - 1] ^= 0x10;
+      EXPECT_FALSE(rfc_check_fcs(len, p, fcs));
+      p[len - 1] ^= 0x10;
+    }
+  }
+
+  // The SABM frame on DLCI 0 from TS 07.10
+  uint8_t sabm[] = {0x03, 0x3F, 0x01};
+  EXPECT_EQ(rfc_calc_fcs(sizeof(sabm), sabm), 0x1C);
+  EXPECT_TRUE(rfc_check_fcs(sizeof(sabm), sabm, 0x1C));
+}
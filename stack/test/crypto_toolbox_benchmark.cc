@@ -0,0 +1,149 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <base/logging.h>
+#include <vector>
+
+#include "stack/crypto_toolbox/aes.h"
+#include "stack/crypto_toolbox/aes_fast.h"
+#include "stack/crypto_toolbox/crypto_toolbox.h"
+
+using ::benchmark::Counter;
+using ::benchmark::State;
+using namespace crypto_toolbox;
+
+static Octet16 test_key(uint8_t seed) {
+  Octet16 key;
+  for (int i = 0; i < OCTET16_LEN; i++) key[i] = seed * 31 + i * 7;
+  return key;
+}
+
+// One block with the byte oriented implementation in aes.cc, keyed per call
+static void BM_Aes128Reference(State& state) {
+  Octet16 key = test_key(1);
+  Octet16 block{};
+  for (auto _ : state) {
+    aes_context ctx;
+    aes_set_key(key.data(), OCTET16_LEN, &ctx);
+    aes_encrypt(block.data(), block.data(), &ctx);
+  }
+  benchmark::DoNotOptimize(block);
+}
+BENCHMARK(BM_Aes128Reference);
+
+// One block with a prepared key schedule
+static void BM_Aes128Backend(State& state, aes_128_encrypt_fn encrypt) {
+  Octet16 key = test_key(1);
+  Octet16 block{};
+  Aes128Key schedule;
+  aes_128_expand_key(&schedule, key.data());
+  for (auto _ : state) {
+    encrypt(schedule, block.data(), block.data());
+  }
+  benchmark::DoNotOptimize(block);
+}
+BENCHMARK_CAPTURE(BM_Aes128Backend, table, aes_128_encrypt_table);
+
+static void BM_Aes128KeyExpansion(State& state) {
+  Octet16 key = test_key(1);
+  Aes128Key schedule;
+  for (auto _ : state) {
+    aes_128_expand_key(&schedule, key.data());
+    benchmark::DoNotOptimize(schedule);
+  }
+}
+BENCHMARK(BM_Aes128KeyExpansion);
+
+// AES-CMAC of messages the size of a signed write and of f4/f5/f6 inputs,
+// keyed per call as before and with a keyed context.
+static void BM_AesCmacKeyed(State& state) {
+  Octet16 key = test_key(2);
+  std::vector<uint8_t> message(state.range(0), 0x5a);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(aes_cmac(key, message.data(), message.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * message.size());
+}
+BENCHMARK(BM_AesCmacKeyed)->Arg(16)->Arg(32)->Arg(65);
+
+static void BM_AesCmacContext(State& state) {
+  AesCmacContext context;
+  aes_cmac_init(&context, test_key(2));
+  std::vector<uint8_t> message(state.range(0), 0x5a);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        aes_cmac(context, message.data(), message.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * message.size());
+}
+BENCHMARK(BM_AesCmacContext)->Arg(16)->Arg(32)->Arg(65);
+
+// Resolving a resolvable private address against every stored IRK, which
+// is the worst case of btm_ble_resolve_random_addr(): ah(IRK, prand) for each
+// bonded device, with no match.
+static void BM_ResolveRpaPerCallKey(State& state) {
+  std::vector<Octet16> irks;
+  for (int i = 0; i < state.range(0); i++) irks.push_back(test_key(i));
+  const uint8_t prand[3] = {0x12, 0x34, 0x56};
+  const uint8_t hash[3] = {0x00, 0x00, 0x00};
+
+  int matches = 0;
+  for (auto _ : state) {
+    for (const Octet16& irk : irks) {
+      Octet16 x = aes_128(irk, prand, sizeof(prand));
+      matches += memcmp(x.data(), hash, sizeof(hash)) == 0;
+    }
+  }
+  benchmark::DoNotOptimize(matches);
+  state.counters["irks_per_second"] =
+      Counter(state.iterations() * irks.size(), Counter::kIsRate);
+}
+BENCHMARK(BM_ResolveRpaPerCallKey)->Arg(16)->Arg(128);
+
+static void BM_ResolveRpaContext(State& state) {
+  std::vector<AesCmacContext> irks(state.range(0));
+  for (int i = 0; i < state.range(0); i++) aes_cmac_init(&irks[i], test_key(i));
+  Octet16 prand{0x12, 0x34, 0x56};
+  const uint8_t hash[3] = {0x00, 0x00, 0x00};
+
+  int matches = 0;
+  for (auto _ : state) {
+    for (const AesCmacContext& irk : irks) {
+      Octet16 x = aes_128(irk, prand);
+      matches += memcmp(x.data(), hash, sizeof(hash)) == 0;
+    }
+  }
+  benchmark::DoNotOptimize(matches);
+  state.counters["irks_per_second"] =
+      Counter(state.iterations() * irks.size(), Counter::kIsRate);
+}
+BENCHMARK(BM_ResolveRpaContext)->Arg(16)->Arg(128);
+
+int main(int argc, char** argv) {
+#if defined(__i386__) || defined(__x86_64__)
+  if (aes_128_aesni_supported()) {
+    benchmark::RegisterBenchmark("BM_Aes128Backend/aesni", BM_Aes128Backend,
+                                 aes_128_encrypt_aesni);
+  }
+#endif
+
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  ::benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
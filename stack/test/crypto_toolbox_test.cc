@@ -20,6 +20,7 @@
 #include <gtest/gtest.h>
 
 #include "stack/crypto_toolbox/aes.h"
+#include "stack/crypto_toolbox/aes_fast.h"
 #include "stack/crypto_toolbox/crypto_toolbox.h"
 
 #include <base/logging.h>
@@ -397,4 +398,88 @@ TEST(CryptoToolboxTest, bt_spec_example_d_12_test) {
   EXPECT_EQ(expected_ltk, ltk);
 }
 
+// FIPS-197 Appendix C.1, for every block cipher backend
+TEST(CryptoToolboxTest, aes_128_backends_fips_197_test) {
+  const uint8_t k[] = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                       0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+  const uint8_t m[] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+                       0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff};
+  const uint8_t expected[] = {0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+                              0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a};
+
+  Aes128Key key;
+  aes_128_expand_key(&key, k);
+
+  uint8_t output[16];
+  aes_128_encrypt_table(key, m, output);
+  EXPECT_THAT(output, ElementsAreArray(expected, OCTET16_LEN));
+
+  aes_128_encrypt_block(key, m, output);
+  EXPECT_THAT(output, ElementsAreArray(expected, OCTET16_LEN));
+
+#if defined(__i386__) || defined(__x86_64__)
+  if (aes_128_aesni_supported()) {
+    aes_128_encrypt_aesni(key, m, output);
+    EXPECT_THAT(output, ElementsAreArray(expected, OCTET16_LEN));
+  }
+#endif
+}
+
+// Every backend agrees with the byte oriented implementation in aes.cc
+TEST(CryptoToolboxTest, aes_128_backends_match_reference_test) {
+  uint32_t seed = 1;
+  for (int i = 0; i < 1000; i++) {
+    uint8_t k[16], m[16], expected[16], output[16];
+    for (int j = 0; j < 16; j++) {
+      seed = seed * 1103515245 + 12345;
+      k[j] = seed >> 24;
+      m[j] = seed >> 16;
+    }
+
+    aes_context ctx;
+    aes_set_key(k, sizeof(k), &ctx);
+    aes_encrypt(m, expected, &ctx);
+
+    Aes128Key key;
+    aes_128_expand_key(&key, k);
+    aes_128_encrypt_table(key, m, output);
+    EXPECT_THAT(output, ElementsAreArray(expected, OCTET16_LEN));
+#if defined(__i386__) || defined(__x86_64__)
+    if (aes_128_aesni_supported()) {
+      aes_128_encrypt_aesni(key, m, output);
+      EXPECT_THAT(output, ElementsAreArray(expected, OCTET16_LEN));
+    }
+#endif
+  }
+}
+
+// A keyed context gives the same results as keying every call, for the
+// message lengths of BT Spec 5.0 | Vol 3, Part H D.1.1 to D.1.4 and more.
+TEST(CryptoToolboxTest, aes_cmac_context_test) {
+  Octet16 k{0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+            0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+  std::reverse(std::begin(k), std::end(k));
+
+  AesCmacContext context;
+  aes_cmac_init(&context, k);
+
+  uint8_t m[80];
+  for (size_t i = 0; i < sizeof(m); i++) m[i] = i * 7;
+
+  for (uint16_t length = 0; length <= sizeof(m); length++) {
+    EXPECT_EQ(aes_cmac(k, m, length), aes_cmac(context, m, length))
+        << "length " << length;
+  }
+
+  Octet16 m16;
+  std::copy(m, m + OCTET16_LEN, m16.begin());
+  EXPECT_EQ(aes_128(k, m16), aes_128(context, m16));
+
+  // D.1.1, empty message
+  Octet16 aes_cmac_k_m{0xbb, 0x1d, 0x69, 0x29, 0xe9, 0x59, 0x37, 0x28,
+                       0x7f, 0xa3, 0x7d, 0x12, 0x9b, 0x75, 0x67, 0x46};
+  std::reverse(std::begin(aes_cmac_k_m), std::end(aes_cmac_k_m));
+  EXPECT_EQ(aes_cmac_k_m, aes_cmac(context, nullptr, 0));
+}
+
 }  // namespace crypto_toolbox
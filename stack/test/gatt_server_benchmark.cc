@@ -0,0 +1,126 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <list>
+
+#include "gatt_int.h"
+#include "osi/include/allocator.h"
+#include "stack/include/gattdefs.h"
+
+using ::benchmark::State;
+using bluetooth::Uuid;
+
+// A populated server: 50 services of 8 characteristics, each with a CCCD.
+#define NUM_SERVICES 50
+#define CHARS_PER_SERVICE 8
+#define HANDLES_PER_SERVICE (1 + CHARS_PER_SERVICE * 3)
+#define SERVICE_HANDLE_STRIDE 32
+
+static std::list<tGATT_SVC_DB> service_dbs;
+static uint16_t last_handle;
+
+static void populate_server() {
+  if (gatt_cb.srv_list_info) return;
+
+  gatt_cb.srv_list_info = new std::list<tGATT_SRV_LIST_ELEM>();
+  uint16_t s_hdl = GATT_APP_START_HANDLE;
+  for (int i = 0; i < NUM_SERVICES; i++) {
+    service_dbs.emplace_back();
+    tGATT_SVC_DB& db = service_dbs.back();
+    gatts_init_service_db(db, Uuid::From16Bit(0x1800 + i), true, s_hdl,
+                          HANDLES_PER_SERVICE);
+    for (int c = 0; c < CHARS_PER_SERVICE; c++) {
+      gatts_add_characteristic(db, GATT_PERM_READ,
+                               GATT_CHAR_PROP_BIT_READ |
+                                   GATT_CHAR_PROP_BIT_NOTIFY,
+                               Uuid::From16Bit(0x2a00 + c));
+      gatts_add_char_descr(db, GATT_PERM_READ | GATT_PERM_WRITE,
+                           Uuid::From16Bit(GATT_UUID_CHAR_CLIENT_CONFIG));
+    }
+
+    gatt_cb.srv_list_info->emplace_back();
+    tGATT_SRV_LIST_ELEM& el = gatt_cb.srv_list_info->back();
+    el.s_hdl = s_hdl;
+    el.e_hdl = s_hdl + HANDLES_PER_SERVICE - 1;
+    el.p_db = &db;
+    el.type = GATT_UUID_PRI_SERVICE;
+    el.is_primary = true;
+
+    last_handle = el.e_hdl;
+    s_hdl += SERVICE_HANDLE_STRIDE;
+  }
+  gatt_sr_update_srv_list_index();
+}
+
+// Resolution of a Read Request: owning service, attribute and permissions.
+static void BM_GattServerReadRequest(State& state) {
+  populate_server();
+
+  uint16_t handle = GATT_APP_START_HANDLE;
+  for (auto _ : state) {
+    auto it = gatt_sr_find_i_rcb_by_handle(handle);
+    if (it != gatt_cb.srv_list_info->end()) {
+      benchmark::DoNotOptimize(find_attr_by_handle(it->p_db, handle));
+      benchmark::DoNotOptimize(gatts_read_attr_perm_check(
+          it->p_db, false, handle, GATT_SEC_FLAG_ENCRYPTED, 16));
+    }
+
+    // Walk every handle, including those between services.
+    if (++handle > last_handle) handle = GATT_APP_START_HANDLE;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GattServerReadRequest);
+
+// Read By Type for characteristic declarations, as issued during discovery,
+// starting at each service in turn.
+static void BM_GattServerReadByType(State& state) {
+  populate_server();
+
+  tGATT_TCB tcb;
+  tcb.payload_size = GATT_MAX_MTU_SIZE;
+  Uuid type = Uuid::From16Bit(GATT_UUID_CHAR_DECLARE);
+  size_t msg_len = sizeof(BT_HDR) + tcb.payload_size + L2CAP_MIN_OFFSET;
+  BT_HDR* p_msg = (BT_HDR*)osi_calloc(msg_len);
+
+  int service = 0;
+  for (auto _ : state) {
+    uint16_t s_hdl = GATT_APP_START_HANDLE + service * SERVICE_HANDLE_STRIDE;
+    uint16_t e_hdl = 0xffff;
+    uint16_t err_hdl = 0;
+    uint16_t buf_len = tcb.payload_size - 2;
+    p_msg->len = 2;
+    p_msg->offset = 0;
+
+    for (auto it = gatt_sr_find_first_srv_from_handle(s_hdl);
+         it != gatt_cb.srv_list_info->end() && it->s_hdl <= e_hdl; it++) {
+      tGATT_STATUS ret = gatts_db_read_attr_value_by_type(
+          tcb, it->p_db, GATT_REQ_READ_BY_TYPE, p_msg, s_hdl, e_hdl, type,
+          &buf_len, GATT_SEC_FLAG_ENCRYPTED, 16, 0, &err_hdl);
+      if (ret != GATT_SUCCESS && ret != GATT_NOT_FOUND) break;
+    }
+
+    if (++service == NUM_SERVICES) service = 0;
+  }
+  state.SetItemsProcessed(state.iterations());
+
+  osi_free(p_msg);
+}
+BENCHMARK(BM_GattServerReadByType);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,217 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+#include "l2c_int.h"
+#include "osi/include/fixed_queue.h"
+#include "osi/include/list.h"
+
+using ::benchmark::Counter;
+using ::benchmark::State;
+
+// Simulated time per iteration, and the controller's air rate
+#define SIM_DURATION_US (10 * 1000 * 1000)
+#define AIR_BYTES_PER_MS 250
+
+// Packets kept queued on the bulk links
+#define BULK_BACKLOG 16
+
+enum { LINK_A2DP, LINK_HID, LINK_OPP, LINK_PAN, NUM_LINKS };
+
+// One channel per link. A period of 0 means the channel is always backlogged.
+struct SimTraffic {
+  bool high_acl_priority;
+  tL2CAP_CHNL_PRIORITY chnl_priority;
+  uint16_t len;
+  uint64_t period_us;
+};
+
+// SBC at 345 kbit/s, a keyboard or mouse at 125 Hz, and two transfers
+static const SimTraffic traffic[NUM_LINKS] = {
+    {true, L2CAP_CHNL_PRIORITY_LOW, 672, 15000},
+    {false, L2CAP_CHNL_PRIORITY_HIGH, 16, 8000},
+    {false, L2CAP_CHNL_PRIORITY_LOW, 1021, 0},
+    {false, L2CAP_CHNL_PRIORITY_LOW, 1021, 0},
+};
+
+// Packets are queued as pointers to their link, as only their count matters
+struct SimLink {
+  std::deque<uint64_t> queued_us;
+  uint64_t next_arrival_us;
+  uint64_t bytes_sent;
+  std::vector<uint64_t> waits_us;
+};
+
+static SimLink sim_links[NUM_LINKS];
+
+// The controller shares |window| buffers between the links, and sends the
+// packets it holds in order.
+static uint16_t window;
+static uint64_t air_free_us;
+static std::deque<uint64_t> completions_us;
+
+static void setup_links() {
+  for (int link = 0; link < NUM_LINKS; link++) {
+    tL2C_LCB* p_lcb = &l2cb.lcb_pool[link];
+    tL2C_CCB* p_ccb = &l2cb.ccb_pool[link];
+
+    if (!p_lcb->in_use) {
+      p_lcb->in_use = true;
+      p_lcb->link_state = LST_CONNECTED;
+      p_lcb->transport = BT_TRANSPORT_BR_EDR;
+      p_lcb->link_xmit_data_q = list_new(NULL);
+      p_lcb->ccb_queue.p_first_ccb = p_lcb->ccb_queue.p_last_ccb = p_ccb;
+
+      p_ccb->in_use = true;
+      p_ccb->p_lcb = p_lcb;
+      p_ccb->local_cid = L2CAP_BASE_APPL_CID + link;
+      p_ccb->xmit_hold_q = fixed_queue_new(SIZE_MAX);
+      p_ccb->fcrb.retrans_q = fixed_queue_new(SIZE_MAX);
+    }
+    while (!fixed_queue_is_empty(p_ccb->xmit_hold_q))
+      fixed_queue_try_dequeue(p_ccb->xmit_hold_q);
+
+    p_lcb->acl_priority = traffic[link].high_acl_priority
+                              ? L2CAP_PRIORITY_HIGH
+                              : L2CAP_PRIORITY_NORMAL;
+    p_lcb->sched_deficit = 0;
+    p_ccb->ccb_priority = traffic[link].chnl_priority;
+
+    SimLink& sim = sim_links[link];
+    sim.queued_us.clear();
+    sim.next_arrival_us = link;
+    sim.bytes_sent = 0;
+    sim.waits_us.clear();
+  }
+  completions_us.clear();
+  air_free_us = 0;
+}
+
+static void enqueue(int link, uint64_t now_us) {
+  fixed_queue_enqueue(l2cb.ccb_pool[link].xmit_hold_q, &sim_links[link]);
+  sim_links[link].queued_us.push_back(now_us);
+}
+
+static tL2C_LINK_SCHED_STATE sim_state(tL2C_LCB* p_lcb) {
+  if (fixed_queue_is_empty(l2cb.ccb_pool[p_lcb - l2cb.lcb_pool].xmit_hold_q))
+    return L2C_LINK_SCHED_IDLE;
+  return window > 0 ? L2C_LINK_SCHED_READY : L2C_LINK_SCHED_BLOCKED;
+}
+
+// Runs SIM_DURATION_US of traffic, returning the number of packets sent
+static uint64_t simulate() {
+  uint64_t now_us = 0;
+  uint64_t sent = 0;
+
+  while (now_us < SIM_DURATION_US) {
+    // Buffers freed by the controller, and new data from the profiles
+    while (!completions_us.empty() && completions_us.front() <= now_us) {
+      completions_us.pop_front();
+      window++;
+    }
+    for (int link = 0; link < NUM_LINKS; link++) {
+      SimLink& sim = sim_links[link];
+      if (traffic[link].period_us == 0) {
+        while (sim.queued_us.size() < BULK_BACKLOG) enqueue(link, now_us);
+      } else if (sim.next_arrival_us <= now_us) {
+        enqueue(link, now_us);
+        sim.next_arrival_us += traffic[link].period_us;
+      }
+    }
+
+    tL2C_LCB* p_lcb;
+    while ((p_lcb = l2c_link_sched_next(BT_TRANSPORT_BR_EDR, sim_state)) !=
+           NULL) {
+      int link = p_lcb - l2cb.lcb_pool;
+      SimLink& sim = sim_links[link];
+      uint16_t len = traffic[link].len;
+      fixed_queue_try_dequeue(l2cb.ccb_pool[link].xmit_hold_q);
+      sim.waits_us.push_back(now_us - sim.queued_us.front());
+      sim.queued_us.pop_front();
+      sim.bytes_sent += len;
+
+      window--;
+      air_free_us =
+          std::max(air_free_us, now_us) + len * 1000 / AIR_BYTES_PER_MS;
+      completions_us.push_back(air_free_us);
+      l2c_link_sched_sent(p_lcb, len);
+      sent++;
+    }
+
+    uint64_t next_us = SIM_DURATION_US;
+    if (!completions_us.empty())
+      next_us = std::min(next_us, completions_us.front());
+    for (int link = 0; link < NUM_LINKS; link++) {
+      if (traffic[link].period_us != 0)
+        next_us = std::min(next_us, sim_links[link].next_arrival_us);
+    }
+    now_us = next_us;
+  }
+  return sent;
+}
+
+static double percentile_us(std::vector<uint64_t> waits, double p) {
+  if (waits.empty()) return 0;
+  size_t n = std::min(waits.size() - 1, (size_t)(waits.size() * p));
+  std::nth_element(waits.begin(), waits.begin() + n, waits.end());
+  return waits[n];
+}
+
+// A2DP, HID and two bulk transfers sharing |state.range(0)| controller
+// buffers. Latency counters are the host side wait, from queueing to being
+// handed to the controller.
+static void BM_LinkScheduler(State& state, const tL2C_LINK_SCHED* p_sched) {
+  l2c_link_sched_set(p_sched);
+
+  std::vector<uint64_t> a2dp_waits, hid_waits;
+  uint64_t opp_bytes = 0, pan_bytes = 0, sent = 0;
+  for (auto _ : state) {
+    setup_links();
+    window = state.range(0);
+    sent += simulate();
+
+    a2dp_waits.insert(a2dp_waits.end(), sim_links[LINK_A2DP].waits_us.begin(),
+                      sim_links[LINK_A2DP].waits_us.end());
+    hid_waits.insert(hid_waits.end(), sim_links[LINK_HID].waits_us.begin(),
+                     sim_links[LINK_HID].waits_us.end());
+    opp_bytes += sim_links[LINK_OPP].bytes_sent;
+    pan_bytes += sim_links[LINK_PAN].bytes_sent;
+  }
+
+  double sim_seconds =
+      state.iterations() * (double)SIM_DURATION_US / (1000 * 1000);
+  state.counters["a2dp_p99_us"] = percentile_us(a2dp_waits, 0.99);
+  state.counters["a2dp_max_us"] = percentile_us(a2dp_waits, 1);
+  state.counters["hid_p99_us"] = percentile_us(hid_waits, 0.99);
+  state.counters["hid_max_us"] = percentile_us(hid_waits, 1);
+  state.counters["bulk_kBps"] = (opp_bytes + pan_bytes) / sim_seconds / 1000;
+  state.counters["bulk_fairness"] =
+      std::min(opp_bytes, pan_bytes) / (double)std::max(opp_bytes, pan_bytes);
+  state.counters["decisions_per_second"] = Counter(sent, Counter::kIsRate);
+}
+BENCHMARK_CAPTURE(BM_LinkScheduler, round_robin, &l2c_link_sched_rr)
+    ->Arg(4)
+    ->Arg(8);
+BENCHMARK_CAPTURE(BM_LinkScheduler, deficit_round_robin, &l2c_link_sched_drr)
+    ->Arg(4)
+    ->Arg(8);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,379 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "btm_api.h"
+#include "btm_int.h"
+#include "device/include/controller.h"
+#include "hcimsgs.h"
+#include "l2c_int.h"
+#include "osi/include/allocator.h"
+#include "osi/include/fixed_queue.h"
+#include "osi/include/list.h"
+
+#define QUANTUM L2CAP_LINK_SCHED_QUANTUM
+#define FAST_PATH_DEBT L2CAP_LINK_SCHED_FAST_PATH_DEBT
+
+// Links 0 to 3 are BR/EDR, link 4 is LE, the others are not in use
+#define LE_LINK 4
+#define NUM_LINKS 5
+
+// The rest of L2CAP and the layers below it are not linked in
+tL2C_CB l2cb;
+void LogMsg(uint32_t trace_set_mask, const char* fmt_str, ...) {}
+void vnd_LogMsg(uint32_t trace_set_mask, const char* fmt_str, ...) {}
+
+static bool link_stalled[NUM_LINKS];
+static int next_buffer_calls[NUM_LINKS];
+static std::vector<BT_HDR*> sent_bufs;
+
+BT_HDR* l2cu_get_next_buffer_to_send(tL2C_LCB* p_lcb,
+                                     tL2C_TX_COMPLETE_CB_INFO* p_cbi) {
+  int link = p_lcb - l2cb.lcb_pool;
+  next_buffer_calls[link]++;
+  p_cbi->cb = NULL;
+  if (link_stalled[link]) return NULL;
+  return (BT_HDR*)fixed_queue_try_dequeue(
+      p_lcb->ccb_queue.p_first_ccb->xmit_hold_q);
+}
+
+void l2cu_tx_complete(tL2C_TX_COMPLETE_CB_INFO* p_cbi) {}
+
+void bte_main_hci_send(BT_HDR* p_msg, uint16_t event) {
+  sent_bufs.push_back(p_msg);
+}
+
+tBTM_STATUS BTM_ReadPowerMode(const RawAddress& remote_bda,
+                              tBTM_PM_MODE* p_mode) {
+  *p_mode = BTM_PM_MD_ACTIVE;
+  return BTM_SUCCESS;
+}
+
+bool btm_pm_is_mode_pend_link(uint16_t hci_handle) { return false; }
+
+void alarm_set_on_mloop(alarm_t* alarm, period_ms_t interval_ms,
+                        alarm_callback_t cb, void* data) {}
+
+void l2c_lcb_timer_timeout(void* data) {}
+
+static uint16_t get_acl_packet_size() { return QUANTUM + 4; }
+
+static controller_t controller;
+const controller_t* controller_get_interface() { return &controller; }
+
+static tL2C_LINK_SCHED_STATE link_state[MAX_L2CAP_LINKS];
+
+static tL2C_LINK_SCHED_STATE stub_state(tL2C_LCB* p_lcb) {
+  return link_state[p_lcb - l2cb.lcb_pool];
+}
+
+class L2capLinkSchedTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    for (int link = 0; link < NUM_LINKS; link++) {
+      tL2C_LCB* p_lcb = &l2cb.lcb_pool[link];
+      tL2C_CCB* p_ccb = &l2cb.ccb_pool[link];
+
+      p_lcb->in_use = true;
+      p_lcb->link_state = LST_CONNECTED;
+      p_lcb->transport =
+          link == LE_LINK ? BT_TRANSPORT_LE : BT_TRANSPORT_BR_EDR;
+      p_lcb->handle = link;
+      p_lcb->link_xmit_data_q = list_new(NULL);
+      p_lcb->ccb_queue.p_first_ccb = p_lcb->ccb_queue.p_last_ccb = p_ccb;
+
+      p_ccb->in_use = true;
+      p_ccb->p_lcb = p_lcb;
+      p_ccb->local_cid = L2CAP_BASE_APPL_CID + link;
+      p_ccb->ccb_priority = L2CAP_CHNL_PRIORITY_LOW;
+      p_ccb->xmit_hold_q = fixed_queue_new(SIZE_MAX);
+      p_ccb->fcrb.retrans_q = fixed_queue_new(SIZE_MAX);
+
+      link_stalled[link] = false;
+      next_buffer_calls[link] = 0;
+    }
+    for (int link = 0; link < MAX_L2CAP_LINKS; link++)
+      link_state[link] = L2C_LINK_SCHED_IDLE;
+
+    l2cb.controller_xmit_window = l2cb.round_robin_quota = 10;
+    l2cb.controller_le_xmit_window = l2cb.ble_round_robin_quota = 10;
+    controller.get_acl_packet_size_classic = get_acl_packet_size;
+    controller.get_acl_packet_size_ble = get_acl_packet_size;
+
+    // Both schedulers start their BR/EDR turns after link 0
+    link_state[0] = L2C_LINK_SCHED_READY;
+    for (const tL2C_LINK_SCHED* p_sched :
+         {&l2c_link_sched_rr, &l2c_link_sched_drr}) {
+      l2c_link_sched_set(p_sched);
+      ASSERT_EQ(&l2cb.lcb_pool[0], Pick(BT_TRANSPORT_BR_EDR));
+    }
+    l2cb.lcb_pool[0].sched_deficit = 0;
+    link_state[0] = L2C_LINK_SCHED_IDLE;
+  }
+
+  void TearDown() override {
+    for (int link = 0; link < NUM_LINKS; link++) {
+      tL2C_LCB* p_lcb = &l2cb.lcb_pool[link];
+      tL2C_CCB* p_ccb = &l2cb.ccb_pool[link];
+
+      list_free(p_lcb->link_xmit_data_q);
+      fixed_queue_free(p_ccb->xmit_hold_q, osi_free);
+      fixed_queue_free(p_ccb->fcrb.retrans_q, osi_free);
+    }
+    for (BT_HDR* p_buf : sent_bufs) osi_free(p_buf);
+    sent_bufs.clear();
+    memset(&l2cb, 0, sizeof(l2cb));
+  }
+
+  tL2C_LCB* Pick(tBT_TRANSPORT transport) {
+    return l2c_link_sched_next(transport, stub_state);
+  }
+
+  // Picks |count| times, sending a packet of |len| bytes on each link picked
+  std::vector<int> Run(int count, uint16_t len) {
+    std::vector<int> picks;
+    for (int i = 0; i < count; i++) {
+      tL2C_LCB* p_lcb = Pick(BT_TRANSPORT_BR_EDR);
+      if (p_lcb == NULL) break;
+      picks.push_back(p_lcb - l2cb.lcb_pool);
+      l2c_link_sched_sent(p_lcb, len);
+    }
+    return picks;
+  }
+
+  void SetReady(int link, uint8_t cls) {
+    tL2C_LCB* p_lcb = &l2cb.lcb_pool[link];
+    tL2C_CCB* p_ccb = &l2cb.ccb_pool[link];
+
+    link_state[link] = L2C_LINK_SCHED_READY;
+    p_lcb->acl_priority = cls == L2C_LINK_CLASS_LATENCY ? L2CAP_PRIORITY_HIGH
+                                                        : L2CAP_PRIORITY_NORMAL;
+    if (cls == L2C_LINK_CLASS_NORMAL) {
+      p_ccb->ccb_priority = L2CAP_CHNL_PRIORITY_MEDIUM;
+      Queue(link, 1);
+    }
+    ASSERT_EQ(cls, l2c_link_sched_class(p_lcb));
+  }
+
+  // Queues |count| packets on the channel of |link|
+  void Queue(int link, int count) {
+    for (int i = 0; i < count; i++) {
+      BT_HDR* p_buf = (BT_HDR*)osi_calloc(sizeof(BT_HDR));
+      p_buf->len = 100;
+      p_buf->event = link;
+      fixed_queue_enqueue(l2cb.ccb_pool[link].xmit_hold_q, p_buf);
+    }
+  }
+
+  std::vector<int> SentLinks() {
+    std::vector<int> links;
+    for (BT_HDR* p_buf : sent_bufs) links.push_back(p_buf->event);
+    return links;
+  }
+};
+
+TEST_F(L2capLinkSchedTest, round_robin_takes_ready_links_in_turn) {
+  l2c_link_sched_set(&l2c_link_sched_rr);
+
+  EXPECT_EQ(nullptr, Pick(BT_TRANSPORT_BR_EDR));
+
+  SetReady(0, L2C_LINK_CLASS_BULK);
+  SetReady(1, L2C_LINK_CLASS_LATENCY);
+  link_state[2] = L2C_LINK_SCHED_BLOCKED;
+  SetReady(3, L2C_LINK_CLASS_BULK);
+  SetReady(LE_LINK, L2C_LINK_CLASS_BULK);
+
+  EXPECT_EQ(std::vector<int>({1, 3, 0, 1, 3, 0}), Run(6, 100));
+  EXPECT_EQ(&l2cb.lcb_pool[LE_LINK], Pick(BT_TRANSPORT_LE));
+  EXPECT_EQ(&l2cb.lcb_pool[LE_LINK], Pick(BT_TRANSPORT_LE));
+}
+
+TEST_F(L2capLinkSchedTest, drr_weights_quantum_by_class) {
+  SetReady(1, L2C_LINK_CLASS_NORMAL);
+  SetReady(2, L2C_LINK_CLASS_BULK);
+
+  // Link 1 keeps the turn while its deficit lasts
+  EXPECT_EQ(&l2cb.lcb_pool[1], Pick(BT_TRANSPORT_BR_EDR));
+  EXPECT_EQ(2 * QUANTUM, l2cb.lcb_pool[1].sched_deficit);
+  EXPECT_EQ(0, l2cb.lcb_pool[2].sched_deficit);
+  l2c_link_sched_sent(&l2cb.lcb_pool[1], 600);
+  EXPECT_EQ(&l2cb.lcb_pool[1], Pick(BT_TRANSPORT_BR_EDR));
+  l2c_link_sched_sent(&l2cb.lcb_pool[1], 600);
+  EXPECT_EQ(&l2cb.lcb_pool[1], Pick(BT_TRANSPORT_BR_EDR));
+  l2c_link_sched_sent(&l2cb.lcb_pool[1], 600);
+  EXPECT_EQ(&l2cb.lcb_pool[1], Pick(BT_TRANSPORT_BR_EDR));
+  l2c_link_sched_sent(&l2cb.lcb_pool[1], 600);
+  EXPECT_EQ(2 * QUANTUM - 4 * 600, l2cb.lcb_pool[1].sched_deficit);
+
+  EXPECT_EQ(&l2cb.lcb_pool[2], Pick(BT_TRANSPORT_BR_EDR));
+  EXPECT_EQ(QUANTUM, l2cb.lcb_pool[2].sched_deficit);
+  l2c_link_sched_sent(&l2cb.lcb_pool[2], QUANTUM);
+
+  // Past the first round, a normal link gets twice the bytes of a bulk one
+  l2cb.lcb_pool[1].sched_deficit = 0;
+  EXPECT_EQ(std::vector<int>({1, 1, 2, 1, 1, 2, 1, 1, 2}), Run(9, QUANTUM));
+  EXPECT_EQ(0, l2cb.lcb_pool[1].sched_deficit);
+  EXPECT_EQ(0, l2cb.lcb_pool[2].sched_deficit);
+  EXPECT_EQ(0u, l2cb.lcb_pool[1].sched_fast_path);
+}
+
+TEST_F(L2capLinkSchedTest, drr_latency_quantum) {
+  SetReady(1, L2C_LINK_CLASS_LATENCY);
+  SetReady(2, L2C_LINK_CLASS_BULK);
+
+  // Out of the fast path, a latency link gets four times the quantum
+  l2cb.lcb_pool[1].sched_deficit = -FAST_PATH_DEBT - 1;
+  EXPECT_EQ(&l2cb.lcb_pool[2], Pick(BT_TRANSPORT_BR_EDR));
+  EXPECT_EQ(4 * QUANTUM - FAST_PATH_DEBT - 1, l2cb.lcb_pool[1].sched_deficit);
+  EXPECT_EQ(QUANTUM, l2cb.lcb_pool[2].sched_deficit);
+  EXPECT_EQ(0u, l2cb.lcb_pool[1].sched_fast_path);
+}
+
+TEST_F(L2capLinkSchedTest, drr_fast_path_stops_at_debt) {
+  SetReady(1, L2C_LINK_CLASS_LATENCY);
+  SetReady(2, L2C_LINK_CLASS_BULK);
+
+  // The latency link goes first until it owes FAST_PATH_DEBT bytes, then
+  // waits for its quantum in turn with the others
+  EXPECT_EQ(std::vector<int>({1, 1, 1, 1, 2}), Run(5, QUANTUM));
+  EXPECT_EQ(4u, l2cb.lcb_pool[1].sched_fast_path);
+  EXPECT_EQ(0, l2cb.lcb_pool[1].sched_deficit);
+  EXPECT_EQ(0, l2cb.lcb_pool[2].sched_deficit);
+
+  EXPECT_EQ(std::vector<int>({1, 1, 1, 1, 2}), Run(5, QUANTUM));
+  EXPECT_EQ(8u, l2cb.lcb_pool[1].sched_fast_path);
+
+  // A link owing less than the debt still takes the fast path
+  l2cb.lcb_pool[1].sched_deficit = -FAST_PATH_DEBT + 1;
+  EXPECT_EQ(&l2cb.lcb_pool[1], Pick(BT_TRANSPORT_BR_EDR));
+  EXPECT_EQ(9u, l2cb.lcb_pool[1].sched_fast_path);
+}
+
+TEST_F(L2capLinkSchedTest, drr_refills_until_a_link_has_credit) {
+  SetReady(1, L2C_LINK_CLASS_BULK);
+  SetReady(3, L2C_LINK_CLASS_BULK);
+  link_state[2] = L2C_LINK_SCHED_BLOCKED;
+  l2cb.lcb_pool[1].sched_deficit = -3000;
+  l2cb.lcb_pool[2].sched_deficit = -5000;
+  l2cb.lcb_pool[3].sched_deficit = -1500;
+
+  // Two rounds: links 1 and 3 reach -1979 and -479, then -958 and 542
+  EXPECT_EQ(&l2cb.lcb_pool[3], Pick(BT_TRANSPORT_BR_EDR));
+  EXPECT_EQ(-3000 + 2 * QUANTUM, l2cb.lcb_pool[1].sched_deficit);
+  EXPECT_EQ(-5000, l2cb.lcb_pool[2].sched_deficit);
+  EXPECT_EQ(-1500 + 2 * QUANTUM, l2cb.lcb_pool[3].sched_deficit);
+
+  // A single link with a large overdraft is refilled alone
+  link_state[3] = L2C_LINK_SCHED_IDLE;
+  l2cb.lcb_pool[1].sched_deficit = -2500;
+  EXPECT_EQ(&l2cb.lcb_pool[1], Pick(BT_TRANSPORT_BR_EDR));
+  EXPECT_EQ(-2500 + 3 * QUANTUM, l2cb.lcb_pool[1].sched_deficit);
+  EXPECT_EQ(0, l2cb.lcb_pool[3].sched_deficit);
+}
+
+TEST_F(L2capLinkSchedTest, drr_idle_link_loses_deficit) {
+  SetReady(1, L2C_LINK_CLASS_BULK);
+  l2cb.lcb_pool[2].sched_deficit = 500;
+  l2cb.lcb_pool[3].sched_deficit = 500;
+  l2cb.lcb_pool[LE_LINK].sched_deficit = 500;
+  link_state[3] = L2C_LINK_SCHED_BLOCKED;
+  SetReady(LE_LINK, L2C_LINK_CLASS_BULK);
+
+  // Only the idle link of the transport is reset
+  EXPECT_EQ(&l2cb.lcb_pool[1], Pick(BT_TRANSPORT_BR_EDR));
+  EXPECT_EQ(0, l2cb.lcb_pool[2].sched_deficit);
+  EXPECT_EQ(500, l2cb.lcb_pool[3].sched_deficit);
+  EXPECT_EQ(500, l2cb.lcb_pool[LE_LINK].sched_deficit);
+
+  link_state[1] = L2C_LINK_SCHED_BLOCKED;
+  EXPECT_EQ(nullptr, Pick(BT_TRANSPORT_BR_EDR));
+  EXPECT_EQ(&l2cb.lcb_pool[LE_LINK], Pick(BT_TRANSPORT_LE));
+}
+
+TEST_F(L2capLinkSchedTest, send_pkts_skips_stalled_link) {
+  Queue(0, 3);
+  Queue(1, 3);
+  link_stalled[0] = true;
+
+  l2c_link_check_send_pkts(NULL, NULL, NULL);
+  EXPECT_EQ(std::vector<int>({1, 1, 1}), SentLinks());
+  EXPECT_EQ(1, next_buffer_calls[0]);
+  EXPECT_EQ(3u, fixed_queue_length(l2cb.ccb_pool[0].xmit_hold_q));
+  EXPECT_EQ(7, l2cb.controller_xmit_window);
+  EXPECT_EQ(3, l2cb.round_robin_unacked);
+
+  // The next pass tries the link again
+  link_stalled[0] = false;
+  l2c_link_check_send_pkts(NULL, NULL, NULL);
+  EXPECT_EQ(std::vector<int>({1, 1, 1, 0, 0, 0}), SentLinks());
+  EXPECT_EQ(4, l2cb.controller_xmit_window);
+}
+
+TEST_F(L2capLinkSchedTest, send_pkts_stops_at_window) {
+  Queue(1, 3);
+  Queue(2, 3);
+  Queue(LE_LINK, 3);
+  l2cb.controller_xmit_window = 4;
+
+  l2c_link_check_send_pkts(NULL, NULL, NULL);
+  EXPECT_EQ(std::vector<int>({1, 1, 1, 2, LE_LINK, LE_LINK, LE_LINK}),
+            SentLinks());
+  EXPECT_EQ(0, l2cb.controller_xmit_window);
+  EXPECT_EQ(7, l2cb.controller_le_xmit_window);
+  EXPECT_EQ(2u, fixed_queue_length(l2cb.ccb_pool[2].xmit_hold_q));
+}
+
+TEST_F(L2capLinkSchedTest, single_write_sends_only_its_link_queue) {
+  tL2C_LCB* p_lcb = &l2cb.lcb_pool[0];
+  tL2C_CCB* p_ccb = &l2cb.ccb_pool[0];
+  Queue(0, 2);
+  Queue(1, 2);
+
+  BT_HDR* p_buf = (BT_HDR*)osi_calloc(sizeof(BT_HDR));
+  p_buf->len = 100;
+  l2c_link_check_send_pkts(p_lcb, p_ccb, p_buf);
+  ASSERT_EQ(std::vector<BT_HDR*>({p_buf}), sent_bufs);
+  EXPECT_EQ(p_ccb->local_cid, p_buf->event);
+  EXPECT_EQ(0, next_buffer_calls[0]);
+  EXPECT_EQ(0, next_buffer_calls[1]);
+  EXPECT_EQ(2u, fixed_queue_length(p_ccb->xmit_hold_q));
+  EXPECT_EQ(2u, fixed_queue_length(l2cb.ccb_pool[1].xmit_hold_q));
+  EXPECT_EQ(9, l2cb.controller_xmit_window);
+}
+
+TEST_F(L2capLinkSchedTest, single_write_waits_for_window) {
+  tL2C_LCB* p_lcb = &l2cb.lcb_pool[0];
+  tL2C_CCB* p_ccb = &l2cb.ccb_pool[0];
+  Queue(0, 1);
+  l2cb.controller_xmit_window = 0;
+
+  BT_HDR* p_buf = (BT_HDR*)osi_calloc(sizeof(BT_HDR));
+  p_buf->len = 100;
+  l2c_link_check_send_pkts(p_lcb, p_ccb, p_buf);
+  EXPECT_TRUE(sent_bufs.empty());
+  EXPECT_EQ(1u, list_length(p_lcb->link_xmit_data_q));
+
+  // The link queue goes before the channel once the window opens
+  l2cb.controller_xmit_window = 10;
+  l2c_link_check_send_pkts(NULL, NULL, NULL);
+  ASSERT_EQ(2u, sent_bufs.size());
+  EXPECT_EQ(p_buf, sent_bufs[0]);
+  EXPECT_EQ(0, sent_bufs[1]->event);
+  EXPECT_TRUE(list_is_empty(p_lcb->link_xmit_data_q));
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "btm_int.h"
+#include "l2c_int.h"
+#include "osi/include/list.h"
+
+using ::benchmark::State;
+
+// Connection handles are handed out sparsely by controllers.
+#define HANDLE_BASE 0x0040
+#define HANDLE_STRIDE 0x0101
+
+// One channel per link, plus a full bond list where the connected devices are
+// the most recently added records.
+#define NUM_BONDED_DEVICES BTM_SEC_MAX_DEVICE_RECORDS
+
+static uint16_t link_handle(int link) {
+  return HANDLE_BASE + link * HANDLE_STRIDE;
+}
+
+static RawAddress device_address(int device) {
+  // Public addresses, so that no lookup attempts RPA resolution.
+  return RawAddress({0x00, 0x1b, 0xdc, 0x00, (uint8_t)(device >> 8),
+                     (uint8_t)device});
+}
+
+static void populate_links() {
+  if (l2cb.lcb_pool[0].in_use) return;
+
+  for (int link = 0; link < MAX_L2CAP_LINKS; link++) {
+    tL2C_LCB* p_lcb = &l2cb.lcb_pool[link];
+    tL2C_CCB* p_ccb = &l2cb.ccb_pool[link];
+
+    p_lcb->in_use = true;
+    p_lcb->handle = HCI_INVALID_HANDLE;
+    p_lcb->link_state = LST_CONNECTED;
+    l2cu_set_lcb_handle(p_lcb, link_handle(link));
+
+    p_ccb->in_use = true;
+    p_ccb->p_lcb = p_lcb;
+    p_ccb->local_cid = L2CAP_BASE_APPL_CID + link;
+  }
+
+  btm_cb.sec_dev_rec = list_new(btm_sec_dev_rec_free);
+  for (int device = 0; device < NUM_BONDED_DEVICES; device++) {
+    tBTM_SEC_DEV_REC* p_dev_rec = btm_sec_allocate_dev_rec();
+    p_dev_rec->bd_addr = device_address(device);
+    p_dev_rec->hci_handle = BTM_SEC_INVALID_HANDLE;
+    p_dev_rec->ble_hci_handle = BTM_SEC_INVALID_HANDLE;
+
+    int link = device - (NUM_BONDED_DEVICES - MAX_L2CAP_LINKS);
+    if (link >= 0) p_dev_rec->hci_handle = link_handle(link);
+  }
+}
+
+// The per-packet lookups of l2c_rcv_acl_data: link by handle, then channel by
+// CID, spread across every connected link.
+static void BM_L2capRcvLookup(State& state) {
+  populate_links();
+
+  int link = 0;
+  for (auto _ : state) {
+    tL2C_LCB* p_lcb = l2cu_find_lcb_by_handle(link_handle(link));
+    benchmark::DoNotOptimize(
+        l2cu_find_ccb_by_cid(p_lcb, L2CAP_BASE_APPL_CID + link));
+
+    if (++link == MAX_L2CAP_LINKS) link = 0;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_L2capRcvLookup);
+
+static void BM_BtmFindDevByHandle(State& state) {
+  populate_links();
+
+  int link = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(btm_find_dev_by_handle(link_handle(link)));
+
+    if (++link == MAX_L2CAP_LINKS) link = 0;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BtmFindDevByHandle);
+
+static void BM_BtmFindDev(State& state) {
+  populate_links();
+
+  int link = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(btm_find_dev(
+        device_address(NUM_BONDED_DEVICES - MAX_L2CAP_LINKS + link)));
+
+    if (++link == MAX_L2CAP_LINKS) link = 0;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BtmFindDev);
+
+BENCHMARK_MAIN();
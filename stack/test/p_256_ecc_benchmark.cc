@@ -0,0 +1,87 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <string.h>
+
+#include "stack/smp/p_256_ecc_pp.h"
+
+using ::benchmark::State;
+
+// Private keys from the LE Secure Connections sample data. The public key of
+// the second one is the peer key of the DHKey benchmarks.
+static const uint32_t private_key_a[KEY_LENGTH_DWORDS_P256] = {
+    0xcd3c1abd, 0x5899b8a6, 0xeb40b799, 0x4aff607b,
+    0xd2103f50, 0x74c9b3e3, 0xa3c55f38, 0x3f49f6d4};
+static const uint32_t private_key_b[KEY_LENGTH_DWORDS_P256] = {
+    0xf47fc5fd, 0x6b4fdd49, 0xf19d7cfb, 0x59cb9ac2,
+    0xeed4e72a, 0x900afcfb, 0x32f6bb9a, 0x55188b3d};
+
+static Point peer_public_key() {
+  Point q;
+  p_256_init_curve(KEY_LENGTH_DWORDS_P256);
+  ECC_PointMultBase_P256(&q, private_key_b);
+  return q;
+}
+
+// Local public key generation as done by smp_process_private_key()
+static void BM_PublicKeyReference(State& state) {
+  p_256_init_curve(KEY_LENGTH_DWORDS_P256);
+  for (auto _ : state) {
+    Point q, g = curve_p256.G;
+    uint32_t n[KEY_LENGTH_DWORDS_P256];
+    memcpy(n, private_key_a, sizeof(n));
+    ECC_PointMult_Bin_NAF(&q, &g, n, KEY_LENGTH_DWORDS_P256);
+    benchmark::DoNotOptimize(q);
+  }
+}
+BENCHMARK(BM_PublicKeyReference);
+
+static void BM_PublicKeyFixedBase(State& state) {
+  p_256_init_curve(KEY_LENGTH_DWORDS_P256);
+  p_256_init_base_comb();
+  for (auto _ : state) {
+    Point q;
+    ECC_PointMultBase_P256(&q, private_key_a);
+    benchmark::DoNotOptimize(q);
+  }
+}
+BENCHMARK(BM_PublicKeyFixedBase);
+
+// DHKey computation as done by smp_compute_dhkey()
+static void BM_DhKeyReference(State& state) {
+  Point peer = peer_public_key();
+  for (auto _ : state) {
+    Point q, p = peer;
+    uint32_t n[KEY_LENGTH_DWORDS_P256];
+    memcpy(n, private_key_a, sizeof(n));
+    ECC_PointMult_Bin_NAF(&q, &p, n, KEY_LENGTH_DWORDS_P256);
+    benchmark::DoNotOptimize(q);
+  }
+}
+BENCHMARK(BM_DhKeyReference);
+
+static void BM_DhKeyVariableBase(State& state) {
+  Point peer = peer_public_key();
+  for (auto _ : state) {
+    Point q;
+    ECC_PointMult_P256(&q, &peer, private_key_a);
+    benchmark::DoNotOptimize(q);
+  }
+}
+BENCHMARK(BM_DhKeyVariableBase);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,164 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stack/smp/p_256_ecc_pp.h"
+
+namespace {
+
+// Parses a big-endian hex string of 64 digits into little-endian words.
+void words_from_hex(uint32_t* w, const char* hex) {
+  for (int i = 0; i < KEY_LENGTH_DWORDS_P256; i++) {
+    char digits[9];
+    memcpy(digits, hex + 8 * (KEY_LENGTH_DWORDS_P256 - 1 - i), 8);
+    digits[8] = '\0';
+    w[i] = strtoul(digits, nullptr, 16);
+  }
+}
+
+void expect_same_point(const Point& expected, const Point& actual) {
+  EXPECT_EQ(0, memcmp(expected.x, actual.x, sizeof(expected.x)));
+  EXPECT_EQ(0, memcmp(expected.y, actual.y, sizeof(expected.y)));
+}
+
+// Reference result from the multiprecision implementation, which modifies
+// its point and scalar arguments.
+Point reference_mult(const Point& p, const uint32_t* n) {
+  Point q, base = p;
+  uint32_t scalar[KEY_LENGTH_DWORDS_P256];
+  memcpy(scalar, n, sizeof(scalar));
+  ECC_PointMult_Bin_NAF(&q, &base, scalar, KEY_LENGTH_DWORDS_P256);
+  return q;
+}
+
+// Bluetooth Core Specification v5.0, Vol 3, Part H, 2.3.5.6.1 P-256 sample
+// data.
+const char* kPrivateKeyA =
+    "3f49f6d4a3c55f3874c9b3e3d2103f504aff607beb40b7995899b8a6cd3c1abd";
+const char* kPublicKeyAX =
+    "20b003d2f297be2c5e2c83a7e9f9a5b9eff49111acf4fddbcc0301480e359de6";
+const char* kPublicKeyAY =
+    "dc809c49652aeb6d63329abf5a52155c766345c28fed3024741c8ed01589d28b";
+const char* kPrivateKeyB =
+    "55188b3d32f6bb9a900afcfbeed4e72a59cb9ac2f19d7cfb6b4fdd49f47fc5fd";
+const char* kPublicKeyBX =
+    "1ea1f0f01faf1d9609592284f19e4c0047b58afd8615a69f559077b22faaa190";
+const char* kPublicKeyBY =
+    "4c55f33e429dad377356703a9ab85160472d1130e28e36765f89aff915b1214a";
+const char* kDhKey =
+    "ec0234a357c8ad05341010a60a397d9b99796b13b4f866f1868d34f373bfa698";
+
+class P256EccTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    p_256_init_curve(KEY_LENGTH_DWORDS_P256);
+    p_256_init_base_comb();
+  }
+};
+
+}  // namespace
+
+TEST_F(P256EccTest, test_public_keys_match_spec) {
+  uint32_t private_a[KEY_LENGTH_DWORDS_P256];
+  uint32_t private_b[KEY_LENGTH_DWORDS_P256];
+  Point expected_a, expected_b, public_a, public_b;
+
+  words_from_hex(private_a, kPrivateKeyA);
+  words_from_hex(private_b, kPrivateKeyB);
+  words_from_hex(expected_a.x, kPublicKeyAX);
+  words_from_hex(expected_a.y, kPublicKeyAY);
+  words_from_hex(expected_b.x, kPublicKeyBX);
+  words_from_hex(expected_b.y, kPublicKeyBY);
+
+  ECC_PointMultBase_P256(&public_a, private_a);
+  ECC_PointMultBase_P256(&public_b, private_b);
+  expect_same_point(expected_a, public_a);
+  expect_same_point(expected_b, public_b);
+  EXPECT_EQ(1u, public_a.z[0]);
+
+  ECC_PointMult_P256(&public_a, &curve_p256.G, private_a);
+  expect_same_point(expected_a, public_a);
+  expect_same_point(expected_a, reference_mult(curve_p256.G, private_a));
+}
+
+TEST_F(P256EccTest, test_dhkey_matches_spec) {
+  uint32_t private_a[KEY_LENGTH_DWORDS_P256];
+  uint32_t private_b[KEY_LENGTH_DWORDS_P256];
+  uint32_t dhkey[KEY_LENGTH_DWORDS_P256];
+  Point public_a, public_b, shared_a, shared_b;
+
+  words_from_hex(private_a, kPrivateKeyA);
+  words_from_hex(private_b, kPrivateKeyB);
+  words_from_hex(public_a.x, kPublicKeyAX);
+  words_from_hex(public_a.y, kPublicKeyAY);
+  words_from_hex(public_b.x, kPublicKeyBX);
+  words_from_hex(public_b.y, kPublicKeyBY);
+  words_from_hex(dhkey, kDhKey);
+
+  ECC_PointMult_P256(&shared_a, &public_b, private_a);
+  ECC_PointMult_P256(&shared_b, &public_a, private_b);
+  EXPECT_EQ(0, memcmp(dhkey, shared_a.x, sizeof(dhkey)));
+  EXPECT_EQ(0, memcmp(dhkey, shared_b.x, sizeof(dhkey)));
+}
+
+TEST_F(P256EccTest, test_small_scalars) {
+  uint32_t n[KEY_LENGTH_DWORDS_P256] = {0};
+  Point q;
+
+  n[0] = 1;
+  ECC_PointMultBase_P256(&q, n);
+  expect_same_point(curve_p256.G, q);
+  ECC_PointMult_P256(&q, &curve_p256.G, n);
+  expect_same_point(curve_p256.G, q);
+
+  for (n[0] = 2; n[0] < 40; n[0]++) {
+    Point expected = reference_mult(curve_p256.G, n);
+    ECC_PointMultBase_P256(&q, n);
+    expect_same_point(expected, q);
+    ECC_PointMult_P256(&q, &curve_p256.G, n);
+    expect_same_point(expected, q);
+  }
+}
+
+TEST_F(P256EccTest, test_random_scalars_match_reference) {
+  uint32_t private_a[KEY_LENGTH_DWORDS_P256];
+  Point public_a;
+  words_from_hex(private_a, kPrivateKeyA);
+  ECC_PointMultBase_P256(&public_a, private_a);
+
+  uint32_t seed = 1;
+  for (int i = 0; i < 64; i++) {
+    uint32_t n[KEY_LENGTH_DWORDS_P256];
+    for (int j = 0; j < KEY_LENGTH_DWORDS_P256; j++) {
+      seed = seed * 1103515245 + 12345;
+      n[j] = seed ^ (seed << 16);
+    }
+    // Cover scalars with leading zero windows and with a full top word.
+    if (i % 4 == 1) n[KEY_LENGTH_DWORDS_P256 - 1] &= 0xFF;
+    if (i % 4 == 2) n[KEY_LENGTH_DWORDS_P256 - 1] = 0xFFFFFFFF;
+
+    Point q;
+    ECC_PointMultBase_P256(&q, n);
+    expect_same_point(reference_mult(curve_p256.G, n), q);
+    ECC_PointMult_P256(&q, &public_a, n);
+    expect_same_point(reference_mult(public_a, n), q);
+  }
+}
@@ -0,0 +1,179 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+#include "btm_ble_int.h"
+#include "btm_int.h"
+#include "osi/include/allocator.h"
+#include "osi/include/list.h"
+
+using ::benchmark::Counter;
+using ::benchmark::State;
+
+extern RawAddress generate_rpa_from_irk_and_rand(const Octet16& irk,
+                                                 BT_OCTET8 random);
+
+#define NUM_BONDED_DEVICES 200
+
+// Bonded devices advertising nearby, and other devices using resolvable
+// private addresses, as in a busy public space.
+#define NUM_BONDED_IN_RANGE 20
+#define NUM_UNKNOWN_IN_RANGE 300
+
+// Reports in a trace, and how many reports an unknown device keeps its RPA
+// for. Real devices keep it for minutes and advertise several times a second.
+#define NUM_REPORTS 8192
+#define REPORTS_PER_RPA 2048
+
+// IRKs of devices in the bond list, and of the other devices around
+static Octet16 device_irk(int device, bool bonded = true) {
+  Octet16 irk;
+  for (int i = 0; i < OCTET16_LEN; i++) irk[i] = device * 13 + i * 29 + 1;
+  irk[14] = device >> 8;
+  irk[15] = bonded ? 0x00 : 0xff;
+  return irk;
+}
+
+static RawAddress device_rpa(const Octet16& irk, uint32_t seed) {
+  BT_OCTET8 random = {(uint8_t)seed, (uint8_t)(seed >> 8),
+                      (uint8_t)(seed >> 16)};
+  return generate_rpa_from_irk_and_rand(irk, random);
+}
+
+// Bonds every device as LE, with an IRK. Records are appended directly, as
+// btm_sec_allocate_dev_rec() would evict beyond BTM_SEC_MAX_DEVICE_RECORDS.
+static void bond_devices() {
+  if (btm_cb.sec_dev_rec == NULL)
+    btm_cb.sec_dev_rec = list_new(btm_sec_dev_rec_free);
+  if (list_length(btm_cb.sec_dev_rec) == NUM_BONDED_DEVICES) return;
+
+  list_clear(btm_cb.sec_dev_rec);
+  for (int device = 0; device < NUM_BONDED_DEVICES; device++) {
+    tBTM_SEC_DEV_REC* p_dev_rec =
+        static_cast<tBTM_SEC_DEV_REC*>(osi_calloc(sizeof(tBTM_SEC_DEV_REC)));
+    p_dev_rec->sec_flags = BTM_SEC_IN_USE | BTM_SEC_LE_LINK_KEY_KNOWN;
+    p_dev_rec->device_type = BT_DEVICE_TYPE_BLE;
+    p_dev_rec->bd_addr = RawAddress(
+        {0x00, 0x1b, 0xdc, 0x00, (uint8_t)(device >> 8), (uint8_t)device});
+    p_dev_rec->ble.key_type = BTM_LE_KEY_PENC | BTM_LE_KEY_PID;
+    p_dev_rec->ble.keys.irk = device_irk(device);
+    list_append(btm_cb.sec_dev_rec, p_dev_rec);
+  }
+  btm_ble_rpa_cache_flush();
+}
+
+// Advertiser addresses of a scan in a busy space. Bonded devices are the last
+// ones in the bond list, so that each has to be searched for, and send a third
+// of the reports.
+static std::vector<RawAddress> busy_scan_trace() {
+  std::mt19937 rng(NUM_BONDED_DEVICES);
+  std::vector<RawAddress> trace;
+
+  std::vector<RawAddress> bonded, unknown;
+  for (int i = 0; i < NUM_BONDED_IN_RANGE; i++) {
+    int device = NUM_BONDED_DEVICES - 1 - i;
+    bonded.push_back(device_rpa(device_irk(device), rng()));
+  }
+  for (int i = 0; i < NUM_UNKNOWN_IN_RANGE; i++)
+    unknown.push_back(device_rpa(device_irk(i, false), rng()));
+
+  while (trace.size() < NUM_REPORTS) {
+    if (rng() % 3 == 0) {
+      trace.push_back(bonded[rng() % bonded.size()]);
+    } else {
+      int device = rng() % unknown.size();
+      trace.push_back(unknown[device]);
+      if (rng() % REPORTS_PER_RPA == 0)
+        unknown[device] = device_rpa(device_irk(device, false), rng());
+    }
+  }
+  return trace;
+}
+
+// Every report from a new RPA, so that nothing is ever cached
+static std::vector<RawAddress> unique_rpa_trace() {
+  std::vector<RawAddress> trace;
+  for (uint32_t i = 0; i < NUM_REPORTS; i++)
+    trace.push_back(device_rpa(device_irk(0, false), i));
+  return trace;
+}
+
+static void report_stats(State& state, const tBTM_BLE_RPA_CACHE_STATS& before,
+                         size_t num_lookups) {
+  tBTM_BLE_RPA_CACHE_STATS after;
+  btm_ble_rpa_cache_get_stats(&after);
+  double lookups = state.iterations() * num_lookups;
+  state.counters["hit_rate"] = (after.hits - before.hits +
+                                after.negative_hits - before.negative_hits) /
+                               lookups;
+  state.counters["irks_per_lookup"] =
+      (after.irk_checks - before.irk_checks) / lookups;
+}
+
+// What btm_ble_resolve_random_addr() did before the cache: ah() with every
+// stored IRK, each keyed per call, until one matches.
+static void BM_ResolveReference(State& state,
+                                std::vector<RawAddress> (*make_trace)()) {
+  bond_devices();
+  std::vector<RawAddress> trace = make_trace();
+
+  int resolved = 0;
+  for (auto _ : state) {
+    for (const RawAddress& rpa : trace) {
+      list_node_t* end = list_end(btm_cb.sec_dev_rec);
+      for (list_node_t* node = list_begin(btm_cb.sec_dev_rec); node != end;
+           node = list_next(node)) {
+        if (btm_ble_addr_resolvable(
+                rpa, static_cast<tBTM_SEC_DEV_REC*>(list_node(node)))) {
+          resolved++;
+          break;
+        }
+      }
+    }
+  }
+  benchmark::DoNotOptimize(resolved);
+  state.counters["lookups_per_second"] =
+      Counter(state.iterations() * trace.size(), Counter::kIsRate);
+}
+BENCHMARK_CAPTURE(BM_ResolveReference, busy_scan, busy_scan_trace);
+BENCHMARK_CAPTURE(BM_ResolveReference, unique_rpas, unique_rpa_trace);
+
+static void BM_ResolveCached(State& state,
+                             std::vector<RawAddress> (*make_trace)()) {
+  bond_devices();
+  std::vector<RawAddress> trace = make_trace();
+  btm_ble_rpa_cache_flush();
+  tBTM_BLE_RPA_CACHE_STATS before;
+  btm_ble_rpa_cache_get_stats(&before);
+
+  int resolved = 0;
+  for (auto _ : state) {
+    for (const RawAddress& rpa : trace)
+      resolved += btm_ble_resolve_random_addr(rpa) != nullptr;
+  }
+  benchmark::DoNotOptimize(resolved);
+  state.counters["lookups_per_second"] =
+      Counter(state.iterations() * trace.size(), Counter::kIsRate);
+  report_stats(state, before, trace.size());
+}
+BENCHMARK_CAPTURE(BM_ResolveCached, busy_scan, busy_scan_trace);
+BENCHMARK_CAPTURE(BM_ResolveCached, unique_rpas, unique_rpa_trace);
+
+BENCHMARK_MAIN();
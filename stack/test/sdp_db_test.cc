@@ -0,0 +1,319 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "bt_types.h"
+#include "sdp_api.h"
+#include "sdpint.h"
+
+using bluetooth::Uuid;
+
+tSDP_CB sdp_cb;
+
+// sdp_utils.cc needs most of the stack, so its parsing helpers are restated
+// here and the rest is stubbed out.
+void LogMsg(uint32_t trace_set_mask, const char* fmt_str, ...) {}
+void vnd_LogMsg(uint32_t trace_set_mask, const char* fmt_str, ...) {}
+
+void sdpu_update_ccb_cont_info(uint32_t handle) {}
+
+uint8_t* sdpu_build_attrib_entry(uint8_t* p_out, tSDP_ATTRIBUTE* p_attr) {
+  return p_out;
+}
+
+uint8_t* sdpu_get_len_from_type(uint8_t* p, uint8_t* p_end, uint8_t type,
+                                uint32_t* p_len) {
+  static const uint32_t fixed_len[] = {1, 2, 4, 8, 16};
+  uint32_t size_bytes;
+
+  if ((type & 7) < SIZE_IN_NEXT_BYTE) {
+    *p_len = fixed_len[type & 7];
+    return p;
+  }
+  size_bytes = 1 << ((type & 7) - SIZE_IN_NEXT_BYTE);
+  if (p + size_bytes > p_end) return NULL;
+  for (*p_len = 0; size_bytes; size_bytes--) *p_len = (*p_len << 8) | *p++;
+  return p;
+}
+
+static bool uuid_from_array(uint8_t* p, uint32_t len, Uuid* uuid) {
+  if (len == Uuid::kNumBytes16)
+    *uuid = Uuid::From16Bit((p[0] << 8) | p[1]);
+  else if (len == Uuid::kNumBytes32)
+    *uuid = Uuid::From32Bit((p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]);
+  else if (len == Uuid::kNumBytes128)
+    *uuid = Uuid::From128BitBE(p);
+  else
+    return false;
+  return true;
+}
+
+bool sdpu_compare_uuid_arrays(uint8_t* p_uuid1, uint32_t len1, uint8_t* p_uuid2,
+                              uint16_t len2) {
+  Uuid uuid1, uuid2;
+  return uuid_from_array(p_uuid1, len1, &uuid1) &&
+         uuid_from_array(p_uuid2, len2, &uuid2) && uuid1 == uuid2;
+}
+
+namespace {
+
+const uint16_t kExtraAttrId = 0x0200;
+const uint32_t kVendorUuid32 = 0x12345678;
+const uint8_t kCustomUuid128[] = {0x6e, 0x40, 0x00, 0x01, 0xb5, 0xa3,
+                                  0xf3, 0x93, 0xe0, 0xa9, 0xe5, 0x0e,
+                                  0x24, 0xdc, 0xca, 0x9e};
+
+tUID_ENT uuid16(uint16_t uuid) {
+  tUID_ENT ent = {};
+  ent.len = Uuid::kNumBytes16;
+  ent.value[0] = uuid >> 8;
+  ent.value[1] = uuid;
+  return ent;
+}
+
+tUID_ENT uuid32(uint32_t uuid) {
+  tUID_ENT ent = {};
+  ent.len = Uuid::kNumBytes32;
+  for (int i = 0; i < 4; i++) ent.value[i] = uuid >> (24 - 8 * i);
+  return ent;
+}
+
+tUID_ENT uuid128(const Uuid& uuid) {
+  tUID_ENT ent = {};
+  ent.len = Uuid::kNumBytes128;
+  memcpy(ent.value, uuid.To128BitBE().data(), Uuid::kNumBytes128);
+  return ent;
+}
+
+tSDP_UUID_SEQ uuid_seq(std::vector<tUID_ENT> uuids) {
+  tSDP_UUID_SEQ seq = {};
+  for (const tUID_ENT& ent : uuids) seq.uuid_entry[seq.num_uids++] = ent;
+  return seq;
+}
+
+// Searches with the scan sdp_db_service_search falls back to when the index
+// overflows, which is the search from before the index.
+tSDP_RECORD* scan_search(tSDP_RECORD* p_rec, tSDP_UUID_SEQ* p_seq) {
+  tSDP_DB* p_db = &sdp_cb.server_db;
+  bool valid = p_db->uuid_index_valid;
+  bool overflow = p_db->uuid_index_overflow;
+
+  p_db->uuid_index_valid = true;
+  p_db->uuid_index_overflow = true;
+  p_rec = sdp_db_service_search(p_rec, p_seq);
+  p_db->uuid_index_valid = valid;
+  p_db->uuid_index_overflow = overflow;
+  return p_rec;
+}
+
+std::vector<uint32_t> search_all(tSDP_UUID_SEQ seq, bool scan) {
+  std::vector<uint32_t> handles;
+  tSDP_RECORD* p_rec = NULL;
+  while ((p_rec = scan ? scan_search(p_rec, &seq)
+                       : sdp_db_service_search(p_rec, &seq)) != NULL)
+    handles.push_back(p_rec->record_handle);
+  return handles;
+}
+
+tSDP_RECORD* linear_find_record(uint32_t handle) {
+  for (uint16_t xx = 0; xx < sdp_cb.server_db.num_records; xx++) {
+    if (sdp_cb.server_db.record[xx].record_handle == handle)
+      return &sdp_cb.server_db.record[xx];
+  }
+  return NULL;
+}
+
+tSDP_ATTRIBUTE* linear_find_attr(tSDP_RECORD* p_rec, uint16_t start_attr,
+                                 uint16_t end_attr) {
+  for (uint16_t xx = 0; xx < p_rec->num_attributes; xx++) {
+    tSDP_ATTRIBUTE* p_attr = &p_rec->attribute[xx];
+    if (p_attr->id >= start_attr && p_attr->id <= end_attr) return p_attr;
+  }
+  return NULL;
+}
+
+}  // namespace
+
+class SdpDbTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    memset(&sdp_cb, 0, sizeof(sdp_cb));
+
+    uint16_t source = UUID_SERVCLASS_AUDIO_SOURCE;
+    tSDP_PROTOCOL_ELEM avdtp[2] = {{UUID_PROTOCOL_L2CAP, 1, {BT_PSM_AVDTP}},
+                                   {UUID_PROTOCOL_AVDTP, 1, {0x0103}}};
+    source_ = SDP_CreateRecord();
+    SDP_AddServiceClassIdList(source_, 1, &source);
+    SDP_AddProtocolList(source_, 2, avdtp);
+
+    uint16_t sink = UUID_SERVCLASS_AUDIO_SINK;
+    sink_ = SDP_CreateRecord();
+    SDP_AddServiceClassIdList(sink_, 1, &sink);
+    SDP_AddProtocolList(sink_, 2, avdtp);
+
+    uint16_t serial = UUID_SERVCLASS_SERIAL_PORT;
+    tSDP_PROTOCOL_ELEM rfcomm[2] = {{UUID_PROTOCOL_L2CAP, 0, {}},
+                                    {UUID_PROTOCOL_RFCOMM, 1, {5}}};
+    serial_ = SDP_CreateRecord();
+    SDP_AddServiceClassIdList(serial_, 1, &serial);
+    SDP_AddProtocolList(serial_, 2, rfcomm);
+
+    custom_ = SDP_CreateRecord();
+    SDP_AddServiceClassIdListUuid128(custom_, (uint8_t*)kCustomUuid128);
+    tUID_ENT vendor = uuid32(kVendorUuid32);
+    SDP_AddAttribute(custom_, kExtraAttrId, UUID_DESC_TYPE, vendor.len,
+                     vendor.value);
+  }
+
+  // Checks the index against the scan, returning the matching handles
+  std::vector<uint32_t> Search(std::vector<tUID_ENT> uuids) {
+    std::vector<uint32_t> handles = search_all(uuid_seq(uuids), false);
+    EXPECT_EQ(handles, search_all(uuid_seq(uuids), true));
+    return handles;
+  }
+
+  void ExpectLookupsMatchScan() {
+    for (uint32_t handle = 0xffff; handle < 0x10000 + SDP_MAX_RECORDS;
+         handle++) {
+      tSDP_RECORD* p_rec = linear_find_record(handle);
+      EXPECT_EQ(sdp_db_find_record(handle), p_rec);
+      if (!p_rec) continue;
+      for (uint32_t start = 0; start <= 0x210; start += 4) {
+        for (uint32_t end = start; end <= start + 0x20; end += 3) {
+          EXPECT_EQ(sdp_db_find_attr_in_rec(p_rec, start, end),
+                    linear_find_attr(p_rec, start, end));
+        }
+      }
+    }
+  }
+
+  uint32_t source_, sink_, serial_, custom_;
+};
+
+TEST_F(SdpDbTest, uuid_forms_match) {
+  std::vector<uint32_t> source = {source_};
+  Uuid audio_source = Uuid::From16Bit(UUID_SERVCLASS_AUDIO_SOURCE);
+  EXPECT_EQ(Search({uuid16(UUID_SERVCLASS_AUDIO_SOURCE)}), source);
+  EXPECT_EQ(Search({uuid32(UUID_SERVCLASS_AUDIO_SOURCE)}), source);
+  EXPECT_EQ(Search({uuid128(audio_source)}), source);
+
+  std::vector<uint32_t> custom = {custom_};
+  EXPECT_EQ(Search({uuid32(kVendorUuid32)}), custom);
+  EXPECT_EQ(Search({uuid128(Uuid::From32Bit(kVendorUuid32))}), custom);
+  EXPECT_EQ(Search({uuid128(Uuid::From128BitBE(kCustomUuid128))}), custom);
+
+  EXPECT_TRUE(Search({uuid16(UUID_SERVCLASS_AUDIO_SOURCE + 0x100)}).empty());
+  EXPECT_TRUE(Search({uuid16(kVendorUuid32 & 0xffff)}).empty());
+}
+
+TEST_F(SdpDbTest, multiple_uuids_all_match) {
+  std::vector<uint32_t> avdtp = {source_, sink_};
+  EXPECT_EQ(Search({uuid16(UUID_PROTOCOL_L2CAP), uuid16(UUID_PROTOCOL_AVDTP)}),
+            avdtp);
+  std::vector<uint32_t> sink = {sink_};
+  EXPECT_EQ(Search({uuid16(UUID_PROTOCOL_AVDTP),
+                    uuid128(Uuid::From16Bit(UUID_SERVCLASS_AUDIO_SINK))}),
+            sink);
+  EXPECT_TRUE(Search({uuid16(UUID_SERVCLASS_AUDIO_SOURCE),
+                      uuid16(UUID_SERVCLASS_AUDIO_SINK)})
+                  .empty());
+
+  std::vector<uint32_t> l2cap = {source_, sink_, serial_};
+  EXPECT_EQ(Search({uuid16(UUID_PROTOCOL_L2CAP)}), l2cap);
+}
+
+TEST_F(SdpDbTest, empty_sequence_matches_every_record) {
+  std::vector<uint32_t> all = {source_, sink_, serial_, custom_};
+  EXPECT_EQ(Search({}), all);
+}
+
+TEST_F(SdpDbTest, delete_record) {
+  ASSERT_TRUE(SDP_DeleteRecord(source_));
+  std::vector<uint32_t> avdtp = {sink_};
+  EXPECT_EQ(Search({uuid16(UUID_PROTOCOL_AVDTP)}), avdtp);
+  EXPECT_TRUE(Search({uuid16(UUID_SERVCLASS_AUDIO_SOURCE)}).empty());
+  std::vector<uint32_t> custom = {custom_};
+  EXPECT_EQ(Search({uuid32(kVendorUuid32)}), custom);
+
+  EXPECT_EQ(sdp_db_find_record(source_), nullptr);
+  ExpectLookupsMatchScan();
+
+  // Handles keep increasing after a deletion
+  uint32_t handle = SDP_CreateRecord();
+  EXPECT_GT(handle, custom_);
+  EXPECT_EQ(sdp_db_find_record(handle)->record_handle, handle);
+  ExpectLookupsMatchScan();
+}
+
+TEST_F(SdpDbTest, add_and_delete_attributes) {
+  tUID_ENT vendor = uuid32(kVendorUuid32);
+  ASSERT_TRUE(SDP_AddAttribute(serial_, kExtraAttrId, UUID_DESC_TYPE,
+                               vendor.len, vendor.value));
+  std::vector<uint32_t> vendor_records = {serial_, custom_};
+  EXPECT_EQ(Search({uuid32(kVendorUuid32)}), vendor_records);
+  ExpectLookupsMatchScan();
+
+  ASSERT_TRUE(SDP_DeleteAttribute(custom_, kExtraAttrId));
+  std::vector<uint32_t> serial = {serial_};
+  EXPECT_EQ(Search({uuid32(kVendorUuid32)}), serial);
+  ExpectLookupsMatchScan();
+
+  // Replacing a value drops the UUID it held
+  uint16_t headset = UUID_SERVCLASS_HEADSET;
+  ASSERT_TRUE(SDP_AddServiceClassIdList(serial_, 1, &headset));
+  EXPECT_TRUE(Search({uuid16(UUID_SERVCLASS_SERIAL_PORT)}).empty());
+  EXPECT_EQ(Search({uuid16(UUID_SERVCLASS_HEADSET)}), serial);
+
+  ASSERT_TRUE(SDP_DeleteAttribute(serial_, ATTR_ID_PROTOCOL_DESC_LIST));
+  std::vector<uint32_t> l2cap = {source_, sink_};
+  EXPECT_EQ(Search({uuid16(UUID_PROTOCOL_L2CAP)}), l2cap);
+  ExpectLookupsMatchScan();
+}
+
+TEST_F(SdpDbTest, index_overflow_falls_back_to_scan) {
+  // Enough distinct UUIDs to overflow the index
+  std::vector<uint32_t> handles;
+  uint16_t next_uuid = 0x8000;
+  while (sdp_cb.server_db.num_records < SDP_MAX_RECORDS) {
+    uint16_t uuids[5];
+    for (uint16_t& uuid : uuids) uuid = next_uuid++;
+    handles.push_back(SDP_CreateRecord());
+    SDP_AddServiceClassIdList(handles.back(), 5, uuids);
+  }
+  ASSERT_GT(next_uuid - 0x8000, SDP_MAX_INDEXED_UUIDS);
+
+  std::vector<uint32_t> last = {handles.back()};
+  EXPECT_EQ(Search({uuid16(next_uuid - 1)}), last);
+  EXPECT_TRUE(sdp_cb.server_db.uuid_index_overflow);
+  std::vector<uint32_t> custom = {custom_};
+  EXPECT_EQ(Search({uuid128(Uuid::From128BitBE(kCustomUuid128))}), custom);
+
+  // Back under the limit the index is used again
+  while (handles.size() > 10) {
+    ASSERT_TRUE(SDP_DeleteRecord(handles.back()));
+    handles.pop_back();
+  }
+  std::vector<uint32_t> first = {handles.front()};
+  EXPECT_EQ(Search({uuid16(0x8000)}), first);
+  EXPECT_FALSE(sdp_cb.server_db.uuid_index_overflow);
+  EXPECT_TRUE(Search({uuid16(next_uuid - 1)}).empty());
+  ExpectLookupsMatchScan();
+}